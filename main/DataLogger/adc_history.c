@@ -0,0 +1,245 @@
+#include "adc_history.h"
+#include "stream_frame.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static const char* TAG = "ADC_HISTORY";
+
+// History State
+typedef struct {
+    bool initialized;
+    int16_t (*rows)[CONFIG_ADC_CHANNEL_COUNT];  // Period p at rows[p % ADC_HISTORY_ROWS]
+    uint32_t newest;            // Newest committed period
+    uint32_t periods;           // Committed periods in the ring, up to ADC_HISTORY_ROWS
+    SemaphoreHandle_t mutex;    // Guards rows, newest and periods
+
+    // Open period (sampling task only)
+    bool open_active;
+    uint32_t open;
+    float sum[CONFIG_ADC_CHANNEL_COUNT];
+    uint32_t samples[CONFIG_ADC_CHANNEL_COUNT];
+} adc_history_state_t;
+
+static adc_history_state_t g_history = {0};
+
+typedef struct {
+    const int16_t* ring;
+    uint32_t rows;
+    uint32_t stride;
+} ring_view_t;
+
+static inline int16_t value_at(const ring_view_t* view, uint32_t period) {
+    return view->ring[(period % view->rows) * view->stride];
+}
+
+esp_err_t adc_history_init(void) {
+    if (g_history.initialized) {
+        return ESP_OK;
+    }
+
+    g_history.mutex = xSemaphoreCreateMutex();
+    g_history.rows = malloc(ADC_HISTORY_ROWS * sizeof(*g_history.rows));
+    if (!g_history.mutex || !g_history.rows) {
+        if (g_history.mutex) {
+            vSemaphoreDelete(g_history.mutex);
+            g_history.mutex = NULL;
+        }
+        free(g_history.rows);
+        g_history.rows = NULL;
+        ESP_LOGE(TAG, "Failed to allocate %d s of history", CONFIG_ADC_HISTORY_SECONDS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    g_history.periods = 0;
+    g_history.open_active = false;
+    g_history.initialized = true;
+    ESP_LOGI(TAG, "History ready: %d s at %d Hz (%u bytes)", CONFIG_ADC_HISTORY_SECONDS,
+             CONFIG_ADC_HISTORY_RATE_HZ, (unsigned)(ADC_HISTORY_ROWS * sizeof(*g_history.rows)));
+    return ESP_OK;
+}
+
+// Close the open period; the periods between it and next had no samples
+static void commit_period(uint32_t next) {
+    int16_t row[CONFIG_ADC_CHANNEL_COUNT];
+    for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+        row[ch] = ADC_HISTORY_MISSING;
+        if (g_history.samples[ch] > 0) {
+            int16_t millivolts = stream_frame_millivolts(g_history.sum[ch] / g_history.samples[ch]);
+            row[ch] = (millivolts == ADC_HISTORY_MISSING) ? ADC_HISTORY_MISSING + 1 : millivolts;
+        }
+    }
+
+    uint32_t gap = next - g_history.open - 1;
+    if (gap > ADC_HISTORY_ROWS) {
+        gap = ADC_HISTORY_ROWS;
+    }
+
+    xSemaphoreTake(g_history.mutex, portMAX_DELAY);
+    memcpy(g_history.rows[g_history.open % ADC_HISTORY_ROWS], row, sizeof(row));
+    for (uint32_t period = next - gap; period != next; period++) {
+        for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+            g_history.rows[period % ADC_HISTORY_ROWS][ch] = ADC_HISTORY_MISSING;
+        }
+    }
+    g_history.newest = next - 1;
+    g_history.periods += 1 + gap;
+    if (g_history.periods > ADC_HISTORY_ROWS) {
+        g_history.periods = ADC_HISTORY_ROWS;
+    }
+    xSemaphoreGive(g_history.mutex);
+}
+
+void adc_history_add(const adc_data_packet_t* packet) {
+    if (!g_history.initialized || packet->channel >= CONFIG_ADC_CHANNEL_COUNT) {
+        return;
+    }
+
+    uint32_t period = packet->timestamp_us / ADC_HISTORY_PERIOD_US;
+    if (g_history.open_active && period != g_history.open) {
+        if (period < g_history.open) {
+            return;
+        }
+        commit_period(period);
+        g_history.open_active = false;
+    }
+
+    if (!g_history.open_active) {
+        g_history.open = period;
+        g_history.open_active = true;
+        memset(g_history.sum, 0, sizeof(g_history.sum));
+        memset(g_history.samples, 0, sizeof(g_history.samples));
+    }
+
+    g_history.sum[packet->channel] += packet->filtered_voltage;
+    g_history.samples[packet->channel]++;
+}
+
+// Largest-Triangle-Three-Buckets in one sweep. The first and last periods
+// with data are kept; the periods between are split into points - 2
+// buckets, and each bucket keeps the period forming the largest triangle
+// with the point kept before it and the average of the next bucket.
+uint32_t adc_history_downsample(const int16_t* ring, uint32_t ring_rows, uint32_t stride,
+                                uint32_t first, uint32_t last, uint32_t points,
+                                adc_history_point_t* out) {
+    const ring_view_t view = { .ring = ring, .rows = ring_rows, .stride = stride };
+
+    while (first < last && value_at(&view, first) == ADC_HISTORY_MISSING) {
+        first++;
+    }
+    while (last > first && value_at(&view, last) == ADC_HISTORY_MISSING) {
+        last--;
+    }
+    if (first > last || value_at(&view, first) == ADC_HISTORY_MISSING || points < 3) {
+        return 0;
+    }
+
+    uint32_t count = 0;
+    if (last - first < points) {
+        for (uint32_t period = first; period <= last; period++) {
+            int16_t value = value_at(&view, period);
+            if (value != ADC_HISTORY_MISSING) {
+                out[count++] = (adc_history_point_t){ .period = period, .millivolts = value };
+            }
+        }
+        return count;
+    }
+
+    // x is the period relative to first, so floats keep their precision
+    const uint32_t buckets = points - 2;
+    const uint64_t span = last - first - 1;
+    const float last_x = last - first;
+    const float last_y = value_at(&view, last);
+
+    out[count++] = (adc_history_point_t){ .period = first, .millivolts = value_at(&view, first) };
+    float ax = 0.0f;
+    float ay = out[0].millivolts;
+
+    uint32_t start = first + 1;
+    for (uint32_t bucket = 0; bucket < buckets; bucket++) {
+        uint32_t end = first + 1 + (uint32_t)(span * (bucket + 1) / buckets);
+
+        // Next bucket average; after the last bucket (or over a gap) the last point
+        float cx = last_x;
+        float cy = last_y;
+        if (bucket + 1 < buckets) {
+            uint32_t next_end = first + 1 + (uint32_t)(span * (bucket + 2) / buckets);
+            float sum_x = 0.0f;
+            float sum_y = 0.0f;
+            uint32_t n = 0;
+            for (uint32_t period = end; period < next_end; period++) {
+                int16_t value = value_at(&view, period);
+                if (value != ADC_HISTORY_MISSING) {
+                    sum_x += period - first;
+                    sum_y += value;
+                    n++;
+                }
+            }
+            if (n > 0) {
+                cx = sum_x / n;
+                cy = sum_y / n;
+            }
+        }
+
+        float best_area = -1.0f;
+        adc_history_point_t best = {0};
+        for (uint32_t period = start; period < end; period++) {
+            int16_t value = value_at(&view, period);
+            if (value == ADC_HISTORY_MISSING) {
+                continue;
+            }
+            float bx = period - first;
+            float area = fabsf((ax - cx) * (value - ay) - (ax - bx) * (cy - ay));
+            if (area > best_area) {
+                best_area = area;
+                best = (adc_history_point_t){ .period = period, .millivolts = value };
+            }
+        }
+
+        // A bucket inside a gap adds no point
+        if (best_area >= 0.0f) {
+            out[count++] = best;
+            ax = best.period - first;
+            ay = best.millivolts;
+        }
+        start = end;
+    }
+
+    out[count++] = (adc_history_point_t){ .period = last, .millivolts = value_at(&view, last) };
+    return count;
+}
+
+// Periods from from_us to the newest, downsampled to at most points
+esp_err_t adc_history_query(uint8_t channel, uint64_t from_us, uint32_t points,
+                            adc_history_point_t* out, uint32_t* count) {
+    *count = 0;
+    if (!g_history.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (channel >= CONFIG_ADC_CHANNEL_COUNT || points < 3 || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (points > ADC_HISTORY_MAX_POINTS) {
+        points = ADC_HISTORY_MAX_POINTS;
+    }
+
+    xSemaphoreTake(g_history.mutex, portMAX_DELAY);
+    if (g_history.periods > 0) {
+        uint32_t first = g_history.newest - g_history.periods + 1;
+        uint64_t from_period = from_us / ADC_HISTORY_PERIOD_US;
+        if (from_period > first) {
+            first = (from_period > g_history.newest) ? g_history.newest + 1 : (uint32_t)from_period;
+        }
+        if (first <= g_history.newest) {
+            *count = adc_history_downsample(&g_history.rows[0][channel], ADC_HISTORY_ROWS,
+                                            CONFIG_ADC_CHANNEL_COUNT, first, g_history.newest,
+                                            points, out);
+        }
+    }
+    xSemaphoreGive(g_history.mutex);
+
+    return ESP_OK;
+}
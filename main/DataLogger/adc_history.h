@@ -0,0 +1,52 @@
+#pragma once
+
+#include "esp_err.h"
+#include "adc_manager.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Recent ADC history in RAM, so a viewer can draw the last minutes in one
+// request instead of polling samples one by one. The sampling task feeds
+// every sample in; samples are averaged into fixed periods of
+// ADC_HISTORY_PERIOD_US and the ring keeps one row of millivolts per
+// period for all channels, the newest CONFIG_ADC_HISTORY_SECONDS of them.
+// A period without samples of a channel (channel disabled, sampling
+// stopped) is kept as ADC_HISTORY_MISSING and skipped by queries.
+//
+// Queries downsample on the device with Largest-Triangle-Three-Buckets:
+// the range is split into one bucket per output point and each bucket
+// keeps the period that spans the largest triangle with the points picked
+// around it, so spikes survive where averaging would flatten them.
+
+// History Configuration
+#define ADC_HISTORY_PERIOD_US       (1000000 / CONFIG_ADC_HISTORY_RATE_HZ)
+#define ADC_HISTORY_ROWS            (CONFIG_ADC_HISTORY_RATE_HZ * CONFIG_ADC_HISTORY_SECONDS)
+#define ADC_HISTORY_MAX_POINTS      2000   // Per query
+#define ADC_HISTORY_MISSING         INT16_MIN
+
+// Query result point
+typedef struct {
+    uint32_t period;            // Period number, starts at period * ADC_HISTORY_PERIOD_US
+    int16_t millivolts;         // Mean over the period
+} adc_history_point_t;
+
+// History Functions (add is called by the sampling task only)
+esp_err_t adc_history_init(void);
+void adc_history_add(const adc_data_packet_t* packet);
+esp_err_t adc_history_query(uint8_t channel, uint64_t from_us, uint32_t points,
+                            adc_history_point_t* out, uint32_t* count);
+
+// Downsample periods first..last of ring (period p at ring[(p % ring_rows) * stride])
+// to at most points (3 or more) points. Returns the number written to out.
+uint32_t adc_history_downsample(const int16_t* ring, uint32_t ring_rows, uint32_t stride,
+                                uint32_t first, uint32_t last, uint32_t points,
+                                adc_history_point_t* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,11 +1,14 @@
 #include "adc_manager.h"
+#include "adc_history.h"
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "hal.h"
 #include "config.h"
+#include "stats_snapshot.h"
 #include <string.h>
 #include <math.h>
 
@@ -18,14 +21,116 @@ typedef struct {
     adc_channel_context_t channels[CONFIG_ADC_CHANNEL_COUNT];
     TaskHandle_t sampling_task;
     QueueHandle_t data_queue;
+    QueueHandle_t stream_queue;     // Live streaming tap, so streaming never takes samples from logging
+    uint32_t stream_dropped;
+    QueueHandle_t command_queue;    // Reconfigurations, taken by the sampling task between scans
+    SemaphoreHandle_t apply_lock;   // One reconfiguration in flight at a time
+    SemaphoreHandle_t applied;      // Given by the sampling task after each command
+    uint32_t generation;            // Last command queued
+    volatile uint32_t applied_generation; // Last command the sampling task finished
+    esp_err_t apply_result;         // Outcome of that command
 } adc_manager_state_t;
 
+// Reconfiguration of the channels in channel_mask
+typedef struct {
+    uint32_t generation;
+    uint8_t channel_mask;
+    adc_channel_settings_t settings[CONFIG_ADC_CHANNEL_COUNT];
+} adc_command_t;
+
 static adc_manager_state_t g_adc_manager = {0};
 
+static uint32_t sample_period_us(uint16_t sample_rate_hz) {
+    return 1000000UL / (sample_rate_hz ? sample_rate_hz : ADC_MIN_SAMPLE_RATE);
+}
+
+// The fastest enabled channel sets the scan period; slower channels are
+// sampled on the scans that reach their own deadline
+static uint32_t scan_period_ms(void) {
+    uint32_t period_ms = ADC_MAX_SCAN_PERIOD_MS;
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        const adc_channel_settings_t* settings = &g_adc_manager.channels[i].settings;
+        if (settings->enabled && sample_period_us(settings->sample_rate_hz) / 1000 < period_ms) {
+            period_ms = sample_period_us(settings->sample_rate_hz) / 1000;
+        }
+    }
+
+    // Ensure minimum delay to prevent watchdog timeout
+    if (period_ms < ADC_MIN_SCAN_PERIOD_MS) {
+        period_ms = ADC_MIN_SCAN_PERIOD_MS;
+    }
+    return period_ms;
+}
+
+// Takes effect between two scans. Only this channel's schedule moves: a
+// new rate counts from its last deadline, a newly enabled channel is due
+// at once, and every other channel keeps its deadline.
+static esp_err_t apply_channel_settings(adc_channel_context_t* channel, const adc_channel_settings_t* settings,
+                                        uint64_t now) {
+    if (settings->enabled && !hal_adc_is_initialized(channel->channel)) {
+        esp_err_t ret = hal_adc_init(channel->channel);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "ADC%d enable failed: %s", channel->channel, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    if (settings->enabled && !channel->settings.enabled) {
+        channel->filter_initialized = false;
+        channel->next_sample_us = now;
+    } else if (settings->sample_rate_hz != channel->settings.sample_rate_hz) {
+        uint32_t old_period_us = sample_period_us(channel->settings.sample_rate_hz);
+        uint64_t last_due = channel->next_sample_us > old_period_us ? channel->next_sample_us - old_period_us : 0;
+        channel->next_sample_us = last_due + sample_period_us(settings->sample_rate_hz);
+    }
+
+    channel->settings = *settings;
+    ESP_LOGI(TAG, "ADC%d %s at %d Hz, filter alpha %.3f", channel->channel,
+             settings->enabled ? "enabled" : "disabled", settings->sample_rate_hz, settings->filter_alpha);
+    return ESP_OK;
+}
+
+// Runs on the sampling task outside a scan, so no channel is mid-sample
+static void apply_command(const adc_command_t* command, uint64_t now) {
+    esp_err_t result = ESP_OK;
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        if (command->channel_mask & (1 << i)) {
+            esp_err_t ret = apply_channel_settings(&g_adc_manager.channels[i], &command->settings[i], now);
+            if (ret != ESP_OK) {
+                result = ret;
+            }
+        }
+    }
+
+    g_adc_manager.apply_result = result;
+    g_adc_manager.applied_generation = command->generation;
+    xSemaphoreGive(g_adc_manager.applied);
+}
+
+// Sleep until the next scan is due. A command wakes the task and is applied
+// at once, and the wait is then measured against the period it leaves, so
+// a slow or idle scan never delays a reconfiguration.
+static void wait_for_next_scan(TickType_t* last_wake_time) {
+    for (;;) {
+        TickType_t next_wake = *last_wake_time + pdMS_TO_TICKS(scan_period_ms());
+        TickType_t wait = next_wake - xTaskGetTickCount();
+
+        // Due, or overdue (the difference wrapped): scan now, keep the cadence
+        if (wait == 0 || wait > pdMS_TO_TICKS(ADC_MAX_SCAN_PERIOD_MS)) {
+            *last_wake_time = next_wake;
+            return;
+        }
+
+        adc_command_t command;
+        if (xQueueReceive(g_adc_manager.command_queue, &command, wait) == pdTRUE) {
+            apply_command(&command, esp_timer_get_time());
+        }
+    }
+}
+
 // Moving average filter implementation
 static float apply_moving_average(adc_channel_context_t* channel, float new_value) {
-    system_config_t* config = config_get_instance();
-    float alpha = config->adc_config[channel->channel].filter_alpha;
+    float alpha = channel->settings.filter_alpha;
 
     if (channel->filter_initialized) {
         channel->filtered_value = alpha * new_value + (1.0f - alpha) * channel->filtered_value;
@@ -41,15 +146,17 @@ static float apply_moving_average(adc_channel_context_t* channel, float new_valu
 static void adc_sampling_task(void* pvParameters) {
     ESP_LOGI(TAG, "ADC sampling task started, running=%d", g_adc_manager.running);
 
-    system_config_t* config = config_get_instance();
     TickType_t last_wake_time = xTaskGetTickCount();
+    uint64_t start_time = esp_timer_get_time();
 
     // Debug: Check enabled channels at startup
     int enabled_count = 0;
     for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
-        if (config->adc_config[i].enabled) {
+        adc_channel_context_t* channel = &g_adc_manager.channels[i];
+        channel->next_sample_us = start_time;
+        if (channel->settings.enabled) {
             enabled_count++;
-            ESP_LOGI(TAG, "ADC%d enabled at %d Hz", i, config->adc_config[i].sample_rate_hz);
+            ESP_LOGI(TAG, "ADC%d enabled at %d Hz", i, channel->settings.sample_rate_hz);
         }
     }
     ESP_LOGI(TAG, "Found %d enabled ADC channels", enabled_count);
@@ -60,13 +167,22 @@ static void adc_sampling_task(void* pvParameters) {
     while (g_adc_manager.running) {
         uint64_t timestamp = esp_timer_get_time();
 
-        // Sample all enabled channels
+        // A channel is due on the scan nearest its deadline
+        uint32_t period_ms = scan_period_ms();
+        uint64_t due_before = timestamp + period_ms * 1000ULL / 2;
+
+        // Sample all enabled channels that are due
         for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
-            if (!config->adc_config[i].enabled) {
+            adc_channel_context_t* channel = &g_adc_manager.channels[i];
+            if (!channel->settings.enabled || channel->next_sample_us > due_before) {
                 continue;
             }
 
-            adc_channel_context_t* channel = &g_adc_manager.channels[i];
+            // Next deadline; one that has fallen behind restarts from now
+            channel->next_sample_us += sample_period_us(channel->settings.sample_rate_hz);
+            if (channel->next_sample_us <= timestamp) {
+                channel->next_sample_us = timestamp + sample_period_us(channel->settings.sample_rate_hz);
+            }
 
             // Read raw ADC value once
             int raw_value;
@@ -91,6 +207,13 @@ static void adc_sampling_task(void* pvParameters) {
                         .sequence = channel->sequence_number++
                     };
 
+                    // Streaming gets its own copy; a lagging stream only loses its own samples
+                    if (xQueueSend(g_adc_manager.stream_queue, &packet, 0) != pdTRUE) {
+                        g_adc_manager.stream_dropped++;
+                    }
+
+                    adc_history_add(&packet);
+
                     // Send to queue (non-blocking) - drop samples if queue full to prevent blocking
                     if (xQueueSend(g_adc_manager.data_queue, &packet, 0) != pdTRUE) {
                         channel->stats.dropped_samples++;
@@ -134,16 +257,8 @@ static void adc_sampling_task(void* pvParameters) {
         // Yield to other tasks immediately after processing all channels
         taskYIELD();
 
-        // Calculate delay for desired sample rate and yield to other tasks
-        uint16_t sample_rate = config->adc_config[0].sample_rate_hz;  // Use first channel's rate
-        TickType_t delay_ticks = pdMS_TO_TICKS(1000 / sample_rate);
-
-        // Ensure minimum delay to prevent watchdog timeout
-        if (delay_ticks < pdMS_TO_TICKS(10)) {
-            delay_ticks = pdMS_TO_TICKS(10);  // Minimum 10ms delay
-        }
-
-        vTaskDelayUntil(&last_wake_time, delay_ticks);
+        // Wait for the next scan at the fastest enabled rate
+        wait_for_next_scan(&last_wake_time);
     }
 
     ESP_LOGI(TAG, "ADC sampling task stopped");
@@ -165,6 +280,27 @@ esp_err_t adc_manager_init(void) {
         return ESP_ERR_NO_MEM;
     }
 
+    g_adc_manager.stream_queue = xQueueCreate(ADC_STREAM_QUEUE_SIZE, sizeof(adc_data_packet_t));
+    if (!g_adc_manager.stream_queue) {
+        ESP_LOGE(TAG, "Failed to create ADC stream queue");
+        vQueueDelete(g_adc_manager.data_queue);
+        g_adc_manager.data_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    g_adc_manager.command_queue = xQueueCreate(ADC_COMMAND_QUEUE_SIZE, sizeof(adc_command_t));
+    g_adc_manager.apply_lock = xSemaphoreCreateMutex();
+    g_adc_manager.applied = xSemaphoreCreateBinary();
+    if (!g_adc_manager.command_queue || !g_adc_manager.apply_lock || !g_adc_manager.applied) {
+        ESP_LOGE(TAG, "Failed to create ADC command queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // History outlives restarts of the manager; without it only /api/data/history is lost
+    if (adc_history_init() != ESP_OK) {
+        ESP_LOGW(TAG, "ADC history unavailable");
+    }
+
     // Initialize channel contexts
     system_config_t* config = config_get_instance();
 
@@ -178,6 +314,11 @@ esp_err_t adc_manager_init(void) {
         channel->last_sample_time = 0;
         memset(&channel->stats, 0, sizeof(adc_stats_t));
 
+        channel->settings.enabled = config->adc_config[i].enabled;
+        channel->settings.sample_rate_hz = config->adc_config[i].sample_rate_hz;
+        channel->settings.filter_alpha = config->adc_config[i].filter_alpha;
+        channel->next_sample_us = 0;
+
         if (config->adc_config[i].enabled) {
             ESP_LOGI(TAG, "ADC%d configured: %d Hz sample rate",
                     i, config->adc_config[i].sample_rate_hz);
@@ -202,6 +343,9 @@ esp_err_t adc_manager_start(void) {
 
     ESP_LOGI(TAG, "Starting ADC Manager");
 
+    // Commands left by an apply that timed out would be stale now
+    xQueueReset(g_adc_manager.command_queue);
+
     // Set running flag BEFORE creating task to avoid race condition
     g_adc_manager.running = true;
 
@@ -254,13 +398,29 @@ esp_err_t adc_manager_get_data(adc_data_packet_t* packet, uint32_t timeout_ms) {
     return ESP_ERR_TIMEOUT;
 }
 
+esp_err_t adc_manager_get_stream_data(adc_data_packet_t* packet, uint32_t timeout_ms) {
+    if (!packet) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_adc_manager.stream_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xQueueReceive(g_adc_manager.stream_queue, packet, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) {
+        return ESP_OK;
+    }
+
+    return ESP_ERR_TIMEOUT;
+}
+
 esp_err_t adc_manager_get_stats(uint8_t channel, adc_stats_t* stats) {
     if (channel >= CONFIG_ADC_CHANNEL_COUNT || !stats) {
         return ESP_ERR_INVALID_ARG;
     }
 
     adc_channel_context_t* ch = &g_adc_manager.channels[channel];
-    memcpy(stats, &ch->stats, sizeof(adc_stats_t));
+    stats_snapshot(stats, &ch->stats, sizeof(adc_stats_t));
 
     return ESP_OK;
 }
@@ -268,13 +428,14 @@ esp_err_t adc_manager_get_stats(uint8_t channel, adc_stats_t* stats) {
 esp_err_t adc_manager_print_stats(void) {
     ESP_LOGI(TAG, "=== ADC Manager Statistics ===");
 
-    system_config_t* config = config_get_instance();
-
     for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
         adc_channel_context_t* channel = &g_adc_manager.channels[i];
 
-        ESP_LOGI(TAG, "ADC%d: %s", i, config->adc_config[i].enabled ? "Enabled" : "Disabled");
-        if (config->adc_config[i].enabled) {
+        ESP_LOGI(TAG, "ADC%d: %s", i, channel->settings.enabled ? "Enabled" : "Disabled");
+        if (channel->settings.enabled) {
+            ESP_LOGI(TAG, "  Rate: %d Hz, Filter alpha: %.3f",
+                    channel->settings.sample_rate_hz,
+                    channel->settings.filter_alpha);
             ESP_LOGI(TAG, "  Samples: %lu, Dropped: %lu, Errors: %lu",
                     channel->stats.total_samples,
                     channel->stats.dropped_samples,
@@ -286,6 +447,8 @@ esp_err_t adc_manager_print_stats(void) {
                     channel->stats.avg_voltage);
         }
     }
+    ESP_LOGI(TAG, "Stream tap: %lu samples dropped (no streaming client or client behind)",
+             g_adc_manager.stream_dropped);
 
     return ESP_OK;
 }
@@ -307,8 +470,145 @@ bool adc_manager_is_channel_enabled(uint8_t channel) {
         return false;
     }
 
-    system_config_t* config = config_get_instance();
-    return config->adc_config[channel].enabled;
+    return g_adc_manager.channels[channel].settings.enabled;
+}
+
+esp_err_t adc_manager_validate_settings(const adc_channel_settings_t* settings) {
+    if (!settings) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (settings->sample_rate_hz < ADC_MIN_SAMPLE_RATE || settings->sample_rate_hz > ADC_MAX_SAMPLE_RATE ||
+        !CONFIG_VALIDATE_FILTER_ALPHA(settings->filter_alpha)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t adc_manager_apply_settings(uint8_t channel_mask,
+                                     const adc_channel_settings_t settings[CONFIG_ADC_CHANNEL_COUNT]) {
+    if (!settings || channel_mask >= (1 << CONFIG_ADC_CHANNEL_COUNT)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_adc_manager.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // All or nothing: one bad channel rejects the whole set
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        if ((channel_mask & (1 << i)) && adc_manager_validate_settings(&settings[i]) != ESP_OK) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    if (channel_mask == 0) {
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(g_adc_manager.apply_lock, portMAX_DELAY);
+
+    esp_err_t result = ESP_OK;
+    if (!g_adc_manager.running) {
+        // No sampling task to race with
+        uint64_t now = esp_timer_get_time();
+        for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+            if (channel_mask & (1 << i)) {
+                esp_err_t ret = apply_channel_settings(&g_adc_manager.channels[i], &settings[i], now);
+                if (ret != ESP_OK) {
+                    result = ret;
+                }
+            }
+        }
+    } else {
+        adc_command_t command = {
+            .generation = ++g_adc_manager.generation,
+            .channel_mask = channel_mask
+        };
+        memcpy(command.settings, settings, sizeof(command.settings));
+
+        // A give left over from a command that timed out is not ours
+        xSemaphoreTake(g_adc_manager.applied, 0);
+
+        result = ESP_ERR_TIMEOUT;
+        if (xQueueSend(g_adc_manager.command_queue, &command, pdMS_TO_TICKS(ADC_APPLY_TIMEOUT_MS)) == pdTRUE) {
+            while (xSemaphoreTake(g_adc_manager.applied, pdMS_TO_TICKS(ADC_APPLY_TIMEOUT_MS)) == pdTRUE) {
+                if (g_adc_manager.applied_generation == command.generation) {
+                    result = g_adc_manager.apply_result;
+                    break;
+                }
+            }
+        }
+
+        if (result == ESP_ERR_TIMEOUT) {
+            ESP_LOGW(TAG, "Sampling task did not take ADC reconfiguration %lu", command.generation);
+        }
+    }
+
+    xSemaphoreGive(g_adc_manager.apply_lock);
+    return result;
+}
+
+esp_err_t adc_manager_get_settings(uint8_t channel, adc_channel_settings_t* settings) {
+    if (channel >= CONFIG_ADC_CHANNEL_COUNT || !settings) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *settings = g_adc_manager.channels[channel].settings;
+    return ESP_OK;
+}
+
+// Single-channel changes go through the same command as a full set
+static esp_err_t apply_single_channel(uint8_t channel, const adc_channel_settings_t* settings) {
+    adc_channel_settings_t all[CONFIG_ADC_CHANNEL_COUNT] = {0};
+    all[channel] = *settings;
+    return adc_manager_apply_settings(1 << channel, all);
+}
+
+esp_err_t adc_manager_enable_channel(uint8_t channel, bool enable) {
+    adc_channel_settings_t settings;
+    esp_err_t ret = adc_manager_get_settings(channel, &settings);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    settings.enabled = enable;
+    return apply_single_channel(channel, &settings);
+}
+
+esp_err_t adc_manager_set_sample_rate(uint8_t channel, uint16_t sample_rate_hz) {
+    adc_channel_settings_t settings;
+    esp_err_t ret = adc_manager_get_settings(channel, &settings);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    settings.sample_rate_hz = sample_rate_hz;
+    return apply_single_channel(channel, &settings);
+}
+
+esp_err_t adc_manager_set_filter_alpha(uint8_t channel, float alpha) {
+    adc_channel_settings_t settings;
+    esp_err_t ret = adc_manager_get_settings(channel, &settings);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    settings.filter_alpha = alpha;
+    return apply_single_channel(channel, &settings);
+}
+
+esp_err_t adc_manager_reconfigure_channel(uint8_t channel, uint16_t sample_rate, float filter_alpha) {
+    adc_channel_settings_t settings;
+    esp_err_t ret = adc_manager_get_settings(channel, &settings);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    settings.sample_rate_hz = sample_rate;
+    settings.filter_alpha = filter_alpha;
+    return apply_single_channel(channel, &settings);
 }
 
 size_t adc_manager_get_available_data(void) {
@@ -334,6 +634,22 @@ esp_err_t adc_manager_deinit(void) {
         vQueueDelete(g_adc_manager.data_queue);
         g_adc_manager.data_queue = NULL;
     }
+    if (g_adc_manager.stream_queue) {
+        vQueueDelete(g_adc_manager.stream_queue);
+        g_adc_manager.stream_queue = NULL;
+    }
+    if (g_adc_manager.command_queue) {
+        vQueueDelete(g_adc_manager.command_queue);
+        g_adc_manager.command_queue = NULL;
+    }
+    if (g_adc_manager.apply_lock) {
+        vSemaphoreDelete(g_adc_manager.apply_lock);
+        g_adc_manager.apply_lock = NULL;
+    }
+    if (g_adc_manager.applied) {
+        vSemaphoreDelete(g_adc_manager.applied);
+        g_adc_manager.applied = NULL;
+    }
 
     // Clean up channel contexts
     memset(&g_adc_manager.channels, 0, sizeof(g_adc_manager.channels));
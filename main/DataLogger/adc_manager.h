@@ -13,8 +13,13 @@ extern "C" {
 
 // ADC Manager Configuration - OPTIMIZED FOR MATCHED RATES
 #define ADC_QUEUE_SIZE              10     // Smaller queue since rates are matched
+#define ADC_STREAM_QUEUE_SIZE       64     // Copy of every sample for live streaming
 #define ADC_MAX_SAMPLE_RATE         10000  // 10kHz maximum
 #define ADC_MIN_SAMPLE_RATE         1      // 1Hz minimum
+#define ADC_MIN_SCAN_PERIOD_MS      10     // Fastest scan the sampling task runs
+#define ADC_MAX_SCAN_PERIOD_MS      1000   // Scan period with no channel enabled
+#define ADC_COMMAND_QUEUE_SIZE      4      // Pending reconfigurations
+#define ADC_APPLY_TIMEOUT_MS        500    // Wait for the sampling task to take a change
 
 // ADC Data Packet Structure
 typedef struct {
@@ -37,9 +42,18 @@ typedef struct {
     uint64_t last_sample_time;  // Timestamp of last sample
 } adc_stats_t;
 
+// Runtime settings of one channel, owned by the sampling task
+typedef struct {
+    bool enabled;               // Channel sampled
+    uint16_t sample_rate_hz;    // Samples per second
+    float filter_alpha;         // Moving average weight of a new sample (0-1]
+} adc_channel_settings_t;
+
 // ADC Channel Context
 typedef struct {
     uint8_t channel;            // Channel number
+    adc_channel_settings_t settings; // Settings in effect
+    uint64_t next_sample_us;    // When this channel is due again
     uint32_t sequence_number;   // Current sequence number
     bool filter_initialized;    // Filter initialization flag
     float filtered_value;       // Current filtered value
@@ -55,6 +69,7 @@ esp_err_t adc_manager_stop(void);
 
 // Data Access
 esp_err_t adc_manager_get_data(adc_data_packet_t* packet, uint32_t timeout_ms);
+esp_err_t adc_manager_get_stream_data(adc_data_packet_t* packet, uint32_t timeout_ms);
 size_t adc_manager_get_available_data(void);
 esp_err_t adc_manager_flush_data(void);
 
@@ -74,6 +89,14 @@ esp_err_t adc_manager_test_channel(uint8_t channel);
 esp_err_t adc_manager_get_instant_reading(uint8_t channel, float* voltage);
 
 // Configuration
+// Changes reach the sampling task through a command queue and take effect
+// between two scans; channels outside channel_mask keep their schedule.
+// Returns once the task has applied them, or applies them directly when
+// the manager is not running.
+esp_err_t adc_manager_validate_settings(const adc_channel_settings_t* settings);
+esp_err_t adc_manager_apply_settings(uint8_t channel_mask,
+                                     const adc_channel_settings_t settings[CONFIG_ADC_CHANNEL_COUNT]);
+esp_err_t adc_manager_get_settings(uint8_t channel, adc_channel_settings_t* settings);
 esp_err_t adc_manager_reconfigure_channel(uint8_t channel, uint16_t sample_rate, float filter_alpha);
 bool adc_manager_is_running(void);
 bool adc_manager_is_channel_enabled(uint8_t channel);
@@ -6,14 +6,72 @@
 #include "cJSON.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 static const char* TAG = "CONFIG";
 static system_config_t g_system_config;
 static bool g_config_initialized = false;
 
 #define NVS_NAMESPACE "datalogger"
+#define NVS_VERSION_KEY "config_ver"
 #define CONFIG_FILE_PATH CONFIG_SD_MOUNT_POINT "/config.json"
 
+// Layout 1, saved by firmware before CONFIG_LAYOUT_VERSION existed (and
+// without a version key). Only migrated from, never written.
+typedef struct {
+    char device_name[CONFIG_MAX_DEVICE_NAME_LEN];
+    uint32_t device_id;
+    struct {
+        bool enabled;
+        uint32_t baud_rate;
+        uint8_t data_bits;
+        uint8_t stop_bits;
+        uint8_t parity;
+        bool flow_control;
+    } uart_config[CONFIG_UART_PORT_COUNT];
+    struct {
+        bool enabled;
+        uint16_t sample_rate_hz;
+        float voltage_scale;
+        float filter_alpha;
+        uint8_t attenuation;
+    } adc_config[CONFIG_ADC_CHANNEL_COUNT];
+    struct {
+        char ssid[CONFIG_MAX_WIFI_SSID_LEN];
+        char password[CONFIG_MAX_WIFI_PASSWORD_LEN];
+        bool auto_connect;
+        int8_t power_save_mode;
+    } wifi_config;
+    struct {
+        bool auto_start;
+        uint32_t max_file_size_mb;
+        uint32_t buffer_flush_interval_ms;
+        bool compress_files;
+        uint8_t retention_days;
+    } storage_config;
+    struct {
+        bool enabled;
+        uint8_t brightness;
+        uint32_t refresh_rate_ms;
+        uint32_t auto_sleep_sec;
+        uint8_t display_mode;
+    } display_config;
+    struct {
+        uint16_t http_port;
+        uint16_t websocket_port;
+        uint8_t max_clients;
+        bool enable_cors;
+        bool require_auth;
+        char auth_token[64];
+    } network_config;
+    struct {
+        uint8_t log_level;
+        bool enable_watchdog;
+        uint32_t task_stack_size;
+        uint8_t task_priority;
+    } system_config;
+} system_config_v1_t;
+
 esp_err_t config_init(void) {
     if (g_config_initialized) {
         return ESP_OK;
@@ -35,7 +93,8 @@ esp_err_t config_init(void) {
 
     // Try to load from NVS
     system_config_t nvs_config;
-    if (config_load_from_nvs(&nvs_config) == ESP_OK) {
+    bool migrated = false;
+    if (config_load_from_nvs(&nvs_config, &migrated) == ESP_OK) {
         ESP_LOGI(TAG, "Configuration loaded from NVS");
 
         // Check if WiFi config matches current defaults
@@ -52,6 +111,9 @@ esp_err_t config_init(void) {
         } else {
             // NVS matches defaults, use NVS config
             memcpy(&g_system_config, &nvs_config, sizeof(system_config_t));
+            if (migrated) {
+                config_save_to_nvs(&g_system_config);
+            }
         }
     } else {
         ESP_LOGI(TAG, "No saved configuration found, using defaults");
@@ -81,6 +143,7 @@ esp_err_t config_load_defaults(system_config_t* config) {
         config->uart_config[i].stop_bits = 1;
         config->uart_config[i].parity = 0; // None
         config->uart_config[i].flow_control = false;
+        config->uart_config[i].compress_log = true;
     }
     config->uart_config[0].baud_rate = CONFIG_UART1_DEFAULT_BAUD;
     config->uart_config[1].baud_rate = CONFIG_UART2_DEFAULT_BAUD;
@@ -107,8 +170,13 @@ esp_err_t config_load_defaults(system_config_t* config) {
     config->storage_config.auto_start = true;
     config->storage_config.max_file_size_mb = CONFIG_MAX_FILE_SIZE_MB;
     config->storage_config.buffer_flush_interval_ms = CONFIG_BUFFER_FLUSH_INTERVAL_MS;
-    config->storage_config.compress_files = false;
+    config->storage_config.sync_threshold_bytes = CONFIG_SYNC_THRESHOLD_BYTES;
+    config->storage_config.compress_files = true;  // Per-port selection via uart_config[].compress_log
     config->storage_config.retention_days = 7;
+    config->storage_config.free_space_low_pct = CONFIG_FREE_SPACE_LOW_PCT;
+    config->storage_config.free_space_high_pct = CONFIG_FREE_SPACE_HIGH_PCT;
+    config->storage_config.spill_latency_ms = CONFIG_SPILL_LATENCY_MS;
+    config->storage_config.sd_high_speed = CONFIG_SD_HIGH_SPEED;
     
     // Display Configuration
     config->display_config.enabled = true;
@@ -124,6 +192,11 @@ esp_err_t config_load_defaults(system_config_t* config) {
     config->network_config.enable_cors = true;
     config->network_config.require_auth = false;
     memset(config->network_config.auth_token, 0, sizeof(config->network_config.auth_token));
+    config->network_config.udp_enabled = false;
+    strncpy(config->network_config.udp_destinations, CONFIG_UDP_STREAM_DESTINATIONS,
+            sizeof(config->network_config.udp_destinations) - 1);
+    config->network_config.udp_port = CONFIG_UDP_STREAM_PORT;
+    config->network_config.udp_interval_ms = CONFIG_UDP_STREAM_INTERVAL_MS;
     
     // System Configuration
     config->system_config.log_level = CONFIG_DEFAULT_LOG_LEVEL;
@@ -134,8 +207,70 @@ esp_err_t config_load_defaults(system_config_t* config) {
     return ESP_OK;
 }
 
-esp_err_t config_load_from_nvs(system_config_t* config) {
+// Layout 1 fields over the current defaults; fields added since keep
+// their default values
+static void config_migrate_v1(const system_config_v1_t* old, system_config_t* config) {
+    config_load_defaults(config);
+
+    memcpy(config->device_name, old->device_name, sizeof(config->device_name));
+    config->device_id = old->device_id;
+
+    for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
+        config->uart_config[i].enabled = old->uart_config[i].enabled;
+        config->uart_config[i].baud_rate = old->uart_config[i].baud_rate;
+        config->uart_config[i].data_bits = old->uart_config[i].data_bits;
+        config->uart_config[i].stop_bits = old->uart_config[i].stop_bits;
+        config->uart_config[i].parity = old->uart_config[i].parity;
+        config->uart_config[i].flow_control = old->uart_config[i].flow_control;
+    }
+
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        config->adc_config[i].enabled = old->adc_config[i].enabled;
+        config->adc_config[i].sample_rate_hz = old->adc_config[i].sample_rate_hz;
+        config->adc_config[i].voltage_scale = old->adc_config[i].voltage_scale;
+        config->adc_config[i].filter_alpha = old->adc_config[i].filter_alpha;
+        config->adc_config[i].attenuation = old->adc_config[i].attenuation;
+    }
+
+    memcpy(config->wifi_config.ssid, old->wifi_config.ssid, sizeof(config->wifi_config.ssid));
+    memcpy(config->wifi_config.password, old->wifi_config.password, sizeof(config->wifi_config.password));
+    config->wifi_config.auto_connect = old->wifi_config.auto_connect;
+    config->wifi_config.power_save_mode = old->wifi_config.power_save_mode;
+
+    config->storage_config.auto_start = old->storage_config.auto_start;
+    config->storage_config.max_file_size_mb = old->storage_config.max_file_size_mb;
+    config->storage_config.buffer_flush_interval_ms = old->storage_config.buffer_flush_interval_ms;
+    config->storage_config.compress_files = old->storage_config.compress_files;
+    config->storage_config.retention_days = old->storage_config.retention_days;
+
+    config->display_config.enabled = old->display_config.enabled;
+    config->display_config.brightness = old->display_config.brightness;
+    config->display_config.refresh_rate_ms = old->display_config.refresh_rate_ms;
+    config->display_config.auto_sleep_sec = old->display_config.auto_sleep_sec;
+    config->display_config.display_mode = old->display_config.display_mode;
+
+    config->network_config.http_port = old->network_config.http_port;
+    config->network_config.websocket_port = old->network_config.websocket_port;
+    config->network_config.max_clients = old->network_config.max_clients;
+    config->network_config.enable_cors = old->network_config.enable_cors;
+    config->network_config.require_auth = old->network_config.require_auth;
+    memcpy(config->network_config.auth_token, old->network_config.auth_token,
+           sizeof(config->network_config.auth_token));
+
+    config->system_config.log_level = old->system_config.log_level;
+    config->system_config.enable_watchdog = old->system_config.enable_watchdog;
+    config->system_config.task_stack_size = old->system_config.task_stack_size;
+    config->system_config.task_priority = old->system_config.task_priority;
+}
+
+// The blob is only taken as-is when its version and size both match the
+// running firmware. Layout 1 is migrated (*migrated is set so the caller
+// can save it back); any other layout is rejected, leaving the defaults.
+esp_err_t config_load_from_nvs(system_config_t* config, bool* migrated) {
     if (!config) return ESP_ERR_INVALID_ARG;
+    if (migrated) {
+        *migrated = false;
+    }
     
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
@@ -143,8 +278,39 @@ esp_err_t config_load_from_nvs(system_config_t* config) {
         return err;
     }
     
-    size_t required_size = sizeof(system_config_t);
-    err = nvs_get_blob(nvs_handle, "config", config, &required_size);
+    // Blobs saved before the version key existed are layout 1
+    uint16_t version = 1;
+    err = nvs_get_u16(nvs_handle, NVS_VERSION_KEY, &version);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    size_t stored_size = 0;
+    err = nvs_get_blob(nvs_handle, "config", NULL, &stored_size);
+    if (err != ESP_OK) {
+        nvs_close(nvs_handle);
+        return err;
+    }
+    
+    if (version == CONFIG_LAYOUT_VERSION && stored_size == sizeof(system_config_t)) {
+        err = nvs_get_blob(nvs_handle, "config", config, &stored_size);
+    } else if (version == 1 && stored_size == sizeof(system_config_v1_t)) {
+        system_config_v1_t* old = malloc(sizeof(system_config_v1_t));
+        err = old ? nvs_get_blob(nvs_handle, "config", old, &stored_size) : ESP_ERR_NO_MEM;
+        if (err == ESP_OK) {
+            config_migrate_v1(old, config);
+            ESP_LOGW(TAG, "Saved configuration migrated from layout 1 to %d", CONFIG_LAYOUT_VERSION);
+            if (migrated) {
+                *migrated = true;
+            }
+        }
+        free(old);
+    } else {
+        ESP_LOGW(TAG, "Saved configuration is layout %u (%u bytes), expected %d (%u bytes); using defaults",
+                 version, (unsigned)stored_size, CONFIG_LAYOUT_VERSION, (unsigned)sizeof(system_config_t));
+        err = ESP_ERR_INVALID_VERSION;
+    }
     
     nvs_close(nvs_handle);
     
@@ -172,6 +338,9 @@ esp_err_t config_save_to_nvs(const system_config_t* config) {
     }
     
     err = nvs_set_blob(nvs_handle, "config", config, sizeof(system_config_t));
+    if (err == ESP_OK) {
+        err = nvs_set_u16(nvs_handle, NVS_VERSION_KEY, CONFIG_LAYOUT_VERSION);
+    }
     if (err == ESP_OK) {
         err = nvs_commit(nvs_handle);
         if (err == ESP_OK) {
@@ -203,9 +372,26 @@ esp_err_t config_validate(const system_config_t* config) {
                 ESP_LOGE(TAG, "Invalid sample rate for ADC%d: %d", i, config->adc_config[i].sample_rate_hz);
                 return ESP_ERR_INVALID_ARG;
             }
+            if (!CONFIG_VALIDATE_FILTER_ALPHA(config->adc_config[i].filter_alpha)) {
+                ESP_LOGE(TAG, "Invalid filter alpha for ADC%d: %.3f", i, config->adc_config[i].filter_alpha);
+                return ESP_ERR_INVALID_ARG;
+            }
         }
     }
     
+    // Validate storage configuration
+    if (config->storage_config.free_space_low_pct > config->storage_config.free_space_high_pct ||
+        config->storage_config.free_space_high_pct > 90) {
+        ESP_LOGE(TAG, "Invalid free space watermarks: %d%%-%d%%", 
+                config->storage_config.free_space_low_pct,
+                config->storage_config.free_space_high_pct);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->storage_config.spill_latency_ms == 0) {
+        ESP_LOGE(TAG, "Invalid spill latency threshold: %lu ms", config->storage_config.spill_latency_ms);
+        return ESP_ERR_INVALID_ARG;
+    }
+    
     // Validate display configuration
     if (!CONFIG_VALIDATE_BRIGHTNESS(config->display_config.brightness)) {
         ESP_LOGE(TAG, "Invalid brightness: %d", config->display_config.brightness);
@@ -215,6 +401,27 @@ esp_err_t config_validate(const system_config_t* config) {
     return ESP_OK;
 }
 
+// Replace the whole configuration at once: validated, saved, then made
+// current, so a failed save leaves the running configuration untouched
+esp_err_t config_commit(const system_config_t* staged) {
+    if (!staged) return ESP_ERR_INVALID_ARG;
+    
+    esp_err_t ret = config_validate(staged);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    ret = config_save_to_nvs(staged);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    if (staged != &g_system_config) {
+        memcpy(&g_system_config, staged, sizeof(system_config_t));
+    }
+    return ESP_OK;
+}
+
 system_config_t* config_get_instance(void) {
     if (!g_config_initialized) {
         config_init();
@@ -237,6 +444,35 @@ esp_err_t config_update_uart(uint8_t port, uint32_t baud_rate, bool enabled) {
     return config_save_to_nvs(&g_system_config);
 }
 
+esp_err_t config_update_uart_compression(uint8_t port, bool compress) {
+    if (!CONFIG_VALIDATE_UART_PORT(port)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    g_system_config.uart_config[port].compress_log = compress;
+    
+    return config_save_to_nvs(&g_system_config);
+}
+
+esp_err_t config_update_udp(bool enabled, const char* destinations, uint16_t port, uint16_t interval_ms) {
+    if (!destinations || strlen(destinations) >= sizeof(g_system_config.network_config.udp_destinations)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (port == 0 || interval_ms == 0 || interval_ms > 1000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    g_system_config.network_config.udp_enabled = enabled;
+    memset(g_system_config.network_config.udp_destinations, 0,
+           sizeof(g_system_config.network_config.udp_destinations));
+    strcpy(g_system_config.network_config.udp_destinations, destinations);
+    g_system_config.network_config.udp_port = port;
+    g_system_config.network_config.udp_interval_ms = interval_ms;
+    
+    return config_save_to_nvs(&g_system_config);
+}
+
 esp_err_t config_update_adc(uint8_t channel, uint16_t sample_rate, bool enabled) {
     if (!CONFIG_VALIDATE_ADC_CHANNEL(channel)) {
         return ESP_ERR_INVALID_ARG;
@@ -287,9 +523,10 @@ esp_err_t config_print(const system_config_t* config) {
     
     ESP_LOGI(TAG, "UART Ports:");
     for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
-        ESP_LOGI(TAG, "  Port %d: %s, %lu baud", i, 
+        ESP_LOGI(TAG, "  Port %d: %s, %lu baud, compression %s", i, 
                 config->uart_config[i].enabled ? "Enabled" : "Disabled",
-                config->uart_config[i].baud_rate);
+                config->uart_config[i].baud_rate,
+                config->uart_config[i].compress_log ? "on" : "off");
     }
     
     ESP_LOGI(TAG, "ADC Channels:");
@@ -303,6 +540,19 @@ esp_err_t config_print(const system_config_t* config) {
             config->wifi_config.ssid,
             config->wifi_config.auto_connect ? "Yes" : "No");
     
+    ESP_LOGI(TAG, "Storage: max %lu MB/file, commit every %lu ms or %lu bytes", 
+            config->storage_config.max_file_size_mb,
+            config->storage_config.buffer_flush_interval_ms,
+            config->storage_config.sync_threshold_bytes);
+    ESP_LOGI(TAG, "Retention: %d days, free space %d%%-%d%%", 
+            config->storage_config.retention_days,
+            config->storage_config.free_space_low_pct,
+            config->storage_config.free_space_high_pct);
+    ESP_LOGI(TAG, "Spill: SD latency threshold %lu ms", 
+            config->storage_config.spill_latency_ms);
+    ESP_LOGI(TAG, "SD bus profile: %s", 
+            config->storage_config.sd_high_speed ? "high-speed" : "default");
+    
     ESP_LOGI(TAG, "Display: %s, Brightness=%d%%", 
             config->display_config.enabled ? "Enabled" : "Disabled",
             config->display_config.brightness);
@@ -310,6 +560,11 @@ esp_err_t config_print(const system_config_t* config) {
     ESP_LOGI(TAG, "Network: HTTP=%d, WebSocket=%d", 
             config->network_config.http_port,
             config->network_config.websocket_port);
+    ESP_LOGI(TAG, "UDP stream: %s, %s:%d every %d ms", 
+            config->network_config.udp_enabled ? "Enabled" : "Disabled",
+            config->network_config.udp_destinations,
+            config->network_config.udp_port,
+            config->network_config.udp_interval_ms);
     
     return ESP_OK;
 }
@@ -25,16 +25,31 @@ extern "C" {
 #define CONFIG_ADC_VOLTAGE_RANGE        4.0f // 0-4V
 #define CONFIG_ADC_FILTER_ALPHA         0.1f // Moving average filter
 
+// ADC History (RAM ring served by /api/data/history)
+#define CONFIG_ADC_HISTORY_RATE_HZ      10   // Periods per second, each the mean of its samples
+#define CONFIG_ADC_HISTORY_SECONDS      300  // 24 KB for 4 channels
+
 // Storage Configuration
 #define CONFIG_SD_MOUNT_POINT           "/sdcard"
 #define CONFIG_LOG_FILE_PREFIX          "datalog"
 #define CONFIG_MAX_FILE_SIZE_MB         100
 #define CONFIG_BUFFER_FLUSH_INTERVAL_MS 1000
+#define CONFIG_SYNC_THRESHOLD_BYTES     (64 * 1024)  // Commit early once this much data is at risk
+#define CONFIG_FREE_SPACE_LOW_PCT       10   // Start deleting old logs below this free space
+#define CONFIG_FREE_SPACE_HIGH_PCT      20   // ...and stop once this much is free again
+#define CONFIG_SPILL_LATENCY_MS         500  // Spill to internal flash when an SD write takes longer
+#define CONFIG_SD_HIGH_SPEED            true // Mount the card with the high-speed SPI profile
 
 // Network Configuration
 #define CONFIG_HTTP_SERVER_PORT         80
 #define CONFIG_WEBSOCKET_PORT           8080
 #define CONFIG_MAX_CLIENTS              5
+#define CONFIG_SNTP_SERVER              "pool.ntp.org"
+
+// UDP Streaming (off by default, see stream_udp.h)
+#define CONFIG_UDP_STREAM_DESTINATIONS  "239.255.0.1"  // Comma-separated IPv4, unicast or multicast
+#define CONFIG_UDP_STREAM_PORT          5005
+#define CONFIG_UDP_STREAM_INTERVAL_MS   5    // Longest wait before a pending datagram is sent
 
 // Display Configuration
 #define CONFIG_LCD_REFRESH_RATE_MS      100
@@ -53,6 +68,10 @@ extern "C" {
 #define CONFIG_ADC3_PIN                 ADC_CHANNEL_2  // GPIO2
 #define CONFIG_ADC4_PIN                 ADC_CHANNEL_3  // GPIO3
 
+// Saved Configuration Layout - bump whenever system_config_t changes and
+// teach config_load_from_nvs to migrate the previous layout
+#define CONFIG_LAYOUT_VERSION           2
+
 // System Configuration Structure
 typedef struct {
     // Device Information
@@ -67,6 +86,7 @@ typedef struct {
         uint8_t stop_bits;
         uint8_t parity;
         bool flow_control;
+        bool compress_log;      // LZ-compress this port's log chunks
     } uart_config[CONFIG_UART_PORT_COUNT];
     
     // ADC Configuration
@@ -90,9 +110,14 @@ typedef struct {
     struct {
         bool auto_start;
         uint32_t max_file_size_mb;
-        uint32_t buffer_flush_interval_ms;
+        uint32_t buffer_flush_interval_ms;  // Group commit (fsync) interval, 0 = every record
+        uint32_t sync_threshold_bytes;      // Commit early after this many bytes, 0 = time only
         bool compress_files;
-        uint8_t retention_days;
+        uint8_t retention_days;             // Delete logs older than this, 0 = keep until space is needed
+        uint8_t free_space_low_pct;         // Low watermark for the space manager
+        uint8_t free_space_high_pct;        // High watermark for the space manager
+        uint32_t spill_latency_ms;          // SD write latency that triggers spilling to flash
+        bool sd_high_speed;                 // High-speed SPI profile (40 MHz if the card allows), falls back to 20 MHz
     } storage_config;
     
     // Display Configuration
@@ -112,6 +137,10 @@ typedef struct {
         bool enable_cors;
         bool require_auth;
         char auth_token[64];
+        bool udp_enabled;
+        char udp_destinations[64];
+        uint16_t udp_port;
+        uint16_t udp_interval_ms;
     } network_config;
     
     // System Configuration
@@ -127,16 +156,19 @@ typedef struct {
 // Configuration Management Functions
 esp_err_t config_init(void);
 esp_err_t config_load_defaults(system_config_t* config);
-esp_err_t config_load_from_nvs(system_config_t* config);
+esp_err_t config_load_from_nvs(system_config_t* config, bool* migrated);
 esp_err_t config_save_to_nvs(const system_config_t* config);
 esp_err_t config_load_from_file(const char* filename, system_config_t* config);
 esp_err_t config_save_to_file(const char* filename, const system_config_t* config);
 esp_err_t config_validate(const system_config_t* config);
+esp_err_t config_commit(const system_config_t* staged);
 esp_err_t config_print(const system_config_t* config);
 
 // Configuration Access Functions
 system_config_t* config_get_instance(void);
 esp_err_t config_update_uart(uint8_t port, uint32_t baud_rate, bool enabled);
+esp_err_t config_update_uart_compression(uint8_t port, bool compress);
+esp_err_t config_update_udp(bool enabled, const char* destinations, uint16_t port, uint16_t interval_ms);
 esp_err_t config_update_adc(uint8_t channel, uint16_t sample_rate, bool enabled);
 esp_err_t config_update_wifi(const char* ssid, const char* password);
 esp_err_t config_update_display(uint8_t brightness, bool enabled);
@@ -154,6 +186,9 @@ esp_err_t config_update_display(uint8_t brightness, bool enabled);
 #define CONFIG_VALIDATE_SAMPLE_RATE(rate) \
     ((rate) >= 1 && (rate) <= 10000)
 
+#define CONFIG_VALIDATE_FILTER_ALPHA(alpha) \
+    ((alpha) > 0.0f && (alpha) <= 1.0f)
+
 #define CONFIG_VALIDATE_BRIGHTNESS(brightness) \
     ((brightness) <= 100)
 
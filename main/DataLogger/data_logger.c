@@ -6,15 +6,19 @@
 #include "display_manager.h"
 #include "test_suite.h"
 #include "hal.h"
+#include "SPI_Arbiter.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char* TAG = "DATA_LOGGER";
 
+#define DATA_LOGGER_STOP_TIMEOUT_MS 500     // Coordination task leaves within one loop pass
+
 // Data coordination task
 static TaskHandle_t g_data_coordination_task = NULL;
-static bool g_data_logger_running = false;
+static TaskHandle_t g_data_logger_stopper = NULL;    // Notified when the coordination task has left
+static volatile bool g_data_logger_running = false;
 
 // Data coordination task - bridges data acquisition and storage
 static void data_coordination_task(void* pvParameters) {
@@ -51,6 +55,10 @@ static void data_coordination_task(void* pvParameters) {
     }
 
     ESP_LOGI(TAG, "Data coordination task stopped");
+    g_data_coordination_task = NULL;
+    if (g_data_logger_stopper) {
+        xTaskNotifyGive(g_data_logger_stopper);
+    }
     vTaskDelete(NULL);
 }
 
@@ -102,6 +110,11 @@ esp_err_t data_logger_init(void) {
 }
 
 esp_err_t data_logger_start(void) {
+    if (g_data_logger_running) {
+        ESP_LOGW(TAG, "Data Logger already running");
+        return ESP_OK;
+    }
+
     ESP_LOGI(TAG, "Starting Data Logger");
 
     // Start Storage Manager first
@@ -139,14 +152,15 @@ esp_err_t data_logger_start(void) {
     //     // Continue without display - not critical for basic operation
     // }
 
-    // Start data coordination task
+    // Start data coordination task; set running first, the task loops while it is set
+    g_data_logger_running = true;
     BaseType_t task_ret = xTaskCreate(data_coordination_task, "data_coord", 4096, NULL, 5, &g_data_coordination_task);
     if (task_ret != pdPASS) {
         ESP_LOGE(TAG, "Failed to create data coordination task");
+        g_data_logger_running = false;
         return ESP_ERR_NO_MEM;
     }
 
-    g_data_logger_running = true;
     ESP_LOGI(TAG, "Data Logger started successfully");
     return ESP_OK;
 }
@@ -154,6 +168,17 @@ esp_err_t data_logger_start(void) {
 esp_err_t data_logger_stop(void) {
     ESP_LOGI(TAG, "Stopping Data Logger");
 
+    // Wait for the coordination task to leave, so a later start does not run two
+    if (g_data_coordination_task) {
+        g_data_logger_stopper = xTaskGetCurrentTaskHandle();
+        g_data_logger_running = false;
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DATA_LOGGER_STOP_TIMEOUT_MS)) == 0) {
+            ESP_LOGW(TAG, "Data coordination task did not stop in time");
+        }
+        g_data_logger_stopper = NULL;
+    }
+    g_data_logger_running = false;
+
     // Stop managers
     adc_manager_stop();
     // uart_manager_stop(); // Will implement this function
@@ -184,6 +209,7 @@ esp_err_t data_logger_print_status(void) {
     uart_manager_print_stats();
     adc_manager_print_stats();
     storage_manager_print_stats();
+    spi_arbiter_print_stats();
     network_manager_print_stats();
 
     // Display status
@@ -155,6 +155,29 @@ esp_err_t hal_uart_deinit(uint8_t port) {
     return ret;
 }
 
+// Takes effect on the installed driver; the FIFO and pins are kept
+esp_err_t hal_uart_set_baud_rate(uint8_t port, uint32_t baud_rate) {
+    if (!HAL_VALIDATE_UART_PORT(port)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    hal_uart_t* uart = &g_hal_system.uart_ports[port];
+    if (!uart->initialized) {
+        return HAL_ERR_NOT_INITIALIZED;
+    }
+    
+    esp_err_t ret = uart_set_baudrate(uart->port, baud_rate);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set UART%d baud rate: %s", port, esp_err_to_name(ret));
+        return ret;
+    }
+    
+    uart->config.baud_rate = baud_rate;
+    ESP_LOGI(TAG, "UART%d baud rate: %lu", port, baud_rate);
+    
+    return ESP_OK;
+}
+
 int hal_uart_read(uint8_t port, uint8_t* buffer, size_t buffer_size, uint32_t timeout_ms) {
     if (!HAL_VALIDATE_UART_PORT(port) || !buffer) {
         return -1;
@@ -46,6 +46,7 @@ esp_err_t hal_system_deinit(void);
 // UART Hardware Functions
 esp_err_t hal_uart_init(uint8_t port, uint32_t baud_rate);
 esp_err_t hal_uart_deinit(uint8_t port);
+esp_err_t hal_uart_set_baud_rate(uint8_t port, uint32_t baud_rate);
 esp_err_t hal_uart_write(uint8_t port, const uint8_t* data, size_t length);
 int hal_uart_read(uint8_t port, uint8_t* buffer, size_t buffer_size, uint32_t timeout_ms);
 esp_err_t hal_uart_flush(uint8_t port);
@@ -0,0 +1,169 @@
+#include "json_writer.h"
+#include <string.h>
+
+void json_writer_init(json_writer_t* writer, char* buffer, size_t size, json_writer_flush_t flush, void* ctx) {
+    text_writer_init(&writer->out, buffer, size, flush, ctx);
+    writer->depth = 0;
+    writer->has_members = 0;
+}
+
+// Quoted string, copied in runs between the characters that need escaping.
+// With escape_high set, bytes from 0x80 up are escaped as well, which makes
+// every byte one character (U+0000 to U+00FF) whatever the input encoding.
+static void put_escaped(json_writer_t* writer, const char* value, size_t length, bool escape_high) {
+    static const char hex[] = "0123456789abcdef";
+
+    text_writer_t* out = &writer->out;
+    text_writer_put_char(out, '"');
+    const char* run = value;
+    const char* end = value + length;
+    for (const char* p = value; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\' && (c < 0x80 || !escape_high)) {
+            continue;
+        }
+
+        text_writer_put(out, run, p - run);
+        run = p + 1;
+        switch (c) {
+            case '"':  text_writer_put(out, "\\\"", 2); break;
+            case '\\': text_writer_put(out, "\\\\", 2); break;
+            case '\n': text_writer_put(out, "\\n", 2); break;
+            case '\r': text_writer_put(out, "\\r", 2); break;
+            case '\t': text_writer_put(out, "\\t", 2); break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F]};
+                text_writer_put(out, escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    text_writer_put(out, run, end - run);
+    text_writer_put_char(out, '"');
+}
+
+// Comma and key in front of a value. Returns false once the writer failed.
+static bool begin_member(json_writer_t* writer, const char* key) {
+    if (writer->out.error != ESP_OK) {
+        return false;
+    }
+
+    uint16_t bit = 1 << writer->depth;
+    if (writer->has_members & bit) {
+        text_writer_put_char(&writer->out, ',');
+    }
+    writer->has_members |= bit;
+
+    if (key) {
+        put_escaped(writer, key, strlen(key), false);
+        text_writer_put_char(&writer->out, ':');
+    }
+    return writer->out.error == ESP_OK;
+}
+
+static void open_level(json_writer_t* writer, const char* key, char bracket) {
+    if (!begin_member(writer, key)) {
+        return;
+    }
+    if (writer->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        writer->out.error = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    text_writer_put_char(&writer->out, bracket);
+    writer->depth++;
+    writer->has_members &= ~(1 << writer->depth);
+}
+
+static void close_level(json_writer_t* writer, char bracket) {
+    if (writer->out.error != ESP_OK) {
+        return;
+    }
+    if (writer->depth == 0) {
+        writer->out.error = ESP_ERR_INVALID_STATE;
+        return;
+    }
+    writer->depth--;
+    text_writer_put_char(&writer->out, bracket);
+}
+
+void json_writer_begin_object(json_writer_t* writer, const char* key) {
+    open_level(writer, key, '{');
+}
+
+void json_writer_end_object(json_writer_t* writer) {
+    close_level(writer, '}');
+}
+
+void json_writer_begin_array(json_writer_t* writer, const char* key) {
+    open_level(writer, key, '[');
+}
+
+void json_writer_end_array(json_writer_t* writer) {
+    close_level(writer, ']');
+}
+
+void json_writer_string(json_writer_t* writer, const char* key, const char* value) {
+    if (begin_member(writer, key)) {
+        put_escaped(writer, value ? value : "", value ? strlen(value) : 0, false);
+    }
+}
+
+// Raw bytes (UART data) as a string, one character per byte, so text stays
+// readable and the client gets every byte back with a Latin-1 encode
+void json_writer_bytes(json_writer_t* writer, const char* key, const uint8_t* data, size_t length) {
+    if (begin_member(writer, key)) {
+        put_escaped(writer, (const char*)data, length, true);
+    }
+}
+
+void json_writer_int(json_writer_t* writer, const char* key, int64_t value) {
+    if (begin_member(writer, key)) {
+        text_writer_put_int(&writer->out, value);
+    }
+}
+
+void json_writer_uint(json_writer_t* writer, const char* key, uint64_t value) {
+    if (begin_member(writer, key)) {
+        text_writer_put_uint(&writer->out, value);
+    }
+}
+
+// Fixed point, see text_format_fixed. NaN and infinities (not valid JSON)
+// become null.
+void json_writer_fixed(json_writer_t* writer, const char* key, double value, uint8_t decimals) {
+    if (!begin_member(writer, key)) {
+        return;
+    }
+
+    char number[TEXT_WRITER_NUMBER_LEN];
+    size_t length = text_format_fixed(number, value, decimals);
+    if (length == 0) {
+        text_writer_put(&writer->out, "null", 4);
+        return;
+    }
+    text_writer_put(&writer->out, number, length);
+}
+
+void json_writer_bool(json_writer_t* writer, const char* key, bool value) {
+    if (begin_member(writer, key)) {
+        text_writer_put(&writer->out, value ? "true" : "false", value ? 4 : 5);
+    }
+}
+
+void json_writer_null(json_writer_t* writer, const char* key) {
+    if (begin_member(writer, key)) {
+        text_writer_put(&writer->out, "null", 4);
+    }
+}
+
+// Flush what is left. Unclosed objects or arrays count as an error.
+// Without a flush callback the output stays in the buffer.
+esp_err_t json_writer_finish(json_writer_t* writer) {
+    if (writer->out.error == ESP_OK && writer->depth != 0) {
+        writer->out.error = ESP_ERR_INVALID_STATE;
+    }
+    if (writer->out.flush) {
+        text_writer_flush(&writer->out);
+    }
+    return writer->out.error;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "esp_err.h"
+#include "text_writer.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming JSON emitter for API responses, built on text_writer. Output
+// goes straight into a caller-provided buffer and is handed to a flush
+// callback whenever the buffer fills (the HTTP handlers send it as a
+// response chunk), so a response of any size is written without a DOM,
+// without heap allocations and without printf. Numbers use integer
+// formatting; floats are written as fixed point with a given number of
+// decimals.
+//
+// Commas between members are tracked per nesting level. Pass a key inside
+// objects and NULL inside arrays. The first error (a failed flush or bad
+// nesting) sticks in out.error and turns later calls into no-ops;
+// json_writer_finish reports it.
+//
+// Without a flush callback the writer fills the buffer once: the output
+// stays in it (out.used bytes) and running out of room is an error. Stream
+// messages are built this way.
+
+// Writer Configuration
+#define JSON_WRITER_MAX_DEPTH       16
+#define JSON_WRITER_MAX_DECIMALS    TEXT_WRITER_MAX_DECIMALS
+
+// Receives formatted output; a non-OK return aborts the response
+typedef text_writer_flush_t json_writer_flush_t;
+
+typedef struct {
+    text_writer_t out;          // Buffer, byte count and sticky error
+    uint8_t depth;
+    uint16_t has_members;       // Bit n: level n already has a member, next one needs a comma
+} json_writer_t;
+
+// Writer Functions
+void json_writer_init(json_writer_t* writer, char* buffer, size_t size, json_writer_flush_t flush, void* ctx);
+esp_err_t json_writer_finish(json_writer_t* writer);
+
+void json_writer_begin_object(json_writer_t* writer, const char* key);
+void json_writer_end_object(json_writer_t* writer);
+void json_writer_begin_array(json_writer_t* writer, const char* key);
+void json_writer_end_array(json_writer_t* writer);
+
+void json_writer_string(json_writer_t* writer, const char* key, const char* value);
+void json_writer_bytes(json_writer_t* writer, const char* key, const uint8_t* data, size_t length);
+void json_writer_int(json_writer_t* writer, const char* key, int64_t value);
+void json_writer_uint(json_writer_t* writer, const char* key, uint64_t value);
+void json_writer_fixed(json_writer_t* writer, const char* key, double value, uint8_t decimals);
+void json_writer_bool(json_writer_t* writer, const char* key, bool value);
+void json_writer_null(json_writer_t* writer, const char* key);
+
+#ifdef __cplusplus
+}
+#endif
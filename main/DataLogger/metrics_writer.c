@@ -0,0 +1,163 @@
+#include "metrics_writer.h"
+#include <string.h>
+#include <math.h>
+
+static const char* const g_type_names[] = {
+    [METRICS_COUNTER] = "counter",
+    [METRICS_GAUGE] = "gauge",
+    [METRICS_HISTOGRAM] = "histogram"
+};
+
+void metrics_writer_init(metrics_writer_t* writer, char* buffer, size_t size,
+                         metrics_writer_flush_t flush, void* ctx) {
+    text_writer_init(&writer->out, buffer, size, flush, ctx);
+    writer->family = NULL;
+    if (!flush) {
+        writer->out.error = ESP_ERR_INVALID_ARG;
+    }
+}
+
+static void put(metrics_writer_t* writer, const char* data, size_t length) {
+    text_writer_put(&writer->out, data, length);
+}
+
+static void put_str(metrics_writer_t* writer, const char* text) {
+    text_writer_put_str(&writer->out, text);
+}
+
+// Fixed point as in json_writer_fixed; NaN and overflow use the
+// exposition format's own tokens
+static void put_fixed(metrics_writer_t* writer, double value, uint8_t decimals) {
+    char number[TEXT_WRITER_NUMBER_LEN];
+    size_t length = text_format_fixed(number, value, decimals);
+    if (length == 0) {
+        put_str(writer, isnan(value) ? "NaN" : (value < 0 ? "-Inf" : "+Inf"));
+        return;
+    }
+    put(writer, number, length);
+}
+
+// Label values escape backslash, double quote and newline
+static void put_label_value(metrics_writer_t* writer, const char* value) {
+    const char* run = value;
+    for (const char* p = value; *p; p++) {
+        if (*p != '\\' && *p != '"' && *p != '\n') {
+            continue;
+        }
+        put(writer, run, p - run);
+        put(writer, *p == '\n' ? "\\n" : (*p == '"' ? "\\\"" : "\\\\"), 2);
+        run = p + 1;
+    }
+    put_str(writer, run);
+}
+
+// name{labels,extra} with the sample value still to come
+static void begin_sample(metrics_writer_t* writer, const char* suffix, const metrics_label_t* labels,
+                         size_t label_count, const char* extra) {
+    put_str(writer, writer->family);
+    if (suffix) {
+        put_str(writer, suffix);
+    }
+
+    if (label_count > 0 || extra) {
+        put(writer, "{", 1);
+        for (size_t i = 0; i < label_count; i++) {
+            if (i > 0) {
+                put(writer, ",", 1);
+            }
+            put_str(writer, labels[i].name);
+            put(writer, "=\"", 2);
+            if (labels[i].value) {
+                put_label_value(writer, labels[i].value);
+            } else {
+                text_writer_put_int(&writer->out, labels[i].index);
+            }
+            put(writer, "\"", 1);
+        }
+        if (extra) {
+            if (label_count > 0) {
+                put(writer, ",", 1);
+            }
+            put_str(writer, extra);
+        }
+        put(writer, "}", 1);
+    }
+    put(writer, " ", 1);
+}
+
+void metrics_writer_family(metrics_writer_t* writer, const char* name, metrics_type_t type, const char* help) {
+    if (writer->out.error != ESP_OK) {
+        return;
+    }
+    writer->family = name;
+
+    put(writer, "# HELP ", 7);
+    put_str(writer, name);
+    put(writer, " ", 1);
+    put_str(writer, help);
+    put(writer, "\n# TYPE ", 8);
+    put_str(writer, name);
+    put(writer, " ", 1);
+    put_str(writer, g_type_names[type]);
+    put(writer, "\n", 1);
+}
+
+void metrics_writer_uint(metrics_writer_t* writer, const metrics_label_t* labels, size_t label_count,
+                         uint64_t value) {
+    if (writer->out.error != ESP_OK || !writer->family) {
+        return;
+    }
+    begin_sample(writer, NULL, labels, label_count, NULL);
+    text_writer_put_uint(&writer->out, value);
+    put(writer, "\n", 1);
+}
+
+void metrics_writer_fixed(metrics_writer_t* writer, const metrics_label_t* labels, size_t label_count,
+                          double value, uint8_t decimals) {
+    if (writer->out.error != ESP_OK || !writer->family) {
+        return;
+    }
+    begin_sample(writer, NULL, labels, label_count, NULL);
+    put_fixed(writer, value, decimals);
+    put(writer, "\n", 1);
+}
+
+void metrics_writer_histogram(metrics_writer_t* writer, const metrics_label_t* labels, size_t label_count,
+                              const uint32_t* counts, const uint32_t* bounds_us, size_t buckets,
+                              uint64_t sum_us) {
+    if (writer->out.error != ESP_OK || !writer->family || buckets == 0) {
+        return;
+    }
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < buckets; i++) {
+        cumulative += counts[i];
+
+        // le="0.000128": the bound in seconds, built without printf
+        char le[32] = "le=\"+Inf\"";
+        if (i < buckets - 1) {
+            size_t n = 4;
+            memcpy(le, "le=\"", 4);
+            n += text_format_u32(le + n, bounds_us[i] / 1000000, 0);
+            le[n++] = '.';
+            n += text_format_u32(le + n, bounds_us[i] % 1000000, METRICS_WRITER_MAX_DECIMALS);
+            memcpy(le + n, "\"", 2);
+        }
+
+        begin_sample(writer, "_bucket", labels, label_count, le);
+        text_writer_put_uint(&writer->out, cumulative);
+        put(writer, "\n", 1);
+    }
+
+    begin_sample(writer, "_sum", labels, label_count, NULL);
+    put_fixed(writer, sum_us / 1e6, METRICS_WRITER_MAX_DECIMALS);
+    put(writer, "\n", 1);
+    begin_sample(writer, "_count", labels, label_count, NULL);
+    text_writer_put_uint(&writer->out, cumulative);
+    put(writer, "\n", 1);
+}
+
+// Flush what is left
+esp_err_t metrics_writer_finish(metrics_writer_t* writer) {
+    return text_writer_flush(&writer->out);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "esp_err.h"
+#include "text_writer.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming Prometheus text exposition (format 0.0.4) for GET /metrics.
+// Built on text_writer like json_writer: output goes into a caller-provided
+// buffer that is handed to a flush callback whenever it fills, so a scrape
+// of any size is rendered without heap allocations and without printf.
+//
+// Start each metric family with metrics_writer_family (HELP and TYPE
+// lines), then write its samples. Counter names end in _total, durations
+// are in seconds and sizes in bytes. The first error sticks and turns
+// later calls into no-ops (out.error); metrics_writer_finish reports it.
+
+// Writer Configuration
+#define METRICS_WRITER_MAX_DECIMALS TEXT_WRITER_MAX_DECIMALS
+
+typedef enum {
+    METRICS_COUNTER,
+    METRICS_GAUGE,
+    METRICS_HISTOGRAM
+} metrics_type_t;
+
+// One label of a sample: value, or index when value is NULL
+typedef struct {
+    const char* name;
+    const char* value;
+    int32_t index;
+} metrics_label_t;
+
+// Receives formatted output; a non-OK return aborts the scrape
+typedef text_writer_flush_t metrics_writer_flush_t;
+
+typedef struct {
+    text_writer_t out;
+    const char* family;         // Name of the family being written
+} metrics_writer_t;
+
+// Writer Functions
+void metrics_writer_init(metrics_writer_t* writer, char* buffer, size_t size,
+                         metrics_writer_flush_t flush, void* ctx);
+esp_err_t metrics_writer_finish(metrics_writer_t* writer);
+
+void metrics_writer_family(metrics_writer_t* writer, const char* name, metrics_type_t type, const char* help);
+void metrics_writer_uint(metrics_writer_t* writer, const metrics_label_t* labels, size_t label_count,
+                         uint64_t value);
+void metrics_writer_fixed(metrics_writer_t* writer, const metrics_label_t* labels, size_t label_count,
+                          double value, uint8_t decimals);
+
+// Cumulative histogram in seconds from per-bucket counts. bounds_us holds
+// the upper bounds of the first buckets - 1 buckets; the last is +Inf.
+void metrics_writer_histogram(metrics_writer_t* writer, const metrics_label_t* labels, size_t label_count,
+                              const uint32_t* counts, const uint32_t* bounds_us, size_t buckets,
+                              uint64_t sum_us);
+
+#ifdef __cplusplus
+}
+#endif
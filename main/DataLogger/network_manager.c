@@ -1,24 +1,48 @@
 #include "network_manager.h"
 #include "uart_manager.h"
 #include "adc_manager.h"
+#include "adc_history.h"
 #include "storage_manager.h"
+#include "storage_catalog.h"
+#include "storage_rollup.h"
+#include "storage_bench.h"
+#include "storage_scrub.h"
+#include "storage_export.h"
+#include "storage_session.h"
+#include "stream_frame.h"
+#include "stream_fanout.h"
+#include "stream_view.h"
+#include "stream_udp.h"
+#include "json_writer.h"
+#include "metrics_writer.h"
+#include "stats_snapshot.h"
+#include "web_assets.h"
+#include "SPI_Arbiter.h"
 #include "data_logger.h"
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_netif.h"
+#include "esp_netif_sntp.h"
 #include "esp_http_server.h"
 // Note: WebSocket server support (esp_http_server_ws.h) is not available in ESP-IDF v5.5
 #include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "freertos/queue.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
+#include "lwip/sockets.h"
 #include "cJSON.h"
 #include "config.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 // Compatibility layer - replaces original Wireless module global variables
 uint16_t WIFI_NUM = 0;  // Number of WiFi APs found (replaces Wireless.c)
@@ -36,15 +60,6 @@ static const char* TAG = "NET_MGR";
 // WiFi Scanning Configuration
 #define NETWORK_MAX_SCAN_RESULTS 20
 
-// WebSocket client tracking
-typedef struct {
-    httpd_handle_t server;
-    int fd;
-    bool active;
-} websocket_client_t;
-
-#define MAX_WEBSOCKET_CLIENTS 4
-
 // Network Manager State
 typedef struct {
     bool initialized;
@@ -59,15 +74,22 @@ typedef struct {
     uint16_t wifi_ap_count;
     wifi_ap_record_t* scan_results;
     uint16_t max_scan_results;
-    // WebSocket support
-    websocket_client_t websocket_clients[MAX_WEBSOCKET_CLIENTS];
+    // WebSocket support (clients are tracked by the stream fan-out)
     TaskHandle_t websocket_task;
     QueueHandle_t websocket_queue;
     bool websocket_running;
+    // Log downloads (the HTTP server runs handlers one at a time, so one buffer is enough)
+    uint8_t* download_buffer;
+    bool sntp_started;
 } network_manager_state_t;
 
 static network_manager_state_t g_network_manager = {0};
 
+// Wall clock set by SNTP; the storage session anchors log timestamps to it
+static void sntp_sync_cb(struct timeval* tv) {
+    storage_session_note_sync("sntp");
+}
+
 // WiFi Event Handler
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                               int32_t event_id, void* event_data) {
@@ -91,6 +113,17 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         g_network_manager.retry_count = 0;
         g_network_manager.wifi_connected = true;
         xEventGroupSetBits(g_network_manager.wifi_event_group, WIFI_CONNECTED_BIT);
+
+        // Time sync on the first connection, SNTP keeps polling after that
+        if (!g_network_manager.sntp_started) {
+            esp_sntp_config_t sntp_config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_SNTP_SERVER);
+            sntp_config.sync_cb = sntp_sync_cb;
+            if (esp_netif_sntp_init(&sntp_config) == ESP_OK) {
+                g_network_manager.sntp_started = true;
+            } else {
+                ESP_LOGW(TAG, "SNTP start failed, logs keep monotonic time only");
+            }
+        }
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
         // WiFi scan completed - replaces original Wireless module functionality
         ESP_LOGI(TAG, "WiFi scan completed");
@@ -99,45 +132,473 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
     }
 }
 
+// JSON responses are streamed: the writer fills a fixed buffer on the
+// handler's stack and sends it as a response chunk whenever it is full
+typedef struct {
+    json_writer_t writer;
+    char buffer[NETWORK_JSON_CHUNK_SIZE];
+} json_response_t;
+
+static esp_err_t json_send_chunk(const char *data, size_t length, void *ctx) {
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, length);
+}
+
+static json_writer_t *json_response_begin(httpd_req_t *req, json_response_t *response) {
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    json_writer_init(&response->writer, response->buffer, sizeof(response->buffer), json_send_chunk, req);
+    return &response->writer;
+}
+
+static esp_err_t json_response_end(httpd_req_t *req, json_response_t *response) {
+    g_network_manager.stats.api_requests++;
+    g_network_manager.stats.bytes_sent += response->writer.out.total;
+
+    esp_err_t ret = json_writer_finish(&response->writer);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "JSON response to %s aborted: %s", req->uri, esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
 // HTTP API Handlers
 static esp_err_t status_handler(httpd_req_t *req) {
-    cJSON *json = cJSON_CreateObject();
-    cJSON *status = cJSON_CreateString("running");
-    cJSON *timestamp = cJSON_CreateNumber(esp_timer_get_time());
-    cJSON *uptime = cJSON_CreateNumber(esp_timer_get_time() / 1000000);
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
 
-    cJSON_AddItemToObject(json, "status", status);
-    cJSON_AddItemToObject(json, "timestamp", timestamp);
-    cJSON_AddItemToObject(json, "uptime_seconds", uptime);
+    int64_t now_us = esp_timer_get_time();
+    json_writer_begin_object(json, NULL);
+    json_writer_string(json, "status", "running");
+    json_writer_int(json, "timestamp", now_us);
+    json_writer_int(json, "uptime_seconds", now_us / 1000000);
 
     // Add system info
-    cJSON *system = cJSON_CreateObject();
-    cJSON *free_heap = cJSON_CreateNumber(esp_get_free_heap_size());
-    cJSON *min_heap = cJSON_CreateNumber(esp_get_minimum_free_heap_size());
-    cJSON_AddItemToObject(system, "free_heap", free_heap);
-    cJSON_AddItemToObject(system, "min_free_heap", min_heap);
-    cJSON_AddItemToObject(json, "system", system);
+    json_writer_begin_object(json, "system");
+    json_writer_uint(json, "free_heap", esp_get_free_heap_size());
+    json_writer_uint(json, "min_free_heap", esp_get_minimum_free_heap_size());
+    json_writer_end_object(json);
+
+    // SD card health from the storage latency monitor
+    storage_stats_t storage_stats;
+    if (storage_manager_get_stats(&storage_stats) == ESP_OK) {
+        json_writer_begin_object(json, "card");
+        json_writer_uint(json, "write_p99_us", storage_stats.write_latency_p99_us);
+        json_writer_uint(json, "write_max_us", storage_stats.write_latency_max_us);
+        json_writer_uint(json, "stalls", storage_stats.write_stalls);
+        json_writer_fixed(json, "write_mb_per_sec", storage_stats.sd_write_kbps / 1024.0, 3);
+        json_writer_uint(json, "staging_blocks", storage_stats.staging_blocks);
+        json_writer_uint(json, "staging_block_limit", storage_stats.staging_block_limit);
+        json_writer_uint(json, "staged_records", storage_stats.staged_records);
+        json_writer_end_object(json);
+    }
+
+    // Shared SPI bus use per client
+    json_writer_begin_object(json, "spi_bus");
+    static const char *const spi_clients[SPI_CLIENT_COUNT] = {"sd", "lcd"};
+    for (int client = 0; client < SPI_CLIENT_COUNT; client++) {
+        spi_client_stats_t bus_stats;
+        spi_arbiter_get_stats(client, &bus_stats);
+        json_writer_begin_object(json, spi_clients[client]);
+        json_writer_uint(json, "utilisation_pct", bus_stats.utilisation_pct);
+        json_writer_uint(json, "grants", bus_stats.grants);
+        json_writer_uint(json, "max_wait_us", bus_stats.max_wait_us);
+        json_writer_uint(json, "yields", bus_stats.yields);
+        json_writer_end_object(json);
+    }
+    json_writer_end_object(json);
+
+    // Logging session and its clock anchors
+    storage_session_info_t session;
+    if (storage_session_get_info(&session) == ESP_OK) {
+        json_writer_begin_object(json, "session");
+        json_writer_uint(json, "id", session.session_id);
+        json_writer_uint(json, "files", session.files);
+        json_writer_uint(json, "anchors", session.anchors);
+        json_writer_bool(json, "clock_valid", session.clock_valid);
+        json_writer_string(json, "manifest", session.manifest);
+        json_writer_end_object(json);
+    }
+
+    // Live stream delivery per client
+    stream_fanout_stats_t fanout;
+    if (stream_fanout_get_stats(&fanout) == ESP_OK) {
+        json_writer_begin_object(json, "stream");
+        json_writer_uint(json, "published", fanout.published);
+        json_writer_uint(json, "evictions", fanout.evictions);
+        json_writer_begin_array(json, "clients");
+        for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+            stream_client_stats_t *client = &fanout.clients[i];
+            if (!client->active) {
+                continue;
+            }
+            json_writer_begin_object(json, NULL);
+            json_writer_int(json, "fd", client->fd);
+            json_writer_string(json, "transport", client->transport);
+            json_writer_string(json, "encoding", client->subscription.encoding == STREAM_ENCODING_BINARY ? "binary" : "json");
+            json_writer_uint(json, "adc_channels", client->subscription.adc_channels);
+            json_writer_uint(json, "uart_ports", client->subscription.uart_ports);
+            json_writer_uint(json, "rate_hz", client->subscription.rate_hz);
+            json_writer_string(json, "reduce", stream_reduce_name(client->subscription.reduce));
+            json_writer_uint(json, "queued", client->queued);
+            json_writer_uint(json, "sent", client->sent);
+            json_writer_uint(json, "dropped", client->dropped);
+            json_writer_uint(json, "stale", client->stale);
+            json_writer_uint(json, "latency_avg_us", client->latency_avg_us);
+            json_writer_uint(json, "latency_max_us", client->latency_max_us);
+            json_writer_end_object(json);
+        }
+        json_writer_end_array(json);
+        json_writer_end_object(json);
+    }
+
+    // UDP streamer
+    stream_udp_stats_t udp;
+    if (stream_udp_get_stats(&udp) == ESP_OK) {
+        json_writer_begin_object(json, "udp");
+        json_writer_bool(json, "running", udp.running);
+        json_writer_uint(json, "destinations", udp.destinations);
+        json_writer_uint(json, "interval_ms", udp.interval_ms);
+        json_writer_uint(json, "datagrams", udp.datagrams);
+        json_writer_uint(json, "frames", udp.frames);
+        json_writer_uint(json, "bytes", udp.bytes);
+        json_writer_uint(json, "send_errors", udp.send_errors);
+        json_writer_uint(json, "send_max_us", udp.send_max_us);
+        json_writer_uint(json, "age_max_us", udp.age_max_us);
+        json_writer_end_object(json);
+    }
+
+    json_writer_end_object(json);
+    return json_response_end(req, &response);
+}
 
-    char *json_string = cJSON_Print(json);
+// Prometheus scrape. Every subsystem's statistics are snapshotted first
+// (stats_snapshot, no locks held against the sampling tasks), then written
+// with metrics_writer straight into response chunks.
+typedef struct {
+    metrics_writer_t writer;
+    char buffer[NETWORK_JSON_CHUNK_SIZE];
+} metrics_response_t;
+
+static void metrics_value(metrics_writer_t *m, const char *name, metrics_type_t type, const char *help,
+                          uint64_t value) {
+    metrics_writer_family(m, name, type, help);
+    metrics_writer_uint(m, NULL, 0, value);
+}
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_send(req, json_string, strlen(json_string));
+static void metrics_seconds(metrics_writer_t *m, const char *name, metrics_type_t type, const char *help,
+                            uint64_t value_us) {
+    metrics_writer_family(m, name, type, help);
+    metrics_writer_fixed(m, NULL, 0, value_us / 1e6, 6);
+}
 
-    free(json_string);
-    cJSON_Delete(json);
+static void write_uart_metrics(metrics_writer_t *m) {
+    uart_stats_t uart[CONFIG_UART_PORT_COUNT];
+    metrics_label_t port[CONFIG_UART_PORT_COUNT];
+    for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
+        uart_manager_get_stats(i, &uart[i]);
+        port[i] = (metrics_label_t){ .name = "port", .index = i };
+    }
+
+    metrics_writer_family(m, "datalogger_uart_active", METRICS_GAUGE, "UART port is capturing (1) or idle (0)");
+    for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
+        metrics_writer_uint(m, &port[i], 1, uart_manager_is_channel_active(i));
+    }
+    metrics_writer_family(m, "datalogger_uart_packets_total", METRICS_COUNTER, "UART packets received");
+    for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
+        metrics_writer_uint(m, &port[i], 1, uart[i].total_packets);
+    }
+    metrics_writer_family(m, "datalogger_uart_received_bytes_total", METRICS_COUNTER, "UART bytes received");
+    for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
+        metrics_writer_uint(m, &port[i], 1, uart[i].total_bytes);
+    }
+    metrics_writer_family(m, "datalogger_uart_dropped_packets_total", METRICS_COUNTER, "UART packets dropped on a full buffer");
+    for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
+        metrics_writer_uint(m, &port[i], 1, uart[i].dropped_packets);
+    }
+    metrics_writer_family(m, "datalogger_uart_errors_total", METRICS_COUNTER, "UART driver errors");
+    for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
+        metrics_writer_uint(m, &port[i], 1, uart[i].error_count);
+    }
+}
+
+static void write_adc_metrics(metrics_writer_t *m) {
+    adc_stats_t adc[CONFIG_ADC_CHANNEL_COUNT];
+    metrics_label_t channel[CONFIG_ADC_CHANNEL_COUNT];
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        adc_manager_get_stats(i, &adc[i]);
+        channel[i] = (metrics_label_t){ .name = "channel", .index = i };
+    }
+
+    metrics_writer_family(m, "datalogger_adc_enabled", METRICS_GAUGE, "ADC channel is sampled (1) or not (0)");
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        metrics_writer_uint(m, &channel[i], 1, adc_manager_is_channel_enabled(i));
+    }
+    metrics_writer_family(m, "datalogger_adc_samples_total", METRICS_COUNTER, "ADC samples taken");
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        metrics_writer_uint(m, &channel[i], 1, adc[i].total_samples);
+    }
+    metrics_writer_family(m, "datalogger_adc_dropped_samples_total", METRICS_COUNTER, "ADC samples dropped on a full queue");
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        metrics_writer_uint(m, &channel[i], 1, adc[i].dropped_samples);
+    }
+    metrics_writer_family(m, "datalogger_adc_errors_total", METRICS_COUNTER, "ADC read errors");
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        metrics_writer_uint(m, &channel[i], 1, adc[i].error_count);
+    }
+    metrics_writer_family(m, "datalogger_adc_voltage_min_volts", METRICS_GAUGE, "Lowest voltage since start");
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        metrics_writer_fixed(m, &channel[i], 1, adc[i].min_voltage, 4);
+    }
+    metrics_writer_family(m, "datalogger_adc_voltage_max_volts", METRICS_GAUGE, "Highest voltage since start");
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        metrics_writer_fixed(m, &channel[i], 1, adc[i].max_voltage, 4);
+    }
+    metrics_writer_family(m, "datalogger_adc_voltage_avg_volts", METRICS_GAUGE, "Mean voltage since start");
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        metrics_writer_fixed(m, &channel[i], 1, adc[i].avg_voltage, 4);
+    }
+}
+
+static void write_storage_metrics(metrics_writer_t *m) {
+    storage_stats_t s;
+    if (storage_manager_get_stats(&s) != ESP_OK) {
+        return;
+    }
+
+    metrics_value(m, "datalogger_storage_writes_total", METRICS_COUNTER, "Records written", s.total_writes);
+    metrics_value(m, "datalogger_storage_write_errors_total", METRICS_COUNTER, "Record write errors", s.write_errors);
+    metrics_value(m, "datalogger_storage_written_bytes_total", METRICS_COUNTER, "Record bytes written", s.bytes_written);
+    metrics_seconds(m, "datalogger_storage_last_write_age_seconds", METRICS_GAUGE, "Time since the last record write",
+                    s.last_write_time ? esp_timer_get_time() - s.last_write_time : 0);
+    metrics_value(m, "datalogger_storage_files_created_total", METRICS_COUNTER, "Log files created", s.files_created);
+    metrics_value(m, "datalogger_storage_files_rotated_total", METRICS_COUNTER, "Log files rotated", s.files_rotated);
+    metrics_value(m, "datalogger_storage_files_deleted_total", METRICS_COUNTER, "Old log files deleted by the space manager", s.files_deleted);
+    metrics_value(m, "datalogger_storage_reclaimed_bytes_total", METRICS_COUNTER, "Bytes freed by deleting old logs", s.bytes_reclaimed);
+    metrics_value(m, "datalogger_storage_recovered_files_total", METRICS_COUNTER, "Files checked by the boot recovery scan", s.recovered_files);
+    metrics_value(m, "datalogger_storage_recovered_truncated_bytes_total", METRICS_COUNTER, "Torn tail bytes removed by recovery", s.recovered_truncated_bytes);
+
+    metrics_value(m, "datalogger_storage_chunks_written_total", METRICS_COUNTER, "Chunks written to log files", s.chunks_written);
+    metrics_value(m, "datalogger_storage_chunks_compressed_total", METRICS_COUNTER, "Chunks stored compressed", s.chunks_compressed);
+    metrics_value(m, "datalogger_storage_compress_input_bytes_total", METRICS_COUNTER, "Bytes offered to the compressor", s.compress_bytes_in);
+    metrics_value(m, "datalogger_storage_compress_output_bytes_total", METRICS_COUNTER, "Bytes stored for compressed chunks", s.compress_bytes_out);
+    metrics_seconds(m, "datalogger_storage_compress_seconds_total", METRICS_COUNTER, "CPU time spent compressing", s.compress_time_us);
+    metrics_value(m, "datalogger_storage_write_batches_total", METRICS_COUNTER, "Writer passes over full chunks", s.write_batches);
+    metrics_value(m, "datalogger_storage_batched_chunks_total", METRICS_COUNTER, "Chunks written by writer passes", s.batched_chunks);
+
+    metrics_value(m, "datalogger_storage_syncs_total", METRICS_COUNTER, "Group commits", s.sync_count);
+    metrics_value(m, "datalogger_storage_sync_errors_total", METRICS_COUNTER, "Failed fflush/fsync calls", s.sync_errors);
+    metrics_seconds(m, "datalogger_storage_sync_seconds_total", METRICS_COUNTER, "Time spent in group commits", s.sync_time_us);
+    metrics_value(m, "datalogger_storage_last_sync_bytes", METRICS_GAUGE, "Bytes at risk before the last commit", s.last_sync_bytes);
+    metrics_seconds(m, "datalogger_storage_last_sync_window_seconds", METRICS_GAUGE, "Age of the oldest uncommitted record at the last commit",
+                    (uint64_t)s.last_sync_window_ms * 1000);
+    metrics_value(m, "datalogger_storage_max_sync_bytes", METRICS_GAUGE, "Most data ever at risk", s.max_sync_bytes);
+    metrics_value(m, "datalogger_storage_at_risk_bytes", METRICS_GAUGE, "Bytes accepted but not yet committed", s.bytes_at_risk);
+
+    metrics_value(m, "datalogger_sd_available", METRICS_GAUGE, "SD card takes writes (0: records go to the spill tier)", s.sd_available);
+    metrics_value(m, "datalogger_sd_size_bytes", METRICS_GAUGE, "SD card capacity", s.card_total_bytes);
+    metrics_value(m, "datalogger_sd_free_bytes", METRICS_GAUGE, "SD card free space", s.card_free_bytes);
+    metrics_value(m, "datalogger_sd_faults_total", METRICS_COUNTER, "Write/sync failures that switched to the spill tier", s.sd_faults);
+    metrics_value(m, "datalogger_sd_slow_writes_total", METRICS_COUNTER, "SD writes slower than the spill latency threshold", s.sd_stalls);
+    metrics_value(m, "datalogger_sd_stalls_total", METRICS_COUNTER, "SD operations of 100 ms or more", s.write_stalls);
+    metrics_value(m, "datalogger_sd_written_bytes_total", METRICS_COUNTER, "Bytes handed to the card", s.sd_write_bytes);
+    metrics_seconds(m, "datalogger_sd_write_latency_max_seconds", METRICS_GAUGE, "Slowest SD write or sync", s.write_latency_max_us);
+
+    uint32_t bounds_us[STORAGE_LATENCY_BUCKETS - 1];
+    for (int i = 0; i < STORAGE_LATENCY_BUCKETS - 1; i++) {
+        bounds_us[i] = STORAGE_LATENCY_BUCKET0_US << i;
+    }
+    metrics_writer_family(m, "datalogger_sd_write_latency_seconds", METRICS_HISTOGRAM, "SD write and sync latency");
+    metrics_writer_histogram(m, NULL, 0, s.write_latency_hist, bounds_us, STORAGE_LATENCY_BUCKETS, s.sd_write_time_us);
+
+    metrics_value(m, "datalogger_spill_pending_bytes", METRICS_GAUGE, "Spilled data waiting to be drained", s.spill_pending_bytes);
+    metrics_value(m, "datalogger_spill_capacity_bytes", METRICS_GAUGE, "Spill tier size (0 when not mounted)", s.spill_capacity_bytes);
+    metrics_value(m, "datalogger_spill_dropped_records_total", METRICS_COUNTER, "Records lost because the spill was full", s.spill_records_dropped);
+
+    static const char *const priorities[STORAGE_PRIORITY_LEVELS] = {"event", "frame", "bulk"};
+    metrics_label_t priority[STORAGE_PRIORITY_LEVELS];
+    for (int i = 0; i < STORAGE_PRIORITY_LEVELS; i++) {
+        priority[i] = (metrics_label_t){ .name = "priority", .value = priorities[i] };
+    }
+    metrics_writer_family(m, "datalogger_storage_queue_enqueued_total", METRICS_COUNTER, "Records accepted per priority");
+    for (int i = 0; i < STORAGE_PRIORITY_LEVELS; i++) {
+        metrics_writer_uint(m, &priority[i], 1, s.queue_enqueued[i]);
+    }
+    metrics_writer_family(m, "datalogger_storage_queue_shed_total", METRICS_COUNTER, "Records rejected per priority (queue full or shed)");
+    for (int i = 0; i < STORAGE_PRIORITY_LEVELS; i++) {
+        metrics_writer_uint(m, &priority[i], 1, s.queue_shed[i]);
+    }
+    metrics_writer_family(m, "datalogger_storage_queue_high_water", METRICS_GAUGE, "Deepest backlog seen per priority");
+    for (int i = 0; i < STORAGE_PRIORITY_LEVELS; i++) {
+        metrics_writer_uint(m, &priority[i], 1, s.queue_high_water[i]);
+    }
+    metrics_writer_family(m, "datalogger_storage_queue_max_wait_seconds", METRICS_GAUGE, "Longest time a record waited per priority");
+    for (int i = 0; i < STORAGE_PRIORITY_LEVELS; i++) {
+        metrics_writer_fixed(m, &priority[i], 1, s.queue_max_wait_us[i] / 1e6, 6);
+    }
+
+    metrics_value(m, "datalogger_storage_staging_blocks", METRICS_GAUGE, "Staging pool blocks allocated", s.staging_blocks);
+    metrics_value(m, "datalogger_storage_staging_block_limit", METRICS_GAUGE, "Staging pool limit set from recent card stalls", s.staging_block_limit);
+    metrics_value(m, "datalogger_storage_staging_peak_blocks", METRICS_GAUGE, "Most staging blocks in use", s.staging_peak_blocks);
+    metrics_value(m, "datalogger_storage_staging_records", METRICS_GAUGE, "Records waiting in the staging pool", s.staging_records);
+    metrics_value(m, "datalogger_storage_staged_records_total", METRICS_COUNTER, "Records that overflowed into the staging pool", s.staged_records);
+    metrics_value(m, "datalogger_storage_open_streams", METRICS_GAUGE, "Streams with an open log file", s.open_streams);
+    metrics_value(m, "datalogger_storage_chunk_buffers", METRICS_GAUGE, "Chunk buffers allocated from the shared pool", s.chunk_buffers);
+    metrics_value(m, "datalogger_storage_chunk_buffers_peak", METRICS_GAUGE, "Most chunk buffers in use", s.chunk_buffers_peak);
+}
+
+static void write_network_metrics(metrics_writer_t *m) {
+    network_stats_t n;
+    network_manager_get_stats(&n);
+
+    metrics_value(m, "datalogger_wifi_connected", METRICS_GAUGE, "WiFi station is connected", g_network_manager.wifi_connected);
+    metrics_value(m, "datalogger_http_api_requests_total", METRICS_COUNTER, "API requests served", n.api_requests);
+    metrics_value(m, "datalogger_http_sent_bytes_total", METRICS_COUNTER, "Response bytes sent", n.bytes_sent);
+    metrics_value(m, "datalogger_http_received_bytes_total", METRICS_COUNTER, "Request bytes received", n.bytes_received);
+    metrics_value(m, "datalogger_http_connection_errors_total", METRICS_COUNTER, "Connection errors", n.connection_errors);
+    metrics_value(m, "datalogger_http_downloads_total", METRICS_COUNTER, "Log downloads completed", n.downloads);
+    metrics_value(m, "datalogger_http_download_errors_total", METRICS_COUNTER, "Log downloads aborted", n.download_errors);
+    metrics_value(m, "datalogger_http_download_bytes_total", METRICS_COUNTER, "Log bytes sent", n.download_bytes);
+    metrics_seconds(m, "datalogger_http_download_read_seconds_total", METRICS_COUNTER, "Time spent reading logs for downloads", n.download_read_us);
+    metrics_seconds(m, "datalogger_http_download_seconds_total", METRICS_COUNTER, "Time spent serving log downloads", n.download_time_us);
+    metrics_value(m, "datalogger_websocket_connections_total", METRICS_COUNTER, "WebSocket connections", n.websocket_connections);
+    metrics_value(m, "datalogger_sse_connections_total", METRICS_COUNTER, "Server-Sent Events connections", n.sse_connections);
+    metrics_value(m, "datalogger_stream_frames_total", METRICS_COUNTER, "Binary stream frames published", n.stream_frames);
+    metrics_value(m, "datalogger_stream_samples_total", METRICS_COUNTER, "ADC samples packed into stream frames", n.stream_samples);
+
+    stream_fanout_stats_t fanout;
+    if (stream_fanout_get_stats(&fanout) == ESP_OK) {
+        metrics_value(m, "datalogger_stream_published_total", METRICS_COUNTER, "Messages published to stream clients", fanout.published);
+        metrics_value(m, "datalogger_stream_evictions_total", METRICS_COUNTER, "Stream clients evicted", fanout.evictions);
+        metrics_value(m, "datalogger_stream_alloc_failures_total", METRICS_COUNTER, "Stream messages lost to allocation failures", fanout.alloc_failures);
+
+        // Per client slot; the labels name the connection in the slot now
+        metrics_label_t client[STREAM_FANOUT_MAX_CLIENTS][2];
+        for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+            client[i][0] = (metrics_label_t){ .name = "slot", .index = i };
+            client[i][1] = (metrics_label_t){ .name = "transport",
+                                              .value = fanout.clients[i].transport ? fanout.clients[i].transport : "" };
+        }
+        static const struct {
+            const char *name;
+            metrics_type_t type;
+            const char *help;
+            size_t offset;
+        } client_metrics[] = {
+            {"datalogger_stream_client_queued", METRICS_GAUGE, "Messages waiting for the client", offsetof(stream_client_stats_t, queued)},
+            {"datalogger_stream_client_sent_total", METRICS_COUNTER, "Messages sent to the client", offsetof(stream_client_stats_t, sent)},
+            {"datalogger_stream_client_dropped_total", METRICS_COUNTER, "Messages pushed out of a full client queue", offsetof(stream_client_stats_t, dropped)},
+            {"datalogger_stream_client_stale_total", METRICS_COUNTER, "Messages skipped as too old", offsetof(stream_client_stats_t, stale)},
+            {"datalogger_stream_client_send_errors_total", METRICS_COUNTER, "Failed sends to the client", offsetof(stream_client_stats_t, send_errors)},
+        };
+        for (size_t k = 0; k < sizeof(client_metrics) / sizeof(client_metrics[0]); k++) {
+            metrics_writer_family(m, client_metrics[k].name, client_metrics[k].type, client_metrics[k].help);
+            for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+                if (fanout.clients[i].active) {
+                    uint32_t value;
+                    memcpy(&value, (const uint8_t *)&fanout.clients[i] + client_metrics[k].offset, sizeof(value));
+                    metrics_writer_uint(m, client[i], 2, value);
+                }
+            }
+        }
+        metrics_writer_family(m, "datalogger_stream_client_sent_bytes_total", METRICS_COUNTER, "Bytes sent to the client");
+        for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+            if (fanout.clients[i].active) {
+                metrics_writer_uint(m, client[i], 2, fanout.clients[i].bytes);
+            }
+        }
+        metrics_writer_family(m, "datalogger_stream_client_latency_avg_seconds", METRICS_GAUGE, "Mean publish-to-sent latency");
+        for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+            if (fanout.clients[i].active) {
+                metrics_writer_fixed(m, client[i], 2, fanout.clients[i].latency_avg_us / 1e6, 6);
+            }
+        }
+        metrics_writer_family(m, "datalogger_stream_client_latency_max_seconds", METRICS_GAUGE, "Worst publish-to-sent latency");
+        for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+            if (fanout.clients[i].active) {
+                metrics_writer_fixed(m, client[i], 2, fanout.clients[i].latency_max_us / 1e6, 6);
+            }
+        }
+    }
+
+    stream_udp_stats_t udp;
+    if (stream_udp_get_stats(&udp) == ESP_OK) {
+        metrics_value(m, "datalogger_udp_running", METRICS_GAUGE, "UDP streamer is sending", udp.running);
+        metrics_value(m, "datalogger_udp_datagrams_total", METRICS_COUNTER, "UDP datagrams sent", udp.datagrams);
+        metrics_value(m, "datalogger_udp_frames_total", METRICS_COUNTER, "Stream frames sent over UDP", udp.frames);
+        metrics_value(m, "datalogger_udp_sent_bytes_total", METRICS_COUNTER, "UDP payload bytes sent", udp.bytes);
+        metrics_value(m, "datalogger_udp_send_errors_total", METRICS_COUNTER, "Datagrams a destination did not take", udp.send_errors);
+        metrics_seconds(m, "datalogger_udp_send_max_seconds", METRICS_GAUGE, "Longest time spent sending one datagram", udp.send_max_us);
+        metrics_seconds(m, "datalogger_udp_sample_age_max_seconds", METRICS_GAUGE, "Oldest sample at send (batching delay)", udp.age_max_us);
+    }
+}
+
+static void write_spi_metrics(metrics_writer_t *m) {
+    static const char *const spi_clients[SPI_CLIENT_COUNT] = {"sd", "lcd"};
+    spi_client_stats_t bus[SPI_CLIENT_COUNT];
+    metrics_label_t bus_client[SPI_CLIENT_COUNT];
+    for (int i = 0; i < SPI_CLIENT_COUNT; i++) {
+        spi_arbiter_get_stats(i, &bus[i]);
+        bus_client[i] = (metrics_label_t){ .name = "client", .value = spi_clients[i] };
+    }
+    metrics_writer_family(m, "datalogger_spi_grants_total", METRICS_COUNTER, "Times the client got the shared SPI bus");
+    for (int i = 0; i < SPI_CLIENT_COUNT; i++) {
+        metrics_writer_uint(m, &bus_client[i], 1, bus[i].grants);
+    }
+    metrics_writer_family(m, "datalogger_spi_busy_seconds_total", METRICS_COUNTER, "Time holding the shared SPI bus");
+    for (int i = 0; i < SPI_CLIENT_COUNT; i++) {
+        metrics_writer_fixed(m, &bus_client[i], 1, bus[i].busy_us / 1e6, 6);
+    }
+    metrics_writer_family(m, "datalogger_spi_wait_seconds_total", METRICS_COUNTER, "Time waiting for the shared SPI bus");
+    for (int i = 0; i < SPI_CLIENT_COUNT; i++) {
+        metrics_writer_fixed(m, &bus_client[i], 1, bus[i].wait_us / 1e6, 6);
+    }
+    metrics_writer_family(m, "datalogger_spi_wait_max_seconds", METRICS_GAUGE, "Worst wait for the shared SPI bus");
+    for (int i = 0; i < SPI_CLIENT_COUNT; i++) {
+        metrics_writer_fixed(m, &bus_client[i], 1, bus[i].max_wait_us / 1e6, 6);
+    }
+    metrics_writer_family(m, "datalogger_spi_yields_total", METRICS_COUNTER, "Bus hand-overs cut short for the other client");
+    for (int i = 0; i < SPI_CLIENT_COUNT; i++) {
+        metrics_writer_uint(m, &bus_client[i], 1, bus[i].yields);
+    }
+}
+
+static esp_err_t metrics_handler(httpd_req_t *req) {
+    metrics_response_t response;
+    metrics_writer_t *m = &response.writer;
+    httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+    metrics_writer_init(m, response.buffer, sizeof(response.buffer), json_send_chunk, req);
+
+    metrics_seconds(m, "datalogger_uptime_seconds", METRICS_GAUGE, "Time since boot", esp_timer_get_time());
+    metrics_value(m, "datalogger_heap_free_bytes", METRICS_GAUGE, "Free heap", esp_get_free_heap_size());
+    metrics_value(m, "datalogger_heap_min_free_bytes", METRICS_GAUGE, "Lowest free heap since boot", esp_get_minimum_free_heap_size());
+
+    write_uart_metrics(m);
+    write_adc_metrics(m);
+    write_storage_metrics(m);
+    write_network_metrics(m);
+    write_spi_metrics(m);
 
     g_network_manager.stats.api_requests++;
-    return ESP_OK;
+    g_network_manager.stats.bytes_sent += m->out.total;
+
+    esp_err_t ret = metrics_writer_finish(m);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Metrics response aborted: %s", esp_err_to_name(ret));
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
 static esp_err_t data_latest_handler(httpd_req_t *req) {
-    cJSON *json = cJSON_CreateObject();
-    cJSON *timestamp = cJSON_CreateNumber(esp_timer_get_time());
-    cJSON_AddItemToObject(json, "timestamp", timestamp);
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+
+    json_writer_begin_object(json, NULL);
+    json_writer_int(json, "timestamp", esp_timer_get_time());
 
     // Get UART data
-    cJSON *uart_data = cJSON_CreateObject();
+    json_writer_begin_object(json, "uart");
     for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
         if (uart_manager_is_channel_active(i)) {
             uart_data_packet_t packet;
@@ -145,22 +606,18 @@ static esp_err_t data_latest_handler(httpd_req_t *req) {
                 char port_name[16];
                 snprintf(port_name, sizeof(port_name), "port%d", i);
 
-                cJSON *port_data = cJSON_CreateObject();
-                cJSON *data_str = cJSON_CreateString((char*)packet.data);
-                cJSON *length = cJSON_CreateNumber(packet.length);
-                cJSON *seq = cJSON_CreateNumber(packet.sequence);
-
-                cJSON_AddItemToObject(port_data, "data", data_str);
-                cJSON_AddItemToObject(port_data, "length", length);
-                cJSON_AddItemToObject(port_data, "sequence", seq);
-                cJSON_AddItemToObject(uart_data, port_name, port_data);
+                json_writer_begin_object(json, port_name);
+                json_writer_string(json, "data", (char*)packet.data);
+                json_writer_uint(json, "length", packet.length);
+                json_writer_uint(json, "sequence", packet.sequence);
+                json_writer_end_object(json);
             }
         }
     }
-    cJSON_AddItemToObject(json, "uart", uart_data);
+    json_writer_end_object(json);
 
     // Get ADC data from queue (latest samples)
-    cJSON *adc_data = cJSON_CreateObject();
+    json_writer_begin_object(json, "adc");
     for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
         if (adc_manager_is_channel_enabled(i)) {
             // Try to get latest queued data first
@@ -178,121 +635,708 @@ static esp_err_t data_latest_handler(httpd_req_t *req) {
 
             char channel_name[16];
             snprintf(channel_name, sizeof(channel_name), "channel%d", i);
-            cJSON *channel_data = cJSON_CreateObject();
+            json_writer_begin_object(json, channel_name);
 
             if (got_queued_data) {
                 // Use queued data (from continuous sampling)
-                cJSON *voltage_val = cJSON_CreateNumber(packet.filtered_voltage);
-                cJSON *raw_val = cJSON_CreateNumber(packet.raw_value);
-                cJSON *seq_val = cJSON_CreateNumber(packet.sequence);
-                cJSON_AddItemToObject(channel_data, "voltage", voltage_val);
-                cJSON_AddItemToObject(channel_data, "raw", raw_val);
-                cJSON_AddItemToObject(channel_data, "sequence", seq_val);
+                json_writer_fixed(json, "voltage", packet.filtered_voltage, 4);
+                json_writer_int(json, "raw", packet.raw_value);
+                json_writer_uint(json, "sequence", packet.sequence);
             } else {
                 // Fallback to instant reading if no queued data
                 float voltage;
                 if (adc_manager_get_instant_reading(i, &voltage) == ESP_OK) {
-                    cJSON *voltage_val = cJSON_CreateNumber(voltage);
-                    cJSON_AddItemToObject(channel_data, "voltage", voltage_val);
-                    cJSON_AddItemToObject(channel_data, "source", cJSON_CreateString("instant"));
+                    json_writer_fixed(json, "voltage", voltage, 4);
+                    json_writer_string(json, "source", "instant");
                 }
             }
 
-            cJSON_AddItemToObject(adc_data, channel_name, channel_data);
+            json_writer_end_object(json);
         }
     }
-    cJSON_AddItemToObject(json, "adc", adc_data);
+    json_writer_end_object(json);
 
-    char *json_string = cJSON_Print(json);
+    json_writer_end_object(json);
+    return json_response_end(req, &response);
+}
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_send(req, json_string, strlen(json_string));
+#define DATA_HISTORY_DEFAULT_POINTS     500
+
+// Recent ADC history from the RAM ring, downsampled on the device:
+// GET /api/data/history?ch=0&from=<us>&points=500
+// Returns [timestamp_us, voltage] points picked with Largest-Triangle-
+// Three-Buckets. from defaults to the oldest period still held; a negative
+// from is relative to now (from=-10000000: the last 10 s).
+static esp_err_t data_history_handler(httpd_req_t *req) {
+    char query[96] = {0};
+    char value[24];
+    uint32_t channel = 0;
+    uint64_t from_us = 0;
+    uint32_t max_points = DATA_HISTORY_DEFAULT_POINTS;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "ch", value, sizeof(value)) == ESP_OK) {
+            channel = strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "from", value, sizeof(value)) == ESP_OK) {
+            int64_t from = strtoll(value, NULL, 10);
+            int64_t now_us = esp_timer_get_time();
+            from_us = (from >= 0) ? (uint64_t)from : (uint64_t)(now_us + from > 0 ? now_us + from : 0);
+        }
+        if (httpd_query_key_value(query, "points", value, sizeof(value)) == ESP_OK) {
+            max_points = strtoul(value, NULL, 10);
+        }
+    }
 
-    free(json_string);
-    cJSON_Delete(json);
+    if (!CONFIG_VALIDATE_ADC_CHANNEL(channel)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid ADC channel");
+    }
+    if (max_points < 3) {
+        max_points = 3;
+    } else if (max_points > ADC_HISTORY_MAX_POINTS) {
+        max_points = ADC_HISTORY_MAX_POINTS;
+    }
 
-    g_network_manager.stats.api_requests++;
-    return ESP_OK;
+    // The ring is locked only while picking points, not while they are sent
+    adc_history_point_t *points = malloc(max_points * sizeof(adc_history_point_t));
+    if (!points) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    uint32_t count = 0;
+    esp_err_t ret = adc_history_query(channel, from_us, max_points, points, &count);
+    if (ret != ESP_OK) {
+        free(points);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, esp_err_to_name(ret));
+    }
+
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+
+    json_writer_begin_object(json, NULL);
+    json_writer_uint(json, "channel", channel);
+    json_writer_uint(json, "period_ms", ADC_HISTORY_PERIOD_US / 1000);
+    json_writer_uint(json, "now_us", esp_timer_get_time());
+    json_writer_uint(json, "from", from_us);
+    json_writer_begin_array(json, "points");
+    for (uint32_t i = 0; i < count; i++) {
+        json_writer_begin_array(json, NULL);
+        json_writer_uint(json, NULL, (uint64_t)points[i].period * ADC_HISTORY_PERIOD_US);
+        json_writer_fixed(json, NULL, points[i].millivolts / 1000.0, 3);
+        json_writer_end_array(json);
+    }
+    json_writer_end_array(json);
+    json_writer_end_object(json);
+
+    free(points);
+    return json_response_end(req, &response);
 }
 
 static esp_err_t config_get_handler(httpd_req_t *req) {
     system_config_t* config = config_get_instance();
 
-    cJSON *json = cJSON_CreateObject();
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+
+    json_writer_begin_object(json, NULL);
 
     // Device info
-    cJSON *device_name = cJSON_CreateString(config->device_name);
-    cJSON_AddItemToObject(json, "device_name", device_name);
+    json_writer_string(json, "device_name", config->device_name);
 
     // UART config
-    cJSON *uart_config = cJSON_CreateArray();
+    json_writer_begin_array(json, "uart");
     for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
-        cJSON *uart = cJSON_CreateObject();
-        cJSON *port = cJSON_CreateNumber(i);
-        cJSON *enabled = cJSON_CreateBool(config->uart_config[i].enabled);
-        cJSON *baud = cJSON_CreateNumber(config->uart_config[i].baud_rate);
-
-        cJSON_AddItemToObject(uart, "port", port);
-        cJSON_AddItemToObject(uart, "enabled", enabled);
-        cJSON_AddItemToObject(uart, "baud_rate", baud);
-        cJSON_AddItemToArray(uart_config, uart);
+        json_writer_begin_object(json, NULL);
+        json_writer_int(json, "port", i);
+        json_writer_bool(json, "enabled", config->uart_config[i].enabled);
+        json_writer_uint(json, "baud_rate", config->uart_config[i].baud_rate);
+        json_writer_bool(json, "compress", config->uart_config[i].compress_log);
+        json_writer_end_object(json);
     }
-    cJSON_AddItemToObject(json, "uart", uart_config);
+    json_writer_end_array(json);
 
     // ADC config
-    cJSON *adc_config = cJSON_CreateArray();
+    json_writer_begin_array(json, "adc");
     for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
-        cJSON *adc = cJSON_CreateObject();
-        cJSON *channel = cJSON_CreateNumber(i);
-        cJSON *enabled = cJSON_CreateBool(config->adc_config[i].enabled);
-        cJSON *sample_rate = cJSON_CreateNumber(config->adc_config[i].sample_rate_hz);
+        json_writer_begin_object(json, NULL);
+        json_writer_int(json, "channel", i);
+        json_writer_bool(json, "enabled", config->adc_config[i].enabled);
+        json_writer_uint(json, "sample_rate", config->adc_config[i].sample_rate_hz);
+        json_writer_end_object(json);
+    }
+    json_writer_end_array(json);
+
+    json_writer_end_object(json);
+    return json_response_end(req, &response);
+}
+
+// SD card benchmark, run synchronously and returned as JSON
+static esp_err_t bench_handler(httpd_req_t *req) {
+    ESP_LOGI(TAG, "Running SD card benchmark via API");
 
-        cJSON_AddItemToObject(adc, "channel", channel);
-        cJSON_AddItemToObject(adc, "enabled", enabled);
-        cJSON_AddItemToObject(adc, "sample_rate", sample_rate);
-        cJSON_AddItemToArray(adc_config, adc);
+    storage_bench_result_t bench;
+    esp_err_t ret = storage_bench_run(&bench);
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, esp_err_to_name(ret));
+        return ESP_FAIL;
     }
-    cJSON_AddItemToObject(json, "adc", adc_config);
+    storage_bench_print(&bench);
 
-    char *json_string = cJSON_Print(json);
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_send(req, json_string, strlen(json_string));
+    json_writer_begin_object(json, NULL);
+    json_writer_string(json, "card", bench.card_name);
+    json_writer_bool(json, "high_capacity", bench.high_capacity);
+    json_writer_uint(json, "size_mb", bench.card_size_mb);
+    json_writer_uint(json, "bus_freq_khz", bench.bus_freq_khz);
 
-    free(json_string);
-    cJSON_Delete(json);
+    json_writer_begin_array(json, "sequential");
+    for (int i = 0; i < STORAGE_BENCH_BLOCK_SIZES; i++) {
+        json_writer_begin_object(json, NULL);
+        json_writer_uint(json, "block_size", bench.seq[i].block_size);
+        json_writer_uint(json, "write_kbps", bench.seq[i].write_kbps);
+        json_writer_uint(json, "read_kbps", bench.seq[i].read_kbps);
+        json_writer_end_object(json);
+    }
+    json_writer_end_array(json);
 
-    g_network_manager.stats.api_requests++;
-    return ESP_OK;
+    json_writer_uint(json, "random_read_iops", bench.random_read_iops);
+    json_writer_uint(json, "random_read_avg_us", bench.random_read_avg_us);
+    json_writer_uint(json, "fsync_avg_us", bench.fsync_avg_us);
+    json_writer_uint(json, "fsync_max_us", bench.fsync_max_us);
+    json_writer_uint(json, "verify_errors", bench.verify_errors);
+    json_writer_uint(json, "duration_ms", bench.duration_ms);
+    json_writer_end_object(json);
+
+    return json_response_end(req, &response);
 }
 
 static esp_err_t test_handler(httpd_req_t *req) {
-    ESP_LOGI(TAG, "Running test suite via API");
-
-    cJSON *json = cJSON_CreateObject();
-    cJSON *status = cJSON_CreateString("running");
-    cJSON_AddItemToObject(json, "status", status);
-
-    char *json_string = cJSON_Print(json);
+    char query[32];
+    char value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "bench", value, sizeof(value)) == ESP_OK &&
+        strcmp(value, "sd") == 0) {
+        return bench_handler(req);
+    }
 
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_send(req, json_string, strlen(json_string));
+    ESP_LOGI(TAG, "Running test suite via API");
 
-    free(json_string);
-    cJSON_Delete(json);
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+    json_writer_begin_object(json, NULL);
+    json_writer_string(json, "status", "running");
+    json_writer_end_object(json);
+    esp_err_t ret = json_response_end(req, &response);
 
     // Run test suite in background
     esp_err_t test_result = data_logger_run_full_test_suite();
     ESP_LOGI(TAG, "Test suite completed with result: %s",
              test_result == ESP_OK ? "PASS" : "FAIL");
 
-    g_network_manager.stats.api_requests++;
+    return ret;
+}
+
+// Log file listing, served from the in-RAM storage catalog. Entries are
+// copied out one at a time, so the catalog is not locked while sending.
+static esp_err_t logs_list_handler(httpd_req_t *req) {
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+
+    json_writer_begin_array(json, NULL);
+    storage_catalog_entry_t entry;
+    bool open;
+    for (uint32_t i = 0; json->out.error == ESP_OK && storage_manager_get_file(i, &entry, &open); i++) {
+        json_writer_begin_object(json, NULL);
+        json_writer_string(json, "name", entry.name);
+        json_writer_string(json, "type", storage_data_type_name(entry.data_type));
+        json_writer_uint(json, "source", entry.source_id);
+        json_writer_uint(json, "size", entry.size);
+        json_writer_uint(json, "records", entry.record_count);
+        json_writer_int(json, "created", entry.created);
+        json_writer_uint(json, "first_us", entry.first_timestamp_us);
+        json_writer_uint(json, "last_us", entry.last_timestamp_us);
+        json_writer_bool(json, "open", open);
+        json_writer_uint(json, "scrub", entry.scrub_verdict);
+        json_writer_uint(json, "corrupt_bytes", entry.corrupt_bytes);
+        json_writer_end_object(json);
+    }
+    json_writer_end_array(json);
+
+    return json_response_end(req, &response);
+}
+
+// Range numbers are plain digits; strtoull alone would also take a sign or spaces
+static bool parse_range_number(const char *p, unsigned long long *value, char **endp) {
+    if (!isdigit((unsigned char)*p)) {
+        return false;
+    }
+    *value = strtoull(p, endp, 10);
+    return true;
+}
+
+// Parse a single "bytes=start-end", "bytes=start-" or "bytes=-suffix" range.
+// Multi-range and malformed headers are ignored, as RFC 9110 allows.
+network_range_t network_manager_parse_range(const char *header, size_t total,
+                                            size_t *start, size_t *end) {
+    if (strncmp(header, "bytes=", 6) != 0 || strchr(header, ',')) {
+        return NETWORK_RANGE_NONE;
+    }
+
+    const char *p = header + 6;
+    char *endp;
+
+    if (*p == '-') {
+        unsigned long long suffix;
+        if (!parse_range_number(p + 1, &suffix, &endp) || *endp != '\0') {
+            return NETWORK_RANGE_NONE;
+        }
+        if (suffix == 0 || total == 0) {
+            return NETWORK_RANGE_UNSATISFIABLE;
+        }
+        *start = (suffix >= total) ? 0 : total - suffix;
+        *end = total - 1;
+        return NETWORK_RANGE_PARTIAL;
+    }
+
+    unsigned long long first;
+    if (!parse_range_number(p, &first, &endp) || *endp != '-') {
+        return NETWORK_RANGE_NONE;
+    }
+
+    p = endp + 1;
+    unsigned long long last = total - 1;
+    if (*p != '\0') {
+        if (!parse_range_number(p, &last, &endp) || *endp != '\0' || last < first) {
+            return NETWORK_RANGE_NONE;
+        }
+    }
+
+    if (first >= total) {
+        return NETWORK_RANGE_UNSATISFIABLE;
+    }
+
+    *start = first;
+    *end = (last >= total) ? total - 1 : last;
+    return NETWORK_RANGE_PARTIAL;
+}
+
+// Back off while the storage task has a backlog so logging is never starved.
+// Only the priority queues count; the staging pool holds overflow under
+// sustained logging and would otherwise throttle downloads for good. The
+// transfer waits in short steps for as long as the client stays connected.
+static bool client_connected(httpd_req_t *req) {
+    char byte;
+    int ret = recv(httpd_req_to_sockfd(req), &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return ret > 0 || (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+static esp_err_t wait_for_storage_headroom(httpd_req_t *req) {
+    while (storage_manager_is_running() && storage_manager_get_queued_records() > STORAGE_QUEUE_SIZE / 2) {
+        if (!client_connected(req)) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        vTaskDelay(pdMS_TO_TICKS(NETWORK_STORAGE_BACKOFF_MS));
+    }
     return ESP_OK;
 }
 
+// Log file download with Range support. Files still being written are
+// served up to their last group commit; the client can resume with a
+// Range request to pick up data committed later.
+typedef struct {
+    httpd_req_t *req;
+} export_sink_ctx_t;
+
+static esp_err_t export_sink(const char *data, size_t length, void *arg) {
+    export_sink_ctx_t *ctx = arg;
+
+    // A client that leaves during a backlog aborts the export like a failed send
+    esp_err_t ret = wait_for_storage_headroom(ctx->req);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return httpd_resp_send_chunk(ctx->req, data, length);
+}
+
+// Log file decoded to text:
+// GET /api/logs/<name>/export?format=csv|ndjson&start=<us>&end=<us>&channel=<n>
+static esp_err_t logs_export_handler(httpd_req_t *req, const char *name) {
+    char query[128] = {0};
+    char value[24];
+    storage_export_filter_t filter = {
+        .format = STORAGE_EXPORT_CSV,
+        .start_us = 0,
+        .end_us = UINT64_MAX,
+        .channel = STORAGE_EXPORT_ALL_CHANNELS
+    };
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK) {
+            if (strcmp(value, "ndjson") == 0) {
+                filter.format = STORAGE_EXPORT_NDJSON;
+            } else if (strcmp(value, "csv") != 0) {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Format must be csv or ndjson");
+            }
+        }
+        if (httpd_query_key_value(query, "start", value, sizeof(value)) == ESP_OK) {
+            filter.start_us = strtoull(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "end", value, sizeof(value)) == ESP_OK) {
+            filter.end_us = strtoull(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "channel", value, sizeof(value)) == ESP_OK) {
+            filter.channel = strtol(value, NULL, 10);
+            if (filter.channel < 0 || filter.channel > UINT8_MAX) {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid channel");
+            }
+        }
+    }
+
+    storage_catalog_entry_t entry;
+    size_t total = 0;
+    if (!storage_catalog_find(name, &entry) ||
+        storage_manager_get_readable_size(name, &total, NULL) != ESP_OK) {
+        return httpd_resp_send_404(req);
+    }
+
+    // Export file name: the log name with a .csv / .ndjson extension
+    char disposition[STORAGE_CATALOG_NAME_LEN + 48];
+    int base_len = strcspn(name, ".");
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%.*s.%s\"", base_len, name,
+             filter.format == STORAGE_EXPORT_CSV ? "csv" : "ndjson");
+    httpd_resp_set_type(req, filter.format == STORAGE_EXPORT_CSV ? "text/csv" : "application/x-ndjson");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+
+    // A file that cannot match the filters is not read at all
+    if (!storage_export_entry_matches(&entry, &filter)) {
+        g_network_manager.stats.api_requests++;
+        if (filter.format == STORAGE_EXPORT_CSV) {
+            httpd_resp_send_chunk(req, STORAGE_EXPORT_CSV_HEADER, strlen(STORAGE_EXPORT_CSV_HEADER));
+        }
+        return httpd_resp_send_chunk(req, NULL, 0);
+    }
+
+    char path[STORAGE_MAX_FILENAME_LEN];
+    snprintf(path, sizeof(path), "%s/%s", CONFIG_SD_MOUNT_POINT, name);
+    export_sink_ctx_t sink_ctx = { .req = req };
+    storage_export_result_t result;
+    uint64_t start_time = esp_timer_get_time();
+    esp_err_t ret = storage_export_file(path, total, &filter, export_sink, &sink_ctx, &result);
+    uint32_t elapsed_ms = (esp_timer_get_time() - start_time) / 1000;
+
+    g_network_manager.stats.api_requests++;
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Export of %s aborted: %s", name, esp_err_to_name(ret));
+        if (ret == ESP_ERR_NOT_FOUND || ret == ESP_ERR_NO_MEM) {
+            return httpd_resp_send_500(req);
+        }
+        // Returning an error makes the server close the connection mid-body
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Exported %s: %lu of %lu records, %lu chunks decoded, %lu skipped, %lu -> %lu bytes in %lu ms%s",
+             name, result.records_exported, result.records_scanned, result.chunks_decoded,
+             result.chunks_skipped, result.bytes_read, result.bytes_out, elapsed_ms,
+             result.truncated ? " (stopped at damaged chunk)" : "");
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static esp_err_t logs_download_handler(httpd_req_t *req) {
+    uint64_t start_time = esp_timer_get_time();
+
+    // File name follows /api/logs/, up to any query string or /export
+    char name[STORAGE_CATALOG_NAME_LEN];
+    const char *uri_name = req->uri + strlen("/api/logs/");
+    size_t name_len = strcspn(uri_name, "?");
+    bool export_text = false;
+    const char *export_suffix = "/export";
+    if (name_len > strlen(export_suffix) &&
+        strncmp(uri_name + name_len - strlen(export_suffix), export_suffix, strlen(export_suffix)) == 0) {
+        name_len -= strlen(export_suffix);
+        export_text = true;
+    }
+    if (name_len == 0 || name_len >= sizeof(name)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid log file name");
+    }
+    memcpy(name, uri_name, name_len);
+    name[name_len] = '\0';
+    if (strchr(name, '/') || strstr(name, "..")) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid log file name");
+    }
+    if (export_text) {
+        return logs_export_handler(req, name);
+    }
+
+    size_t total = 0;
+    bool active = false;
+    if (storage_manager_get_readable_size(name, &total, &active) != ESP_OK) {
+        return httpd_resp_send_404(req);
+    }
+
+    size_t start = 0;
+    size_t end = (total > 0) ? total - 1 : 0;
+    network_range_t range = NETWORK_RANGE_NONE;
+    char range_header[64];
+    if (httpd_req_get_hdr_value_str(req, "Range", range_header, sizeof(range_header)) == ESP_OK) {
+        range = network_manager_parse_range(range_header, total, &start, &end);
+    }
+
+    char content_range[64];
+    if (range == NETWORK_RANGE_UNSATISFIABLE) {
+        snprintf(content_range, sizeof(content_range), "bytes */%zu", total);
+        httpd_resp_set_status(req, "416 Range Not Satisfiable");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    if (!g_network_manager.download_buffer) {
+        g_network_manager.download_buffer = heap_caps_malloc(NETWORK_DOWNLOAD_CHUNK_SIZE, MALLOC_CAP_DMA);
+        if (!g_network_manager.download_buffer) {
+            ESP_LOGE(TAG, "Failed to allocate download buffer");
+            return httpd_resp_send_500(req);
+        }
+    }
+
+    char path[STORAGE_MAX_FILENAME_LEN];
+    snprintf(path, sizeof(path), "%s/%s", CONFIG_SD_MOUNT_POINT, name);
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return httpd_resp_send_404(req);
+    }
+
+    // Unbuffered: SD reads land directly in the DMA-capable buffer
+    setvbuf(file, NULL, _IONBF, 0);
+    if (start > 0 && fseek(file, start, SEEK_SET) != 0) {
+        fclose(file);
+        return httpd_resp_send_500(req);
+    }
+
+    char disposition[STORAGE_CATALOG_NAME_LEN + 32];
+    snprintf(disposition, sizeof(disposition), "attachment; filename=\"%s\"", name);
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+    httpd_resp_set_hdr(req, "Accept-Ranges", "bytes");
+    httpd_resp_set_hdr(req, "Content-Disposition", disposition);
+    httpd_resp_set_hdr(req, "X-Log-Active", active ? "true" : "false");
+    if (range == NETWORK_RANGE_PARTIAL) {
+        snprintf(content_range, sizeof(content_range), "bytes %zu-%zu/%zu", start, end, total);
+        httpd_resp_set_status(req, "206 Partial Content");
+        httpd_resp_set_hdr(req, "Content-Range", content_range);
+    }
+
+    size_t remaining = (total > 0) ? end - start + 1 : 0;
+    uint64_t read_us = 0;
+    esp_err_t ret = ESP_OK;
+    while (remaining > 0) {
+        // Throttled, not aborted, while the storage task catches up
+        ret = wait_for_storage_headroom(req);
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        size_t want = (remaining < NETWORK_DOWNLOAD_CHUNK_SIZE) ? remaining : NETWORK_DOWNLOAD_CHUNK_SIZE;
+        uint64_t read_start = esp_timer_get_time();
+        size_t got = fread(g_network_manager.download_buffer, 1, want, file);
+        read_us += esp_timer_get_time() - read_start;
+        if (got == 0) {
+            ret = ESP_FAIL;
+            break;
+        }
+
+        ret = httpd_resp_send_chunk(req, (const char *)g_network_manager.download_buffer, got);
+        if (ret != ESP_OK) {
+            break;
+        }
+        remaining -= got;
+        g_network_manager.stats.download_bytes += got;
+    }
+    fclose(file);
+
+    g_network_manager.stats.download_read_us += read_us;
+    g_network_manager.stats.download_time_us += esp_timer_get_time() - start_time;
+    g_network_manager.stats.api_requests++;
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Download of %s aborted with %zu bytes left: %s", name, remaining, esp_err_to_name(ret));
+        g_network_manager.stats.download_errors++;
+        // Returning an error makes the server close the connection mid-body
+        return ESP_FAIL;
+    }
+
+    g_network_manager.stats.downloads++;
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Scrub verdict counts, gathered under the catalog lock
+typedef struct {
+    uint32_t verdicts[STORAGE_SCRUB_INDEX_MISMATCH + 1];
+} health_ctx_t;
+
+static bool count_health_entry(const storage_catalog_entry_t *entry, void *arg) {
+    health_ctx_t *ctx = arg;
+    if (entry->scrub_verdict <= STORAGE_SCRUB_INDEX_MISMATCH) {
+        ctx->verdicts[entry->scrub_verdict]++;
+    }
+    return true;
+}
+
+// Stored log integrity as seen by the background scrubber
+static esp_err_t storage_health_handler(httpd_req_t *req) {
+    storage_scrub_stats_t scrub;
+    storage_scrub_get_stats(&scrub);
+
+    health_ctx_t ctx = {0};
+    storage_catalog_for_each(count_health_entry, &ctx);
+    bool degraded = ctx.verdicts[STORAGE_SCRUB_CORRUPT] + ctx.verdicts[STORAGE_SCRUB_INDEX_MISMATCH] > 0;
+
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+
+    json_writer_begin_object(json, NULL);
+    json_writer_string(json, "status", degraded ? "degraded" : "ok");
+    json_writer_uint(json, "files_clean", ctx.verdicts[STORAGE_SCRUB_CLEAN]);
+    json_writer_uint(json, "files_corrupt", ctx.verdicts[STORAGE_SCRUB_CORRUPT]);
+    json_writer_uint(json, "files_index_mismatch", ctx.verdicts[STORAGE_SCRUB_INDEX_MISMATCH]);
+    json_writer_uint(json, "files_unchecked", ctx.verdicts[STORAGE_SCRUB_UNCHECKED]);
+
+    // Damaged files are copied out one at a time, so the catalog is not
+    // locked while the response is sent
+    json_writer_begin_array(json, "damaged");
+    storage_catalog_entry_t entry;
+    for (uint32_t i = 0; degraded && storage_catalog_get(i, &entry); i++) {
+        if (entry.scrub_verdict != STORAGE_SCRUB_CORRUPT && entry.scrub_verdict != STORAGE_SCRUB_INDEX_MISMATCH) {
+            continue;
+        }
+        json_writer_begin_object(json, NULL);
+        json_writer_string(json, "name", entry.name);
+        json_writer_string(json, "verdict",
+                           entry.scrub_verdict == STORAGE_SCRUB_CORRUPT ? "corrupt" : "index_mismatch");
+        json_writer_uint(json, "size", entry.size);
+        json_writer_uint(json, "corrupt_ranges", entry.corrupt_ranges);
+        json_writer_uint(json, "corrupt_offset", entry.corrupt_offset);
+        json_writer_uint(json, "corrupt_bytes", entry.corrupt_bytes);
+        json_writer_end_object(json);
+    }
+    json_writer_end_array(json);
+
+    json_writer_begin_object(json, "scrubber");
+    json_writer_bool(json, "running", scrub.running);
+    json_writer_string(json, "current", scrub.current);
+    json_writer_uint(json, "passes", scrub.passes);
+    json_writer_uint(json, "files_scrubbed", scrub.files_scrubbed);
+    json_writer_uint(json, "files_skipped", scrub.files_skipped);
+    json_writer_uint(json, "chunks_verified", scrub.chunks_verified);
+    json_writer_uint(json, "bytes_read", scrub.bytes_read);
+    json_writer_uint(json, "crc_errors", scrub.crc_errors);
+    json_writer_uint(json, "record_errors", scrub.record_errors);
+    json_writer_uint(json, "index_mismatches", scrub.index_mismatches);
+    json_writer_uint(json, "backoffs", scrub.backoffs);
+    json_writer_uint(json, "rate_kbps", STORAGE_SCRUB_RATE_KBPS);
+    json_writer_end_object(json);
+
+    json_writer_end_object(json);
+    return json_response_end(req, &response);
+}
+
+#define HISTORY_MAX_POINTS      5000
+
+typedef struct {
+    json_writer_t *json;
+    uint32_t points;
+    bool all_sessions;          // Points carry their session, timestamps of different boots mix
+} history_ctx_t;
+
+static bool append_history_point(const storage_rollup_record_t *record, void *arg) {
+    history_ctx_t *ctx = arg;
+    json_writer_t *json = ctx->json;
+
+    json_writer_begin_array(json, NULL);
+    json_writer_uint(json, NULL, record->start_us);
+    json_writer_fixed(json, NULL, record->min, 4);
+    json_writer_fixed(json, NULL, record->max, 4);
+    json_writer_fixed(json, NULL, record->mean, 4);
+    json_writer_uint(json, NULL, record->count);
+    if (ctx->all_sessions) {
+        json_writer_uint(json, NULL, record->session_id);
+    }
+    json_writer_end_array(json);
+
+    return json->out.error == ESP_OK && ++ctx->points < HISTORY_MAX_POINTS;
+}
+
+// ADC history from the rollup tiers:
+// GET /api/adc/history?channel=0&start=<us>&end=<us>&resolution_ms=60000&session=<id>|all
+// Returns [start_us, min, max, mean, count] points from the coarsest tier
+// that meets the resolution; finer resolutions need the raw log files.
+// start_us is microseconds since boot, so only one session is returned by
+// default: the current boot's. session=all appends each point's session.
+static esp_err_t adc_history_handler(httpd_req_t *req) {
+    char query[160] = {0};
+    char value[24];
+    uint32_t channel = 0;
+    storage_session_info_t session;
+    uint32_t session_id = (storage_session_get_info(&session) == ESP_OK) ? session.session_id : 0;
+    uint64_t start_us = 0;
+    uint64_t end_us = UINT64_MAX;
+    uint64_t resolution_ms = 60 * 1000;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "channel", value, sizeof(value)) == ESP_OK) {
+            channel = strtoul(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "start", value, sizeof(value)) == ESP_OK) {
+            start_us = strtoull(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "end", value, sizeof(value)) == ESP_OK) {
+            end_us = strtoull(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "resolution_ms", value, sizeof(value)) == ESP_OK) {
+            resolution_ms = strtoull(value, NULL, 10);
+        }
+        if (httpd_query_key_value(query, "session", value, sizeof(value)) == ESP_OK) {
+            session_id = (strcmp(value, "all") == 0) ? STORAGE_ROLLUP_ALL_SESSIONS : strtoul(value, NULL, 10);
+        }
+    }
+
+    if (!CONFIG_VALIDATE_ADC_CHANNEL(channel)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid ADC channel");
+    }
+
+    storage_rollup_tier_t tier;
+    if (storage_rollup_select_tier(resolution_ms * 1000, &tier) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                                   "Resolution below 1 s, download the raw log instead");
+    }
+
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+
+    json_writer_begin_object(json, NULL);
+    json_writer_uint(json, "channel", channel);
+    json_writer_string(json, "tier", storage_rollup_tier_name(tier));
+    json_writer_uint(json, "bucket_ms", storage_rollup_bucket_us(tier) / 1000);
+    if (session_id == STORAGE_ROLLUP_ALL_SESSIONS) {
+        json_writer_string(json, "session", "all");
+    } else {
+        json_writer_uint(json, "session", session_id);
+    }
+    json_writer_begin_array(json, "points");
+
+    history_ctx_t ctx = { .json = json, .all_sessions = (session_id == STORAGE_ROLLUP_ALL_SESSIONS) };
+    esp_err_t ret = storage_rollup_query(channel, session_id, start_us, end_us, tier, append_history_point, &ctx);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "ADC history request failed: %s", esp_err_to_name(ret));
+        g_network_manager.stats.api_requests++;
+        return ESP_FAIL;
+    }
+
+    json_writer_end_array(json);
+    json_writer_end_object(json);
+    return json_response_end(req, &response);
+}
+
 // JSON Configuration Parsing Utilities
 static esp_err_t parse_request_body(httpd_req_t *req, char **json_string) {
     if (!req || !json_string) {
@@ -331,12 +1375,13 @@ static esp_err_t parse_request_body(httpd_req_t *req, char **json_string) {
     return ESP_OK;
 }
 
+// POST handlers still build their change lists with cJSON; they are sent compact
 static esp_err_t send_json_response(httpd_req_t *req, cJSON *json) {
     if (!req || !json) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    char *json_string = cJSON_Print(json);
+    char *json_string = cJSON_PrintUnformatted(json);
     if (!json_string) {
         return ESP_ERR_NO_MEM;
     }
@@ -355,18 +1400,17 @@ static esp_err_t send_json_response(httpd_req_t *req, cJSON *json) {
 static esp_err_t send_error_response(httpd_req_t *req, int status_code, const char *error_message) {
     httpd_resp_set_status(req, status_code == 400 ? "400 Bad Request" :
                               status_code == 500 ? "500 Internal Server Error" : "400 Bad Request");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
+    httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
 
-    cJSON *json = cJSON_CreateObject();
-    cJSON *error = cJSON_CreateString(error_message);
-    cJSON *success = cJSON_CreateBool(false);
-
-    cJSON_AddItemToObject(json, "success", success);
-    cJSON_AddItemToObject(json, "error", error);
-
-    esp_err_t ret = send_json_response(req, json);
-    cJSON_Delete(json);
+    json_response_t response;
+    json_writer_t *json = json_response_begin(req, &response);
+    json_writer_begin_object(json, NULL);
+    json_writer_bool(json, "success", false);
+    json_writer_string(json, "error", error_message);
+    json_writer_end_object(json);
 
-    return ret;
+    return json_response_end(req, &response);
 }
 
 // ADC Configuration POST Handler
@@ -411,11 +1455,14 @@ static esp_err_t config_adc_post_handler(httpd_req_t *req) {
                 continue;
             }
 
+            // Compare with the saved configuration; /api/config/apply makes it live
+            system_config_t* config = config_get_instance();
+
             // Update enabled state
             if (cJSON_IsBool(enabled)) {
                 bool new_enabled = cJSON_IsTrue(enabled);
-                if (adc_manager_is_channel_enabled(ch) != new_enabled) {
-                    ret = config_update_adc(ch, 0, new_enabled);  // Keep current sample rate
+                if (config->adc_config[ch].enabled != new_enabled) {
+                    ret = config_update_adc(ch, config->adc_config[ch].sample_rate_hz, new_enabled);  // Keep current sample rate
                     if (ret == ESP_OK) {
                         config_changed = true;
                         restart_required = true;
@@ -436,7 +1483,7 @@ static esp_err_t config_adc_post_handler(httpd_req_t *req) {
                 uint16_t new_rate = (uint16_t)cJSON_GetNumberValue(sample_rate);
                 if (new_rate >= 1 && new_rate <= 10000) {  // Validate range
                     // Get current config to preserve enabled state
-                    bool current_enabled = adc_manager_is_channel_enabled(ch);
+                    bool current_enabled = config->adc_config[ch].enabled;
                     ret = config_update_adc(ch, new_rate, current_enabled);
                     if (ret == ESP_OK) {
                         config_changed = true;
@@ -507,6 +1554,7 @@ static esp_err_t config_uart_post_handler(httpd_req_t *req) {
             cJSON *port_num = cJSON_GetObjectItem(port_item, "port");
             cJSON *enabled = cJSON_GetObjectItem(port_item, "enabled");
             cJSON *baud_rate = cJSON_GetObjectItem(port_item, "baud_rate");
+            cJSON *compress = cJSON_GetObjectItem(port_item, "compress");
 
             if (!cJSON_IsNumber(port_num)) {
                 continue;
@@ -517,11 +1565,14 @@ static esp_err_t config_uart_post_handler(httpd_req_t *req) {
                 continue;
             }
 
+            // Compare with the saved configuration; /api/config/apply makes it live
+            system_config_t* config = config_get_instance();
+
             // Update enabled state
             if (cJSON_IsBool(enabled)) {
                 bool new_enabled = cJSON_IsTrue(enabled);
-                if (uart_manager_is_channel_active(port) != new_enabled) {
-                    ret = config_update_uart(port, 0, new_enabled);  // Keep current baud rate
+                if (config->uart_config[port].enabled != new_enabled) {
+                    ret = config_update_uart(port, config->uart_config[port].baud_rate, new_enabled);  // Keep current baud rate
                     if (ret == ESP_OK) {
                         config_changed = true;
                         restart_required = true;
@@ -546,7 +1597,7 @@ static esp_err_t config_uart_post_handler(httpd_req_t *req) {
                     new_baud == 460800 || new_baud == 921600) {
 
                     // Get current config to preserve enabled state
-                    bool current_enabled = uart_manager_is_channel_active(port);
+                    bool current_enabled = config->uart_config[port].enabled;
                     ret = config_update_uart(port, new_baud, current_enabled);
                     if (ret == ESP_OK) {
                         config_changed = true;
@@ -562,6 +1613,25 @@ static esp_err_t config_uart_post_handler(httpd_req_t *req) {
                     }
                 }
             }
+
+            // Update log compression (applies to the next chunk, no restart needed)
+            if (cJSON_IsBool(compress)) {
+                bool new_compress = cJSON_IsTrue(compress);
+                if (config->uart_config[port].compress_log != new_compress) {
+                    ret = config_update_uart_compression(port, new_compress);
+                    if (ret == ESP_OK) {
+                        config_changed = true;
+
+                        cJSON *change = cJSON_CreateObject();
+                        cJSON_AddNumberToObject(change, "port", port);
+                        cJSON_AddStringToObject(change, "property", "compress");
+                        cJSON_AddBoolToObject(change, "value", new_compress);
+                        cJSON_AddItemToArray(changes, change);
+
+                        ESP_LOGI(TAG, "UART port %d log compression: %s", port, new_compress ? "on" : "off");
+                    }
+                }
+            }
         }
     }
 
@@ -585,80 +1655,224 @@ static esp_err_t config_uart_post_handler(httpd_req_t *req) {
     return ret;
 }
 
-// Service Restart Coordination Functions
-static esp_err_t restart_adc_service(void) {
-    ESP_LOGI(TAG, "Restarting ADC service...");
+// UDP streamer settings; the streaming task reopens the socket, no restart needed
+static esp_err_t config_udp_post_handler(httpd_req_t *req) {
+    ESP_LOGI(TAG, "UDP stream configuration update request");
 
-    // Stop ADC manager
-    esp_err_t ret = adc_manager_stop();
+    char *json_string = NULL;
+    esp_err_t ret = parse_request_body(req, &json_string);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop ADC manager: %s", esp_err_to_name(ret));
-        return ret;
+        return send_error_response(req, 400, "Failed to parse request body");
+    }
+
+    cJSON *json = cJSON_Parse(json_string);
+    free(json_string);
+
+    if (!json) {
+        return send_error_response(req, 400, "Invalid JSON format");
     }
 
-    // Small delay to ensure clean shutdown
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // Unset fields keep their current value
+    system_config_t* config = config_get_instance();
+    bool enabled = config->network_config.udp_enabled;
+    char destinations[sizeof(config->network_config.udp_destinations)];
+    strcpy(destinations, config->network_config.udp_destinations);
+    int port = config->network_config.udp_port;
+    int interval_ms = config->network_config.udp_interval_ms;
+
+    cJSON *item = cJSON_GetObjectItem(json, "enabled");
+    if (cJSON_IsBool(item)) {
+        enabled = cJSON_IsTrue(item);
+    }
+    item = cJSON_GetObjectItem(json, "destinations");
+    if (cJSON_IsString(item)) {
+        if (strlen(item->valuestring) >= sizeof(destinations)) {
+            cJSON_Delete(json);
+            return send_error_response(req, 400, "Destination list too long");
+        }
+        strcpy(destinations, item->valuestring);
+    }
+    item = cJSON_GetObjectItem(json, "port");
+    if (cJSON_IsNumber(item)) {
+        port = (int)cJSON_GetNumberValue(item);
+    }
+    item = cJSON_GetObjectItem(json, "interval_ms");
+    if (cJSON_IsNumber(item)) {
+        interval_ms = (int)cJSON_GetNumberValue(item);
+    }
+    cJSON_Delete(json);
+
+    if (port < 1 || port > 65535 || interval_ms < 1 || interval_ms > 1000) {
+        return send_error_response(req, 400, "Invalid port or interval_ms (1-1000)");
+    }
 
-    // Restart ADC manager with new configuration
-    ret = adc_manager_start();
+    ret = config_update_udp(enabled, destinations, port, interval_ms);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to restart ADC manager: %s", esp_err_to_name(ret));
-        return ret;
+        return send_error_response(req, 500, "Failed to save UDP configuration");
     }
+    stream_udp_configure();
 
-    ESP_LOGI(TAG, "ADC service restarted successfully");
-    return ESP_OK;
+    ESP_LOGI(TAG, "UDP stream %s: %s:%d every %d ms", enabled ? "enabled" : "disabled",
+             destinations, port, interval_ms);
+
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddBoolToObject(response, "success", true);
+    cJSON_AddBoolToObject(response, "enabled", enabled);
+    cJSON_AddStringToObject(response, "destinations", destinations);
+    cJSON_AddNumberToObject(response, "port", port);
+    cJSON_AddNumberToObject(response, "interval_ms", interval_ms);
+
+    ret = send_json_response(req, response);
+
+    cJSON_Delete(response);
+    g_network_manager.stats.api_requests++;
+
+    return ret;
 }
 
-static esp_err_t restart_uart_service(void) {
-    ESP_LOGI(TAG, "Restarting UART service...");
+// Stage the "adc" items of an apply request; false with a message at the first bad one
+static bool stage_adc_changes(const cJSON *items, system_config_t *staged, uint8_t *channel_mask,
+                              char *error, size_t error_size) {
+    if (!items) {
+        return true;
+    }
+    if (!cJSON_IsArray(items)) {
+        snprintf(error, error_size, "\"adc\" must be an array");
+        return false;
+    }
 
-    // Stop UART manager
-    esp_err_t ret = uart_manager_stop();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop UART manager: %s", esp_err_to_name(ret));
-        return ret;
+    const cJSON *item = NULL;
+    cJSON_ArrayForEach(item, items) {
+        const cJSON *channel = cJSON_GetObjectItem(item, "channel");
+        const cJSON *enabled = cJSON_GetObjectItem(item, "enabled");
+        const cJSON *sample_rate = cJSON_GetObjectItem(item, "sample_rate");
+        const cJSON *filter_alpha = cJSON_GetObjectItem(item, "filter_alpha");
+
+        if (!cJSON_IsNumber(channel) || channel->valuedouble < 0 || channel->valuedouble >= CONFIG_ADC_CHANNEL_COUNT) {
+            snprintf(error, error_size, "ADC item needs a channel 0-%d", CONFIG_ADC_CHANNEL_COUNT - 1);
+            return false;
+        }
+        int ch = (int)channel->valuedouble;
+
+        if (enabled && !cJSON_IsBool(enabled)) {
+            snprintf(error, error_size, "ADC%d enabled must be true or false", ch);
+            return false;
+        }
+        if (sample_rate && (!cJSON_IsNumber(sample_rate) || !CONFIG_VALIDATE_SAMPLE_RATE(sample_rate->valuedouble))) {
+            snprintf(error, error_size, "ADC%d sample_rate must be %d-%d Hz", ch, ADC_MIN_SAMPLE_RATE, ADC_MAX_SAMPLE_RATE);
+            return false;
+        }
+        if (filter_alpha && (!cJSON_IsNumber(filter_alpha) ||
+                             !CONFIG_VALIDATE_FILTER_ALPHA((float)filter_alpha->valuedouble))) {
+            snprintf(error, error_size, "ADC%d filter_alpha must be above 0 and at most 1", ch);
+            return false;
+        }
+
+        if (enabled) {
+            staged->adc_config[ch].enabled = cJSON_IsTrue(enabled);
+        }
+        if (sample_rate) {
+            staged->adc_config[ch].sample_rate_hz = (uint16_t)sample_rate->valuedouble;
+        }
+        if (filter_alpha) {
+            staged->adc_config[ch].filter_alpha = (float)filter_alpha->valuedouble;
+        }
+        *channel_mask |= 1 << ch;
     }
 
-    // Small delay to ensure clean shutdown
-    vTaskDelay(pdMS_TO_TICKS(100));
+    return true;
+}
 
-    // Restart UART manager with new configuration
-    ret = uart_manager_start();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to restart UART manager: %s", esp_err_to_name(ret));
-        return ret;
+// Stage the "uart" items of an apply request; false with a message at the first bad one
+static bool stage_uart_changes(const cJSON *items, system_config_t *staged, uint8_t *port_mask,
+                               char *error, size_t error_size) {
+    if (!items) {
+        return true;
+    }
+    if (!cJSON_IsArray(items)) {
+        snprintf(error, error_size, "\"uart\" must be an array");
+        return false;
     }
 
-    ESP_LOGI(TAG, "UART service restarted successfully");
-    return ESP_OK;
+    const cJSON *item = NULL;
+    cJSON_ArrayForEach(item, items) {
+        const cJSON *port_num = cJSON_GetObjectItem(item, "port");
+        const cJSON *enabled = cJSON_GetObjectItem(item, "enabled");
+        const cJSON *baud_rate = cJSON_GetObjectItem(item, "baud_rate");
+
+        if (!cJSON_IsNumber(port_num) || port_num->valuedouble < 0 || port_num->valuedouble >= CONFIG_UART_PORT_COUNT) {
+            snprintf(error, error_size, "UART item needs a port 0-%d", CONFIG_UART_PORT_COUNT - 1);
+            return false;
+        }
+        int port = (int)port_num->valuedouble;
+
+        if (enabled && !cJSON_IsBool(enabled)) {
+            snprintf(error, error_size, "UART%d enabled must be true or false", port);
+            return false;
+        }
+        if (baud_rate && (!cJSON_IsNumber(baud_rate) || !CONFIG_VALIDATE_BAUD_RATE(baud_rate->valuedouble))) {
+            snprintf(error, error_size, "UART%d baud_rate must be 300-921600", port);
+            return false;
+        }
+
+        if (enabled) {
+            staged->uart_config[port].enabled = cJSON_IsTrue(enabled);
+        }
+        if (baud_rate) {
+            staged->uart_config[port].baud_rate = (uint32_t)baud_rate->valuedouble;
+        }
+        *port_mask |= 1 << port;
+    }
+
+    return true;
+}
+
+// Push one port's settings into the running UART manager
+static esp_err_t apply_uart_port(uint8_t port, const system_config_t *config) {
+    esp_err_t ret = ESP_OK;
+    if (CONFIG_VALIDATE_BAUD_RATE(config->uart_config[port].baud_rate)) {
+        ret = uart_manager_reconfigure_channel(port, config->uart_config[port].baud_rate);
+    }
+    if (ret == ESP_OK) {
+        ret = uart_manager_enable_channel(port, config->uart_config[port].enabled);
+    }
+    return ret;
 }
 
-static esp_err_t restart_data_logger_service(void) {
-    ESP_LOGI(TAG, "Restarting data logger coordination...");
-
-    // Stop data logger
-    esp_err_t ret = data_logger_stop();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop data logger: %s", esp_err_to_name(ret));
-        return ret;
+// Push the listed ADC channels' settings into the running ADC manager as one command
+static esp_err_t apply_adc_channels(uint8_t channel_mask, const system_config_t *config) {
+    adc_channel_settings_t settings[CONFIG_ADC_CHANNEL_COUNT];
+    for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+        settings[i].enabled = config->adc_config[i].enabled;
+        settings[i].sample_rate_hz = config->adc_config[i].sample_rate_hz;
+        settings[i].filter_alpha = config->adc_config[i].filter_alpha;
     }
+    return adc_manager_apply_settings(channel_mask, settings);
+}
 
-    // Small delay to ensure clean shutdown
-    vTaskDelay(pdMS_TO_TICKS(200));
-
-    // Restart data logger
-    ret = data_logger_start();
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to restart data logger: %s", esp_err_to_name(ret));
-        return ret;
+// Put the listed channels back on the previous configuration after a failed apply
+static void restore_channels(uint8_t adc_mask, uint8_t uart_mask, const system_config_t *previous) {
+    if (adc_mask && apply_adc_channels(adc_mask, previous) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to restore ADC channels 0x%02x", adc_mask);
+    }
+    for (int port = 0; port < CONFIG_UART_PORT_COUNT; port++) {
+        if ((uart_mask & (1 << port)) && apply_uart_port(port, previous) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to restore UART%d", port);
+        }
     }
-
-    ESP_LOGI(TAG, "Data logger service restarted successfully");
-    return ESP_OK;
 }
 
 // Configuration Apply POST Handler
+// Transactional: every item is validated before anything changes, and one
+// bad item rejects the request. Each listed channel is then pushed into its
+// running manager, which takes the change between two samples or reads and
+// confirms it; acquisition never stops and other channels keep their
+// schedule. The configuration is saved only once every manager has
+// confirmed. If one fails, or the save does, the channels already changed
+// are put back on the previous configuration and nothing is saved.
+// restart_adc and restart_uart push the whole saved configuration of that
+// service, for clients that save with /api/config/adc or /api/config/uart
+// first.
 static esp_err_t config_apply_post_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "Configuration apply request");
 
@@ -676,105 +1890,346 @@ static esp_err_t config_apply_post_handler(httpd_req_t *req) {
         return send_error_response(req, 400, "Invalid JSON format");
     }
 
+    // staged is the requested configuration, previous the one to restore
+    system_config_t *staged = malloc(2 * sizeof(system_config_t));
+    if (!staged) {
+        cJSON_Delete(json);
+        return send_error_response(req, 500, "Out of memory");
+    }
+    system_config_t *previous = staged + 1;
+    memcpy(previous, config_get_instance(), sizeof(system_config_t));
+    memcpy(staged, previous, sizeof(system_config_t));
+
+    // Validate and stage the whole change set
+    char error[96];
+    uint8_t adc_mask = 0;
+    uint8_t uart_mask = 0;
+    bool valid = stage_adc_changes(cJSON_GetObjectItem(json, "adc"), staged, &adc_mask, error, sizeof(error)) &&
+                 stage_uart_changes(cJSON_GetObjectItem(json, "uart"), staged, &uart_mask, error, sizeof(error));
+
+    if (cJSON_IsTrue(cJSON_GetObjectItem(json, "restart_adc"))) {
+        adc_mask = (1 << CONFIG_ADC_CHANNEL_COUNT) - 1;
+    }
+    if (cJSON_IsTrue(cJSON_GetObjectItem(json, "restart_uart"))) {
+        uart_mask = (1 << CONFIG_UART_PORT_COUNT) - 1;
+    }
+    bool restart_data_logger = cJSON_IsTrue(cJSON_GetObjectItem(json, "restart_data_logger"));
+    cJSON_Delete(json);
+
+    if (valid && config_validate(staged) != ESP_OK) {
+        snprintf(error, sizeof(error), "Configuration rejected");
+        valid = false;
+    }
+    if (!valid) {
+        free(staged);
+        return send_error_response(req, 400, error);
+    }
+
     cJSON *response = cJSON_CreateObject();
     cJSON *results = cJSON_CreateArray();
     bool overall_success = true;
+    uint8_t applied_adc = 0;
+    uint8_t applied_uart = 0;
 
-    // Check which services to restart
-    cJSON *restart_adc = cJSON_GetObjectItem(json, "restart_adc");
-    cJSON *restart_uart = cJSON_GetObjectItem(json, "restart_uart");
-    cJSON *restart_data_logger = cJSON_GetObjectItem(json, "restart_data_logger");
-
-    // Restart ADC service if requested
-    if (cJSON_IsTrue(restart_adc)) {
-        ESP_LOGI(TAG, "Applying ADC configuration changes...");
-        ret = restart_adc_service();
+    // ADC: one command for all listed channels, taken between two scans
+    if (adc_mask) {
+        ret = apply_adc_channels(adc_mask, staged);
+        // A command that timed out may still be taken, so it is restored either way
+        applied_adc = adc_mask;
 
+        cJSON *channels = cJSON_CreateArray();
+        for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
+            if (adc_mask & (1 << i)) {
+                cJSON_AddItemToArray(channels, cJSON_CreateNumber(i));
+            }
+        }
         cJSON *adc_result = cJSON_CreateObject();
         cJSON_AddStringToObject(adc_result, "service", "adc");
+        cJSON_AddItemToObject(adc_result, "channels", channels);
         cJSON_AddBoolToObject(adc_result, "success", ret == ESP_OK);
         if (ret == ESP_OK) {
-            cJSON_AddStringToObject(adc_result, "message", "ADC service restarted successfully");
+            cJSON_AddStringToObject(adc_result, "message", "ADC channels reconfigured while sampling");
         } else {
-            cJSON_AddStringToObject(adc_result, "message", "Failed to restart ADC service");
+            cJSON_AddStringToObject(adc_result, "message", esp_err_to_name(ret));
             overall_success = false;
         }
         cJSON_AddItemToArray(results, adc_result);
     }
 
-    // Restart UART service if requested
-    if (cJSON_IsTrue(restart_uart)) {
-        ESP_LOGI(TAG, "Applying UART configuration changes...");
-        ret = restart_uart_service();
+    // UART: each port's reader task takes its own change
+    for (int port = 0; port < CONFIG_UART_PORT_COUNT && overall_success; port++) {
+        if (!(uart_mask & (1 << port))) {
+            continue;
+        }
+        ret = apply_uart_port(port, staged);
+        // A port can fail halfway (baud set, start failed), so it is restored either way
+        applied_uart |= 1 << port;
 
         cJSON *uart_result = cJSON_CreateObject();
         cJSON_AddStringToObject(uart_result, "service", "uart");
+        cJSON_AddNumberToObject(uart_result, "port", port);
         cJSON_AddBoolToObject(uart_result, "success", ret == ESP_OK);
         if (ret == ESP_OK) {
-            cJSON_AddStringToObject(uart_result, "message", "UART service restarted successfully");
+            cJSON_AddStringToObject(uart_result, "message", "UART port reconfigured while reading");
         } else {
-            cJSON_AddStringToObject(uart_result, "message", "Failed to restart UART service");
+            cJSON_AddStringToObject(uart_result, "message", esp_err_to_name(ret));
             overall_success = false;
         }
         cJSON_AddItemToArray(results, uart_result);
     }
 
-    // Restart data logger if requested (usually after ADC/UART changes)
-    if (cJSON_IsTrue(restart_data_logger)) {
-        ESP_LOGI(TAG, "Applying data logger configuration changes...");
-        ret = restart_data_logger_service();
+    // Save only what every manager took
+    const char *message = "Configuration applied successfully";
+    if (overall_success) {
+        ret = config_commit(staged);
+        if (ret != ESP_OK) {
+            overall_success = false;
+            message = "Failed to save configuration; previous configuration restored";
+        }
+    } else {
+        message = "A channel failed to apply; previous configuration restored, nothing saved";
+    }
+    if (!overall_success) {
+        restore_channels(applied_adc, applied_uart, previous);
+    }
 
+    // The coordination task forwards whatever the managers produce; it has nothing to reload
+    if (restart_data_logger) {
         cJSON *logger_result = cJSON_CreateObject();
         cJSON_AddStringToObject(logger_result, "service", "data_logger");
-        cJSON_AddBoolToObject(logger_result, "success", ret == ESP_OK);
-        if (ret == ESP_OK) {
-            cJSON_AddStringToObject(logger_result, "message", "Data logger restarted successfully");
-        } else {
-            cJSON_AddStringToObject(logger_result, "message", "Failed to restart data logger");
-            overall_success = false;
-        }
+        cJSON_AddBoolToObject(logger_result, "success", true);
+        cJSON_AddStringToObject(logger_result, "message", "Data logger kept running, no restart needed");
         cJSON_AddItemToArray(results, logger_result);
     }
 
+    ESP_LOGI(TAG, "Configuration apply: ADC mask 0x%02x, UART mask 0x%02x, %s",
+             adc_mask, uart_mask, overall_success ? "saved" : "rolled back");
+    free(staged);
+
     // Build response
     cJSON_AddBoolToObject(response, "success", overall_success);
     cJSON_AddItemToObject(response, "results", results);
-
-    if (overall_success) {
-        cJSON_AddStringToObject(response, "message", "Configuration applied successfully");
-    } else {
-        cJSON_AddStringToObject(response, "message", "Some configuration changes failed to apply");
-    }
+    cJSON_AddStringToObject(response, "message", message);
 
     ret = send_json_response(req, response);
 
-    cJSON_Delete(json);
     cJSON_Delete(response);
     g_network_manager.stats.api_requests++;
 
     return ret;
 }
 
+// WebSocket transport for the stream fan-out; runs on the client's sender task
+static esp_err_t websocket_send_message(void* ctx, int fd, const stream_message_t* message) {
+    httpd_ws_frame_t ws_pkt;
+    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+    ws_pkt.payload = (uint8_t*)message->data;
+    ws_pkt.len = message->length;
+    ws_pkt.type = (message->encoding == STREAM_ENCODING_BINARY) ? HTTPD_WS_TYPE_BINARY : HTTPD_WS_TYPE_TEXT;
+
+    esp_err_t ret = httpd_ws_send_frame_async((httpd_handle_t)ctx, fd, &ws_pkt);
+    if (ret == ESP_OK) {
+        g_network_manager.stats.bytes_sent += message->length;
+    }
+    return ret;
+}
+
+static void websocket_close_client(void* ctx, int fd) {
+    httpd_sess_trigger_close((httpd_handle_t)ctx, fd);
+}
+
+static const stream_transport_t g_websocket_transport = {
+    .name = "ws",
+    .send = websocket_send_message,
+    .close = websocket_close_client
+};
+
+// Every closed session, so stream clients are dropped as soon as they go
+static void http_session_closed(httpd_handle_t hd, int sockfd) {
+    stream_fanout_remove_client(sockfd);
+    close(sockfd);
+}
+
+// Reply to one client. Stream clients get it through their send queue, so
+// it cannot interleave with a frame their sender task is writing.
+static esp_err_t websocket_reply(httpd_req_t *req, int slot, const char* text, size_t length) {
+    if (slot >= 0) {
+        stream_message_t* message = stream_message_create(STREAM_ENCODING_JSON, length);
+        if (!message) {
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(message->data, text, length);
+        message->length = length;
+        return stream_fanout_publish(message, 1 << slot) ? ESP_OK : ESP_FAIL;
+    }
+
+    httpd_ws_frame_t ws_response;
+    memset(&ws_response, 0, sizeof(httpd_ws_frame_t));
+    ws_response.payload = (uint8_t*)text;
+    ws_response.len = length;
+    ws_response.type = HTTPD_WS_TYPE_TEXT;
+    return httpd_ws_send_frame(req, &ws_response);
+}
+
+// Topics, rate, reduction and format of a subscribe message. Fields left
+// out keep their current value; "topics" replaces the whole topic set.
+static const char* websocket_parse_subscribe(const cJSON* json, stream_subscription_t* subscription) {
+    stream_subscription_t updated = *subscription;
+
+    const cJSON* topics = cJSON_GetObjectItem(json, "topics");
+    if (topics) {
+        if (!cJSON_IsArray(topics)) {
+            return "topics must be an array";
+        }
+        updated.adc_channels = 0;
+        updated.uart_ports = 0;
+        const cJSON* topic;
+        cJSON_ArrayForEach(topic, topics) {
+            if (!cJSON_IsString(topic) || !stream_subscription_set_topic(&updated, topic->valuestring, true)) {
+                return "Unknown topic";
+            }
+        }
+    }
+
+    const cJSON* rate = cJSON_GetObjectItem(json, "rate_limit");
+    if (rate) {
+        if (!cJSON_IsNumber(rate) || rate->valuedouble < 0 || rate->valuedouble > UINT16_MAX) {
+            return "rate_limit must be 0 to 65535";
+        }
+        updated.rate_hz = (uint16_t)rate->valuedouble;
+    }
+
+    const cJSON* reduce = cJSON_GetObjectItem(json, "reduce");
+    if (reduce && (!cJSON_IsString(reduce) || !stream_reduce_from_name(reduce->valuestring, &updated.reduce))) {
+        return "reduce must be latest, decimate or minmax";
+    }
+
+    const cJSON* format = cJSON_GetObjectItem(json, "format");
+    if (format) {
+        if (cJSON_IsString(format) && strcmp(format->valuestring, "binary") == 0) {
+            updated.encoding = STREAM_ENCODING_BINARY;
+        } else if (cJSON_IsString(format) && strcmp(format->valuestring, "json") == 0) {
+            updated.encoding = STREAM_ENCODING_JSON;
+        } else {
+            return "format must be json or binary";
+        }
+    }
+
+    *subscription = updated;
+    return NULL;
+}
+
+// Topics of an unsubscribe message, all of them when none are listed
+static const char* websocket_parse_unsubscribe(const cJSON* json, stream_subscription_t* subscription) {
+    stream_subscription_t updated = *subscription;
+
+    const cJSON* topics = cJSON_GetObjectItem(json, "topics");
+    if (!topics) {
+        updated.adc_channels = 0;
+        updated.uart_ports = 0;
+    } else if (!cJSON_IsArray(topics)) {
+        return "topics must be an array";
+    } else {
+        const cJSON* topic;
+        cJSON_ArrayForEach(topic, topics) {
+            if (!cJSON_IsString(topic) || !stream_subscription_set_topic(&updated, topic->valuestring, false)) {
+                return "Unknown topic";
+            }
+        }
+    }
+
+    *subscription = updated;
+    return NULL;
+}
+
+// Client control messages: subscribe and unsubscribe change what the client
+// is streamed and are answered with the resulting subscription
+static esp_err_t websocket_handle_message(httpd_req_t *req, const char* text) {
+    int fd = httpd_req_to_sockfd(req);
+    stream_subscription_t subscription;
+    int slot = stream_fanout_get_subscription(fd, &subscription);
+
+    cJSON* json = cJSON_Parse(text);
+    const cJSON* type = json ? cJSON_GetObjectItem(json, "type") : NULL;
+    bool subscribe = cJSON_IsString(type) && strcmp(type->valuestring, "subscribe") == 0;
+    bool unsubscribe = cJSON_IsString(type) && strcmp(type->valuestring, "unsubscribe") == 0;
+
+    if (!subscribe && !unsubscribe) {
+        cJSON_Delete(json);
+        const char* welcome = "{\"type\":\"connected\",\"message\":\"ESP32 ADC stream ready\"}";
+        return websocket_reply(req, slot, welcome, strlen(welcome));
+    }
+
+    const char* error = "No free stream slot";
+    if (slot >= 0) {
+        error = subscribe ? websocket_parse_subscribe(json, &subscription)
+                          : websocket_parse_unsubscribe(json, &subscription);
+    }
+    cJSON_Delete(json);
+
+    if (!error) {
+        stream_subscription_normalize(&subscription);
+        stream_fanout_set_subscription(fd, &subscription);
+        ESP_LOGI(TAG, "WebSocket client %d: adc 0x%02x, uart 0x%02x, %u Hz %s, %s", slot,
+                 subscription.adc_channels, subscription.uart_ports, subscription.rate_hz,
+                 stream_reduce_name(subscription.reduce),
+                 subscription.encoding == STREAM_ENCODING_BINARY ? "binary" : "json");
+    }
+
+    char reply[256];
+    json_writer_t writer;
+    json_writer_init(&writer, reply, sizeof(reply), NULL, NULL);
+    json_writer_begin_object(&writer, NULL);
+    if (error) {
+        json_writer_string(&writer, "type", "error");
+        json_writer_string(&writer, "message", error);
+    } else {
+        json_writer_string(&writer, "type", "subscription_ack");
+        json_writer_int(&writer, "client_id", slot);
+        json_writer_begin_array(&writer, "topics");
+        for (int i = 0; i < STREAM_VIEW_TOPIC_COUNT; i++) {
+            char topic[STREAM_VIEW_TOPIC_LEN];
+            if (stream_subscription_topic(&subscription, i, topic, sizeof(topic))) {
+                json_writer_string(&writer, NULL, topic);
+            }
+        }
+        json_writer_end_array(&writer);
+        json_writer_uint(&writer, "rate_limit", subscription.rate_hz);
+        json_writer_string(&writer, "reduce", stream_reduce_name(subscription.reduce));
+        json_writer_string(&writer, "format", subscription.encoding == STREAM_ENCODING_BINARY ? "binary" : "json");
+    }
+    json_writer_end_object(&writer);
+
+    esp_err_t ret = json_writer_finish(&writer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return websocket_reply(req, slot, reply, writer.out.used);
+}
+
 // WebSocket handler based on ESP-IDF example
 static esp_err_t websocket_handler(httpd_req_t *req) {
     if (req->method == HTTP_GET) {
         ESP_LOGI(TAG, "WebSocket handshake done, new connection opened");
 
-        // Register client
-        int client_id = -1;
-        for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
-            if (!g_network_manager.websocket_clients[i].active) {
-                client_id = i;
-                break;
-            }
-        }
-
-        if (client_id != -1) {
-            g_network_manager.websocket_clients[client_id].server = req->handle;
-            g_network_manager.websocket_clients[client_id].fd = httpd_req_to_sockfd(req);
-            g_network_manager.websocket_clients[client_id].active = true;
-            ESP_LOGI(TAG, "WebSocket client %d registered (fd: %d)", client_id,
-                     g_network_manager.websocket_clients[client_id].fd);
+        // Encoding is chosen at the handshake, JSON text unless asked otherwise
+        char query[32];
+        char value[8];
+        bool binary = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                      httpd_query_key_value(query, "format", value, sizeof(value)) == ESP_OK &&
+                      strcmp(value, "binary") == 0;
+
+        // Register client; it gets every ADC channel until it subscribes
+        int fd = httpd_req_to_sockfd(req);
+        stream_subscription_t subscription;
+        stream_subscription_default(&subscription, binary ? STREAM_ENCODING_BINARY : STREAM_ENCODING_JSON);
+        int client_id = stream_fanout_add_client(&g_websocket_transport, req->handle, fd, &subscription);
+        if (client_id >= 0) {
+            g_network_manager.stats.websocket_connections++;
+            ESP_LOGI(TAG, "WebSocket client %d registered (fd: %d, %s)", client_id, fd,
+                     binary ? "binary" : "json");
+        } else {
+            ESP_LOGW(TAG, "No free stream slot, WebSocket client fd %d gets no data", fd);
         }
 
         return ESP_OK;
@@ -813,17 +2268,12 @@ static esp_err_t websocket_handler(httpd_req_t *req) {
         ESP_LOGI(TAG, "Got WebSocket packet with message: %s", ws_pkt.payload);
     }
 
-    // Send welcome message back
-    const char* welcome = "{\"type\":\"connected\",\"message\":\"ESP32 ADC stream ready\"}";
-    httpd_ws_frame_t ws_response;
-    memset(&ws_response, 0, sizeof(httpd_ws_frame_t));
-    ws_response.payload = (uint8_t*)welcome;
-    ws_response.len = strlen(welcome);
-    ws_response.type = HTTPD_WS_TYPE_TEXT;
-
-    ret = httpd_ws_send_frame(req, &ws_response);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "httpd_ws_send_frame failed with %d", ret);
+    // Subscription requests get an ack, anything else the welcome message
+    if (ws_pkt.type == HTTPD_WS_TYPE_TEXT) {
+        ret = websocket_handle_message(req, buf ? (const char*)buf : "");
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "WebSocket reply failed with %d", ret);
+        }
     }
 
     if (buf) {
@@ -832,153 +2282,341 @@ static esp_err_t websocket_handler(httpd_req_t *req) {
     return ret;
 }
 
-static esp_err_t root_handler(httpd_req_t *req) {
-    const char* html_page =
-        "<!DOCTYPE html>"
-        "<html><head><title>ESP32 Data Logger</title>"
-        "<style>"
-        "body { font-family: Arial, sans-serif; margin: 40px; }"
-        ".container { max-width: 800px; margin: 0 auto; }"
-        ".status { background: #f0f0f0; padding: 20px; border-radius: 5px; margin: 20px 0; }"
-        ".button { background: #4CAF50; color: white; padding: 10px 20px; border: none; border-radius: 4px; cursor: pointer; margin: 5px; }"
-        ".button:hover { background: #45a049; }"
-        ".data { background: #e7f3ff; padding: 15px; border-radius: 5px; margin: 10px 0; }"
-        "</style></head><body>"
-        "<div class='container'>"
-        "<h1>ESP32-C6 Data Logger</h1>"
-        "<div class='status'>"
-        "<h2>System Status</h2>"
-        "<p>Data Logger: Running</p>"
-        "<p>WiFi: Connected</p>"
-        "<p>Storage: Active</p>"
-        "</div>"
-        "<div class='data'>"
-        "<h2>Quick Actions</h2>"
-        "<button class='button' onclick='runTest()'>Run Test Suite</button>"
-        "<button class='button' onclick='getStatus()'>Get Status</button>"
-        "<button class='button' onclick='getData()'>Get Latest Data</button>"
-        "</div>"
-        "<div id='results'></div>"
-        "<script>"
-        "function runTest() {"
-        "  fetch('/api/test').then(r => r.json()).then(d => {"
-        "    document.getElementById('results').innerHTML = '<div class=\"data\">Test Status: ' + d.status + '</div>';"
-        "  });"
-        "}"
-        "function getStatus() {"
-        "  fetch('/api/status').then(r => r.json()).then(d => {"
-        "    document.getElementById('results').innerHTML = '<div class=\"data\">Uptime: ' + d.uptime_seconds + 's<br>Free Heap: ' + d.system.free_heap + ' bytes</div>';"
-        "  });"
-        "}"
-        "function getData() {"
-        "  fetch('/api/data/latest').then(r => r.json()).then(d => {"
-        "    let html = '<div class=\"data\"><h3>Latest Data</h3>';"
-        "    if (d.adc) {"
-        "      for (let ch in d.adc) {"
-        "        html += ch + ': ' + d.adc[ch].voltage + 'V<br>';"
-        "      }"
-        "    }"
-        "    html += '</div>';"
-        "    document.getElementById('results').innerHTML = html;"
-        "  });"
-        "}"
-        "</script>"
-        "</div></body></html>";
-
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, html_page, strlen(html_page));
+// Server-Sent Events for clients that cannot use WebSockets. Each client
+// holds one chunked text/event-stream response open and gets the same
+// fan-out messages as a JSON WebSocket client, one "data:" event each.
+// The request is detached with the async handler API: the httpd worker is
+// free again once the client is registered, and the client's fan-out
+// sender task writes the events from then on.
+#define SSE_EVENT_MAX_SIZE      (STREAM_VIEW_JSON_MAX_SIZE + 8)  // "data: " + message + blank line
+
+_Static_assert(STREAM_VIEW_UART_MAX_SIZE <= STREAM_VIEW_JSON_MAX_SIZE, "UART messages must fit an SSE event");
+
+typedef struct {
+    httpd_req_t *req;           // Async copy of the request, completed on release
+    char event[SSE_EVENT_MAX_SIZE];
+} sse_client_t;
+
+// Framed in the client's buffer so each event is a single chunk
+static esp_err_t sse_send_message(void* ctx, int fd, const stream_message_t* message) {
+    sse_client_t *client = ctx;
+    size_t length = 6 + message->length + 2;
+    if (length > sizeof(client->event)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(client->event, "data: ", 6);
+    memcpy(client->event + 6, message->data, message->length);
+    memcpy(client->event + 6 + message->length, "\n\n", 2);
+
+    esp_err_t ret = httpd_resp_send_chunk(client->req, client->event, length);
+    if (ret == ESP_OK) {
+        g_network_manager.stats.bytes_sent += length;
+    }
+    return ret;
+}
+
+// Evicted: fail the send a stalled client is blocking; release cleans up
+static void sse_close_client(void* ctx, int fd) {
+    shutdown(fd, SHUT_RDWR);
+}
+
+static void sse_release_client(void* ctx, int fd) {
+    sse_client_t *client = ctx;
+    httpd_handle_t server = client->req->handle;
+
+    httpd_req_async_handler_complete(client->req);
+    httpd_sess_trigger_close(server, fd);
+    free(client);
+    ESP_LOGI(TAG, "SSE client fd %d closed", fd);
+}
+
+static const stream_transport_t g_sse_transport = {
+    .name = "sse",
+    .send = sse_send_message,
+    .close = sse_close_client,
+    .release = sse_release_client
+};
+
+// Live stream as Server-Sent Events:
+// GET /api/stream?topics=adc0,uart1&rate=10&reduce=decimate|minmax|latest
+// Without parameters: every ADC channel, every scan, batched per window.
+static esp_err_t sse_stream_handler(httpd_req_t *req) {
+    stream_subscription_t subscription;
+    stream_subscription_default(&subscription, STREAM_ENCODING_JSON);
+    subscription.reduce = STREAM_REDUCE_DECIMATE;
+
+    char query[96];
+    char value[64];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        if (httpd_query_key_value(query, "topics", value, sizeof(value)) == ESP_OK) {
+            subscription.adc_channels = 0;
+            subscription.uart_ports = 0;
+            char *save = NULL;
+            for (char *topic = strtok_r(value, ",", &save); topic; topic = strtok_r(NULL, ",", &save)) {
+                if (!stream_subscription_set_topic(&subscription, topic, true)) {
+                    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown topic");
+                }
+            }
+        }
+        if (httpd_query_key_value(query, "rate", value, sizeof(value)) == ESP_OK) {
+            unsigned long rate = strtoul(value, NULL, 10);
+            if (rate > UINT16_MAX) {
+                return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "rate must be 0 to 65535");
+            }
+            subscription.rate_hz = (uint16_t)rate;
+        }
+        if (httpd_query_key_value(query, "reduce", value, sizeof(value)) == ESP_OK &&
+            !stream_reduce_from_name(value, &subscription.reduce)) {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "reduce must be latest, decimate or minmax");
+        }
+    }
+    stream_subscription_normalize(&subscription);
+
+    sse_client_t *client = malloc(sizeof(sse_client_t));
+    if (!client) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    if (httpd_req_async_handler_begin(req, &client->req) != ESP_OK) {
+        free(client);
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Async handler unavailable");
+    }
+
+    httpd_req_t *stream = client->req;
+    httpd_resp_set_type(stream, "text/event-stream");
+    httpd_resp_set_hdr(stream, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(stream, "Access-Control-Allow-Origin", "*");
+
+    // Headers and the reconnect delay go out before the client is registered,
+    // so nothing else writes to the response yet
+    char retry[24];
+    int length = snprintf(retry, sizeof(retry), "retry: %d\n\n", NETWORK_SSE_RETRY_MS);
+    int fd = httpd_req_to_sockfd(stream);
+    int slot = -1;
+    if (httpd_resp_send_chunk(stream, retry, length) == ESP_OK) {
+        slot = stream_fanout_add_client(&g_sse_transport, client, fd, &subscription);
+    }
+    if (slot < 0) {
+        ESP_LOGW(TAG, "No free stream slot, SSE client fd %d refused", fd);
+        httpd_resp_send_chunk(stream, NULL, 0);
+        httpd_req_async_handler_complete(stream);
+        free(client);
+        return ESP_OK;
+    }
 
+    g_network_manager.stats.sse_connections++;
     g_network_manager.stats.api_requests++;
+    ESP_LOGI(TAG, "SSE client %d registered (fd: %d)", slot, fd);
     return ESP_OK;
 }
 
-// WebSocket streaming task - batch all channels together
+static const web_asset_t *find_web_asset(const char *path) {
+    for (size_t i = 0; i < g_web_asset_count; i++) {
+        if (strcmp(g_web_assets[i].path, path) == 0) {
+            return &g_web_assets[i];
+        }
+    }
+    return NULL;
+}
+
+// Web UI, served gzipped as stored in flash. Every response carries the
+// asset's ETag, and a matching If-None-Match gets an empty 304, so a
+// reload costs a few hundred bytes instead of the page.
+static esp_err_t web_asset_handler(httpd_req_t *req) {
+    char path[32];
+    size_t length = strcspn(req->uri, "?");  // Fingerprint query (?v=) is only for caches
+    if (length >= sizeof(path)) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+    }
+    memcpy(path, req->uri, length);
+    path[length] = '\0';
+
+    const web_asset_t *asset = find_web_asset(strcmp(path, "/") == 0 ? "/index.html" : path);
+    if (!asset) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+    }
+
+    g_network_manager.stats.api_requests++;
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cache_control);
+
+    // A truncated header (long list of tags) just means a full response
+    char if_none_match[64];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", if_none_match, sizeof(if_none_match)) == ESP_OK &&
+        strstr(if_none_match, asset->etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // Every browser accepts gzip; the assets exist in no other form
+    httpd_resp_set_type(req, asset->content_type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    g_network_manager.stats.bytes_sent += asset->length;
+    return httpd_resp_send(req, (const char *)asset->data, asset->length);
+}
+
+// Views of the streaming task, one per distinct ADC subscription
+typedef struct {
+    stream_view_t views[STREAM_FANOUT_MAX_CLIENTS];
+    uint8_t count;
+    uint32_t uart_clients[CONFIG_UART_PORT_COUNT];  // Fan-out slots per UART port
+} websocket_stream_t;
+
+// Encode what the view has collected, once, for all of its clients
+static void websocket_publish_view(stream_view_t* view) {
+    while (stream_view_pending(view)) {
+        stream_message_t* message = stream_message_create(view->subscription.encoding,
+                                                          stream_view_message_size(view));
+        if (!message) {
+            return;
+        }
+
+        message->length = stream_view_encode(view, message->data, message->capacity);
+        if (message->length == 0) {
+            stream_message_release(message);
+            return;
+        }
+
+        if (message->encoding == STREAM_ENCODING_BINARY) {
+            const stream_frame_header_t* header = (const stream_frame_header_t*)message->data;
+            g_network_manager.stats.stream_frames++;
+            g_network_manager.stats.stream_samples += header->samples * __builtin_popcount(header->channel_mask);
+        }
+        stream_fanout_publish(message, view->clients);
+    }
+}
+
+static void websocket_publish_uart(websocket_stream_t* stream, const uart_data_packet_t* packet) {
+    if (packet->port >= CONFIG_UART_PORT_COUNT || !stream->uart_clients[packet->port]) {
+        return;
+    }
+
+    stream_message_t* message = stream_message_create(STREAM_ENCODING_JSON, STREAM_VIEW_UART_MAX_SIZE);
+    if (!message) {
+        return;
+    }
+    message->length = stream_view_encode_uart(packet, message->data, message->capacity);
+    if (message->length == 0) {
+        stream_message_release(message);
+        return;
+    }
+    stream_fanout_publish(message, stream->uart_clients[packet->port]);
+}
+
+static int websocket_find_view(websocket_stream_t* stream, const stream_subscription_t* subscription) {
+    for (int v = 0; v < stream->count; v++) {
+        if (stream_subscription_same_view(&stream->views[v].subscription, subscription)) {
+            return v;
+        }
+    }
+    return -1;
+}
+
+// Match the views to the current subscriptions. Views nobody uses any more
+// are dropped, new subscriptions get a fresh view.
+static void websocket_update_views(websocket_stream_t* stream) {
+    stream_subscription_t subscriptions[STREAM_FANOUT_MAX_CLIENTS];
+    uint32_t active = stream_fanout_get_subscriptions(subscriptions);
+    uint32_t unassigned = 0;
+
+    memset(stream->uart_clients, 0, sizeof(stream->uart_clients));
+    for (int v = 0; v < stream->count; v++) {
+        stream->views[v].clients = 0;
+    }
+
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        if (!(active & (1 << i))) {
+            continue;
+        }
+        for (int port = 0; port < CONFIG_UART_PORT_COUNT; port++) {
+            if (subscriptions[i].uart_ports & (1 << port)) {
+                stream->uart_clients[port] |= 1 << i;
+            }
+        }
+        if (subscriptions[i].adc_channels == 0) {
+            continue;
+        }
+
+        int v = websocket_find_view(stream, &subscriptions[i]);
+        if (v >= 0) {
+            stream->views[v].clients |= 1 << i;
+        } else {
+            unassigned |= 1 << i;
+        }
+    }
+
+    for (int v = 0; v < stream->count; ) {
+        if (stream->views[v].clients == 0) {
+            stream->views[v] = stream->views[--stream->count];
+        } else {
+            v++;
+        }
+    }
+
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        if (!(unassigned & (1 << i))) {
+            continue;
+        }
+        int v = websocket_find_view(stream, &subscriptions[i]);
+        if (v < 0) {
+            v = stream->count++;
+            stream_view_init(&stream->views[v], &subscriptions[i]);
+        }
+        stream->views[v].clients |= 1 << i;
+    }
+}
+
+// WebSocket streaming task. Samples come from the ADC stream tap and go
+// into one view per distinct subscription; every NETWORK_STREAM_BATCH_MS
+// (or when a view's frame is full) each view is encoded once and handed
+// to the fan-out for its clients. UART packets are forwarded as they come.
+// The UDP streamer, when enabled, takes every sample on the same loop.
 static void websocket_streaming_task(void* pvParameters) {
     ESP_LOGI(TAG, "WebSocket streaming task started");
 
-    adc_data_packet_t adc_packets[CONFIG_ADC_CHANNEL_COUNT]; // Buffer for all channels
-    bool channel_data[CONFIG_ADC_CHANNEL_COUNT] = {false}; // Track which channels we have data for
+    websocket_stream_t* stream = calloc(1, sizeof(websocket_stream_t));
+    if (!stream) {
+        ESP_LOGE(TAG, "Failed to allocate stream views");
+        g_network_manager.websocket_running = false;
+        g_network_manager.websocket_task = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
 
-    while (g_network_manager.websocket_running) {
-        // Clear channel data flags
-        for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
-            channel_data[i] = false;
-        }
+    uint64_t window_start = esp_timer_get_time();
 
-        // Try to get data for all channels
+    while (g_network_manager.websocket_running) {
         adc_data_packet_t packet;
-        int attempts = 0;
-        bool all_channels_ready = false;
-        while (attempts < 20 && !all_channels_ready) {
-            if (adc_manager_get_data(&packet, 5) == ESP_OK) {
-                if (packet.channel < CONFIG_ADC_CHANNEL_COUNT) {
-                    adc_packets[packet.channel] = packet;
-                    channel_data[packet.channel] = true;
-                }
-            }
-            attempts++;
-
-            // Check if we have data for all enabled channels
-            all_channels_ready = true;
-            for (int i = 0; i < CONFIG_ADC_CHANNEL_COUNT; i++) {
-                if (adc_manager_is_channel_enabled(i) && !channel_data[i]) {
-                    all_channels_ready = false;
-                    break;
+        if (adc_manager_get_stream_data(&packet, 10) == ESP_OK) {
+            stream_udp_add(&packet);
+            for (int v = 0; v < stream->count; v++) {
+                if (!stream_view_add(&stream->views[v], &packet)) {
+                    // Frame full: send it and start the next with this sample
+                    websocket_publish_view(&stream->views[v]);
+                    stream_view_add(&stream->views[v], &packet);
                 }
             }
         }
 
-        // Send data for any channels we have
-        for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
-            if (channel_data[ch]) {
-                // Create JSON message for this channel
-                cJSON *json = cJSON_CreateObject();
-                cJSON *type = cJSON_CreateString("data");
-                cJSON *timestamp = cJSON_CreateNumber(adc_packets[ch].timestamp_us);
-                cJSON *channel = cJSON_CreateNumber(adc_packets[ch].channel);
-                cJSON *voltage = cJSON_CreateNumber(adc_packets[ch].filtered_voltage);
-                cJSON *raw = cJSON_CreateNumber(adc_packets[ch].raw_value);
-                cJSON *sequence = cJSON_CreateNumber(adc_packets[ch].sequence);
-
-                cJSON_AddItemToObject(json, "type", type);
-                cJSON_AddItemToObject(json, "timestamp", timestamp);
-                cJSON_AddItemToObject(json, "channel", channel);
-                cJSON_AddItemToObject(json, "voltage", voltage);
-                cJSON_AddItemToObject(json, "raw", raw);
-                cJSON_AddItemToObject(json, "sequence", sequence);
-
-                char *json_string = cJSON_Print(json);
-
-                // Send to all active WebSocket clients
-                for (int i = 0; i < MAX_WEBSOCKET_CLIENTS; i++) {
-                    if (g_network_manager.websocket_clients[i].active) {
-                        httpd_ws_frame_t ws_pkt;
-                        memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
-                        ws_pkt.payload = (uint8_t*)json_string;
-                        ws_pkt.len = strlen(json_string);
-                        ws_pkt.type = HTTPD_WS_TYPE_TEXT;
-
-                        esp_err_t ret = httpd_ws_send_frame_async(
-                            g_network_manager.websocket_clients[i].server,
-                            g_network_manager.websocket_clients[i].fd,
-                            &ws_pkt);
-
-                        if (ret != ESP_OK) {
-                            ESP_LOGW(TAG, "WebSocket client %d disconnected", i);
-                            g_network_manager.websocket_clients[i].active = false;
-                        }
-                    }
-                }
+        uart_data_packet_t uart_packet;
+        while (uart_manager_get_stream_data(&uart_packet, 0) == ESP_OK) {
+            websocket_publish_uart(stream, &uart_packet);
+        }
+
+        stream_udp_poll();
 
-                free(json_string);
-                cJSON_Delete(json);
+        if (esp_timer_get_time() - window_start >= NETWORK_STREAM_BATCH_MS * 1000) {
+            for (int v = 0; v < stream->count; v++) {
+                websocket_publish_view(&stream->views[v]);
             }
+            websocket_update_views(stream);
+            window_start = esp_timer_get_time();
         }
-
-        // Delay between batches
-        vTaskDelay(pdMS_TO_TICKS(50)); // Send batches every 50ms
     }
 
+    free(stream);
+
     ESP_LOGI(TAG, "WebSocket streaming task stopped");
     vTaskDelete(NULL);
 }
@@ -1031,7 +2669,11 @@ esp_err_t network_manager_init(void) {
     }
 
     // Initialize WebSocket support
-    memset(g_network_manager.websocket_clients, 0, sizeof(g_network_manager.websocket_clients));
+    ret = stream_fanout_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize stream fan-out: %s", esp_err_to_name(ret));
+        return ret;
+    }
     g_network_manager.websocket_running = false;
     g_network_manager.websocket_task = NULL;
 
@@ -1138,11 +2780,13 @@ esp_err_t network_manager_start_http_server(void) {
     httpd_config_t server_config = HTTPD_DEFAULT_CONFIG();
     server_config.server_port = config->network_config.http_port;
     server_config.max_open_sockets = config->network_config.max_clients;
-    server_config.max_uri_handlers = 12;  // Increase from default 8 to support WebSocket + all API endpoints
+    server_config.max_uri_handlers = 20;  // Increase from default 8 to support WebSocket + all API endpoints
+    server_config.uri_match_fn = httpd_uri_match_wildcard;  // For /api/logs/* and the web UI
     server_config.task_priority = 5;
     server_config.stack_size = 8192;
     server_config.enable_so_linger = true;
     server_config.linger_timeout = 0;
+    server_config.close_fn = http_session_closed;
 
     ESP_LOGI(TAG, "Starting HTTP server on port %d", server_config.server_port);
 
@@ -1164,6 +2808,14 @@ esp_err_t network_manager_start_http_server(void) {
         };
         httpd_register_uri_handler(g_network_manager.http_server, &data_latest_uri);
 
+        httpd_uri_t data_history_uri = {
+            .uri = "/api/data/history",
+            .method = HTTP_GET,
+            .handler = data_history_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &data_history_uri);
+
         httpd_uri_t config_get_uri = {
             .uri = "/api/config",
             .method = HTTP_GET,
@@ -1180,6 +2832,38 @@ esp_err_t network_manager_start_http_server(void) {
         };
         httpd_register_uri_handler(g_network_manager.http_server, &test_uri);
 
+        httpd_uri_t logs_list_uri = {
+            .uri = "/api/logs",
+            .method = HTTP_GET,
+            .handler = logs_list_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &logs_list_uri);
+
+        httpd_uri_t logs_download_uri = {
+            .uri = "/api/logs/*",
+            .method = HTTP_GET,
+            .handler = logs_download_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &logs_download_uri);
+
+        httpd_uri_t storage_health_uri = {
+            .uri = "/api/storage/health",
+            .method = HTTP_GET,
+            .handler = storage_health_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &storage_health_uri);
+
+        httpd_uri_t adc_history_uri = {
+            .uri = "/api/adc/history",
+            .method = HTTP_GET,
+            .handler = adc_history_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &adc_history_uri);
+
         // Configuration POST endpoints
         httpd_uri_t config_adc_post_uri = {
             .uri = "/api/config/adc",
@@ -1205,13 +2889,13 @@ esp_err_t network_manager_start_http_server(void) {
         };
         httpd_register_uri_handler(g_network_manager.http_server, &config_apply_post_uri);
 
-        httpd_uri_t root_uri = {
-            .uri = "/",
-            .method = HTTP_GET,
-            .handler = root_handler,
+        httpd_uri_t config_udp_post_uri = {
+            .uri = "/api/config/udp",
+            .method = HTTP_POST,
+            .handler = config_udp_post_handler,
             .user_ctx = NULL
         };
-        httpd_register_uri_handler(g_network_manager.http_server, &root_uri);
+        httpd_register_uri_handler(g_network_manager.http_server, &config_udp_post_uri);
 
         // Register WebSocket handler
         httpd_uri_t websocket_uri = {
@@ -1223,8 +2907,34 @@ esp_err_t network_manager_start_http_server(void) {
         };
         httpd_register_uri_handler(g_network_manager.http_server, &websocket_uri);
 
+        httpd_uri_t sse_stream_uri = {
+            .uri = "/api/stream",
+            .method = HTTP_GET,
+            .handler = sse_stream_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &sse_stream_uri);
+
+        httpd_uri_t metrics_uri = {
+            .uri = "/metrics",
+            .method = HTTP_GET,
+            .handler = metrics_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &metrics_uri);
+
+        // Web UI last: the wildcard catches every GET no handler above took
+        httpd_uri_t web_asset_uri = {
+            .uri = "/*",
+            .method = HTTP_GET,
+            .handler = web_asset_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(g_network_manager.http_server, &web_asset_uri);
+
         // Start WebSocket streaming task on core 0 (separate from main app on core 1)
         g_network_manager.websocket_running = true;
+        stream_udp_configure();
         BaseType_t ret = xTaskCreatePinnedToCore(websocket_streaming_task, "websocket_stream", 4096, NULL, 4, &g_network_manager.websocket_task, 0);
         if (ret != pdPASS) {
             ESP_LOGE(TAG, "Failed to create WebSocket streaming task");
@@ -1285,7 +2995,7 @@ esp_err_t network_manager_get_stats(network_stats_t* stats) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    memcpy(stats, &g_network_manager.stats, sizeof(network_stats_t));
+    stats_snapshot(stats, &g_network_manager.stats, sizeof(network_stats_t));
     return ESP_OK;
 }
 
@@ -1295,8 +3005,35 @@ esp_err_t network_manager_print_stats(void) {
     ESP_LOGI(TAG, "HTTP Server: %s", g_network_manager.http_server_running ? "Running" : "Stopped");
     ESP_LOGI(TAG, "API Requests: %lu", g_network_manager.stats.api_requests);
     ESP_LOGI(TAG, "WebSocket Connections: %lu", g_network_manager.stats.websocket_connections);
+    ESP_LOGI(TAG, "SSE Connections: %lu", g_network_manager.stats.sse_connections);
+    ESP_LOGI(TAG, "Stream Frames: %lu (%llu samples)", g_network_manager.stats.stream_frames,
+             g_network_manager.stats.stream_samples);
+    stream_fanout_stats_t fanout;
+    if (stream_fanout_get_stats(&fanout) == ESP_OK) {
+        ESP_LOGI(TAG, "Stream Messages: %lu published, %lu clients evicted", fanout.published, fanout.evictions);
+        for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+            stream_client_stats_t *client = &fanout.clients[i];
+            if (client->active) {
+                ESP_LOGI(TAG, "  Client fd %d (%s): %lu sent, %lu dropped, %lu stale, latency avg %lu us max %lu us",
+                         client->fd, client->transport, client->sent, client->dropped, client->stale,
+                         client->latency_avg_us, client->latency_max_us);
+            }
+        }
+    }
+    stream_udp_stats_t udp;
+    if (stream_udp_get_stats(&udp) == ESP_OK && udp.running) {
+        ESP_LOGI(TAG, "UDP Stream: %lu datagrams, %lu send errors, send max %lu us, sample age max %lu us",
+                 udp.datagrams, udp.send_errors, udp.send_max_us, udp.age_max_us);
+    }
     ESP_LOGI(TAG, "Bytes Sent: %lu", g_network_manager.stats.bytes_sent);
     ESP_LOGI(TAG, "Connection Errors: %lu", g_network_manager.stats.connection_errors);
+
+    // Read throughput counts SD time only; overall includes WiFi send time
+    network_stats_t *stats = &g_network_manager.stats;
+    ESP_LOGI(TAG, "Log Downloads: %lu (%lu aborted), %llu bytes, SD read %llu KB/s, overall %llu KB/s",
+             stats->downloads, stats->download_errors, stats->download_bytes,
+             stats->download_read_us ? stats->download_bytes * 1000000 / 1024 / stats->download_read_us : 0,
+             stats->download_time_us ? stats->download_bytes * 1000000 / 1024 / stats->download_time_us : 0);
     ESP_LOGI(TAG, "WiFi APs Found: %d", g_network_manager.wifi_ap_count);
 
     return ESP_OK;
@@ -15,17 +15,37 @@ extern "C" {
 #define NETWORK_MAX_RETRY           5
 #define NETWORK_WEBSOCKET_BUFFER    1024
 #define NETWORK_MAX_CLIENTS         5
+#define NETWORK_DOWNLOAD_CHUNK_SIZE (16 * 1024)  // SD read / HTTP chunk size for log downloads
+#define NETWORK_STREAM_BATCH_MS     50     // WebSocket batch window
+#define NETWORK_JSON_CHUNK_SIZE     1024   // JSON response buffer, sent as one chunk when full
+#define NETWORK_SSE_RETRY_MS        2000   // Reconnect delay suggested to Server-Sent Events clients
+#define NETWORK_STORAGE_BACKOFF_MS  10     // Download pause while the storage queues are backed up
 
 // Network Statistics
 typedef struct {
     uint32_t api_requests;          // Total API requests
     uint32_t websocket_connections; // WebSocket connections
+    uint32_t sse_connections;       // Server-Sent Events connections
     uint32_t bytes_sent;            // Total bytes sent
     uint32_t bytes_received;        // Total bytes received
     uint32_t connection_errors;     // Connection errors
     uint64_t last_activity;         // Last network activity
+    uint32_t downloads;             // Log downloads completed
+    uint32_t download_errors;       // Log downloads aborted
+    uint64_t download_bytes;        // Log bytes sent
+    uint64_t download_read_us;      // Time spent reading logs from the SD card
+    uint64_t download_time_us;      // Total time spent serving log downloads
+    uint32_t stream_frames;         // Binary WebSocket frames published (once for all clients)
+    uint64_t stream_samples;        // ADC samples packed into binary frames
 } network_stats_t;
 
+// Byte range of a log download request
+typedef enum {
+    NETWORK_RANGE_NONE,             // No (usable) Range header, send the whole file
+    NETWORK_RANGE_PARTIAL,          // Single satisfiable range
+    NETWORK_RANGE_UNSATISFIABLE     // Range outside the readable part of the file
+} network_range_t;
+
 // WebSocket Message Types
 typedef enum {
     WS_MSG_DATA = 1,
@@ -82,6 +102,7 @@ esp_err_t network_manager_set_auth_token(const char* token);
 // Utility Functions
 esp_err_t network_manager_create_json_response(const char* status, const char* message, char** json_str);
 esp_err_t network_manager_parse_json_request(const char* json_str, cJSON** json_obj);
+network_range_t network_manager_parse_range(const char* header, size_t total, size_t* start, size_t* end);
 
 #ifdef __cplusplus
 }
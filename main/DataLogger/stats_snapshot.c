@@ -0,0 +1,15 @@
+#include "stats_snapshot.h"
+#include <string.h>
+
+bool stats_snapshot(void* dst, const void* src, size_t size) {
+    for (int attempt = 0; attempt < STATS_SNAPSHOT_ATTEMPTS; attempt++) {
+        memcpy(dst, src, size);
+
+        // Make the compare read the live block again rather than reuse the copy
+        __asm__ __volatile__("" ::: "memory");
+        if (memcmp(dst, src, size) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
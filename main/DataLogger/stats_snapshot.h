@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Lock-free copy of a statistics block that other tasks keep updating.
+// Writers are untouched: they bump counters in place, without a lock or
+// sequence count, so the sampling and logging paths pay nothing. The
+// reader copies the block and checks it against the live one; a writer
+// that ran in between (a half-updated 64-bit counter, or two fields out
+// of step) makes the check fail and the copy is taken again.
+//
+// Counters only grow, so a block that matches after the copy is one that
+// existed. After STATS_SNAPSHOT_ATTEMPTS misses the last copy is kept and
+// false is returned; it is then as good as a plain memcpy.
+
+// Snapshot Configuration
+#define STATS_SNAPSHOT_ATTEMPTS     4
+
+// Snapshot Functions
+bool stats_snapshot(void* dst, const void* src, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,217 @@
+#include "storage_bench.h"
+#include "SD_SPI.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char* TAG = "STORAGE_BENCH";
+
+static const uint32_t g_block_sizes[STORAGE_BENCH_BLOCK_SIZES] = {512, 4096, 16384, 32768};
+
+#define STORAGE_BENCH_MAX_BLOCK     32768
+#define STORAGE_BENCH_RANDOM_BLOCK  4096
+
+// Fill a block with a pattern stamped with its file offset, so a read of
+// the wrong sector is caught as well as corrupted data
+static void fill_block(uint8_t* buffer, uint32_t length, uint32_t offset) {
+    for (uint32_t i = 0; i < length; i++) {
+        buffer[i] = (uint8_t)((offset + i) * 31 + 7);
+    }
+    memcpy(buffer, &offset, sizeof(offset));
+}
+
+// Check data read at offset; stamped when offset is the start of a written block
+static bool check_block(const uint8_t* buffer, uint32_t length, uint32_t offset, bool stamped) {
+    uint32_t i = 0;
+    if (stamped) {
+        uint32_t stamp;
+        memcpy(&stamp, buffer, sizeof(stamp));
+        if (stamp != offset) {
+            return false;
+        }
+        i = sizeof(stamp);
+    }
+    for (; i < length; i++) {
+        if (buffer[i] != (uint8_t)((offset + i) * 31 + 7)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t kbps(uint64_t bytes, uint64_t elapsed_us) {
+    return elapsed_us ? (uint32_t)(bytes * 1000000ULL / 1024 / elapsed_us) : 0;
+}
+
+// Write the scratch file in blocks of block_size (fsync included), then read it back
+static esp_err_t bench_sequential(uint8_t* buffer, uint32_t block_size,
+                                  storage_bench_seq_t* seq, uint32_t* verify_errors) {
+    seq->block_size = block_size;
+
+    int fd = open(STORAGE_BENCH_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Failed to create %s", STORAGE_BENCH_FILE);
+        return ESP_FAIL;
+    }
+
+    uint64_t elapsed_us = 0;
+    for (uint32_t offset = 0; offset < STORAGE_BENCH_FILE_SIZE; offset += block_size) {
+        fill_block(buffer, block_size, offset);
+        uint64_t start = esp_timer_get_time();
+        ssize_t written = write(fd, buffer, block_size);
+        elapsed_us += esp_timer_get_time() - start;
+        if (written != (ssize_t)block_size) {
+            close(fd);
+            return ESP_FAIL;
+        }
+    }
+    uint64_t start = esp_timer_get_time();
+    fsync(fd);
+    elapsed_us += esp_timer_get_time() - start;
+    close(fd);
+    seq->write_kbps = kbps(STORAGE_BENCH_FILE_SIZE, elapsed_us);
+
+    fd = open(STORAGE_BENCH_FILE, O_RDONLY);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+
+    elapsed_us = 0;
+    for (uint32_t offset = 0; offset < STORAGE_BENCH_FILE_SIZE; offset += block_size) {
+        start = esp_timer_get_time();
+        ssize_t got = read(fd, buffer, block_size);
+        elapsed_us += esp_timer_get_time() - start;
+        if (got != (ssize_t)block_size) {
+            close(fd);
+            return ESP_FAIL;
+        }
+        if (!check_block(buffer, block_size, offset, true)) {
+            (*verify_errors)++;
+        }
+    }
+    close(fd);
+    seq->read_kbps = kbps(STORAGE_BENCH_FILE_SIZE, elapsed_us);
+
+    return ESP_OK;
+}
+
+// 4 KB reads at random aligned offsets of the file left by the last sequential pass
+static esp_err_t bench_random_reads(uint8_t* buffer, storage_bench_result_t* result) {
+    int fd = open(STORAGE_BENCH_FILE, O_RDONLY);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+
+    const uint32_t blocks = STORAGE_BENCH_FILE_SIZE / STORAGE_BENCH_RANDOM_BLOCK;
+    uint64_t elapsed_us = 0;
+    for (int i = 0; i < STORAGE_BENCH_RANDOM_READS; i++) {
+        uint32_t offset = (esp_random() % blocks) * STORAGE_BENCH_RANDOM_BLOCK;
+        uint64_t start = esp_timer_get_time();
+        bool ok = lseek(fd, offset, SEEK_SET) == (off_t)offset &&
+                  read(fd, buffer, STORAGE_BENCH_RANDOM_BLOCK) == STORAGE_BENCH_RANDOM_BLOCK;
+        elapsed_us += esp_timer_get_time() - start;
+        if (!ok) {
+            close(fd);
+            return ESP_FAIL;
+        }
+        // The last pass wrote the largest blocks, stamped at their own offsets
+        bool stamped = offset % g_block_sizes[STORAGE_BENCH_BLOCK_SIZES - 1] == 0;
+        if (!check_block(buffer, STORAGE_BENCH_RANDOM_BLOCK, offset, stamped)) {
+            result->verify_errors++;
+        }
+    }
+    close(fd);
+
+    result->random_read_avg_us = (uint32_t)(elapsed_us / STORAGE_BENCH_RANDOM_READS);
+    result->random_read_iops = result->random_read_avg_us ? 1000000 / result->random_read_avg_us : 0;
+    return ESP_OK;
+}
+
+// Cost of one group commit: a sector-sized append followed by fsync
+static esp_err_t bench_fsync(uint8_t* buffer, storage_bench_result_t* result) {
+    int fd = open(STORAGE_BENCH_FILE, O_WRONLY | O_APPEND);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+
+    uint64_t total_us = 0;
+    for (int i = 0; i < STORAGE_BENCH_FSYNC_ROUNDS; i++) {
+        if (write(fd, buffer, 512) != 512) {
+            close(fd);
+            return ESP_FAIL;
+        }
+        uint64_t start = esp_timer_get_time();
+        fsync(fd);
+        uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+        total_us += elapsed_us;
+        if (elapsed_us > result->fsync_max_us) {
+            result->fsync_max_us = elapsed_us;
+        }
+    }
+    close(fd);
+
+    result->fsync_avg_us = (uint32_t)(total_us / STORAGE_BENCH_FSYNC_ROUNDS);
+    return ESP_OK;
+}
+
+esp_err_t storage_bench_run(storage_bench_result_t* result) {
+    if (!result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(result, 0, sizeof(storage_bench_result_t));
+
+    sdmmc_card_t* card = SD_Get_Card();
+    if (!card) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memcpy(result->card_name, card->cid.name, sizeof(result->card_name) - 1);
+    result->high_capacity = (card->ocr & SD_OCR_SDHC_CAP) != 0;
+    result->card_size_mb = SDCard_Size;
+    result->bus_freq_khz = card->real_freq_khz;
+
+    uint8_t* buffer = malloc(STORAGE_BENCH_MAX_BLOCK);
+    if (!buffer) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint64_t start_time = esp_timer_get_time();
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < STORAGE_BENCH_BLOCK_SIZES && ret == ESP_OK; i++) {
+        ret = bench_sequential(buffer, g_block_sizes[i], &result->seq[i], &result->verify_errors);
+    }
+    if (ret == ESP_OK) {
+        ret = bench_random_reads(buffer, result);
+    }
+    if (ret == ESP_OK) {
+        ret = bench_fsync(buffer, result);
+    }
+    result->duration_ms = (uint32_t)((esp_timer_get_time() - start_time) / 1000);
+
+    free(buffer);
+    unlink(STORAGE_BENCH_FILE);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Benchmark failed");
+    }
+    return ret;
+}
+
+void storage_bench_print(const storage_bench_result_t* result) {
+    ESP_LOGI(TAG, "=== SD Card Benchmark ===");
+    ESP_LOGI(TAG, "Card: %s, %s, %lu MB at %lu kHz", result->card_name,
+             result->high_capacity ? "SDHC/SDXC" : "SDSC",
+             result->card_size_mb, result->bus_freq_khz);
+    for (int i = 0; i < STORAGE_BENCH_BLOCK_SIZES; i++) {
+        ESP_LOGI(TAG, "Sequential %5lu B: write %lu KB/s, read %lu KB/s",
+                 result->seq[i].block_size, result->seq[i].write_kbps, result->seq[i].read_kbps);
+    }
+    ESP_LOGI(TAG, "Random 4 KB reads: %lu IOPS (%lu us avg)",
+             result->random_read_iops, result->random_read_avg_us);
+    ESP_LOGI(TAG, "fsync: %lu us avg, %lu us max", result->fsync_avg_us, result->fsync_max_us);
+    ESP_LOGI(TAG, "Verify errors: %lu, duration %lu ms", result->verify_errors, result->duration_ms);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "esp_err.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// SD card transfer benchmark. Writes and reads back a scratch file at
+// several block sizes, then measures random 4 KB reads and the cost of a
+// small write plus fsync (one group commit). Runs alongside normal
+// logging, so results include whatever bus and card load that adds.
+// The scratch file is removed afterwards.
+
+// Benchmark Configuration
+#define STORAGE_BENCH_FILE              CONFIG_SD_MOUNT_POINT "/BENCH.TMP"
+#define STORAGE_BENCH_FILE_SIZE         (256 * 1024)
+#define STORAGE_BENCH_BLOCK_SIZES       4      // 512 B, 4 KB, 16 KB, 32 KB
+#define STORAGE_BENCH_RANDOM_READS      64
+#define STORAGE_BENCH_FSYNC_ROUNDS      16
+
+// Sequential Result for one block size
+typedef struct {
+    uint32_t block_size;
+    uint32_t write_kbps;
+    uint32_t read_kbps;
+} storage_bench_seq_t;
+
+// Benchmark Result
+typedef struct {
+    char card_name[8];
+    bool high_capacity;                 // SDHC/SDXC
+    uint32_t card_size_mb;
+    uint32_t bus_freq_khz;              // Clock the card actually runs at
+    storage_bench_seq_t seq[STORAGE_BENCH_BLOCK_SIZES];
+    uint32_t random_read_iops;          // 4 KB reads at random aligned offsets
+    uint32_t random_read_avg_us;
+    uint32_t fsync_avg_us;              // 512 B append + fsync
+    uint32_t fsync_max_us;
+    uint32_t verify_errors;             // Blocks that read back wrong
+    uint32_t duration_ms;
+} storage_bench_result_t;
+
+// Benchmark Functions
+esp_err_t storage_bench_run(storage_bench_result_t* result);
+void storage_bench_print(const storage_bench_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,494 @@
+#include "storage_catalog.h"
+#include "storage_manager.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <ctype.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static const char* TAG = "STORAGE_CAT";
+
+#define CATALOG_MAGIC       0x474C5443  // "CTLG"
+#define CATALOG_VERSION     3
+
+// Journal operations
+typedef enum {
+    CATALOG_OP_ADD = 1,
+    CATALOG_OP_UPDATE = 2,
+    CATALOG_OP_REMOVE_OLDEST = 3,
+    CATALOG_OP_REMOVE = 4           // By name, for a closed file behind an open head
+} catalog_op_t;
+
+// On-disk journal header, followed by catalog records
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+} catalog_file_header_t;
+
+// On-disk journal record
+typedef struct __attribute__((packed)) {
+    uint8_t op;
+    storage_catalog_entry_t entry;
+    uint32_t crc32;             // CRC32 of op and entry
+} catalog_record_t;
+
+// Catalog State
+typedef struct {
+    storage_catalog_ring_t ring;
+    uint32_t journal_records;   // Records in the on-card journal
+    SemaphoreHandle_t mutex;    // Listing runs outside the storage task
+} storage_catalog_state_t;
+
+static storage_catalog_state_t g_catalog = {0};
+
+static storage_catalog_entry_t* ring_at(const storage_catalog_ring_t* ring, uint32_t index) {
+    return (storage_catalog_entry_t*)&ring->entries[(ring->head + index) % STORAGE_CATALOG_MAX_ENTRIES];
+}
+
+static storage_catalog_entry_t* entry_at(uint32_t index) {
+    return ring_at(&g_catalog.ring, index);
+}
+
+esp_err_t storage_catalog_ring_add(storage_catalog_ring_t* ring, const storage_catalog_entry_t* entry) {
+    if (ring->count >= STORAGE_CATALOG_MAX_ENTRIES) {
+        return ESP_ERR_NO_MEM;
+    }
+    storage_catalog_entry_t* slot = ring_at(ring, ring->count);
+    *slot = *entry;
+    slot->name[STORAGE_CATALOG_NAME_LEN - 1] = '\0';
+    ring->count++;
+    return ESP_OK;
+}
+
+// Close the gap by moving the older entries up one slot; order is kept.
+// Removing the head moves nothing. Reclaim only removes deeper entries to
+// get past files still open, so at most a few entries move.
+esp_err_t storage_catalog_ring_remove(storage_catalog_ring_t* ring, uint32_t index) {
+    if (index >= ring->count) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    for (uint32_t i = index; i > 0; i--) {
+        *ring_at(ring, i) = *ring_at(ring, i - 1);
+    }
+    ring->head = (ring->head + 1) % STORAGE_CATALOG_MAX_ENTRIES;
+    ring->count--;
+    return ESP_OK;
+}
+
+bool storage_catalog_ring_oldest_except(const storage_catalog_ring_t* ring, storage_catalog_visit_t skip,
+                                        void* ctx, uint32_t* index) {
+    for (uint32_t i = 0; i < ring->count; i++) {
+        if (!skip || !skip(ring_at(ring, i), ctx)) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void catalog_lock(void) {
+    if (!g_catalog.mutex) {
+        g_catalog.mutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(g_catalog.mutex, portMAX_DELAY);
+}
+
+static void catalog_unlock(void) {
+    xSemaphoreGive(g_catalog.mutex);
+}
+
+static void catalog_reset(void) {
+    g_catalog.ring.head = 0;
+    g_catalog.ring.count = 0;
+    g_catalog.journal_records = 0;
+}
+
+static uint32_t record_crc(const catalog_record_t* record) {
+    return esp_rom_crc32_le(0, (const uint8_t*)record, offsetof(catalog_record_t, crc32));
+}
+
+// Newest entry with this name (open files are at the tail)
+static storage_catalog_entry_t* find_entry(const char* name) {
+    for (uint32_t i = g_catalog.ring.count; i > 0; i--) {
+        storage_catalog_entry_t* entry = entry_at(i - 1);
+        if (strncmp(entry->name, name, STORAGE_CATALOG_NAME_LEN) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Apply one journal operation to the in-RAM ring
+static esp_err_t apply_op(uint8_t op, const storage_catalog_entry_t* entry) {
+    switch (op) {
+        case CATALOG_OP_ADD:
+            return storage_catalog_ring_add(&g_catalog.ring, entry);
+
+        case CATALOG_OP_UPDATE: {
+            storage_catalog_entry_t* existing = find_entry(entry->name);
+            if (!existing) {
+                return ESP_ERR_NOT_FOUND;
+            }
+            *existing = *entry;
+            return ESP_OK;
+        }
+
+        case CATALOG_OP_REMOVE_OLDEST:
+            return storage_catalog_ring_remove(&g_catalog.ring, 0);
+
+        case CATALOG_OP_REMOVE:
+            for (uint32_t i = 0; i < g_catalog.ring.count; i++) {
+                if (strncmp(entry_at(i)->name, entry->name, STORAGE_CATALOG_NAME_LEN) == 0) {
+                    return storage_catalog_ring_remove(&g_catalog.ring, i);
+                }
+            }
+            return ESP_ERR_NOT_FOUND;
+
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+}
+
+static bool write_record(FILE* file, uint8_t op, const storage_catalog_entry_t* entry) {
+    catalog_record_t record = { .op = op, .entry = *entry };
+    record.crc32 = record_crc(&record);
+    return fwrite(&record, sizeof(record), 1, file) == 1;
+}
+
+// Write a snapshot of the live entries and swap it in for the journal
+static esp_err_t compact_locked(void) {
+    FILE* file = fopen(STORAGE_CATALOG_TEMP_FILE, "wb");
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to write catalog snapshot");
+        return ESP_FAIL;
+    }
+
+    catalog_file_header_t header = {
+        .magic = CATALOG_MAGIC,
+        .version = CATALOG_VERSION,
+        .record_size = sizeof(catalog_record_t)
+    };
+
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (uint32_t i = 0; ok && i < g_catalog.ring.count; i++) {
+        ok = write_record(file, CATALOG_OP_ADD, entry_at(i));
+    }
+    fclose(file);
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Failed to write catalog snapshot entries");
+        remove(STORAGE_CATALOG_TEMP_FILE);
+        return ESP_FAIL;
+    }
+
+    // FAT rename does not replace; load() finishes the swap if we stop here
+    remove(STORAGE_CATALOG_FILE);
+    if (rename(STORAGE_CATALOG_TEMP_FILE, STORAGE_CATALOG_FILE) != 0) {
+        ESP_LOGE(TAG, "Failed to install catalog snapshot");
+        return ESP_FAIL;
+    }
+
+    g_catalog.journal_records = g_catalog.ring.count;
+    return ESP_OK;
+}
+
+// Apply an operation and append it to the journal
+static esp_err_t append_locked(uint8_t op, const storage_catalog_entry_t* entry) {
+    esp_err_t ret = apply_op(op, entry);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    FILE* file = fopen(STORAGE_CATALOG_FILE, "ab");
+    if (!file || !write_record(file, op, entry)) {
+        ESP_LOGE(TAG, "Failed to append to catalog");
+        if (file) {
+            fclose(file);
+        }
+        // A partial record would misalign later appends; rewrite from RAM
+        return compact_locked();
+    }
+    fclose(file);
+    g_catalog.journal_records++;
+
+    if (g_catalog.journal_records > g_catalog.ring.count + STORAGE_CATALOG_COMPACT_SLACK) {
+        return compact_locked();
+    }
+    return ESP_OK;
+}
+
+static bool is_log_file(const char* name) {
+    size_t len = strlen(name);
+    return len > 4 && len < STORAGE_CATALOG_NAME_LEN && strcasecmp(name + len - 4, ".bin") == 0;
+}
+
+// Data source from the file name: the session tag (U<port>, A<group>, S0)
+// or the prefix used by older firmware (uart<port>_, adc<group>_, sys_)
+static void source_from_name(const char* name, storage_catalog_entry_t* entry) {
+    size_t digit = 1;
+    if (strncasecmp(name, "uart", 4) == 0) {
+        digit = 4;
+    } else if (strncasecmp(name, "adc", 3) == 0) {
+        digit = 3;
+    }
+
+    if (toupper((unsigned char)name[0]) == 'U') {
+        entry->data_type = DATA_TYPE_UART;
+    } else if (toupper((unsigned char)name[0]) == 'A') {
+        entry->data_type = DATA_TYPE_ADC;
+    } else {
+        entry->data_type = DATA_TYPE_SYSTEM;
+        return;
+    }
+    entry->source_id = (name[digit] >= '0' && name[digit] <= '9') ? name[digit] - '0' : 0;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    const storage_catalog_entry_t* ea = a;
+    const storage_catalog_entry_t* eb = b;
+    if (ea->created != eb->created) {
+        return (ea->created < eb->created) ? -1 : 1;
+    }
+    return strcmp(ea->name, eb->name);
+}
+
+// Directory scan, used only when the catalog is missing or corrupt.
+// Record counts and time ranges are unknown for rebuilt entries.
+static esp_err_t rebuild_locked(void) {
+    catalog_reset();
+
+    DIR* dir = opendir(CONFIG_SD_MOUNT_POINT);
+    if (!dir) {
+        ESP_LOGE(TAG, "Failed to open %s", CONFIG_SD_MOUNT_POINT);
+        return ESP_FAIL;
+    }
+
+    uint32_t skipped = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!is_log_file(ent->d_name)) {
+            continue;
+        }
+
+        char path[STORAGE_CATALOG_NAME_LEN + sizeof(CONFIG_SD_MOUNT_POINT) + 1];
+        snprintf(path, sizeof(path), "%s/%s", CONFIG_SD_MOUNT_POINT, ent->d_name);
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+
+        if (g_catalog.ring.count >= STORAGE_CATALOG_MAX_ENTRIES) {
+            skipped++;
+            continue;
+        }
+
+        storage_catalog_entry_t* entry = &g_catalog.ring.entries[g_catalog.ring.count++];
+        memset(entry, 0, sizeof(*entry));
+        strncpy(entry->name, ent->d_name, sizeof(entry->name) - 1);
+        source_from_name(ent->d_name, entry);
+        entry->size = st.st_size;
+        entry->created = st.st_mtime;     // 1980 if written before the clock was set: unknown age
+    }
+    closedir(dir);
+
+    qsort(g_catalog.ring.entries, g_catalog.ring.count, sizeof(storage_catalog_entry_t), compare_entries);
+
+    if (skipped > 0) {
+        ESP_LOGW(TAG, "Catalog full, %lu log files left untracked", skipped);
+    }
+    ESP_LOGI(TAG, "Catalog rebuilt: %lu files", g_catalog.ring.count);
+
+    return compact_locked();
+}
+
+esp_err_t storage_catalog_load(void) {
+    catalog_lock();
+    catalog_reset();
+
+    // Finish a compaction interrupted between remove and rename
+    struct stat st;
+    if (stat(STORAGE_CATALOG_FILE, &st) != 0 && stat(STORAGE_CATALOG_TEMP_FILE, &st) == 0) {
+        rename(STORAGE_CATALOG_TEMP_FILE, STORAGE_CATALOG_FILE);
+    }
+
+    FILE* file = fopen(STORAGE_CATALOG_FILE, "rb");
+    if (!file) {
+        ESP_LOGW(TAG, "No catalog on card, rebuilding from directory");
+        esp_err_t ret = rebuild_locked();
+        catalog_unlock();
+        return ret;
+    }
+
+    catalog_file_header_t header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == CATALOG_MAGIC &&
+                 header.version == CATALOG_VERSION &&
+                 header.record_size == sizeof(catalog_record_t);
+
+    bool torn = false;
+    catalog_record_t record;
+    while (valid) {
+        size_t got = fread(&record, 1, sizeof(record), file);
+        if (got == 0) {
+            break;
+        }
+        if (got < sizeof(record)) {
+            torn = true;  // Append cut short by a power loss
+            break;
+        }
+        if (record_crc(&record) != record.crc32) {
+            valid = false;
+            break;
+        }
+        apply_op(record.op, &record.entry);
+        g_catalog.journal_records++;
+    }
+    fclose(file);
+
+    esp_err_t ret = ESP_OK;
+    if (!valid) {
+        ESP_LOGW(TAG, "Catalog failed CRC check, rebuilding from directory");
+        ret = rebuild_locked();
+    } else {
+        ESP_LOGI(TAG, "Catalog loaded: %lu files (%lu journal records)",
+                 g_catalog.ring.count, g_catalog.journal_records);
+        if (torn || g_catalog.journal_records > g_catalog.ring.count + STORAGE_CATALOG_COMPACT_SLACK) {
+            ret = compact_locked();
+        }
+    }
+
+    catalog_unlock();
+    return ret;
+}
+
+esp_err_t storage_catalog_rebuild(void) {
+    catalog_lock();
+    esp_err_t ret = rebuild_locked();
+    catalog_unlock();
+    return ret;
+}
+
+esp_err_t storage_catalog_compact(void) {
+    catalog_lock();
+    esp_err_t ret = compact_locked();
+    catalog_unlock();
+    return ret;
+}
+
+esp_err_t storage_catalog_add(const storage_catalog_entry_t* entry) {
+    if (!entry || strnlen(entry->name, STORAGE_CATALOG_NAME_LEN) >= STORAGE_CATALOG_NAME_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    catalog_lock();
+    esp_err_t ret = append_locked(CATALOG_OP_ADD, entry);
+    catalog_unlock();
+    return ret;
+}
+
+esp_err_t storage_catalog_update(const storage_catalog_entry_t* entry) {
+    if (!entry) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    catalog_lock();
+    esp_err_t ret = append_locked(CATALOG_OP_UPDATE, entry);
+    catalog_unlock();
+    return ret;
+}
+
+esp_err_t storage_catalog_remove_oldest(void) {
+    catalog_lock();
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (g_catalog.ring.count > 0) {
+        ret = append_locked(CATALOG_OP_REMOVE_OLDEST, entry_at(0));
+    }
+    catalog_unlock();
+    return ret;
+}
+
+esp_err_t storage_catalog_remove(const char* name) {
+    if (!name) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    storage_catalog_entry_t entry = {0};
+    strncpy(entry.name, name, sizeof(entry.name) - 1);
+
+    // The oldest file is the usual case; journal it as a head removal so
+    // neither this call nor a later replay searches the ring
+    catalog_lock();
+    uint8_t op = CATALOG_OP_REMOVE;
+    if (g_catalog.ring.count > 0 && strncmp(entry_at(0)->name, entry.name, STORAGE_CATALOG_NAME_LEN) == 0) {
+        op = CATALOG_OP_REMOVE_OLDEST;
+    }
+    esp_err_t ret = append_locked(op, &entry);
+    catalog_unlock();
+    return ret;
+}
+
+uint32_t storage_catalog_count(void) {
+    return g_catalog.ring.count;
+}
+
+bool storage_catalog_oldest(storage_catalog_entry_t* entry) {
+    catalog_lock();
+    bool found = g_catalog.ring.count > 0;
+    if (found) {
+        *entry = *entry_at(0);
+    }
+    catalog_unlock();
+    return found;
+}
+
+// Oldest entry skip does not hold back. skip runs under the catalog lock.
+bool storage_catalog_oldest_except(storage_catalog_visit_t skip, void* ctx, storage_catalog_entry_t* entry) {
+    catalog_lock();
+    uint32_t index;
+    bool found = storage_catalog_ring_oldest_except(&g_catalog.ring, skip, ctx, &index);
+    if (found) {
+        *entry = *entry_at(index);
+    }
+    catalog_unlock();
+    return found;
+}
+
+bool storage_catalog_get(uint32_t index, storage_catalog_entry_t* entry) {
+    catalog_lock();
+    bool found = index < g_catalog.ring.count;
+    if (found) {
+        *entry = *entry_at(index);
+    }
+    catalog_unlock();
+    return found;
+}
+
+bool storage_catalog_find(const char* name, storage_catalog_entry_t* entry) {
+    catalog_lock();
+    storage_catalog_entry_t* existing = find_entry(name);
+    if (existing) {
+        *entry = *existing;
+    }
+    catalog_unlock();
+    return existing != NULL;
+}
+
+// Visit entries oldest first until visit returns false.
+// Runs under the catalog lock, so visit must not call back into the catalog.
+void storage_catalog_for_each(storage_catalog_visit_t visit, void* ctx) {
+    catalog_lock();
+    for (uint32_t i = 0; i < g_catalog.ring.count; i++) {
+        if (!visit(entry_at(i), ctx)) {
+            break;
+        }
+    }
+    catalog_unlock();
+}
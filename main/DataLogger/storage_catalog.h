@@ -0,0 +1,88 @@
+#pragma once
+
+#include "esp_err.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Persistent catalog of log files on the SD card, oldest first.
+// The storage task owns it: files are appended when created and removed
+// from the head when deleted, so finding the oldest file never needs a
+// directory scan. All lookups are served from RAM.
+//
+// On the card the catalog is an append-only journal of CRC-protected
+// add/update/remove records, compacted into a snapshot once the journal
+// grows well past the live entry count. A torn final record is ignored;
+// the directory is rescanned only if a record fails its CRC.
+
+// Catalog Configuration
+#define STORAGE_CATALOG_MAX_ENTRIES     128    // Ring size, also the cap on files kept
+#define STORAGE_CATALOG_NAME_LEN        32     // File name relative to the mount point
+#define STORAGE_CATALOG_FILE            CONFIG_SD_MOUNT_POINT "/CATALOG.DAT"
+#define STORAGE_CATALOG_TEMP_FILE       CONFIG_SD_MOUNT_POINT "/CATALOG.TMP"
+#define STORAGE_CATALOG_COMPACT_SLACK   64     // Journal records allowed beyond the live entries
+
+// Scrub Verdicts (set by the background scrubber, see storage_scrub.h)
+typedef enum {
+    STORAGE_SCRUB_UNCHECKED = 0,
+    STORAGE_SCRUB_CLEAN = 1,
+    STORAGE_SCRUB_CORRUPT = 2,          // Damaged chunks or records, see corrupt_*
+    STORAGE_SCRUB_INDEX_MISMATCH = 3    // Data intact but the entry's figures disagree with it
+} storage_scrub_verdict_t;
+
+// Catalog Entry
+typedef struct __attribute__((packed)) {
+    char name[STORAGE_CATALOG_NAME_LEN];
+    uint8_t data_type;          // data_type_t of the records in the file
+    uint8_t source_id;          // UART port / ADC channel group, 0 for system files
+    uint32_t size;              // Bytes on disk (updated on close/recovery)
+    uint32_t record_count;      // Records in the file
+    int64_t created;            // Wall-clock creation time (time_t)
+    uint64_t first_timestamp_us;// Timestamp of the first record
+    uint64_t last_timestamp_us; // Timestamp of the last record
+    uint8_t scrub_verdict;      // storage_scrub_verdict_t
+    uint16_t corrupt_ranges;    // Damaged byte ranges found by the scrubber
+    uint32_t corrupt_offset;    // Start of the first damaged range
+    uint32_t corrupt_bytes;     // Bytes in damaged ranges
+} storage_catalog_entry_t;
+
+typedef bool (*storage_catalog_visit_t)(const storage_catalog_entry_t* entry, void* ctx);
+
+// Ring of entries, head is the oldest file. The catalog keeps one; the
+// ring functions work on any, so the reclaim order can be checked off-card.
+typedef struct {
+    storage_catalog_entry_t entries[STORAGE_CATALOG_MAX_ENTRIES];
+    uint32_t head;
+    uint32_t count;
+} storage_catalog_ring_t;
+
+// Catalog Functions
+esp_err_t storage_catalog_load(void);
+esp_err_t storage_catalog_rebuild(void);
+esp_err_t storage_catalog_compact(void);
+esp_err_t storage_catalog_add(const storage_catalog_entry_t* entry);
+esp_err_t storage_catalog_update(const storage_catalog_entry_t* entry);
+esp_err_t storage_catalog_remove_oldest(void);
+esp_err_t storage_catalog_remove(const char* name);
+
+// Lookup (index 0 is the oldest file)
+uint32_t storage_catalog_count(void);
+bool storage_catalog_oldest(storage_catalog_entry_t* entry);
+bool storage_catalog_oldest_except(storage_catalog_visit_t skip, void* ctx, storage_catalog_entry_t* entry);
+bool storage_catalog_get(uint32_t index, storage_catalog_entry_t* entry);
+bool storage_catalog_find(const char* name, storage_catalog_entry_t* entry);
+void storage_catalog_for_each(storage_catalog_visit_t visit, void* ctx);
+
+// Ring Functions (no locking, no journal)
+esp_err_t storage_catalog_ring_add(storage_catalog_ring_t* ring, const storage_catalog_entry_t* entry);
+esp_err_t storage_catalog_ring_remove(storage_catalog_ring_t* ring, uint32_t index);
+bool storage_catalog_ring_oldest_except(const storage_catalog_ring_t* ring, storage_catalog_visit_t skip,
+                                        void* ctx, uint32_t* index);
+
+#ifdef __cplusplus
+}
+#endif
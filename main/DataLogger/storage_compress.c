@@ -0,0 +1,206 @@
+#include "storage_compress.h"
+#include <string.h>
+
+// LZ4 block format constants
+#define LZ_MIN_MATCH        4
+#define LZ_LAST_LITERALS    5   // Last 5 bytes are always literals
+#define LZ_MF_LIMIT         12  // Last match must start 12 bytes before end
+#define LZ_MAX_OFFSET       65535
+#define LZ_RUN_MASK         15
+
+static inline uint32_t read_u32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash_u32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - STORAGE_COMPRESS_HASH_LOG);
+}
+
+// Write an LZ4 length continuation (255, 255, ..., remainder)
+static uint8_t* write_length(uint8_t* op, const uint8_t* oend, size_t len) {
+    while (len >= 255) {
+        if (op >= oend) return NULL;
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend) return NULL;
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// Emit one sequence: literals [anchor, anchor+lit_len) followed by an
+// optional match (match_len == 0 means final literal-only sequence)
+static uint8_t* write_sequence(uint8_t* op, const uint8_t* oend,
+                               const uint8_t* anchor, size_t lit_len,
+                               uint16_t offset, size_t match_len) {
+    if (op >= oend) return NULL;
+    uint8_t* token = op++;
+
+    // Literal length
+    if (lit_len >= LZ_RUN_MASK) {
+        *token = LZ_RUN_MASK << 4;
+        op = write_length(op, oend, lit_len - LZ_RUN_MASK);
+        if (!op) return NULL;
+    } else {
+        *token = (uint8_t)(lit_len << 4);
+    }
+
+    if ((size_t)(oend - op) < lit_len) return NULL;
+    memcpy(op, anchor, lit_len);
+    op += lit_len;
+
+    if (match_len == 0) {
+        return op;
+    }
+
+    // Offset (little endian)
+    if (oend - op < 2) return NULL;
+    *op++ = (uint8_t)(offset & 0xFF);
+    *op++ = (uint8_t)(offset >> 8);
+
+    // Match length
+    size_t ml = match_len - LZ_MIN_MATCH;
+    if (ml >= LZ_RUN_MASK) {
+        *token |= LZ_RUN_MASK;
+        op = write_length(op, oend, ml - LZ_RUN_MASK);
+    } else {
+        *token |= (uint8_t)ml;
+    }
+
+    return op;
+}
+
+size_t storage_compress_block(storage_compress_ctx_t* ctx,
+                              const uint8_t* src, size_t src_len,
+                              uint8_t* dst, size_t dst_capacity) {
+    if (!ctx || !src || !dst || src_len > STORAGE_COMPRESS_MAX_INPUT) {
+        return 0;
+    }
+
+    uint8_t* op = dst;
+    const uint8_t* oend = dst + dst_capacity;
+    const uint8_t* anchor = src;
+    const uint8_t* iend = src + src_len;
+
+    if (src_len >= LZ_MF_LIMIT + 1) {
+        const uint8_t* mflimit = iend - LZ_MF_LIMIT;
+        const uint8_t* matchlimit = iend - LZ_LAST_LITERALS;
+        const uint8_t* ip = src + 1;
+
+        memset(ctx->table, 0, sizeof(ctx->table));
+        ctx->table[hash_u32(read_u32(src))] = 0;
+
+        while (ip < mflimit) {
+            uint32_t seq = read_u32(ip);
+            uint32_t h = hash_u32(seq);
+            const uint8_t* ref = src + ctx->table[h];
+            ctx->table[h] = (uint16_t)(ip - src);
+
+            if (ip - ref > LZ_MAX_OFFSET || read_u32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            // Extend backwards into pending literals
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            // Extend forwards
+            size_t match_len = LZ_MIN_MATCH;
+            while (ip + match_len < matchlimit && ref[match_len] == ip[match_len]) {
+                match_len++;
+            }
+
+            op = write_sequence(op, oend, anchor, (size_t)(ip - anchor),
+                                (uint16_t)(ip - ref), match_len);
+            if (!op) return 0;
+
+            ip += match_len;
+            anchor = ip;
+
+            // Prime the table with a position inside the match for the next search
+            if (ip < mflimit) {
+                ctx->table[hash_u32(read_u32(ip - 2))] = (uint16_t)(ip - 2 - src);
+            }
+        }
+    }
+
+    // Final literal run
+    op = write_sequence(op, oend, anchor, (size_t)(iend - anchor), 0, 0);
+    if (!op) return 0;
+
+    return (size_t)(op - dst);
+}
+
+esp_err_t storage_decompress_block(const uint8_t* src, size_t src_len,
+                                   uint8_t* dst, size_t expected_len) {
+    if (!src || !dst) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + expected_len;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        // Literals
+        size_t lit_len = token >> 4;
+        if (lit_len == LZ_RUN_MASK) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return ESP_ERR_INVALID_SIZE;
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+        if ((size_t)(iend - ip) < lit_len || (size_t)(oend - op) < lit_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        // Last sequence carries literals only
+        if (ip >= iend) {
+            break;
+        }
+
+        // Match
+        if (iend - ip < 2) return ESP_ERR_INVALID_SIZE;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        size_t match_len = token & LZ_RUN_MASK;
+        if (match_len == LZ_RUN_MASK) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return ESP_ERR_INVALID_SIZE;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if ((size_t)(oend - op) < match_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        // Byte copy: source and destination may overlap (offset < match_len)
+        const uint8_t* ref = op - offset;
+        for (size_t i = 0; i < match_len; i++) {
+            op[i] = ref[i];
+        }
+        op += match_len;
+    }
+
+    return (op == oend) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Streaming LZ compressor for storage chunks.
+// Output is a standard LZ4 block, so host tools can decode it with any
+// LZ4 block decoder (e.g. python-lz4: lz4.block.decompress(data, raw_len)).
+// The match window is the chunk being compressed, so every chunk decodes
+// independently of the rest of the file.
+
+// Compressor Configuration
+#define STORAGE_COMPRESS_HASH_LOG       10     // 1024-entry match table
+#define STORAGE_COMPRESS_MAX_INPUT      65535  // 16-bit offsets/lengths in chunk header
+
+// Worst-case output size for an incompressible input of length n
+#define STORAGE_COMPRESS_BOUND(n)       ((n) + ((n) / 255) + 16)
+
+// Match table scratch memory (caller owned, one per compressing task)
+typedef struct {
+    uint16_t table[1 << STORAGE_COMPRESS_HASH_LOG];
+} storage_compress_ctx_t;
+
+// Compress src into dst. Returns compressed size, or 0 if the output would
+// not fit in dst_capacity (caller should then store the chunk raw).
+size_t storage_compress_block(storage_compress_ctx_t* ctx,
+                              const uint8_t* src, size_t src_len,
+                              uint8_t* dst, size_t dst_capacity);
+
+// Decompress an LZ4 block. Fails unless exactly expected_len bytes are produced.
+esp_err_t storage_decompress_block(const uint8_t* src, size_t src_len,
+                                   uint8_t* dst, size_t expected_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,311 @@
+#include "storage_export.h"
+#include "storage_manager.h"
+#include "storage_compress.h"
+#include "text_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Longest formatted record: a system message with every byte escaped as \u00XX
+#define EXPORT_MAX_RECORD_TEXT  (6 * STORAGE_MAX_PAYLOAD_LEN + 96)
+
+// Export State - one allocation per export
+typedef struct {
+    FILE* file;
+    const storage_export_filter_t* filter;
+    storage_export_sink_t sink;
+    void* sink_ctx;
+    storage_export_result_t* result;
+    text_writer_t out;
+    uint8_t body[STORAGE_CHUNK_SIZE];       // Stored chunk body
+    uint8_t raw[STORAGE_CHUNK_SIZE];        // Decompressed body
+    char buffer[STORAGE_EXPORT_OUT_SIZE];
+} export_ctx_t;
+
+static const char g_hex_digits[] = "0123456789abcdef";
+
+static char* put_text(char* p, const char* text, size_t length) {
+    memcpy(p, text, length);
+    return p + length;
+}
+
+#define PUT_LITERAL(p, literal) put_text((p), (literal), sizeof(literal) - 1)
+
+static char* put_hex(char* p, const uint8_t* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        *p++ = g_hex_digits[data[i] >> 4];
+        *p++ = g_hex_digits[data[i] & 0x0F];
+    }
+    return p;
+}
+
+// Message text as a quoted CSV field body ("" for a quote)
+static char* put_csv_text(char* p, const uint8_t* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '"') {
+            *p++ = '"';
+        }
+        *p++ = text[i];
+    }
+    return p;
+}
+
+// Message text as a JSON string body
+static char* put_json_text(char* p, const uint8_t* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = text[i];
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = c;
+        } else if (c < 0x20) {
+            p = PUT_LITERAL(p, "\\u00");
+            *p++ = g_hex_digits[c >> 4];
+            *p++ = g_hex_digits[c & 0x0F];
+        } else {
+            *p++ = c;
+        }
+    }
+    return p;
+}
+
+// Output buffer flush: the sink, counting only what it accepted
+static esp_err_t flush_out(const char* data, size_t length, void* arg) {
+    export_ctx_t* ctx = arg;
+    esp_err_t ret = ctx->sink(data, length, ctx->sink_ctx);
+    if (ret == ESP_OK) {
+        ctx->result->bytes_out += length;
+    }
+    return ret;
+}
+
+// CSV columns: timestamp_us,type,source,value,raw,data
+static void format_record(export_ctx_t* ctx, const data_packet_t* packet, const uint8_t* payload) {
+    bool json = ctx->filter->format == STORAGE_EXPORT_NDJSON;
+    char* start = text_writer_reserve(&ctx->out, EXPORT_MAX_RECORD_TEXT);
+    if (!start) {
+        return;
+    }
+    char* p = start;
+
+    if (json) {
+        p = PUT_LITERAL(p, "{\"t\":");
+    }
+    p += text_format_uint(p, packet->timestamp_us);
+
+    const char* type = "uart";
+    if (packet->data_type == DATA_TYPE_ADC) {
+        type = "adc";
+    } else if (packet->data_type == DATA_TYPE_SYSTEM) {
+        type = "system";
+    }
+    if (json) {
+        p = PUT_LITERAL(p, ",\"type\":\"");
+        p = put_text(p, type, strlen(type));
+        p = PUT_LITERAL(p, "\",\"src\":");
+    } else {
+        *p++ = ',';
+        p = put_text(p, type, strlen(type));
+        *p++ = ',';
+    }
+    p += text_format_u32(p, packet->source_id, 0);
+
+    if (packet->data_type == DATA_TYPE_ADC && packet->data_length >= sizeof(float) + sizeof(int32_t)) {
+        // Payload is {float voltage; int raw_value}
+        float voltage;
+        int32_t raw_value;
+        memcpy(&voltage, payload, sizeof(voltage));
+        memcpy(&raw_value, payload + sizeof(voltage), sizeof(raw_value));
+        p = json ? PUT_LITERAL(p, ",\"v\":") : PUT_LITERAL(p, ",");
+        size_t n = text_format_fixed(p, voltage, 4);
+        p = (n > 0) ? p + n : PUT_LITERAL(p, "null");
+        p = json ? PUT_LITERAL(p, ",\"raw\":") : PUT_LITERAL(p, ",");
+        p += text_format_int(p, raw_value);
+        p = json ? PUT_LITERAL(p, "}") : PUT_LITERAL(p, ",");
+    } else if (packet->data_type == DATA_TYPE_SYSTEM) {
+        if (json) {
+            p = PUT_LITERAL(p, ",\"msg\":\"");
+            p = put_json_text(p, payload, packet->data_length);
+            p = PUT_LITERAL(p, "\"}");
+        } else {
+            p = PUT_LITERAL(p, ",,,\"");
+            p = put_csv_text(p, payload, packet->data_length);
+            *p++ = '"';
+        }
+    } else {
+        p = json ? PUT_LITERAL(p, ",\"hex\":\"") : PUT_LITERAL(p, ",,,");
+        p = put_hex(p, payload, packet->data_length);
+        if (json) {
+            p = PUT_LITERAL(p, "\"}");
+        }
+    }
+    *p++ = '\n';
+
+    text_writer_commit(&ctx->out, p - start);
+    ctx->result->records_exported++;
+}
+
+static bool read_header(export_ctx_t* ctx, uint32_t offset, storage_chunk_header_t* header) {
+    if (fseek(ctx->file, offset, SEEK_SET) != 0 ||
+        fread(header, sizeof(*header), 1, ctx->file) != 1) {
+        return false;
+    }
+    ctx->result->bytes_read += sizeof(*header);
+    return header->magic == STORAGE_CHUNK_MAGIC &&
+           header->version == STORAGE_CHUNK_VERSION &&
+           header->raw_length <= STORAGE_CHUNK_SIZE &&
+           header->stored_length <= header->raw_length;
+}
+
+// Offset of the first chunk that can hold records at or after start_us.
+// Chunk k ends before chunk k+1 begins, so chunk k is skipped once the
+// first record of chunk k+1 is still before the range. Only headers and
+// first records are read; a compressed chunk ends the skipping.
+static uint32_t seek_range_start(export_ctx_t* ctx, uint32_t length) {
+    uint32_t offset = 0;
+    uint32_t candidate = 0;
+    uint32_t passed = 0;
+    storage_chunk_header_t header;
+    data_packet_t first;
+
+    while (offset + sizeof(header) <= length && read_header(ctx, offset, &header)) {
+        if ((header.flags & STORAGE_CHUNK_FLAG_COMPRESSED) ||
+            header.stored_length < sizeof(first) ||
+            fread(&first, sizeof(first), 1, ctx->file) != 1 ||
+            first.magic != STORAGE_MAGIC_NUMBER) {
+            break;
+        }
+        ctx->result->bytes_read += sizeof(first);
+        if (first.timestamp_us >= ctx->filter->start_us) {
+            break;
+        }
+        candidate = offset;
+        passed++;
+        offset += sizeof(header) + header.stored_length;
+    }
+
+    ctx->result->chunks_skipped = (passed > 0) ? passed - 1 : 0;
+    return candidate;
+}
+
+// Format the records of a decoded chunk. Returns false once the scan is
+// past the time range or the body does not decode.
+static bool export_records(export_ctx_t* ctx, const storage_chunk_header_t* header, const uint8_t* body) {
+    const storage_export_filter_t* filter = ctx->filter;
+    size_t pos = 0;
+
+    while (pos + sizeof(data_packet_t) <= header->raw_length) {
+        data_packet_t packet;
+        memcpy(&packet, body + pos, sizeof(packet));
+        const uint8_t* payload = body + pos + sizeof(data_packet_t);
+        if (packet.magic != STORAGE_MAGIC_NUMBER ||
+            packet.data_length > STORAGE_MAX_PAYLOAD_LEN ||
+            packet.data_length > header->raw_length - pos - sizeof(data_packet_t)) {
+            ctx->result->truncated = true;
+            return false;
+        }
+        pos += sizeof(data_packet_t) + packet.data_length;
+        ctx->result->records_scanned++;
+
+        if (packet.timestamp_us > filter->end_us) {
+            return false;
+        }
+        if (packet.timestamp_us < filter->start_us ||
+            (filter->channel != STORAGE_EXPORT_ALL_CHANNELS && packet.source_id != filter->channel)) {
+            continue;
+        }
+
+        format_record(ctx, &packet, payload);
+        if (ctx->out.error != ESP_OK) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Whether a catalogued file can hold records for the filter. Time ranges
+// are only known for closed files that were not rebuilt from the directory.
+bool storage_export_entry_matches(const storage_catalog_entry_t* entry, const storage_export_filter_t* filter) {
+    if (!entry || !filter) {
+        return false;
+    }
+
+    if (entry->record_count > 0 && entry->last_timestamp_us > 0 &&
+        (entry->last_timestamp_us < filter->start_us || entry->first_timestamp_us > filter->end_us)) {
+        return false;
+    }
+
+    if (filter->channel == STORAGE_EXPORT_ALL_CHANNELS) {
+        return true;
+    }
+    switch (entry->data_type) {
+        case DATA_TYPE_UART:
+            return entry->source_id == filter->channel;
+        case DATA_TYPE_ADC:
+            return entry->source_id == filter->channel / STORAGE_ADC_STREAM_CHANNELS;
+        default:
+            return false;  // System events carry no channel
+    }
+}
+
+// Export the first length bytes of a log file (the readable size of a
+// file being written). A damaged chunk ends the export early.
+esp_err_t storage_export_file(const char* path, size_t length, const storage_export_filter_t* filter,
+                              storage_export_sink_t sink, void* sink_ctx, storage_export_result_t* result) {
+    if (!path || !filter || !sink || !result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(result, 0, sizeof(*result));
+    export_ctx_t* ctx = malloc(sizeof(export_ctx_t));
+    if (!ctx) {
+        return ESP_ERR_NO_MEM;
+    }
+    ctx->file = fopen(path, "rb");
+    if (!ctx->file) {
+        free(ctx);
+        return ESP_ERR_NOT_FOUND;
+    }
+    ctx->filter = filter;
+    ctx->sink = sink;
+    ctx->sink_ctx = sink_ctx;
+    ctx->result = result;
+    text_writer_init(&ctx->out, ctx->buffer, sizeof(ctx->buffer), flush_out, ctx);
+
+    if (filter->format == STORAGE_EXPORT_CSV) {
+        text_writer_put_str(&ctx->out, STORAGE_EXPORT_CSV_HEADER);
+    }
+
+    uint32_t offset = (filter->start_us > 0) ? seek_range_start(ctx, length) : 0;
+    storage_chunk_header_t header;
+    while (ctx->out.error == ESP_OK && offset + sizeof(header) <= length) {
+        if (!read_header(ctx, offset, &header) ||
+            offset + sizeof(header) + header.stored_length > length ||
+            fread(ctx->body, 1, header.stored_length, ctx->file) != header.stored_length ||
+            storage_chunk_crc(&header, ctx->body) != header.crc32) {
+            result->truncated = true;
+            break;
+        }
+        result->bytes_read += header.stored_length;
+        offset += sizeof(header) + header.stored_length;
+
+        const uint8_t* body = ctx->body;
+        if (header.flags & STORAGE_CHUNK_FLAG_COMPRESSED) {
+            if (storage_decompress_block(ctx->body, header.stored_length, ctx->raw, header.raw_length) != ESP_OK) {
+                result->truncated = true;
+                break;
+            }
+            body = ctx->raw;
+        }
+        result->chunks_decoded++;
+
+        if (!export_records(ctx, &header, body)) {
+            break;
+        }
+    }
+    fclose(ctx->file);
+
+    esp_err_t ret = text_writer_flush(&ctx->out);
+    free(ctx);
+    return ret;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "esp_err.h"
+#include "storage_catalog.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Text export of binary log files. A file is decoded one chunk at a time
+// and each record is formatted straight into a small output buffer that
+// is handed to a sink (the HTTP handler sends it as a response chunk), so
+// an export of any size runs in constant memory. Numbers are formatted
+// with the text_writer integer formatters; printf is not used per record.
+//
+// Filters are pushed down as far as the data allows. Files whose catalog
+// entry cannot match are not opened. Records of a file are in timestamp
+// order, so chunks before the start of a time range are skipped by reading
+// only their headers and first record, and the scan ends at the first
+// record past the end of the range. A channel filter selects the file
+// (UART port, ADC channel group); the two channels of an ADC group share
+// every chunk, so within a file it is applied per record.
+
+// Export Configuration
+#define STORAGE_EXPORT_OUT_SIZE     4096   // Output buffer, flushed to the sink when nearly full
+#define STORAGE_EXPORT_ALL_CHANNELS (-1)
+#define STORAGE_EXPORT_CSV_HEADER   "timestamp_us,type,source,value,raw,data\n"
+
+typedef enum {
+    STORAGE_EXPORT_CSV = 0,
+    STORAGE_EXPORT_NDJSON
+} storage_export_format_t;
+
+typedef struct {
+    storage_export_format_t format;
+    uint64_t start_us;          // 0 = from the first record
+    uint64_t end_us;            // UINT64_MAX = to the last record
+    int channel;                // ADC channel or UART port, STORAGE_EXPORT_ALL_CHANNELS for all
+} storage_export_filter_t;
+
+// Export Statistics
+typedef struct {
+    uint32_t chunks_decoded;
+    uint32_t chunks_skipped;    // Passed over by the time range without decoding
+    uint32_t records_scanned;
+    uint32_t records_exported;
+    uint32_t bytes_read;
+    uint32_t bytes_out;
+    bool truncated;             // Stopped at a damaged chunk
+} storage_export_result_t;
+
+// Receives formatted text; a non-OK return aborts the export
+typedef esp_err_t (*storage_export_sink_t)(const char* data, size_t length, void* ctx);
+
+// Export Functions
+bool storage_export_entry_matches(const storage_catalog_entry_t* entry, const storage_export_filter_t* filter);
+esp_err_t storage_export_file(const char* path, size_t length, const storage_export_filter_t* filter,
+                              storage_export_sink_t sink, void* ctx, storage_export_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,72 +1,912 @@
 #include "storage_manager.h"
+#include "storage_compress.h"
+#include "storage_catalog.h"
+#include "storage_spill.h"
+#include "storage_rollup.h"
+#include "storage_staging.h"
+#include "storage_stream.h"
+#include "storage_scrub.h"
+#include "storage_session.h"
+#include "stats_snapshot.h"
 #include "uart_manager.h"
 #include "adc_manager.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "esp_rom_crc.h"
+#include "esp_vfs_fat.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "config.h"
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <stddef.h>
 #include <time.h>
+#include <unistd.h>
 
 static const char* TAG = "STORAGE_MGR";
 
+#define STORAGE_SPACE_CHECK_INTERVAL_US (10 * 1000 * 1000)
+#define STORAGE_VALID_TIME_MIN          1577836800  // 2020-01-01, wall clock not set before this
+#define STORAGE_SD_RETRY_INTERVAL_US    (2 * 1000 * 1000)
+#define STORAGE_SD_PROBE_FILE           CONFIG_SD_MOUNT_POINT "/PROBE.TMP"
+#define STORAGE_SPILL_DRAIN_BATCH       16  // Spilled records moved per loop, live data goes first
+#define STORAGE_FRAME_WEIGHT            4   // Frames served per bulk record while both are queued
+#define STORAGE_BULK_WEIGHT             1
+#define STORAGE_STALL_THRESHOLD_US      (100 * 1000)    // SD write counted as a stall
+#define STORAGE_ADAPT_INTERVAL_US       (1000 * 1000)   // Staging pool resize period
+#define STORAGE_BULK_SHED_PCT           50  // Staging pool use above which bulk samples are shed
+#define STORAGE_STOP_TIMEOUT_MS         5000    // Wait for the storage task to finish its loop
+
 // Storage Manager State
 typedef struct {
     bool initialized;
     bool running;
     TaskHandle_t storage_task;
-    QueueHandle_t write_queue;
-    log_file_t current_files[STORAGE_MAX_FILES];
+    TaskHandle_t stopper;                   // Notified once the storage task has left its loop
+    QueueHandle_t write_queues[STORAGE_PRIORITY_LEVELS];
+    uint8_t service_credit[STORAGE_PRIORITY_LEVELS];    // Weighted round robin for frames/bulk
+    bool urgent_commit;                     // An event was written, commit without waiting
+    SemaphoreHandle_t staging_mutex;        // Serialises queue sends and the staging pool
+    uint32_t ingest_bytes;                  // Bytes accepted in the current adapt window
+    uint32_t window_peak_latency_us;        // Slowest SD operation in the current adapt window
+    uint32_t latency_peak_us;               // Decaying peak used to size the staging pool
+    uint64_t last_adapt_time;
+    log_file_t streams[STORAGE_STREAM_COUNT];   // Log file per source stream, indexed by stream id
     uint32_t total_files_created;
     uint64_t total_bytes_written;
     storage_stats_t stats;
+    storage_compress_ctx_t* compress_ctx;   // Match table for the storage task
+    uint8_t* compress_buffer;               // Compressed chunk scratch
+    uint64_t last_sync_time;                // Time of the last group commit
+    uint64_t first_unsynced_time;           // Arrival of the oldest uncommitted record
+    size_t bytes_since_sync;                // Bytes accepted since the last group commit
+    uint64_t last_space_check;              // Time of the last space manager pass
+    bool space_check_pending;               // Run the space manager on the next loop
+    uint32_t retention_request_days;        // Retention pass requested from another task
+    bool sd_available;                      // False while records are diverted to the spill tier
+    bool sd_fault;                          // A write or sync failed
+    bool sd_stalled;                        // A write took longer than spill_latency_ms
+    uint64_t sd_retry_time;                 // Next SD probe while unavailable
+    bool created_backfilled;                // Pre-sync creation times of this session fixed
 } storage_manager_state_t;
 
 static storage_manager_state_t g_storage_manager = {0};
 
-// Generate filename with timestamp
-static esp_err_t generate_filename(const char* prefix, char* filename, size_t max_len) {
-    time_t now;
-    struct tm timeinfo;
-    time(&now);
-    localtime_r(&now, &timeinfo);
+// Catalog name of a log file (path relative to the mount point)
+static const char* catalog_name(const char* path) {
+    size_t prefix_len = strlen(CONFIG_SD_MOUNT_POINT);
+    if (strncmp(path, CONFIG_SD_MOUNT_POINT, prefix_len) == 0 && path[prefix_len] == '/') {
+        return path + prefix_len + 1;
+    }
+    return path;
+}
+
+static bool is_file_open(const char* name) {
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        if (g_storage_manager.streams[i].active &&
+            strcmp(catalog_name(g_storage_manager.streams[i].filename), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* storage_data_type_name(uint8_t data_type) {
+    switch (data_type) {
+        case DATA_TYPE_UART:
+            return "uart";
+        case DATA_TYPE_ADC:
+            return "adc";
+        default:
+            return "system";
+    }
+}
+
+// Compression is selected per UART port, behind the global storage switch
+static bool chunk_should_compress(const log_file_t* log_file) {
+    if (log_file->data_type != DATA_TYPE_UART || log_file->source_id >= CONFIG_UART_PORT_COUNT) {
+        return false;
+    }
+
+    system_config_t* config = config_get_instance();
+    return config->storage_config.compress_files &&
+           config->uart_config[log_file->source_id].compress_log;
+}
+
+// Account one SD write or sync in the card health figures, and flag the
+// card as stalled when it exceeds the spill latency threshold
+static void record_sd_latency(uint64_t elapsed_us, size_t bytes) {
+    storage_stats_t* stats = &g_storage_manager.stats;
+
+    int bucket = 0;
+    uint64_t limit = STORAGE_LATENCY_BUCKET0_US;
+    while (elapsed_us >= limit && bucket < STORAGE_LATENCY_BUCKETS - 1) {
+        limit <<= 1;
+        bucket++;
+    }
+    stats->write_latency_hist[bucket]++;
+    stats->sd_write_bytes += bytes;
+    stats->sd_write_time_us += elapsed_us;
+    if (elapsed_us > stats->write_latency_max_us) {
+        stats->write_latency_max_us = (uint32_t)elapsed_us;
+    }
+    if (elapsed_us > g_storage_manager.window_peak_latency_us) {
+        g_storage_manager.window_peak_latency_us = (uint32_t)elapsed_us;
+    }
+    if (elapsed_us >= STORAGE_STALL_THRESHOLD_US) {
+        stats->write_stalls++;
+    }
+
+    system_config_t* config = config_get_instance();
+    if (elapsed_us > (uint64_t)config->storage_config.spill_latency_ms * 1000) {
+        ESP_LOGW(TAG, "SD write took %llu ms", elapsed_us / 1000);
+        g_storage_manager.stats.sd_stalls++;
+        g_storage_manager.sd_stalled = true;
+    }
+}
+
+// Write a chunk of the file's stream to the file, compressing it when
+// enabled. The chunk is left as it is; the caller recycles it.
+static esp_err_t write_chunk(log_file_t* log_file, const storage_chunk_t* chunk) {
+    if (!log_file || !log_file->file_handle || !chunk) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (chunk->used == 0) {
+        return ESP_OK;
+    }
+
+    storage_chunk_header_t header = {
+        .magic = STORAGE_CHUNK_MAGIC,
+        .version = STORAGE_CHUNK_VERSION,
+        .flags = 0,
+        .record_count = chunk->records,
+        .raw_length = chunk->used,
+        .stored_length = chunk->used
+    };
+    const uint8_t* body = chunk->data;
+
+    if (chunk_should_compress(log_file)) {
+        uint64_t start_time = esp_timer_get_time();
+        size_t compressed = storage_compress_block(g_storage_manager.compress_ctx,
+                                                   chunk->data, chunk->used,
+                                                   g_storage_manager.compress_buffer,
+                                                   STORAGE_COMPRESS_BOUND(STORAGE_CHUNK_SIZE));
+        g_storage_manager.stats.compress_time_us += esp_timer_get_time() - start_time;
+        g_storage_manager.stats.compress_bytes_in += chunk->used;
+
+        // Keep the chunk raw if compression did not help
+        if (compressed > 0 && compressed < chunk->used) {
+            header.flags |= STORAGE_CHUNK_FLAG_COMPRESSED;
+            header.stored_length = compressed;
+            body = g_storage_manager.compress_buffer;
+            g_storage_manager.stats.chunks_compressed++;
+        }
+        g_storage_manager.stats.compress_bytes_out += header.stored_length;
+    }
 
-    snprintf(filename, max_len, "%s/%s_%04d%02d%02d_%02d%02d%02d.bin",
-             CONFIG_SD_MOUNT_POINT, prefix,
-             timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-             timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+    header.crc32 = storage_chunk_crc(&header, body);
+
+    uint64_t write_start = esp_timer_get_time();
+    if (fwrite(&header, sizeof(header), 1, log_file->file_handle) != 1 ||
+        fwrite(body, 1, header.stored_length, log_file->file_handle) != header.stored_length) {
+        ESP_LOGE(TAG, "Failed to write chunk to %s", log_file->filename);
+        return ESP_FAIL;
+    }
+    size_t chunk_bytes = sizeof(header) + header.stored_length;
+    record_sd_latency(esp_timer_get_time() - write_start, chunk_bytes);
+
+    log_file->current_size += chunk_bytes;
+    log_file->pending_size -= chunk->used;
+    g_storage_manager.total_bytes_written += chunk_bytes;
+    g_storage_manager.stats.total_writes += chunk->records;
+
+    // Record count and time range cover what is in the file; records
+    // staged and then spilled are counted by the file they drain into
+    data_packet_t packet;
+    if (log_file->record_count == 0) {
+        memcpy(&packet, chunk->data, sizeof(packet));
+        log_file->first_timestamp_us = packet.timestamp_us;
+    }
+    memcpy(&packet, chunk->data + chunk->last_record, sizeof(packet));
+    log_file->last_timestamp_us = packet.timestamp_us;
+    log_file->record_count += chunk->records;
+    g_storage_manager.stats.chunks_written++;
+    g_storage_manager.stats.last_write_time = esp_timer_get_time();
 
     return ESP_OK;
 }
 
-// Write data packet to file
-static esp_err_t write_data_packet(log_file_t* log_file, const data_packet_t* packet) {
-    if (!log_file || !log_file->file_handle || !packet) {
+// Writer pass: write up to max_chunks full chunks, oldest first, whichever
+// streams they belong to. A chunk that fails stays at the head of the
+// ready list for the spill tier.
+static esp_err_t write_ready_chunks(uint32_t max_chunks) {
+    uint32_t written = 0;
+    esp_err_t ret = ESP_OK;
+
+    storage_chunk_t* chunk;
+    while (written < max_chunks && (chunk = storage_chunk_peek_ready()) != NULL) {
+        ret = write_chunk(&g_storage_manager.streams[chunk->stream], chunk);
+        if (ret != ESP_OK) {
+            break;
+        }
+        storage_chunk_pop_ready();
+        storage_chunk_put(chunk);
+        written++;
+    }
+
+    if (written > 0) {
+        storage_stream_account_batch(written);
+    }
+    return ret;
+}
+
+// Stage a record in the file's open chunk. A full chunk goes to the ready
+// list and the stream takes a fresh buffer from the pool; when the pool is
+// used up the ready chunks are written first to free buffers.
+static esp_err_t write_data_packet(log_file_t* log_file, uint8_t stream, const storage_write_request_t* request) {
+    if (!log_file || !log_file->file_handle || !request) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Write packet header
-    size_t written = fwrite(packet, sizeof(data_packet_t), 1, log_file->file_handle);
-    if (written != 1) {
-        ESP_LOGE(TAG, "Failed to write packet header to %s", log_file->filename);
+    size_t payload_len = request->packet.data_length;
+    size_t record_len = sizeof(data_packet_t) + payload_len;
+
+    if (log_file->chunk && log_file->chunk->used + record_len > STORAGE_CHUNK_SIZE) {
+        storage_chunk_ready(log_file->chunk);
+        log_file->chunk = NULL;
+    }
+
+    // On failure nothing is staged; the caller moves the staged chunks and
+    // the record to the spill tier so none of them is lost
+    if (!log_file->chunk) {
+        log_file->chunk = storage_chunk_get(stream);
+        if (!log_file->chunk) {
+            esp_err_t ret = write_ready_chunks(STORAGE_CHUNK_POOL_SIZE);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            log_file->chunk = storage_chunk_get(stream);
+            if (!log_file->chunk) {
+                return ESP_ERR_NO_MEM;
+            }
+        }
+    }
+
+    storage_chunk_t* chunk = log_file->chunk;
+    memcpy(chunk->data + chunk->used, &request->packet, sizeof(data_packet_t));
+    memcpy(chunk->data + chunk->used + sizeof(data_packet_t), request->payload, payload_len);
+    chunk->last_record = chunk->used;
+    chunk->used += record_len;
+    chunk->records++;
+    log_file->pending_size += record_len;
+
+    return ESP_OK;
+}
+
+// Move a staged chunk to the spill tier (its records are already packed)
+static void spill_chunk(storage_chunk_t* chunk) {
+    if (chunk->used == 0) {
+        return;
+    }
+
+    if (storage_spill_append(chunk->data, chunk->used, chunk->records) != ESP_OK) {
+        g_storage_manager.stats.write_errors += chunk->records;
+    }
+    g_storage_manager.streams[chunk->stream].pending_size -= chunk->used;
+    chunk->used = 0;
+    chunk->records = 0;
+}
+
+// Spill every full chunk still waiting for the writer, oldest first. They
+// precede the open chunks of their streams, so those must follow them.
+static void spill_ready_chunks(void) {
+    storage_chunk_t* chunk;
+    while ((chunk = storage_chunk_peek_ready()) != NULL) {
+        storage_chunk_pop_ready();
+        spill_chunk(chunk);
+        storage_chunk_put(chunk);
+    }
+}
+
+// Write any staged data and close the file. Full chunks of every stream
+// go first, so none is left behind for a closed file.
+static void close_log_file(log_file_t* log_file) {
+    if (log_file->file_handle) {
+        if (write_ready_chunks(STORAGE_CHUNK_POOL_SIZE) != ESP_OK) {
+            g_storage_manager.stats.write_errors++;
+            g_storage_manager.sd_fault = true;
+            spill_ready_chunks();
+        }
+        // After a fault the open chunk follows the spilled ones
+        if (log_file->chunk &&
+            (g_storage_manager.sd_fault || write_chunk(log_file, log_file->chunk) != ESP_OK)) {
+            if (!g_storage_manager.sd_fault) {
+                g_storage_manager.stats.write_errors++;
+                g_storage_manager.sd_fault = true;
+            }
+            spill_chunk(log_file->chunk);
+        }
+        fclose(log_file->file_handle);
+        log_file->file_handle = NULL;
+
+        // Final size, record count and time range go to the catalog
+        storage_catalog_entry_t entry;
+        if (storage_catalog_find(catalog_name(log_file->filename), &entry)) {
+            entry.size = log_file->current_size;
+            entry.record_count = log_file->record_count;
+            entry.first_timestamp_us = log_file->first_timestamp_us;
+            entry.last_timestamp_us = log_file->last_timestamp_us;
+            storage_catalog_update(&entry);
+        }
+    }
+
+    storage_chunk_put(log_file->chunk);
+    log_file->chunk = NULL;
+    log_file->pending_size = 0;
+    log_file->active = false;
+}
+
+// Files created before the wall clock was set carry a 1970 (or FAT 1980)
+// stamp; their real age is unknown
+static bool created_known(const storage_catalog_entry_t* entry) {
+    return entry->created >= STORAGE_VALID_TIME_MIN;
+}
+
+// Entries delete_oldest_file passes over. ctx is the age cutoff: an age
+// based pass cannot judge files of unknown age, a space pass (no cutoff)
+// still reclaims them in catalog order.
+static bool catalog_entry_kept(const storage_catalog_entry_t* entry, void* ctx) {
+    int64_t created_before = *(const int64_t*)ctx;
+    return is_file_open(entry->name) || (created_before != INT64_MAX && !created_known(entry));
+}
+
+// Delete the oldest closed log file created before created_before. Files
+// still being written are passed over: a quiet UART port or the system
+// stream can hold the oldest file open for days, and the closed files
+// behind it must still be reclaimed.
+static esp_err_t delete_oldest_file(int64_t created_before) {
+    storage_catalog_entry_t oldest;
+    if (!storage_catalog_oldest_except(catalog_entry_kept, &created_before, &oldest) ||
+        oldest.created >= created_before) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char path[STORAGE_MAX_FILENAME_LEN];
+    snprintf(path, sizeof(path), "%s/%s", CONFIG_SD_MOUNT_POINT, oldest.name);
+    storage_scrub_forget(oldest.name);
+    if (remove(path) != 0) {
+        // Already gone (e.g. removed by hand); drop it from the catalog anyway
+        ESP_LOGW(TAG, "Could not delete %s", path);
+    } else {
+        ESP_LOGI(TAG, "Deleted old log file: %s (%lu bytes)", path, oldest.size);
+        g_storage_manager.stats.files_deleted++;
+        g_storage_manager.stats.bytes_reclaimed += oldest.size;
+    }
+
+    return storage_catalog_remove(oldest.name);
+}
+
+// Once the clock is anchored, give the files this session opened before
+// it a creation time: the UTC of their first record, or of the boot when
+// it is not known. Files of earlier sessions stay unknown.
+static void backfill_created(const storage_session_info_t* session) {
+    char prefix[8];
+    snprintf(prefix, sizeof(prefix), "%03lX", (unsigned long)(session->session_id & STORAGE_SESSION_ID_MASK));
+
+    storage_catalog_entry_t entry;
+    for (uint32_t i = 0; storage_catalog_get(i, &entry); i++) {
+        if (created_known(&entry) || strncmp(entry.name + 2, prefix, 3) != 0) {
+            continue;
+        }
+
+        int64_t mono_us = entry.first_timestamp_us;
+        for (int stream = 0; stream < STORAGE_STREAM_COUNT; stream++) {
+            const log_file_t* log_file = &g_storage_manager.streams[stream];
+            if (log_file->active && strcmp(catalog_name(log_file->filename), entry.name) == 0) {
+                mono_us = log_file->creation_time;
+            }
+        }
+        entry.created = (session->utc_offset_us + mono_us) / 1000000;
+        storage_catalog_update(&entry);
+    }
+
+    g_storage_manager.created_backfilled = true;
+}
+
+// Delete files older than retention_days. Needs an anchored wall clock.
+static void enforce_retention(uint32_t retention_days) {
+    storage_session_info_t session;
+    if (storage_session_get_info(&session) != ESP_OK || !session.clock_valid) {
+        return;
+    }
+    if (!g_storage_manager.created_backfilled) {
+        backfill_created(&session);
+    }
+
+    time_t now = time(NULL);
+    if (retention_days == 0 || now < STORAGE_VALID_TIME_MIN) {
+        return;
+    }
+
+    int64_t cutoff = (int64_t)now - (int64_t)retention_days * 24 * 60 * 60;
+    while (delete_oldest_file(cutoff) == ESP_OK) {
+    }
+}
+
+// Low/high watermark policy: once free space drops below the low mark,
+// delete oldest files until the high mark is reached again.
+static void enforce_free_space(void) {
+    uint64_t total_bytes = 0;
+    uint64_t free_bytes = 0;
+    if (esp_vfs_fat_info(CONFIG_SD_MOUNT_POINT, &total_bytes, &free_bytes) != ESP_OK || total_bytes == 0) {
+        return;
+    }
+
+    system_config_t* config = config_get_instance();
+    uint64_t low_mark = total_bytes * config->storage_config.free_space_low_pct / 100;
+    uint64_t high_mark = total_bytes * config->storage_config.free_space_high_pct / 100;
+
+    if (free_bytes < low_mark) {
+        ESP_LOGW(TAG, "SD card low on space: %llu of %llu bytes free", free_bytes, total_bytes);
+        while (free_bytes < high_mark) {
+            if (delete_oldest_file(INT64_MAX) != ESP_OK) {
+                ESP_LOGW(TAG, "No closed log files left to delete");
+                break;
+            }
+            esp_vfs_fat_info(CONFIG_SD_MOUNT_POINT, &total_bytes, &free_bytes);
+        }
+    }
+
+    g_storage_manager.stats.card_total_bytes = total_bytes;
+    g_storage_manager.stats.card_free_bytes = free_bytes;
+}
+
+// Space manager pass, run from the storage task
+static void run_space_manager(void) {
+    system_config_t* config = config_get_instance();
+
+    uint32_t retention_days = config->storage_config.retention_days;
+    if (g_storage_manager.retention_request_days > 0) {
+        retention_days = g_storage_manager.retention_request_days;
+        g_storage_manager.retention_request_days = 0;
+    }
+
+    enforce_retention(retention_days);
+    enforce_free_space();
+
+    g_storage_manager.space_check_pending = false;
+    g_storage_manager.last_space_check = esp_timer_get_time();
+}
+
+// Rewrite the journal of files open for writing. Recovery at the next boot
+// only has to check the files listed here.
+static esp_err_t update_open_journal(void) {
+    bool any_open = false;
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        if (g_storage_manager.streams[i].active) {
+            any_open = true;
+            break;
+        }
+    }
+
+    if (!any_open) {
+        remove(STORAGE_OPEN_JOURNAL);
+        return ESP_OK;
+    }
+
+    FILE* journal = fopen(STORAGE_OPEN_JOURNAL, "w");
+    if (!journal) {
+        ESP_LOGE(TAG, "Failed to write open-file journal");
+        return ESP_FAIL;
+    }
+
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        if (g_storage_manager.streams[i].active) {
+            fprintf(journal, "%s\n", g_storage_manager.streams[i].filename);
+        }
+    }
+
+    fflush(journal);
+    fsync(fileno(journal));
+    fclose(journal);
+
+    return ESP_OK;
+}
+
+// Check the files left open by the previous run and cut off torn tails
+static void recover_open_files(void) {
+    FILE* journal = fopen(STORAGE_OPEN_JOURNAL, "r");
+    if (!journal) {
+        return;  // Clean shutdown, nothing to recover
+    }
+
+    ESP_LOGW(TAG, "Previous run did not close its log files, checking them");
+
+    char filename[STORAGE_MAX_FILENAME_LEN];
+    while (fgets(filename, sizeof(filename), journal)) {
+        filename[strcspn(filename, "\r\n")] = '\0';
+        if (filename[0] == '\0') {
+            continue;
+        }
+
+        size_t valid_length = 0;
+        esp_err_t ret = storage_manager_recover_file(filename, &valid_length);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Recovery of %s failed: %s", filename, esp_err_to_name(ret));
+        }
+    }
+
+    fclose(journal);
+    remove(STORAGE_OPEN_JOURNAL);
+}
+
+// Group commit: seal the open chunks and fsync every open file. Everything
+// accepted since the previous commit was at risk until this point.
+// Short intervals shrink the loss window at the cost of smaller (less
+// compressible) chunks and more SD writes.
+static void commit_open_files(void) {
+    uint64_t start_time = esp_timer_get_time();
+
+    // Full chunks first; if they fail the open chunks stay staged behind them
+    if (write_ready_chunks(STORAGE_CHUNK_POOL_SIZE) != ESP_OK) {
+        g_storage_manager.stats.write_errors++;
+        g_storage_manager.sd_fault = true;
+    }
+
+    for (int i = 0; i < STORAGE_STREAM_COUNT && !g_storage_manager.sd_fault; i++) {
+        log_file_t* log_file = &g_storage_manager.streams[i];
+        if (!log_file->active || !log_file->file_handle) {
+            continue;
+        }
+
+        if (log_file->chunk) {
+            if (write_chunk(log_file, log_file->chunk) != ESP_OK) {
+                g_storage_manager.stats.write_errors++;
+                g_storage_manager.sd_fault = true;
+                continue;
+            }
+            // Back to the pool, an idle stream holds no buffer
+            storage_chunk_put(log_file->chunk);
+            log_file->chunk = NULL;
+        }
+        uint64_t sync_start = esp_timer_get_time();
+        if (fflush(log_file->file_handle) != 0 || fsync(fileno(log_file->file_handle)) != 0) {
+            ESP_LOGE(TAG, "Failed to sync %s", log_file->filename);
+            g_storage_manager.stats.sync_errors++;
+            g_storage_manager.sd_fault = true;
+        } else {
+            log_file->committed_size = log_file->current_size;
+            record_sd_latency(esp_timer_get_time() - sync_start, 0);
+        }
+    }
+    storage_rollup_commit();
+
+    // Spilled records drained before this point are on the card now, so
+    // their spill segments can take new records
+    if (!g_storage_manager.sd_fault && storage_spill_is_available()) {
+        storage_spill_release();
+    }
+
+    uint64_t now = esp_timer_get_time();
+    storage_stats_t* stats = &g_storage_manager.stats;
+    stats->sync_count++;
+    stats->sync_time_us += now - start_time;
+    stats->last_sync_bytes = g_storage_manager.bytes_since_sync;
+    stats->last_sync_window_ms = (g_storage_manager.bytes_since_sync > 0) ?
+        (uint32_t)((now - g_storage_manager.first_unsynced_time) / 1000) : 0;
+    if (stats->last_sync_bytes > stats->max_sync_bytes) {
+        stats->max_sync_bytes = stats->last_sync_bytes;
+    }
+
+    g_storage_manager.bytes_since_sync = 0;
+    g_storage_manager.last_sync_time = now;
+    g_storage_manager.urgent_commit = false;
+}
+
+// Commit once the configured interval or byte threshold is reached
+static bool commit_due(void) {
+    if (g_storage_manager.bytes_since_sync == 0) {
+        return false;
+    }
+
+    // Events reach the card without waiting for the commit interval
+    if (g_storage_manager.urgent_commit) {
+        return true;
+    }
+
+    system_config_t* config = config_get_instance();
+    uint32_t threshold = config->storage_config.sync_threshold_bytes;
+    if (threshold > 0 && g_storage_manager.bytes_since_sync >= threshold) {
+        return true;
+    }
+
+    uint64_t interval_us = (uint64_t)config->storage_config.buffer_flush_interval_ms * 1000;
+    return (esp_timer_get_time() - g_storage_manager.last_sync_time) >= interval_us;
+}
+
+// Open log file of a stream, creating one if needed. O(1): the stream
+// table is indexed by stream id.
+static log_file_t* get_log_file(uint8_t stream) {
+    log_file_t* log_file = &g_storage_manager.streams[stream];
+    if (log_file->active) {
+        return log_file;
+    }
+
+    // Session-scoped name for the data source
+    if (storage_session_next_filename(storage_stream_prefix(stream), log_file->filename,
+                                      sizeof(log_file->filename)) != ESP_OK) {
+        return NULL;
+    }
+
+    // Keep the file count within the catalog ring
+    if (storage_catalog_count() >= STORAGE_CATALOG_MAX_ENTRIES &&
+        delete_oldest_file(INT64_MAX) != ESP_OK) {
+        ESP_LOGE(TAG, "Catalog full and no file can be deleted");
+        return NULL;
+    }
+
+    // Open file
+    log_file->file_handle = fopen(log_file->filename, "wb");
+    if (!log_file->file_handle) {
+        ESP_LOGE(TAG, "Failed to create file: %s", log_file->filename);
+        g_storage_manager.space_check_pending = true;
+        return NULL;
+    }
+
+    uint8_t data_type;
+    storage_stream_source(stream, &data_type, &log_file->source_id);
+    log_file->active = true;
+    log_file->data_type = data_type;
+    log_file->chunk = NULL;
+    log_file->pending_size = 0;
+    log_file->current_size = 0;
+    log_file->committed_size = 0;
+    log_file->record_count = 0;
+    log_file->first_timestamp_us = 0;
+    log_file->last_timestamp_us = 0;
+    log_file->creation_time = esp_timer_get_time();
+
+    ESP_LOGI(TAG, "Created new log file: %s", log_file->filename);
+    g_storage_manager.total_files_created++;
+    storage_catalog_entry_t entry = {
+        .data_type = log_file->data_type,
+        .source_id = log_file->source_id,
+        .created = (int64_t)time(NULL)
+    };
+    strncpy(entry.name, catalog_name(log_file->filename), sizeof(entry.name) - 1);
+    storage_catalog_add(&entry);
+    update_open_journal();
+    return log_file;
+}
+
+// Write a record to its SD log file, rotating the file when it is full
+static esp_err_t store_record(const storage_write_request_t* request) {
+    uint8_t stream = storage_stream_id(request->packet.data_type, request->packet.source_id);
+    if (stream == STORAGE_STREAM_NONE) {
+        return ESP_ERR_INVALID_ARG;  // Producers only queue known sources
+    }
+
+    log_file_t* log_file = get_log_file(stream);
+    if (!log_file) {
         return ESP_FAIL;
     }
 
-    log_file->current_size += sizeof(data_packet_t);
-    log_file->record_count++;
+    esp_err_t ret = write_data_packet(log_file, stream, request);
+    if (ret != ESP_OK) {
+        return ret;
+    }
 
-    // Flush periodically for data integrity
-    if (log_file->record_count % 10 == 0) {
-        fflush(log_file->file_handle);
+    if (g_storage_manager.bytes_since_sync == 0) {
+        g_storage_manager.first_unsynced_time = request->packet.timestamp_us;
+    }
+    g_storage_manager.bytes_since_sync += sizeof(data_packet_t) + request->packet.data_length;
+
+    // Check if file rotation is needed
+    system_config_t* config = config_get_instance();
+    if (log_file->current_size + log_file->pending_size >=
+        (config->storage_config.max_file_size_mb * 1024 * 1024)) {
+        ESP_LOGI(TAG, "Rotating file: %s (size: %zu bytes)",
+                log_file->filename, log_file->current_size);
+
+        close_log_file(log_file);
+        update_open_journal();
+        g_storage_manager.stats.files_rotated++;
     }
 
     return ESP_OK;
 }
 
+// ADC samples feed the rollup tiers (payload starts with the voltage).
+// Done once when the storage task takes a record, never for a spill
+// replay, so the tiers see each sample once and in order.
+static void rollup_record(const storage_write_request_t* request) {
+    if (request->packet.data_type == DATA_TYPE_ADC && request->packet.data_length >= sizeof(float)) {
+        float voltage;
+        memcpy(&voltage, request->payload, sizeof(voltage));
+        storage_rollup_add(request->packet.source_id, request->packet.timestamp_us, voltage);
+    }
+}
+
+// Append one record to the spill tier
+static void spill_record(const storage_write_request_t* request) {
+    uint8_t record[sizeof(data_packet_t) + STORAGE_MAX_PAYLOAD_LEN];
+    size_t payload_len = request->packet.data_length;
+
+    memcpy(record, &request->packet, sizeof(data_packet_t));
+    memcpy(record + sizeof(data_packet_t), request->payload, payload_len);
+    if (storage_spill_append(record, sizeof(data_packet_t) + payload_len, 1) != ESP_OK) {
+        g_storage_manager.stats.write_errors++;
+    } else if (request->priority == STORAGE_PRIORITY_EVENT) {
+        storage_spill_sync();
+    }
+}
+
+// Divert new records to the flash spill tier. After a fault the open files
+// are abandoned: their staged chunks are spilled first so per-source order
+// is kept, and the handles are closed because the card may be gone. A stall
+// leaves the files open; the data written so far is fine.
+static void enter_spill_mode(bool fault) {
+    if (fault) {
+        spill_ready_chunks();
+        for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+            log_file_t* log_file = &g_storage_manager.streams[i];
+            if (log_file->active) {
+                if (log_file->chunk) {
+                    spill_chunk(log_file->chunk);
+                }
+                close_log_file(log_file);
+            }
+        }
+        update_open_journal();
+        g_storage_manager.stats.sd_faults++;
+    }
+
+    if (g_storage_manager.sd_available) {
+        ESP_LOGW(TAG, "SD card %s, %s", fault ? "failed" : "stalled",
+                 storage_spill_is_available() ? "spilling to internal flash" : "no spill tier");
+    }
+
+    g_storage_manager.sd_available = false;
+    g_storage_manager.sd_fault = false;
+    g_storage_manager.sd_stalled = false;
+    g_storage_manager.sd_retry_time = esp_timer_get_time() + STORAGE_SD_RETRY_INTERVAL_US;
+}
+
+// Check that the card accepts a synced write within the latency threshold
+static bool probe_sd(void) {
+    static const uint8_t pattern[512] = {0};
+    uint64_t start_time = esp_timer_get_time();
+
+    FILE* file = fopen(STORAGE_SD_PROBE_FILE, "wb");
+    if (!file) {
+        return false;
+    }
+    bool ok = fwrite(pattern, 1, sizeof(pattern), file) == sizeof(pattern) &&
+              fflush(file) == 0 && fsync(fileno(file)) == 0;
+    fclose(file);
+    remove(STORAGE_SD_PROBE_FILE);
+
+    system_config_t* config = config_get_instance();
+    uint64_t elapsed_us = esp_timer_get_time() - start_time;
+    return ok && elapsed_us <= (uint64_t)config->storage_config.spill_latency_ms * 1000;
+}
+
+// Move a batch of spilled records back into the SD logs, oldest first.
+// A record leaves the spill only after it has been staged for the SD card,
+// and the spill is emptied only after a commit, so a fault mid-drain can
+// reorder records but never loses them.
+static void drain_spill(void) {
+    uint64_t start_time = esp_timer_get_time();
+    storage_write_request_t request;
+
+    for (int i = 0; i < STORAGE_SPILL_DRAIN_BATCH; i++) {
+        if (storage_spill_peek(&request) != ESP_OK) {
+            break;
+        }
+        if (store_record(&request) != ESP_OK) {
+            g_storage_manager.stats.write_errors++;
+            enter_spill_mode(true);
+            break;
+        }
+        storage_spill_consume();
+        if (request.priority == STORAGE_PRIORITY_EVENT) {
+            g_storage_manager.urgent_commit = true;
+        }
+    }
+
+    // The commit releases the drained spill space
+    if (g_storage_manager.sd_available && storage_spill_is_empty()) {
+        commit_open_files();
+        ESP_LOGI(TAG, "Spill drained, writing to SD card directly");
+    }
+
+    storage_spill_account_drain(esp_timer_get_time() - start_time);
+}
+
+static const uint8_t g_service_weight[STORAGE_PRIORITY_LEVELS] = {
+    [STORAGE_PRIORITY_FRAME] = STORAGE_FRAME_WEIGHT,
+    [STORAGE_PRIORITY_BULK] = STORAGE_BULK_WEIGHT
+};
+
+// Move overflowed records back into a queue as it frees up, oldest first
+static void refill_queue(storage_priority_t level) {
+    storage_write_request_t staged;
+
+    xSemaphoreTake(g_storage_manager.staging_mutex, portMAX_DELAY);
+    while (storage_staging_pending(level) > 0 &&
+           uxQueueSpacesAvailable(g_storage_manager.write_queues[level]) > 0) {
+        storage_staging_pop(level, &staged);
+        xQueueSend(g_storage_manager.write_queues[level], &staged, 0);
+    }
+    xSemaphoreGive(g_storage_manager.staging_mutex);
+}
+
+static bool receive_request(storage_priority_t level, storage_write_request_t* request) {
+    if (xQueueReceive(g_storage_manager.write_queues[level], request, 0) != pdTRUE) {
+        return false;
+    }
+    refill_queue(level);
+
+    uint32_t wait_us = (uint32_t)(esp_timer_get_time() - request->packet.timestamp_us);
+    if (wait_us > g_storage_manager.stats.queue_max_wait_us[level]) {
+        g_storage_manager.stats.queue_max_wait_us[level] = wait_us;
+    }
+    return true;
+}
+
+// Take the next request: events strictly first, then frames and bulk
+// samples by weighted round robin
+static bool dequeue_request(storage_write_request_t* request) {
+    if (receive_request(STORAGE_PRIORITY_EVENT, request)) {
+        return true;
+    }
+
+    // Second pass runs with fresh credits once the current round is spent
+    for (int pass = 0; pass < 2; pass++) {
+        for (int level = STORAGE_PRIORITY_FRAME; level < STORAGE_PRIORITY_LEVELS; level++) {
+            if (g_storage_manager.service_credit[level] > 0 && receive_request(level, request)) {
+                g_storage_manager.service_credit[level]--;
+                return true;
+            }
+        }
+        memcpy(g_storage_manager.service_credit, g_service_weight, sizeof(g_service_weight));
+    }
+
+    return false;
+}
+
+// Size the staging pool to ride out the card's recent worst stall at the
+// current ingest rate (with 2x headroom). Grows at once, shrinks as the
+// peak decays by 1/8 per interval.
+static void adapt_staging_pool(void) {
+    uint64_t now = esp_timer_get_time();
+    uint64_t elapsed_us = now - g_storage_manager.last_adapt_time;
+    if (elapsed_us < STORAGE_ADAPT_INTERVAL_US) {
+        return;
+    }
+
+    xSemaphoreTake(g_storage_manager.staging_mutex, portMAX_DELAY);
+    uint64_t ingest_bytes = g_storage_manager.ingest_bytes;
+    g_storage_manager.ingest_bytes = 0;
+
+    uint32_t peak_us = g_storage_manager.latency_peak_us - g_storage_manager.latency_peak_us / 8;
+    if (g_storage_manager.window_peak_latency_us > peak_us) {
+        peak_us = g_storage_manager.window_peak_latency_us;
+    }
+    g_storage_manager.latency_peak_us = peak_us;
+    g_storage_manager.window_peak_latency_us = 0;
+
+    uint64_t needed = ingest_bytes * peak_us / elapsed_us * 2;
+    storage_staging_set_limit((needed + STORAGE_STAGING_BLOCK_SIZE - 1) / STORAGE_STAGING_BLOCK_SIZE);
+    xSemaphoreGive(g_storage_manager.staging_mutex);
+
+    g_storage_manager.last_adapt_time = now;
+}
+
 // Storage task - handles data writing
 static void storage_task(void* pvParameters) {
     ESP_LOGI(TAG, "Storage task started");
@@ -74,91 +914,95 @@ static void storage_task(void* pvParameters) {
     storage_write_request_t request;
 
     while (g_storage_manager.running) {
-        // Wait for write requests
-        if (xQueueReceive(g_storage_manager.write_queue, &request, pdMS_TO_TICKS(100)) == pdTRUE) {
-
-            // Find appropriate log file
-            log_file_t* log_file = NULL;
-            for (int i = 0; i < STORAGE_MAX_FILES; i++) {
-                if (g_storage_manager.current_files[i].active &&
-                    g_storage_manager.current_files[i].data_type == request.packet.data_type) {
-                    log_file = &g_storage_manager.current_files[i];
-                    break;
-                }
-            }
+        // Wait for write requests (producers notify the task after queueing)
+        bool have_request = dequeue_request(&request);
+        if (!have_request) {
+            storage_spill_sync();   // Nothing queued, the spill tail goes to flash now
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            have_request = dequeue_request(&request);
+        }
 
-            // Create new file if needed
-            if (!log_file) {
-                for (int i = 0; i < STORAGE_MAX_FILES; i++) {
-                    if (!g_storage_manager.current_files[i].active) {
-                        log_file = &g_storage_manager.current_files[i];
-
-                        // Generate filename based on data type
-                        const char* prefix = (request.packet.data_type == DATA_TYPE_UART) ? "uart" : "adc";
-                        generate_filename(prefix, log_file->filename, sizeof(log_file->filename));
-
-                        // Open file
-                        log_file->file_handle = fopen(log_file->filename, "wb");
-                        if (!log_file->file_handle) {
-                            ESP_LOGE(TAG, "Failed to create file: %s", log_file->filename);
-                            g_storage_manager.stats.write_errors++;
-                            continue;
-                        }
-
-                        log_file->active = true;
-                        log_file->data_type = request.packet.data_type;
-                        log_file->current_size = 0;
-                        log_file->record_count = 0;
-                        log_file->creation_time = esp_timer_get_time();
-
-                        ESP_LOGI(TAG, "Created new log file: %s", log_file->filename);
-                        g_storage_manager.total_files_created++;
-                        break;
-                    }
-                }
+        if (have_request) {
+            rollup_record(&request);
+
+            // While the card is down or the spill is still draining, new
+            // records queue up behind the spilled ones to keep them in order
+            if (storage_spill_is_available() &&
+                (!g_storage_manager.sd_available || !storage_spill_is_empty())) {
+                spill_record(&request);
+            } else if (store_record(&request) != ESP_OK) {
+                g_storage_manager.stats.write_errors++;
+                enter_spill_mode(true);
+                spill_record(&request);
+            } else if (request.priority == STORAGE_PRIORITY_EVENT) {
+                g_storage_manager.urgent_commit = true;
             }
+        }
 
-            // Write data
-            if (log_file) {
-                esp_err_t ret = write_data_packet(log_file, &request.packet);
-                if (ret == ESP_OK) {
-                    g_storage_manager.stats.total_writes++;
-                    g_storage_manager.total_bytes_written += sizeof(data_packet_t);
-                } else {
-                    g_storage_manager.stats.write_errors++;
-                }
+        // Writer pass once a batch of full chunks has gathered
+        if (g_storage_manager.sd_available && storage_chunk_ready_count() >= STORAGE_WRITE_BATCH &&
+            write_ready_chunks(STORAGE_CHUNK_POOL_SIZE) != ESP_OK) {
+            g_storage_manager.stats.write_errors++;
+            g_storage_manager.sd_fault = true;
+        }
 
-                // Check if file rotation is needed
-                system_config_t* config = config_get_instance();
-                if (log_file->current_size >= (config->storage_config.max_file_size_mb * 1024 * 1024)) {
-                    ESP_LOGI(TAG, "Rotating file: %s (size: %zu bytes)",
-                            log_file->filename, log_file->current_size);
+        // Faults and stalls flagged by writes and commits
+        if (g_storage_manager.sd_fault) {
+            enter_spill_mode(true);
+        } else if (g_storage_manager.sd_stalled) {
+            enter_spill_mode(false);
+        }
 
-                    fclose(log_file->file_handle);
-                    log_file->active = false;
-                    log_file->file_handle = NULL;
+        // SD recovery and spill drain
+        if (!g_storage_manager.sd_available) {
+            if (esp_timer_get_time() >= g_storage_manager.sd_retry_time) {
+                if (probe_sd()) {
+                    ESP_LOGI(TAG, "SD card available again");
+                    g_storage_manager.sd_available = true;
+                } else {
+                    g_storage_manager.sd_retry_time = esp_timer_get_time() + STORAGE_SD_RETRY_INTERVAL_US;
                 }
             }
+        } else if (!storage_spill_is_empty()) {
+            drain_spill();
         }
 
-        // Periodic maintenance
-        static uint32_t maintenance_counter = 0;
-        if (++maintenance_counter >= 100) {  // Every ~10 seconds
-            maintenance_counter = 0;
-            // Flush all open files
-            for (int i = 0; i < STORAGE_MAX_FILES; i++) {
-                if (g_storage_manager.current_files[i].active &&
-                    g_storage_manager.current_files[i].file_handle) {
-                    fflush(g_storage_manager.current_files[i].file_handle);
-                }
-            }
+        // Durability policy
+        if (commit_due()) {
+            commit_open_files();
+        }
+
+        adapt_staging_pool();
+
+        // Space manager: periodic, or right away after a failed write
+        if (g_storage_manager.sd_available && (g_storage_manager.space_check_pending ||
+            g_storage_manager.retention_request_days > 0 ||
+            esp_timer_get_time() - g_storage_manager.last_space_check >= STORAGE_SPACE_CHECK_INTERVAL_US)) {
+            storage_session_check_clock();
+            run_space_manager();
         }
     }
 
     ESP_LOGI(TAG, "Storage task stopped");
+    if (g_storage_manager.stopper) {
+        xTaskNotifyGive(g_storage_manager.stopper);
+    }
     vTaskDelete(NULL);
 }
 
+static void delete_write_queues(void) {
+    for (int level = 0; level < STORAGE_PRIORITY_LEVELS; level++) {
+        if (g_storage_manager.write_queues[level]) {
+            vQueueDelete(g_storage_manager.write_queues[level]);
+            g_storage_manager.write_queues[level] = NULL;
+        }
+    }
+    if (g_storage_manager.staging_mutex) {
+        vSemaphoreDelete(g_storage_manager.staging_mutex);
+        g_storage_manager.staging_mutex = NULL;
+    }
+}
+
 esp_err_t storage_manager_init(void) {
     if (g_storage_manager.initialized) {
         ESP_LOGW(TAG, "Storage Manager already initialized");
@@ -167,19 +1011,53 @@ esp_err_t storage_manager_init(void) {
 
     ESP_LOGI(TAG, "Initializing Storage Manager");
 
-    // Create write queue
-    g_storage_manager.write_queue = xQueueCreate(STORAGE_QUEUE_SIZE, sizeof(storage_write_request_t));
-    if (!g_storage_manager.write_queue) {
-        ESP_LOGE(TAG, "Failed to create storage write queue");
+    // Overflow pool behind the queues, resized by the latency monitor
+    g_storage_manager.staging_mutex = xSemaphoreCreateMutex();
+    if (!g_storage_manager.staging_mutex) {
+        ESP_LOGE(TAG, "Failed to create staging mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    storage_staging_init();
+    storage_stream_init();
+
+    // Create one write queue per priority level
+    static const uint32_t queue_sizes[STORAGE_PRIORITY_LEVELS] = {
+        STORAGE_EVENT_QUEUE_SIZE, STORAGE_FRAME_QUEUE_SIZE, STORAGE_BULK_QUEUE_SIZE
+    };
+    for (int level = 0; level < STORAGE_PRIORITY_LEVELS; level++) {
+        g_storage_manager.write_queues[level] = xQueueCreate(queue_sizes[level], sizeof(storage_write_request_t));
+        if (!g_storage_manager.write_queues[level]) {
+            ESP_LOGE(TAG, "Failed to create storage write queue %d", level);
+            delete_write_queues();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Allocate compressor scratch for the storage task
+    g_storage_manager.compress_ctx = malloc(sizeof(storage_compress_ctx_t));
+    g_storage_manager.compress_buffer = malloc(STORAGE_COMPRESS_BOUND(STORAGE_CHUNK_SIZE));
+    if (!g_storage_manager.compress_ctx || !g_storage_manager.compress_buffer) {
+        ESP_LOGE(TAG, "Failed to allocate compression buffers");
+        free(g_storage_manager.compress_ctx);
+        free(g_storage_manager.compress_buffer);
+        g_storage_manager.compress_ctx = NULL;
+        g_storage_manager.compress_buffer = NULL;
+        delete_write_queues();
         return ESP_ERR_NO_MEM;
     }
 
     // Initialize file structures
-    memset(g_storage_manager.current_files, 0, sizeof(g_storage_manager.current_files));
+    memset(g_storage_manager.streams, 0, sizeof(g_storage_manager.streams));
     memset(&g_storage_manager.stats, 0, sizeof(storage_stats_t));
 
     g_storage_manager.total_files_created = 0;
     g_storage_manager.total_bytes_written = 0;
+    g_storage_manager.sd_available = true;
+
+    // Spill tier on internal flash; logging still works without it
+    if (storage_spill_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Spill tier unavailable, SD outages will drop data");
+    }
 
     g_storage_manager.initialized = true;
     ESP_LOGI(TAG, "Storage Manager initialized");
@@ -199,6 +1077,17 @@ esp_err_t storage_manager_start(void) {
 
     ESP_LOGI(TAG, "Starting Storage Manager");
 
+    // Load the file catalog, then repair files torn by a power cut
+    // before new data is written
+    storage_catalog_load();
+    recover_open_files();
+    storage_session_begin();
+    storage_rollup_init();
+    g_storage_manager.space_check_pending = true;
+    g_storage_manager.last_sync_time = esp_timer_get_time();
+    g_storage_manager.last_adapt_time = g_storage_manager.last_sync_time;
+    g_storage_manager.bytes_since_sync = 0;
+
     // Create storage task
     BaseType_t ret = xTaskCreate(storage_task, "storage_task", 8192, NULL, 4, &g_storage_manager.storage_task);
     if (ret != pdPASS) {
@@ -207,52 +1096,104 @@ esp_err_t storage_manager_start(void) {
     }
 
     g_storage_manager.running = true;
+
+    // Integrity scrubber for closed files; logging works without it
+    if (storage_scrub_start() != ESP_OK) {
+        ESP_LOGW(TAG, "Scrubber unavailable, stored logs will not be verified");
+    }
+
     ESP_LOGI(TAG, "Storage Manager started");
 
     return ESP_OK;
 }
 
-esp_err_t storage_manager_write_uart_data(uint8_t port, const uint8_t* data, size_t length) {
-    if (!data || length == 0 || length > 256) {
-        return ESP_ERR_INVALID_ARG;
+// Queue level for a record type; spilled records get theirs back from it
+storage_priority_t storage_record_priority(uint8_t data_type) {
+    switch (data_type) {
+        case DATA_TYPE_UART:
+            return STORAGE_PRIORITY_FRAME;
+        case DATA_TYPE_ADC:
+            return STORAGE_PRIORITY_BULK;
+        default:
+            return STORAGE_PRIORITY_EVENT;
     }
+}
 
-    if (!g_storage_manager.running) {
-        return ESP_ERR_INVALID_STATE;
+// Build a write request and hand it to the storage task. Producers never
+// block: a full queue overflows into the staging pool, and bulk samples are
+// shed once the pool is half used so the rest is kept for frames and events.
+static esp_err_t enqueue_record(data_type_t type, uint8_t source_id, const uint8_t* data, size_t length) {
+    storage_priority_t level = storage_record_priority(type);
+    storage_stats_t* stats = &g_storage_manager.stats;
+
+    storage_write_request_t request = {
+        .packet = {
+            .magic = STORAGE_MAGIC_NUMBER,
+            .timestamp_us = esp_timer_get_time(),
+            .source_id = source_id,
+            .data_type = type,
+            .data_length = length,
+            .checksum = storage_calculate_checksum(data, length)
+        },
+        .priority = level
+    };
+    memcpy(request.payload, data, length);
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(g_storage_manager.staging_mutex, portMAX_DELAY);
+    // Once a level overflows, later records go behind it to stay in order
+    if (storage_staging_pending(level) == 0 &&
+        xQueueSend(g_storage_manager.write_queues[level], &request, 0) == pdTRUE) {
+        // Queued directly
+    } else if (level == STORAGE_PRIORITY_BULK && storage_staging_usage_pct() >= STORAGE_BULK_SHED_PCT) {
+        ret = ESP_ERR_TIMEOUT;
+    } else if (storage_staging_push(level, &request) != ESP_OK) {
+        ret = ESP_ERR_TIMEOUT;
     }
 
-    // Create data packet
-    data_packet_t* packet = malloc(sizeof(data_packet_t) + length);
-    if (!packet) {
-        return ESP_ERR_NO_MEM;
+    if (ret == ESP_OK) {
+        stats->queue_enqueued[level]++;
+        g_storage_manager.ingest_bytes += sizeof(data_packet_t) + length;
+        uint32_t depth = uxQueueMessagesWaiting(g_storage_manager.write_queues[level]) +
+                         storage_staging_pending(level);
+        if (depth > stats->queue_high_water[level]) {
+            stats->queue_high_water[level] = depth;
+        }
+    } else {
+        stats->queue_shed[level]++;
     }
+    xSemaphoreGive(g_storage_manager.staging_mutex);
 
-    packet->magic = STORAGE_MAGIC_NUMBER;
-    packet->timestamp_us = esp_timer_get_time();
-    packet->source_id = port;
-    packet->data_type = DATA_TYPE_UART;
-    packet->data_length = length;
-    packet->checksum = storage_calculate_checksum(data, length);
-    memcpy(packet->data, data, length);
+    if (ret == ESP_OK) {
+        xTaskNotifyGive(g_storage_manager.storage_task);
+    }
 
-    // Create write request
-    storage_write_request_t request = {
-        .priority = STORAGE_DEFAULT_PRIORITY
-    };
-    memcpy(&request.packet, packet, sizeof(data_packet_t));
+    return ret;
+}
 
-    // Send to queue
-    esp_err_t ret = ESP_OK;
-    if (xQueueSend(g_storage_manager.write_queue, &request, pdMS_TO_TICKS(10)) != pdTRUE) {
+esp_err_t storage_manager_write_uart_data(uint8_t port, const uint8_t* data, size_t length) {
+    if (!data || length == 0 || length > STORAGE_MAX_PAYLOAD_LEN ||
+        storage_stream_id(DATA_TYPE_UART, port) == STORAGE_STREAM_NONE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_storage_manager.running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = enqueue_record(DATA_TYPE_UART, port, data, length);
+    if (ret == ESP_ERR_TIMEOUT) {
         ESP_LOGW(TAG, "Storage queue full, dropping UART data");
-        ret = ESP_ERR_TIMEOUT;
     }
 
-    free(packet);
     return ret;
 }
 
 esp_err_t storage_manager_write_adc_data(uint8_t channel, float voltage, int raw_value) {
+    if (storage_stream_id(DATA_TYPE_ADC, channel) == STORAGE_STREAM_NONE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
     if (!g_storage_manager.running) {
         return ESP_ERR_INVALID_STATE;
     }
@@ -263,37 +1204,112 @@ esp_err_t storage_manager_write_adc_data(uint8_t channel, float voltage, int raw
         int raw_value;
     } adc_data = {voltage, raw_value};
 
-    // Create data packet
-    data_packet_t* packet = malloc(sizeof(data_packet_t) + sizeof(adc_data));
-    if (!packet) {
-        return ESP_ERR_NO_MEM;
+    esp_err_t ret = enqueue_record(DATA_TYPE_ADC, channel, (const uint8_t*)&adc_data, sizeof(adc_data));
+    // Shedding bulk samples is expected under load, only log every 100th
+    if (ret == ESP_ERR_TIMEOUT && g_storage_manager.stats.queue_shed[STORAGE_PRIORITY_BULK] % 100 == 1) {
+        ESP_LOGW(TAG, "Storage backlogged, shed %lu ADC samples",
+                 g_storage_manager.stats.queue_shed[STORAGE_PRIORITY_BULK]);
     }
 
-    packet->magic = STORAGE_MAGIC_NUMBER;
-    packet->timestamp_us = esp_timer_get_time();
-    packet->source_id = channel;
-    packet->data_type = DATA_TYPE_ADC;
-    packet->data_length = sizeof(adc_data);
-    packet->checksum = storage_calculate_checksum((uint8_t*)&adc_data, sizeof(adc_data));
-    memcpy(packet->data, &adc_data, sizeof(adc_data));
+    return ret;
+}
 
-    // Create write request
-    storage_write_request_t request = {
-        .priority = STORAGE_DEFAULT_PRIORITY
-    };
-    memcpy(&request.packet, packet, sizeof(data_packet_t));
+esp_err_t storage_manager_write_system_data(const char* message) {
+    if (!message) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    // Send to queue
-    esp_err_t ret = ESP_OK;
-    if (xQueueSend(g_storage_manager.write_queue, &request, pdMS_TO_TICKS(10)) != pdTRUE) {
-        ESP_LOGW(TAG, "Storage queue full, dropping ADC data");
-        ret = ESP_ERR_TIMEOUT;
+    if (!g_storage_manager.running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t length = strnlen(message, STORAGE_MAX_PAYLOAD_LEN);
+    esp_err_t ret = enqueue_record(DATA_TYPE_SYSTEM, 0, (const uint8_t*)message, length);
+    if (ret == ESP_ERR_TIMEOUT) {
+        ESP_LOGW(TAG, "Storage event queue full, dropping system event");
     }
 
-    free(packet);
     return ret;
 }
 
+uint32_t storage_chunk_crc(const storage_chunk_header_t* header, const uint8_t* body) {
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)header, offsetof(storage_chunk_header_t, crc32));
+    return esp_rom_crc32_le(crc, body, header->stored_length);
+}
+
+// Scan a log file chunk by chunk and truncate it after the last valid chunk
+esp_err_t storage_manager_recover_file(const char* filename, size_t* valid_length) {
+    if (!filename || !valid_length) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t* body = malloc(STORAGE_CHUNK_SIZE);
+    if (!body) {
+        fclose(file);
+        return ESP_ERR_NO_MEM;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    size_t valid = 0;
+    uint32_t chunks = 0;
+    uint32_t records = 0;
+    storage_chunk_header_t header;
+    while (fread(&header, sizeof(header), 1, file) == 1) {
+        if (header.magic != STORAGE_CHUNK_MAGIC ||
+            header.version != STORAGE_CHUNK_VERSION ||
+            header.raw_length > STORAGE_CHUNK_SIZE ||
+            header.stored_length > header.raw_length) {
+            break;
+        }
+
+        if (fread(body, 1, header.stored_length, file) != header.stored_length ||
+            storage_chunk_crc(&header, body) != header.crc32) {
+            break;
+        }
+
+        valid += sizeof(header) + header.stored_length;
+        records += header.record_count;
+        chunks++;
+    }
+    fclose(file);
+    free(body);
+
+    *valid_length = valid;
+    g_storage_manager.stats.recovered_files++;
+
+    storage_catalog_entry_t entry;
+    if (storage_catalog_find(catalog_name(filename), &entry)) {
+        entry.size = valid;
+        entry.record_count = records;
+        storage_catalog_update(&entry);
+    }
+
+    if (file_size < 0 || (size_t)file_size == valid) {
+        ESP_LOGI(TAG, "Recovery: %s intact (%lu chunks)", filename, chunks);
+        return ESP_OK;
+    }
+
+    size_t torn = (size_t)file_size - valid;
+    if (truncate(filename, valid) != 0) {
+        ESP_LOGE(TAG, "Recovery: failed to truncate %s", filename);
+        return ESP_FAIL;
+    }
+
+    g_storage_manager.stats.recovered_truncated_bytes += torn;
+    ESP_LOGW(TAG, "Recovery: %s truncated to %zu bytes (%lu chunks), dropped %zu torn bytes",
+             filename, valid, chunks, torn);
+
+    return ESP_OK;
+}
+
 uint8_t storage_calculate_checksum(const uint8_t* data, size_t length) {
     uint8_t checksum = 0;
     for (size_t i = 0; i < length; i++) {
@@ -307,10 +1323,73 @@ esp_err_t storage_manager_get_stats(storage_stats_t* stats) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    memcpy(stats, &g_storage_manager.stats, sizeof(storage_stats_t));
+    stats_snapshot(stats, &g_storage_manager.stats, sizeof(storage_stats_t));
     stats->files_created = g_storage_manager.total_files_created;
     stats->bytes_written = g_storage_manager.total_bytes_written;
 
+    // Derived compression metrics
+    stats->compression_ratio = (stats->compress_bytes_out > 0) ?
+        (float)stats->compress_bytes_in / (float)stats->compress_bytes_out : 0.0f;
+    stats->compress_us_per_kb = (stats->compress_bytes_in > 0) ?
+        (uint32_t)(stats->compress_time_us * 1024 / stats->compress_bytes_in) : 0;
+    stats->bytes_at_risk = g_storage_manager.bytes_since_sync;
+
+    // Spill tier
+    storage_spill_stats_t spill;
+    storage_spill_get_stats(&spill);
+    stats->sd_available = g_storage_manager.sd_available;
+    stats->spill_pending_bytes = spill.pending_bytes;
+    stats->spill_capacity_bytes = spill.capacity_bytes;
+    stats->spill_records_dropped = spill.records_dropped;
+    stats->spill_drain_bytes_per_sec = (spill.drain_time_us > 0) ?
+        (uint32_t)(spill.bytes_drained * 1000000 / spill.drain_time_us) : 0;
+
+    // Card health
+    uint32_t operations = 0;
+    for (int i = 0; i < STORAGE_LATENCY_BUCKETS; i++) {
+        operations += stats->write_latency_hist[i];
+    }
+    uint32_t seen = 0;
+    stats->write_latency_p99_us = 0;
+    for (int i = 0; i < STORAGE_LATENCY_BUCKETS && operations > 0; i++) {
+        seen += stats->write_latency_hist[i];
+        if ((uint64_t)seen * 100 >= (uint64_t)operations * 99) {
+            stats->write_latency_p99_us = (i < STORAGE_LATENCY_BUCKETS - 1) ?
+                (STORAGE_LATENCY_BUCKET0_US << i) : stats->write_latency_max_us;
+            break;
+        }
+    }
+    stats->sd_write_kbps = (stats->sd_write_time_us > 0) ?
+        (uint32_t)(stats->sd_write_bytes * 1000000 / 1024 / stats->sd_write_time_us) : 0;
+
+    storage_staging_stats_t staging;
+    if (g_storage_manager.staging_mutex) {
+        xSemaphoreTake(g_storage_manager.staging_mutex, portMAX_DELAY);
+        storage_staging_get_stats(&staging);
+        xSemaphoreGive(g_storage_manager.staging_mutex);
+    } else {
+        memset(&staging, 0, sizeof(staging));
+    }
+    stats->staging_blocks = staging.blocks;
+    stats->staging_block_limit = staging.block_limit;
+    stats->staging_peak_blocks = staging.peak_blocks;
+    stats->staging_records = staging.records;
+    stats->staged_records = staging.records_staged;
+
+    // Streams and the chunk pool (storage task state, read without locking)
+    stats->open_streams = 0;
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        if (g_storage_manager.streams[i].active) {
+            stats->open_streams++;
+        }
+    }
+    storage_stream_stats_t streams;
+    storage_stream_get_stats(&streams);
+    stats->chunk_buffers = streams.buffers;
+    stats->chunk_buffers_peak = streams.peak_buffers;
+    stats->write_batches = streams.batches;
+    stats->batched_chunks = streams.batched_chunks;
+
     return ESP_OK;
 }
 
@@ -321,19 +1400,137 @@ esp_err_t storage_manager_print_stats(void) {
     ESP_LOGI(TAG, "Files created: %lu", g_storage_manager.total_files_created);
     ESP_LOGI(TAG, "Bytes written: %llu", g_storage_manager.total_bytes_written);
 
+    storage_stats_t stats;
+    storage_manager_get_stats(&stats);
+    ESP_LOGI(TAG, "Chunks: %lu written, %lu compressed (ratio %.2f, %lu us/KB)",
+             stats.chunks_written, stats.chunks_compressed,
+             stats.compression_ratio, stats.compress_us_per_kb);
+    ESP_LOGI(TAG, "Commits: %lu (%lu errors), last %lu bytes at risk over %lu ms, max %lu bytes, now %lu bytes",
+             stats.sync_count, stats.sync_errors, stats.last_sync_bytes,
+             stats.last_sync_window_ms, stats.max_sync_bytes, stats.bytes_at_risk);
+    ESP_LOGI(TAG, "Space: %llu of %llu bytes free, %lu old files deleted (%llu bytes), %lu files in catalog",
+             stats.card_free_bytes, stats.card_total_bytes, stats.files_deleted,
+             stats.bytes_reclaimed, storage_catalog_count());
+    if (stats.recovered_files > 0) {
+        ESP_LOGI(TAG, "Recovery: %lu files checked, %llu torn bytes removed",
+                 stats.recovered_files, stats.recovered_truncated_bytes);
+    }
+    static const char* level_names[STORAGE_PRIORITY_LEVELS] = {"events", "frames", "bulk"};
+    for (int level = 0; level < STORAGE_PRIORITY_LEVELS; level++) {
+        ESP_LOGI(TAG, "Queue %s: %lu queued, %lu shed, high water %lu, max wait %lu us",
+                 level_names[level], stats.queue_enqueued[level], stats.queue_shed[level],
+                 stats.queue_high_water[level], stats.queue_max_wait_us[level]);
+    }
+    ESP_LOGI(TAG, "Card: p99 %lu us, max %lu us, %lu stalls, %lu KB/s",
+             stats.write_latency_p99_us, stats.write_latency_max_us,
+             stats.write_stalls, stats.sd_write_kbps);
+    ESP_LOGI(TAG, "Staging: %lu/%lu blocks (peak %lu), %lu records waiting, %lu staged",
+             stats.staging_blocks, stats.staging_block_limit, stats.staging_peak_blocks,
+             stats.staging_records, stats.staged_records);
+    ESP_LOGI(TAG, "Streams: %lu open, chunk pool %lu/%d buffers (peak %lu), %lu writer passes, %lu chunks",
+             stats.open_streams, stats.chunk_buffers, STORAGE_CHUNK_POOL_SIZE,
+             stats.chunk_buffers_peak, stats.write_batches, stats.batched_chunks);
+    storage_rollup_stats_t rollup;
+    storage_rollup_get_stats(&rollup);
+    ESP_LOGI(TAG, "Rollups: %lu/%lu/%lu s/min/h records, %lu errors, %lu queries (%llu bytes read)",
+             rollup.records_written[STORAGE_ROLLUP_SECOND], rollup.records_written[STORAGE_ROLLUP_MINUTE],
+             rollup.records_written[STORAGE_ROLLUP_HOUR], rollup.write_errors,
+             rollup.queries, rollup.query_bytes_read);
+    storage_scrub_stats_t scrub;
+    storage_scrub_get_stats(&scrub);
+    ESP_LOGI(TAG, "Scrub: %lu passes, %lu files, %lu chunks verified, %lu CRC / %lu record errors, %lu index mismatches",
+             scrub.passes, scrub.files_scrubbed, scrub.chunks_verified,
+             scrub.crc_errors, scrub.record_errors, scrub.index_mismatches);
+    if (stats.spill_capacity_bytes > 0) {
+        ESP_LOGI(TAG, "Spill: SD %s, %lu faults, %lu stalls, %lu/%lu bytes pending (%lu%%), %lu dropped, drain %lu B/s",
+                 stats.sd_available ? "ok" : "unavailable", stats.sd_faults, stats.sd_stalls,
+                 stats.spill_pending_bytes, stats.spill_capacity_bytes,
+                 stats.spill_pending_bytes * 100 / stats.spill_capacity_bytes,
+                 stats.spill_records_dropped, stats.spill_drain_bytes_per_sec);
+    }
+
     ESP_LOGI(TAG, "Active files:");
-    for (int i = 0; i < STORAGE_MAX_FILES; i++) {
-        if (g_storage_manager.current_files[i].active) {
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        if (g_storage_manager.streams[i].active) {
             ESP_LOGI(TAG, "  %s: %zu bytes, %lu records",
-                    g_storage_manager.current_files[i].filename,
-                    g_storage_manager.current_files[i].current_size,
-                    g_storage_manager.current_files[i].record_count);
+                    g_storage_manager.streams[i].filename,
+                    g_storage_manager.streams[i].current_size,
+                    g_storage_manager.streams[i].record_count);
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Bytes of a catalogued log file that can be read safely. For a file that
+// is still being written this stops at the last group commit, so readers
+// never see a partially written chunk and never block the storage task.
+esp_err_t storage_manager_get_readable_size(const char* name, size_t* size, bool* active) {
+    if (!name || !size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    storage_catalog_entry_t entry;
+    if (!storage_catalog_find(name, &entry)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        const log_file_t* log_file = &g_storage_manager.streams[i];
+        if (log_file->active && strcmp(catalog_name(log_file->filename), name) == 0) {
+            *size = log_file->committed_size;
+            if (active) {
+                *active = true;
+            }
+            return ESP_OK;
         }
     }
 
+    char path[STORAGE_MAX_FILENAME_LEN];
+    snprintf(path, sizeof(path), "%s/%s", CONFIG_SD_MOUNT_POINT, name);
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *size = st.st_size;
+    if (active) {
+        *active = false;
+    }
     return ESP_OK;
 }
 
+// Records waiting for the storage task, including the staging pool
+uint32_t storage_manager_get_queue_depth(void) {
+    if (!g_storage_manager.staging_mutex) {
+        return 0;
+    }
+
+    uint32_t depth = 0;
+    xSemaphoreTake(g_storage_manager.staging_mutex, portMAX_DELAY);
+    for (int level = 0; level < STORAGE_PRIORITY_LEVELS; level++) {
+        depth += uxQueueMessagesWaiting(g_storage_manager.write_queues[level]) +
+                 storage_staging_pending(level);
+    }
+    xSemaphoreGive(g_storage_manager.staging_mutex);
+    return depth;
+}
+
+// Records waiting in the priority queues. Overflow into the staging pool
+// is left out: the pool absorbs sustained load and can stay occupied while
+// the writer keeps up.
+uint32_t storage_manager_get_queued_records(void) {
+    if (!g_storage_manager.staging_mutex) {
+        return 0;
+    }
+
+    uint32_t depth = 0;
+    for (int level = 0; level < STORAGE_PRIORITY_LEVELS; level++) {
+        depth += uxQueueMessagesWaiting(g_storage_manager.write_queues[level]);
+    }
+    return depth;
+}
+
 bool storage_manager_is_running(void) {
     return g_storage_manager.running;
 }
@@ -345,18 +1542,82 @@ esp_err_t storage_manager_stop(void) {
 
     ESP_LOGI(TAG, "Stopping Storage Manager");
 
+    storage_scrub_stop();
+
+    // The storage task may be in the middle of a write; files are only
+    // closed once it has left its loop
+    g_storage_manager.stopper = xTaskGetCurrentTaskHandle();
     g_storage_manager.running = false;
+    xTaskNotifyGive(g_storage_manager.storage_task);
+    bool stopped = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STORAGE_STOP_TIMEOUT_MS)) != 0;
+    g_storage_manager.stopper = NULL;
+    if (!stopped) {
+        ESP_LOGE(TAG, "Storage task did not stop in time, log files left open");
+        return ESP_ERR_TIMEOUT;
+    }
 
     // Close all open files
-    for (int i = 0; i < STORAGE_MAX_FILES; i++) {
-        if (g_storage_manager.current_files[i].active &&
-            g_storage_manager.current_files[i].file_handle) {
-            fclose(g_storage_manager.current_files[i].file_handle);
-            g_storage_manager.current_files[i].active = false;
-            g_storage_manager.current_files[i].file_handle = NULL;
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        if (g_storage_manager.streams[i].active) {
+            close_log_file(&g_storage_manager.streams[i]);
         }
     }
+    update_open_journal();
+    storage_rollup_close();
 
     ESP_LOGI(TAG, "Storage Manager stopped");
     return ESP_OK;
 }
+
+// Catalog entry <index> (0 = oldest). An open file reports its live
+// figures rather than the last catalog update.
+bool storage_manager_get_file(uint32_t index, storage_catalog_entry_t* entry, bool* open) {
+    if (!entry || !storage_catalog_get(index, entry)) {
+        return false;
+    }
+
+    bool active = false;
+    for (int i = 0; i < STORAGE_STREAM_COUNT; i++) {
+        const log_file_t* log_file = &g_storage_manager.streams[i];
+        if (log_file->active && strcmp(catalog_name(log_file->filename), entry->name) == 0) {
+            entry->size = log_file->current_size;
+            entry->record_count = log_file->record_count;
+            entry->first_timestamp_us = log_file->first_timestamp_us;
+            entry->last_timestamp_us = log_file->last_timestamp_us;
+            active = true;
+            break;
+        }
+    }
+
+    if (open) {
+        *open = active;
+    }
+    return true;
+}
+
+esp_err_t storage_manager_cleanup_old_files(uint32_t retention_days) {
+    if (retention_days == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_storage_manager.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The storage task owns the catalog; hand the request over if it is running
+    if (g_storage_manager.running) {
+        g_storage_manager.retention_request_days = retention_days;
+        return ESP_OK;
+    }
+
+    enforce_retention(retention_days);
+    return ESP_OK;
+}
+
+esp_err_t storage_manager_enable_compression(bool enable) {
+    system_config_t* config = config_get_instance();
+    config->storage_config.compress_files = enable;
+
+    ESP_LOGI(TAG, "UART log compression %s", enable ? "enabled" : "disabled");
+    return ESP_OK;
+}
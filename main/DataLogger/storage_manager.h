@@ -5,6 +5,7 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "config.h"
+#include "storage_catalog.h"
 #include <stdio.h>
 #include <stdint.h>
 
@@ -13,9 +14,31 @@ extern "C" {
 #endif
 
 // Storage Manager Configuration
-#define STORAGE_QUEUE_SIZE          50
-#define STORAGE_MAX_FILES           8
+#define STORAGE_QUEUE_SIZE          (STORAGE_EVENT_QUEUE_SIZE + STORAGE_FRAME_QUEUE_SIZE + STORAGE_BULK_QUEUE_SIZE)
+#define STORAGE_EVENT_QUEUE_SIZE    8      // System events and alarms
+#define STORAGE_FRAME_QUEUE_SIZE    24     // UART frames
+#define STORAGE_BULK_QUEUE_SIZE     18     // ADC samples, shed first under backpressure
+#define STORAGE_ADC_STREAM_CHANNELS 2      // ADC channels sharing one stream (and log file)
+#define STORAGE_UART_STREAMS        CONFIG_UART_PORT_COUNT
+#define STORAGE_ADC_STREAMS         ((CONFIG_ADC_CHANNEL_COUNT + STORAGE_ADC_STREAM_CHANNELS - 1) / STORAGE_ADC_STREAM_CHANNELS)
+#define STORAGE_STREAM_COUNT        (STORAGE_UART_STREAMS + STORAGE_ADC_STREAMS + 1)  // + system events
+#define STORAGE_WRITE_BATCH         3      // Full chunks gathered before a writer pass
 #define STORAGE_MAX_FILENAME_LEN    128
+#define STORAGE_MAX_PAYLOAD_LEN     256    // Largest record payload (one UART packet)
+#define STORAGE_CHUNK_SIZE          4096   // Records are staged and written in chunks
+#define STORAGE_LATENCY_BUCKETS     16     // SD latency histogram, log2 buckets
+#define STORAGE_LATENCY_BUCKET0_US  128    // Upper bound of the first bucket
+
+// Write Priorities - one storage queue per level, 0 = highest.
+// Events are served strictly first; frames and bulk samples share the
+// writer by weight so bulk data cannot starve, but bulk is shed at the
+// queue when the writer falls behind.
+typedef enum {
+    STORAGE_PRIORITY_EVENT = 0,
+    STORAGE_PRIORITY_FRAME = 1,
+    STORAGE_PRIORITY_BULK = 2,
+    STORAGE_PRIORITY_LEVELS
+} storage_priority_t;
 
 // Data Types
 typedef enum {
@@ -35,31 +58,100 @@ typedef struct __attribute__((packed)) {
     uint8_t data[];             // Variable length payload
 } data_packet_t;
 
+// On-disk chunk header - each file is a sequence of header + body chunks.
+// The body holds packed data_packet_t records, LZ4-compressed if flagged.
+// A chunk is valid only if its CRC matches, so after a power cut the valid
+// prefix of a file ends at the first chunk that fails the check.
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             // STORAGE_CHUNK_MAGIC
+    uint8_t version;            // STORAGE_CHUNK_VERSION
+    uint8_t flags;              // STORAGE_CHUNK_FLAG_*
+    uint16_t record_count;      // Records in this chunk
+    uint16_t raw_length;        // Body length before compression
+    uint16_t stored_length;     // Body length on disk
+    uint32_t crc32;             // CRC32 of the fields above and the stored body
+} storage_chunk_header_t;
+
 // Log File Structure
 typedef struct {
     char filename[STORAGE_MAX_FILENAME_LEN];
     FILE* file_handle;
     bool active;
     data_type_t data_type;
+    uint8_t source_id;          // UART port for per-port files
     size_t current_size;
+    size_t committed_size;      // Bytes synced to the card, readable by other tasks
     uint32_t record_count;
     uint64_t creation_time;
+    uint64_t first_timestamp_us;// First record in the file
+    uint64_t last_timestamp_us; // Latest record in the file
+    struct storage_chunk* chunk;// Open chunk, drawn from the shared pool
+    size_t pending_size;        // Bytes staged in chunks not yet written
 } log_file_t;
 
 // Storage Statistics
 typedef struct {
-    uint32_t total_writes;      // Total write operations
+    uint32_t total_writes;      // Records written to the SD card
     uint32_t write_errors;      // Write errors
     uint32_t files_created;     // Files created
     uint32_t files_rotated;     // Files rotated
     uint64_t bytes_written;     // Total bytes written
     uint64_t last_write_time;   // Last write timestamp
+    uint32_t chunks_written;    // Chunks written to files
+    uint32_t chunks_compressed; // Chunks stored compressed
+    uint64_t compress_bytes_in; // Raw bytes offered to the compressor
+    uint64_t compress_bytes_out;// Bytes stored for those chunks
+    uint64_t compress_time_us;  // CPU time spent compressing
+    float compression_ratio;    // compress_bytes_in / compress_bytes_out
+    uint32_t compress_us_per_kb;// Compressor cost per KB of input
+    uint32_t sync_count;        // Group commits (fsync of all open files)
+    uint32_t sync_errors;       // Failed fflush/fsync calls
+    uint64_t sync_time_us;      // Time spent in group commits
+    uint32_t last_sync_bytes;   // Bytes at risk before the last commit
+    uint32_t last_sync_window_ms;// Age of the oldest uncommitted record at the last commit
+    uint32_t max_sync_bytes;    // Largest amount of data ever at risk
+    uint32_t bytes_at_risk;     // Bytes accepted but not yet committed
+    uint32_t recovered_files;   // Files checked by the boot-time recovery scan
+    uint64_t recovered_truncated_bytes; // Torn tail bytes removed by recovery
+    uint32_t files_deleted;     // Old files deleted by the space manager
+    uint64_t bytes_reclaimed;   // Bytes freed by those deletions
+    uint64_t card_total_bytes;  // SD card capacity at the last space check
+    uint64_t card_free_bytes;   // SD card free space at the last space check
+    bool sd_available;          // False while records go to the spill tier
+    uint32_t sd_faults;         // Write/sync failures that switched to the spill tier
+    uint32_t sd_stalls;         // Writes slower than spill_latency_ms
+    uint32_t spill_pending_bytes;   // Spilled data waiting to be drained
+    uint32_t spill_capacity_bytes;  // Spill tier size (0 when not mounted)
+    uint32_t spill_records_dropped; // Records lost because the spill was full
+    uint32_t spill_drain_bytes_per_sec; // Spill drain throughput
+    uint32_t queue_enqueued[STORAGE_PRIORITY_LEVELS];   // Records accepted per priority
+    uint32_t queue_shed[STORAGE_PRIORITY_LEVELS];       // Records rejected (queue full or shed)
+    uint32_t queue_high_water[STORAGE_PRIORITY_LEVELS]; // Deepest backlog seen
+    uint32_t queue_max_wait_us[STORAGE_PRIORITY_LEVELS];// Longest time a record waited in its queue
+    uint32_t write_latency_hist[STORAGE_LATENCY_BUCKETS]; // SD writes/syncs, bucket i < 128 us << i
+    uint32_t write_latency_p99_us;  // Upper bound of the 99th percentile bucket
+    uint32_t write_latency_max_us;
+    uint32_t write_stalls;      // SD operations of 100 ms or more
+    uint64_t sd_write_bytes;    // Bytes handed to the card
+    uint64_t sd_write_time_us;  // Time spent in SD writes and syncs
+    uint32_t sd_write_kbps;     // Card throughput while busy (KB/s)
+    uint32_t staging_blocks;    // Staging pool blocks allocated
+    uint32_t staging_block_limit;   // Pool limit set from the card's recent stalls
+    uint32_t staging_peak_blocks;
+    uint32_t staging_records;   // Records waiting in the pool
+    uint32_t staged_records;    // Records that overflowed into the pool
+    uint32_t open_streams;      // Streams with an open log file
+    uint32_t chunk_buffers;     // Chunk buffers allocated from the shared pool
+    uint32_t chunk_buffers_peak;
+    uint32_t write_batches;     // Writer passes over full chunks
+    uint32_t batched_chunks;    // Chunks written by those passes
 } storage_stats_t;
 
 // Storage Write Request
 typedef struct {
     data_packet_t packet;
-    uint32_t priority;          // Write priority (0 = highest)
+    uint8_t payload[STORAGE_MAX_PAYLOAD_LEN];  // Record payload (packet.data_length bytes)
+    uint32_t priority;          // storage_priority_t (0 = highest)
 } storage_write_request_t;
 
 // Storage Manager Functions
@@ -80,12 +172,18 @@ esp_err_t storage_manager_flush_all(void);
 esp_err_t storage_manager_rotate_files(void);
 esp_err_t storage_manager_close_all_files(void);
 esp_err_t storage_manager_cleanup_old_files(uint32_t retention_days);
+esp_err_t storage_manager_recover_file(const char* filename, size_t* valid_length);
+
+// Log Download Support
+esp_err_t storage_manager_get_readable_size(const char* name, size_t* size, bool* active);
+bool storage_manager_get_file(uint32_t index, storage_catalog_entry_t* entry, bool* open);
+uint32_t storage_manager_get_queue_depth(void);
+uint32_t storage_manager_get_queued_records(void);
 
 // Statistics and Monitoring
 esp_err_t storage_manager_get_stats(storage_stats_t* stats);
 esp_err_t storage_manager_reset_stats(void);
 esp_err_t storage_manager_print_stats(void);
-esp_err_t storage_manager_get_file_list(char* buffer, size_t buffer_size);
 
 // Configuration
 esp_err_t storage_manager_set_max_file_size(uint32_t size_mb);
@@ -93,14 +191,21 @@ esp_err_t storage_manager_enable_compression(bool enable);
 
 // Utility Functions
 uint8_t storage_calculate_checksum(const uint8_t* data, size_t length);
+storage_priority_t storage_record_priority(uint8_t data_type);
+const char* storage_data_type_name(uint8_t data_type);
 esp_err_t storage_create_data_packet(data_type_t type, uint8_t source_id, 
                                    const uint8_t* data, size_t length, 
                                    data_packet_t** packet);
 esp_err_t storage_validate_packet(const data_packet_t* packet);
+uint32_t storage_chunk_crc(const storage_chunk_header_t* header, const uint8_t* body);
 
 // Constants
 #define STORAGE_MAGIC_NUMBER        0xDEADBEEF
-#define STORAGE_DEFAULT_PRIORITY    5
+#define STORAGE_DEFAULT_PRIORITY    STORAGE_PRIORITY_FRAME
+#define STORAGE_CHUNK_MAGIC         0x4B4E4843  // "CHNK"
+#define STORAGE_CHUNK_VERSION       2
+#define STORAGE_CHUNK_FLAG_COMPRESSED 0x01
+#define STORAGE_OPEN_JOURNAL        CONFIG_SD_MOUNT_POINT "/OPENLOG.TXT"  // Files open for writing
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,343 @@
+#include "storage_rollup.h"
+#include "storage_session.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char* TAG = "STORAGE_ROLLUP";
+
+// Open bucket of one channel in one tier
+typedef struct {
+    bool active;
+    uint64_t start_us;
+    float min;
+    float max;
+    double sum;                 // Double so an hour of 1 kHz samples keeps its precision
+    uint32_t count;
+} rollup_bucket_t;
+
+// Rollup State
+typedef struct {
+    bool initialized;
+    uint32_t session_id;        // Stamped on every record written this boot
+    FILE* files[STORAGE_ROLLUP_TIERS];
+    rollup_bucket_t buckets[CONFIG_ADC_CHANNEL_COUNT][STORAGE_ROLLUP_TIERS];
+    bool rotate_pending[STORAGE_ROLLUP_TIERS];
+    uint32_t readers;           // Queries scanning tier files, rotation waits for them
+    SemaphoreHandle_t mutex;
+    storage_rollup_stats_t stats;
+} storage_rollup_state_t;
+
+static storage_rollup_state_t g_rollup = {0};
+
+static const uint64_t g_bucket_us[STORAGE_ROLLUP_TIERS] = {
+    1000ULL * 1000,
+    60ULL * 1000 * 1000,
+    3600ULL * 1000 * 1000
+};
+
+static const char* const g_tier_names[STORAGE_ROLLUP_TIERS] = {"second", "minute", "hour"};
+
+// Tier files are 8.3 names (long file names are disabled)
+static const char* const g_tier_files[STORAGE_ROLLUP_TIERS] = {
+    CONFIG_SD_MOUNT_POINT "/RUSEC2.DAT",
+    CONFIG_SD_MOUNT_POINT "/RUMIN2.DAT",
+    CONFIG_SD_MOUNT_POINT "/RUHOUR2.DAT"
+};
+
+static const char* const g_tier_old_files[STORAGE_ROLLUP_TIERS] = {
+    CONFIG_SD_MOUNT_POINT "/RUSEC2.OLD",
+    CONFIG_SD_MOUNT_POINT "/RUMIN2.OLD",
+    CONFIG_SD_MOUNT_POINT "/RUHOUR2.OLD"
+};
+
+// Tier files of the record layout without a session ID
+static const char* const g_legacy_files[] = {
+    CONFIG_SD_MOUNT_POINT "/RUSEC.DAT",
+    CONFIG_SD_MOUNT_POINT "/RUMIN.DAT",
+    CONFIG_SD_MOUNT_POINT "/RUHOUR.DAT",
+    CONFIG_SD_MOUNT_POINT "/RUSEC.OLD",
+    CONFIG_SD_MOUNT_POINT "/RUMIN.OLD",
+    CONFIG_SD_MOUNT_POINT "/RUHOUR.OLD"
+};
+
+static const long g_tier_max_size[STORAGE_ROLLUP_TIERS] = {
+    STORAGE_ROLLUP_SECOND_MAX_SIZE,
+    STORAGE_ROLLUP_MAX_SIZE,
+    STORAGE_ROLLUP_MAX_SIZE
+};
+
+// Start a new generation once the tier file is full (deferred while a query reads it)
+static void rotate_tier(storage_rollup_tier_t tier) {
+    xSemaphoreTake(g_rollup.mutex, portMAX_DELAY);
+    if (g_rollup.readers > 0) {
+        g_rollup.rotate_pending[tier] = true;
+        xSemaphoreGive(g_rollup.mutex);
+        return;
+    }
+
+    fclose(g_rollup.files[tier]);
+    remove(g_tier_old_files[tier]);
+    rename(g_tier_files[tier], g_tier_old_files[tier]);
+    g_rollup.files[tier] = fopen(g_tier_files[tier], "ab");
+    g_rollup.rotate_pending[tier] = false;
+    g_rollup.stats.rotations++;
+    xSemaphoreGive(g_rollup.mutex);
+
+    ESP_LOGI(TAG, "Rotated %s rollups", g_tier_names[tier]);
+}
+
+static void merge_bucket(uint8_t channel, storage_rollup_tier_t tier, const rollup_bucket_t* src);
+
+// Append a closed bucket to its tier file and fold it into the next tier
+static void emit_bucket(uint8_t channel, storage_rollup_tier_t tier, const rollup_bucket_t* bucket) {
+    storage_rollup_record_t record = {
+        .session_id = g_rollup.session_id,
+        .start_us = bucket->start_us,
+        .min = bucket->min,
+        .max = bucket->max,
+        .mean = (float)(bucket->sum / bucket->count),
+        .count = bucket->count,
+        .channel = channel,
+        .tier = tier
+    };
+
+    FILE* file = g_rollup.files[tier];
+    if (!file || fwrite(&record, sizeof(record), 1, file) != 1) {
+        g_rollup.stats.write_errors++;
+    } else {
+        g_rollup.stats.records_written[tier]++;
+        if (ftell(file) >= g_tier_max_size[tier] || g_rollup.rotate_pending[tier]) {
+            rotate_tier(tier);
+        }
+    }
+
+    if (tier + 1 < STORAGE_ROLLUP_TIERS) {
+        merge_bucket(channel, tier + 1, bucket);
+    }
+}
+
+// Add a finer bucket (or a single sample) to the open bucket of a tier,
+// closing that bucket first when src falls outside it
+static void merge_bucket(uint8_t channel, storage_rollup_tier_t tier, const rollup_bucket_t* src) {
+    rollup_bucket_t* bucket = &g_rollup.buckets[channel][tier];
+    uint64_t start_us = src->start_us - src->start_us % g_bucket_us[tier];
+
+    if (bucket->active && bucket->start_us != start_us) {
+        emit_bucket(channel, tier, bucket);
+        bucket->active = false;
+    }
+
+    if (!bucket->active) {
+        *bucket = *src;
+        bucket->start_us = start_us;
+        return;
+    }
+
+    if (src->min < bucket->min) {
+        bucket->min = src->min;
+    }
+    if (src->max > bucket->max) {
+        bucket->max = src->max;
+    }
+    bucket->sum += src->sum;
+    bucket->count += src->count;
+}
+
+esp_err_t storage_rollup_init(void) {
+    if (g_rollup.initialized) {
+        return ESP_OK;
+    }
+
+    if (!g_rollup.mutex) {
+        g_rollup.mutex = xSemaphoreCreateMutex();
+        if (!g_rollup.mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    // Runs after storage_session_begin; without a session records carry 0
+    storage_session_info_t session;
+    g_rollup.session_id = (storage_session_get_info(&session) == ESP_OK) ? session.session_id : 0;
+
+    for (size_t i = 0; i < sizeof(g_legacy_files) / sizeof(g_legacy_files[0]); i++) {
+        remove(g_legacy_files[i]);
+    }
+
+    memset(g_rollup.buckets, 0, sizeof(g_rollup.buckets));
+    for (int tier = 0; tier < STORAGE_ROLLUP_TIERS; tier++) {
+        g_rollup.files[tier] = fopen(g_tier_files[tier], "ab");
+        if (!g_rollup.files[tier]) {
+            ESP_LOGE(TAG, "Failed to open %s", g_tier_files[tier]);
+        }
+        g_rollup.rotate_pending[tier] = false;
+    }
+
+    g_rollup.initialized = true;
+    ESP_LOGI(TAG, "Rollup tiers ready (%zu byte records, session %lu)",
+             sizeof(storage_rollup_record_t), (unsigned long)g_rollup.session_id);
+
+    return ESP_OK;
+}
+
+void storage_rollup_add(uint8_t channel, uint64_t timestamp_us, float value) {
+    if (!g_rollup.initialized || channel >= CONFIG_ADC_CHANNEL_COUNT) {
+        return;
+    }
+
+    rollup_bucket_t sample = {
+        .active = true,
+        .start_us = timestamp_us,
+        .min = value,
+        .max = value,
+        .sum = value,
+        .count = 1
+    };
+    merge_bucket(channel, STORAGE_ROLLUP_SECOND, &sample);
+}
+
+esp_err_t storage_rollup_commit(void) {
+    if (!g_rollup.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = ESP_OK;
+    for (int tier = 0; tier < STORAGE_ROLLUP_TIERS; tier++) {
+        FILE* file = g_rollup.files[tier];
+        if (file && (fflush(file) != 0 || fsync(fileno(file)) != 0)) {
+            g_rollup.stats.write_errors++;
+            ret = ESP_FAIL;
+        }
+    }
+
+    return ret;
+}
+
+// Write out the partial buckets and close the tier files
+esp_err_t storage_rollup_close(void) {
+    if (!g_rollup.initialized) {
+        return ESP_OK;
+    }
+
+    // Finest tier first so partial buckets cascade into the coarser ones
+    for (int tier = 0; tier < STORAGE_ROLLUP_TIERS; tier++) {
+        for (int channel = 0; channel < CONFIG_ADC_CHANNEL_COUNT; channel++) {
+            rollup_bucket_t* bucket = &g_rollup.buckets[channel][tier];
+            if (bucket->active) {
+                emit_bucket(channel, tier, bucket);
+                bucket->active = false;
+            }
+        }
+    }
+
+    xSemaphoreTake(g_rollup.mutex, portMAX_DELAY);
+    for (int tier = 0; tier < STORAGE_ROLLUP_TIERS; tier++) {
+        if (g_rollup.files[tier]) {
+            fclose(g_rollup.files[tier]);
+            g_rollup.files[tier] = NULL;
+        }
+    }
+    g_rollup.initialized = false;
+    xSemaphoreGive(g_rollup.mutex);
+
+    return ESP_OK;
+}
+
+uint64_t storage_rollup_bucket_us(storage_rollup_tier_t tier) {
+    return (tier < STORAGE_ROLLUP_TIERS) ? g_bucket_us[tier] : 0;
+}
+
+const char* storage_rollup_tier_name(storage_rollup_tier_t tier) {
+    return (tier < STORAGE_ROLLUP_TIERS) ? g_tier_names[tier] : "raw";
+}
+
+// Coarsest tier whose buckets are no longer than the requested resolution
+esp_err_t storage_rollup_select_tier(uint64_t resolution_us, storage_rollup_tier_t* tier) {
+    if (!tier) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int t = STORAGE_ROLLUP_TIERS - 1; t >= 0; t--) {
+        if (g_bucket_us[t] <= resolution_us) {
+            *tier = t;
+            return ESP_OK;
+        }
+    }
+
+    // Finer than one second needs the raw samples
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// Records of one session (or of all, STORAGE_ROLLUP_ALL_SESSIONS) that
+// overlap [start_us, end_us] of that session's clock
+esp_err_t storage_rollup_query(uint8_t channel, uint32_t session_id, uint64_t start_us, uint64_t end_us,
+                               storage_rollup_tier_t tier,
+                               storage_rollup_visit_t visit, void* ctx) {
+    if (!visit || tier >= STORAGE_ROLLUP_TIERS || channel >= CONFIG_ADC_CHANNEL_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_rollup.mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    storage_rollup_record_t* batch = malloc(STORAGE_ROLLUP_READ_BATCH * sizeof(storage_rollup_record_t));
+    if (!batch) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(g_rollup.mutex, portMAX_DELAY);
+    g_rollup.readers++;
+    xSemaphoreGive(g_rollup.mutex);
+
+    // Older generation first, records are appended in time order
+    const char* paths[2] = {g_tier_old_files[tier], g_tier_files[tier]};
+    bool stop = false;
+    for (int gen = 0; gen < 2 && !stop; gen++) {
+        FILE* file = fopen(paths[gen], "rb");
+        if (!file) {
+            continue;
+        }
+
+        size_t count;
+        while (!stop && (count = fread(batch, sizeof(storage_rollup_record_t),
+                                       STORAGE_ROLLUP_READ_BATCH, file)) > 0) {
+            g_rollup.stats.query_bytes_read += count * sizeof(storage_rollup_record_t);
+            for (size_t i = 0; i < count; i++) {
+                const storage_rollup_record_t* record = &batch[i];
+                if (record->channel != channel ||
+                    (session_id != STORAGE_ROLLUP_ALL_SESSIONS && record->session_id != session_id) ||
+                    record->start_us + g_bucket_us[tier] <= start_us ||
+                    record->start_us > end_us) {
+                    continue;
+                }
+                if (!visit(record, ctx)) {
+                    stop = true;
+                    break;
+                }
+            }
+        }
+        fclose(file);
+    }
+
+    xSemaphoreTake(g_rollup.mutex, portMAX_DELAY);
+    g_rollup.readers--;
+    g_rollup.stats.queries++;
+    xSemaphoreGive(g_rollup.mutex);
+
+    free(batch);
+    return ESP_OK;
+}
+
+esp_err_t storage_rollup_get_stats(storage_rollup_stats_t* stats) {
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(stats, &g_rollup.stats, sizeof(storage_rollup_stats_t));
+    return ESP_OK;
+}
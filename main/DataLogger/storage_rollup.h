@@ -0,0 +1,81 @@
+#pragma once
+
+#include "esp_err.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Multi-resolution rollups of the ADC channels, kept next to the raw logs.
+// The storage task feeds every ADC sample in; per-second buckets are
+// merged into per-minute and per-hour buckets as they close, and each
+// closed bucket is appended to its tier file as a fixed-size record.
+// Zoomed-out history is then served from the coarsest tier that still
+// meets the requested resolution instead of from the raw samples.
+//
+// Each tier file keeps one older generation (.OLD) so its size is bounded.
+// Records use the same esp_timer clock as the raw records. That clock
+// restarts at boot, so every record also carries the storage_session ID of
+// the boot that wrote it; start_us is only comparable within one session,
+// and the session manifest maps it to UTC.
+
+// Rollup Tiers
+typedef enum {
+    STORAGE_ROLLUP_SECOND = 0,
+    STORAGE_ROLLUP_MINUTE,
+    STORAGE_ROLLUP_HOUR,
+    STORAGE_ROLLUP_TIERS
+} storage_rollup_tier_t;
+
+// Rollup Configuration
+#define STORAGE_ROLLUP_SECOND_MAX_SIZE  (8 * 1024 * 1024)  // Per generation, ~20 h of 4 channels
+#define STORAGE_ROLLUP_MAX_SIZE         (1024 * 1024)      // Minute and hour tiers
+#define STORAGE_ROLLUP_READ_BATCH       64                 // Records read per fread when querying
+#define STORAGE_ROLLUP_ALL_SESSIONS     UINT32_MAX         // Query filter matching every session
+
+// Rollup Record (one closed bucket of one channel)
+typedef struct __attribute__((packed)) {
+    uint32_t session_id;        // Boot that wrote the record, 0 when no session was started
+    uint64_t start_us;          // Bucket start, aligned to the tier's bucket length
+    float min;
+    float max;
+    float mean;
+    uint32_t count;             // Raw samples in the bucket
+    uint8_t channel;
+    uint8_t tier;               // storage_rollup_tier_t
+} storage_rollup_record_t;
+
+// Rollup Statistics
+typedef struct {
+    uint32_t records_written[STORAGE_ROLLUP_TIERS];
+    uint32_t write_errors;
+    uint32_t rotations;         // Tier files moved to .OLD
+    uint32_t queries;
+    uint64_t query_bytes_read;  // SD bytes read to answer queries
+} storage_rollup_stats_t;
+
+// Return false to stop the query
+typedef bool (*storage_rollup_visit_t)(const storage_rollup_record_t* record, void* ctx);
+
+// Rollup Functions (add/commit/close are called by the storage task only)
+esp_err_t storage_rollup_init(void);
+void storage_rollup_add(uint8_t channel, uint64_t timestamp_us, float value);
+esp_err_t storage_rollup_commit(void);
+esp_err_t storage_rollup_close(void);
+
+// Query (any task)
+uint64_t storage_rollup_bucket_us(storage_rollup_tier_t tier);
+const char* storage_rollup_tier_name(storage_rollup_tier_t tier);
+esp_err_t storage_rollup_select_tier(uint64_t resolution_us, storage_rollup_tier_t* tier);
+esp_err_t storage_rollup_query(uint8_t channel, uint32_t session_id, uint64_t start_us, uint64_t end_us,
+                               storage_rollup_tier_t tier,
+                               storage_rollup_visit_t visit, void* ctx);
+
+esp_err_t storage_rollup_get_stats(storage_rollup_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
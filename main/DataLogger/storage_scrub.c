@@ -0,0 +1,436 @@
+#include "storage_scrub.h"
+#include "storage_manager.h"
+#include "storage_compress.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char* TAG = "STORAGE_SCRUB";
+
+// Scrubber State
+typedef struct {
+    bool running;
+    TaskHandle_t task;
+    SemaphoreHandle_t mutex;    // Held while a file is open, and for the stats
+    char forgotten[STORAGE_CATALOG_NAME_LEN];  // Last file deleted by the space manager
+    storage_scrub_stats_t stats;
+} storage_scrub_state_t;
+
+static storage_scrub_state_t g_scrub = {0};
+
+// One file being scrubbed
+typedef struct {
+    const char* name;           // Relative to the mount point
+    FILE* file;
+    uint8_t* body;              // Stored chunk body, also the resync window
+    uint8_t* raw;               // Decompressed body
+    uint32_t batch_bytes;       // Read since the last throttle pause
+    uint32_t corrupt_end;       // End of the last damaged range
+    bool background;            // Run by the scrub task, ends when it stops
+    storage_scrub_result_t* result;
+} scrub_ctx_t;
+
+static const char* base_name(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static void scrub_lock(void) {
+    if (!g_scrub.mutex) {
+        g_scrub.mutex = xSemaphoreCreateMutex();
+    }
+    xSemaphoreTake(g_scrub.mutex, portMAX_DELAY);
+}
+
+static void scrub_unlock(void) {
+    xSemaphoreGive(g_scrub.mutex);
+}
+
+static bool scan_cancelled(const scrub_ctx_t* ctx) {
+    return ctx->background && !g_scrub.running;
+}
+
+// Logging first: wait until the storage task has nothing queued
+static void wait_for_idle_writer(const scrub_ctx_t* ctx) {
+    while (!scan_cancelled(ctx) && storage_manager_is_running() &&
+           storage_manager_get_queue_depth() > 0) {
+        g_scrub.stats.backoffs++;
+        vTaskDelay(pdMS_TO_TICKS(STORAGE_SCRUB_BACKOFF_MS));
+    }
+}
+
+// Sleep long enough to keep the reads of the last batch within the budget
+static void throttle(scrub_ctx_t* ctx) {
+    uint32_t delay_ms = (uint64_t)ctx->batch_bytes * 1000 / (STORAGE_SCRUB_RATE_KBPS * 1024);
+    ctx->batch_bytes = 0;
+    vTaskDelay(delay_ms > 0 ? pdMS_TO_TICKS(delay_ms) : 1);
+}
+
+static size_t read_at(scrub_ctx_t* ctx, uint32_t offset, void* buffer, size_t length) {
+    if (fseek(ctx->file, offset, SEEK_SET) != 0) {
+        return 0;
+    }
+    size_t got = fread(buffer, 1, length, ctx->file);
+    ctx->batch_bytes += got;
+    ctx->result->bytes_read += got;
+    return got;
+}
+
+// Record a damaged range, merging it with the previous one when adjacent
+static void mark_corrupt(scrub_ctx_t* ctx, uint32_t offset, uint32_t length) {
+    storage_scrub_result_t* result = ctx->result;
+    if (result->corrupt_ranges == 0) {
+        result->corrupt_offset = offset;
+    }
+    if (result->corrupt_ranges == 0 || offset != ctx->corrupt_end) {
+        result->corrupt_ranges++;
+    }
+    result->corrupt_bytes += length;
+    ctx->corrupt_end = offset + length;
+}
+
+// Offset of the next chunk magic at or after from, or the file size
+static uint32_t resync(scrub_ctx_t* ctx, uint32_t from) {
+    const uint32_t magic = STORAGE_CHUNK_MAGIC;
+    uint32_t pos = from;
+    while (pos < ctx->result->size) {
+        size_t got = read_at(ctx, pos, ctx->body, STORAGE_CHUNK_SIZE);
+        if (got < sizeof(magic)) {
+            break;
+        }
+        for (size_t i = 0; i + sizeof(magic) <= got; i++) {
+            if (memcmp(ctx->body + i, &magic, sizeof(magic)) == 0) {
+                return pos + i;
+            }
+        }
+        pos += got - (sizeof(magic) - 1);
+    }
+    return ctx->result->size;
+}
+
+// Walk the records of a decoded chunk body
+static bool check_records(scrub_ctx_t* ctx, const storage_chunk_header_t* header, const uint8_t* body) {
+    uint64_t first_us = 0;
+    uint64_t last_us = 0;
+    uint32_t records = 0;
+    size_t pos = 0;
+
+    while (pos < header->raw_length) {
+        if (header->raw_length - pos < sizeof(data_packet_t)) {
+            return false;
+        }
+        data_packet_t packet;
+        memcpy(&packet, body + pos, sizeof(packet));
+        const uint8_t* payload = body + pos + sizeof(data_packet_t);
+        if (packet.magic != STORAGE_MAGIC_NUMBER ||
+            packet.data_length > STORAGE_MAX_PAYLOAD_LEN ||
+            packet.data_length > header->raw_length - pos - sizeof(data_packet_t) ||
+            storage_calculate_checksum(payload, packet.data_length) != packet.checksum) {
+            return false;
+        }
+        if (records == 0) {
+            first_us = packet.timestamp_us;
+        }
+        last_us = packet.timestamp_us;
+        records++;
+        pos += sizeof(data_packet_t) + packet.data_length;
+    }
+
+    if (records != header->record_count) {
+        return false;
+    }
+
+    storage_scrub_result_t* result = ctx->result;
+    if (records > 0) {
+        if (result->records == 0) {
+            result->first_timestamp_us = first_us;
+        }
+        result->last_timestamp_us = last_us;
+    }
+    result->records += records;
+    return true;
+}
+
+// Verify the chunk at offset and return the offset to continue from
+static uint32_t scrub_chunk(scrub_ctx_t* ctx, uint32_t offset) {
+    storage_scrub_result_t* result = ctx->result;
+    storage_chunk_header_t header;
+
+    size_t got = read_at(ctx, offset, &header, sizeof(header));
+    bool valid = got == sizeof(header) &&
+                 header.magic == STORAGE_CHUNK_MAGIC &&
+                 header.version == STORAGE_CHUNK_VERSION &&
+                 header.raw_length <= STORAGE_CHUNK_SIZE &&
+                 header.stored_length <= header.raw_length &&
+                 read_at(ctx, offset + sizeof(header), ctx->body, header.stored_length) == header.stored_length &&
+                 storage_chunk_crc(&header, ctx->body) == header.crc32;
+    if (!valid) {
+        result->crc_errors++;
+        uint32_t next = resync(ctx, offset + 1);
+        mark_corrupt(ctx, offset, next - offset);
+        return next;
+    }
+
+    result->chunks++;
+    uint32_t chunk_len = sizeof(header) + header.stored_length;
+
+    const uint8_t* body = ctx->body;
+    bool decoded = true;
+    if (header.flags & STORAGE_CHUNK_FLAG_COMPRESSED) {
+        decoded = storage_decompress_block(ctx->body, header.stored_length, ctx->raw, header.raw_length) == ESP_OK;
+        body = ctx->raw;
+    }
+    if (!decoded || !check_records(ctx, &header, body)) {
+        result->record_errors++;
+        mark_corrupt(ctx, offset, chunk_len);
+    }
+
+    return offset + chunk_len;
+}
+
+// Scan a closed log file. The file is opened for one batch at a time, and
+// the scan gives up with ESP_ERR_NOT_FOUND if the file is deleted meanwhile.
+static esp_err_t scrub_path(const char* path, bool background, storage_scrub_result_t* result) {
+    memset(result, 0, sizeof(*result));
+    scrub_ctx_t ctx = {
+        .name = base_name(path),
+        .background = background,
+        .body = malloc(STORAGE_CHUNK_SIZE),
+        .raw = malloc(STORAGE_CHUNK_SIZE),
+        .result = result
+    };
+    if (!ctx.body || !ctx.raw) {
+        free(ctx.body);
+        free(ctx.raw);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    scrub_lock();
+    // A file created under the name of a deleted one is a new file
+    if (strncmp(g_scrub.forgotten, ctx.name, STORAGE_CATALOG_NAME_LEN) == 0) {
+        g_scrub.forgotten[0] = '\0';
+    }
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        ret = ESP_ERR_NOT_FOUND;
+    } else {
+        result->size = st.st_size;
+    }
+    scrub_unlock();
+
+    uint32_t offset = 0;
+    while (ret == ESP_OK && offset < result->size) {
+        wait_for_idle_writer(&ctx);
+        if (scan_cancelled(&ctx)) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+
+        scrub_lock();
+        if (strncmp(g_scrub.forgotten, ctx.name, STORAGE_CATALOG_NAME_LEN) == 0 ||
+            (ctx.file = fopen(path, "rb")) == NULL) {
+            scrub_unlock();
+            ret = ESP_ERR_NOT_FOUND;
+            break;
+        }
+        uint32_t batch_end = offset + STORAGE_SCRUB_BATCH_SIZE;
+        while (offset < result->size && offset < batch_end) {
+            offset = scrub_chunk(&ctx, offset);
+        }
+        fclose(ctx.file);
+        ctx.file = NULL;
+        scrub_unlock();
+
+        throttle(&ctx);
+    }
+
+    free(ctx.body);
+    free(ctx.raw);
+    return ret;
+}
+
+esp_err_t storage_scrub_file(const char* path, storage_scrub_result_t* result) {
+    if (!path || !result) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return scrub_path(path, false, result);
+}
+
+// Called by the space manager before deleting a file: waits for a batch
+// in progress, then stops any scan of the file
+void storage_scrub_forget(const char* name) {
+    if (!name) {
+        return;
+    }
+    scrub_lock();
+    strncpy(g_scrub.forgotten, name, sizeof(g_scrub.forgotten) - 1);
+    g_scrub.forgotten[sizeof(g_scrub.forgotten) - 1] = '\0';
+    scrub_unlock();
+}
+
+// Verdict for a catalogued file. Record counts and time ranges are only
+// compared when the catalog knows them (not after a directory rebuild)
+// and the data is intact.
+static storage_scrub_verdict_t judge_entry(const storage_catalog_entry_t* entry,
+                                           const storage_scrub_result_t* result) {
+    if (result->corrupt_ranges > 0) {
+        return STORAGE_SCRUB_CORRUPT;
+    }
+    if (entry->size != result->size) {
+        return STORAGE_SCRUB_INDEX_MISMATCH;
+    }
+    if (entry->record_count > 0 &&
+        (entry->record_count != result->records ||
+         entry->first_timestamp_us != result->first_timestamp_us ||
+         entry->last_timestamp_us != result->last_timestamp_us)) {
+        return STORAGE_SCRUB_INDEX_MISMATCH;
+    }
+    return STORAGE_SCRUB_CLEAN;
+}
+
+static void scrub_entry(const storage_catalog_entry_t* entry) {
+    size_t size = 0;
+    bool active = false;
+    if (storage_manager_get_readable_size(entry->name, &size, &active) != ESP_OK || active) {
+        g_scrub.stats.files_skipped++;
+        return;
+    }
+
+    scrub_lock();
+    strncpy(g_scrub.stats.current, entry->name, sizeof(g_scrub.stats.current) - 1);
+    scrub_unlock();
+
+    char path[STORAGE_MAX_FILENAME_LEN];
+    snprintf(path, sizeof(path), "%s/%s", CONFIG_SD_MOUNT_POINT, entry->name);
+    storage_scrub_result_t result;
+    esp_err_t ret = scrub_path(path, true, &result);
+
+    scrub_lock();
+    g_scrub.stats.current[0] = '\0';
+    g_scrub.stats.bytes_read += result.bytes_read;
+    if (ret != ESP_OK) {
+        g_scrub.stats.files_skipped++;
+        scrub_unlock();
+        return;
+    }
+    g_scrub.stats.files_scrubbed++;
+    g_scrub.stats.chunks_verified += result.chunks;
+    g_scrub.stats.crc_errors += result.crc_errors;
+    g_scrub.stats.record_errors += result.record_errors;
+    scrub_unlock();
+
+    storage_scrub_verdict_t verdict = judge_entry(entry, &result);
+    if (verdict == STORAGE_SCRUB_INDEX_MISMATCH) {
+        g_scrub.stats.index_mismatches++;
+        ESP_LOGW(TAG, "%s: catalog says %lu bytes / %lu records, file has %lu / %lu",
+                 entry->name, entry->size, entry->record_count, result.size, result.records);
+    } else if (verdict == STORAGE_SCRUB_CORRUPT) {
+        ESP_LOGW(TAG, "%s: %u damaged ranges, %lu bytes from offset %lu (%lu CRC, %lu record errors)",
+                 entry->name, result.corrupt_ranges, result.corrupt_bytes, result.corrupt_offset,
+                 result.crc_errors, result.record_errors);
+    }
+
+    // Only changed verdicts go to the catalog journal. Re-read the entry so
+    // an update made meanwhile is not overwritten.
+    storage_catalog_entry_t current;
+    if (!storage_catalog_find(entry->name, &current)) {
+        return;
+    }
+    if (current.scrub_verdict != verdict ||
+        current.corrupt_ranges != result.corrupt_ranges ||
+        current.corrupt_offset != result.corrupt_offset ||
+        current.corrupt_bytes != result.corrupt_bytes) {
+        current.scrub_verdict = verdict;
+        current.corrupt_ranges = result.corrupt_ranges;
+        current.corrupt_offset = result.corrupt_offset;
+        current.corrupt_bytes = result.corrupt_bytes;
+        storage_catalog_update(&current);
+    }
+}
+
+static void scrub_task(void* pvParameters) {
+    ESP_LOGI(TAG, "Scrub task started");
+
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STORAGE_SCRUB_START_DELAY_MS));
+    while (g_scrub.running) {
+        // Walk by index, oldest first. A file deleted from the head during
+        // the pass shifts the index by one, so one file may wait a pass.
+        storage_catalog_entry_t entry;
+        for (uint32_t index = 0; g_scrub.running && storage_catalog_get(index, &entry); index++) {
+            scrub_entry(&entry);
+        }
+
+        if (g_scrub.running) {
+            g_scrub.stats.passes++;
+            ESP_LOGI(TAG, "Scrub pass %lu done: %lu files, %lu CRC errors, %lu record errors, %lu index mismatches",
+                     g_scrub.stats.passes, g_scrub.stats.files_scrubbed, g_scrub.stats.crc_errors,
+                     g_scrub.stats.record_errors, g_scrub.stats.index_mismatches);
+        }
+
+        // Woken early by storage_scrub_stop
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STORAGE_SCRUB_INTERVAL_MS));
+    }
+
+    ESP_LOGI(TAG, "Scrub task stopped");
+    g_scrub.task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t storage_scrub_start(void) {
+    if (g_scrub.running) {
+        return ESP_OK;
+    }
+
+    if (!g_scrub.mutex) {
+        g_scrub.mutex = xSemaphoreCreateMutex();
+        if (!g_scrub.mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    g_scrub.running = true;
+    BaseType_t ret = xTaskCreate(scrub_task, "storage_scrub", STORAGE_SCRUB_TASK_STACK, NULL,
+                                 STORAGE_SCRUB_TASK_PRIORITY, &g_scrub.task);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create scrub task");
+        g_scrub.running = false;
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+// Stop after the file in progress
+esp_err_t storage_scrub_stop(void) {
+    if (!g_scrub.running) {
+        return ESP_OK;
+    }
+
+    g_scrub.running = false;
+    if (g_scrub.task) {
+        xTaskNotifyGive(g_scrub.task);
+    }
+    while (g_scrub.task) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t storage_scrub_get_stats(storage_scrub_stats_t* stats) {
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    scrub_lock();
+    memcpy(stats, &g_scrub.stats, sizeof(storage_scrub_stats_t));
+    stats->running = g_scrub.running;
+    scrub_unlock();
+    return ESP_OK;
+}
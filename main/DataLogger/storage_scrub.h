@@ -0,0 +1,72 @@
+#pragma once
+
+#include "esp_err.h"
+#include "storage_catalog.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Background integrity scrubber for closed log files. A low priority task
+// walks the catalog oldest first and re-reads every closed file at a
+// throttled rate: each chunk must pass its header and CRC checks, and its
+// records must decode to the count and length the header claims. Damaged
+// ranges (the scan resyncs on the next chunk magic) and catalog entries
+// whose size, record count or time range disagree with the file are marked
+// in the catalog and reported by /api/storage/health.
+//
+// The scrubber never competes with logging: it only reads while the
+// storage write queue is empty, and it holds a file only for one batch
+// at a time so the space manager can delete it in between.
+
+// Scrub Configuration
+#define STORAGE_SCRUB_RATE_KBPS         64     // Read budget
+#define STORAGE_SCRUB_BATCH_SIZE        (16 * 1024)  // Bytes read per file open
+#define STORAGE_SCRUB_BACKOFF_MS        20     // Wait while the storage task has work
+#define STORAGE_SCRUB_START_DELAY_MS    30000  // First pass after boot
+#define STORAGE_SCRUB_INTERVAL_MS       (60 * 60 * 1000)  // Pause between passes
+#define STORAGE_SCRUB_TASK_STACK        4096
+#define STORAGE_SCRUB_TASK_PRIORITY     1
+
+// Result of scrubbing one file
+typedef struct {
+    uint32_t size;              // File size when the scrub started
+    uint32_t bytes_read;        // Including resync scans
+    uint32_t chunks;            // Chunks that passed the CRC check
+    uint32_t records;           // Records in chunks that decoded cleanly
+    uint64_t first_timestamp_us;
+    uint64_t last_timestamp_us;
+    uint32_t crc_errors;        // Chunks with a bad header or CRC (or torn)
+    uint32_t record_errors;     // Chunks whose CRC holds but whose records do not decode
+    uint16_t corrupt_ranges;
+    uint32_t corrupt_offset;    // Start of the first damaged range
+    uint32_t corrupt_bytes;
+} storage_scrub_result_t;
+
+// Scrub Statistics
+typedef struct {
+    bool running;
+    uint32_t passes;            // Completed walks over the catalog
+    uint32_t files_scrubbed;
+    uint32_t files_skipped;     // Open for writing, or deleted while being scrubbed
+    uint32_t chunks_verified;
+    uint64_t bytes_read;
+    uint32_t crc_errors;
+    uint32_t record_errors;
+    uint32_t index_mismatches;
+    uint32_t backoffs;          // Waits for a non-empty write queue
+    char current[STORAGE_CATALOG_NAME_LEN];  // File being scrubbed, empty when idle
+} storage_scrub_stats_t;
+
+// Scrub Functions
+esp_err_t storage_scrub_start(void);
+esp_err_t storage_scrub_stop(void);
+esp_err_t storage_scrub_file(const char* path, storage_scrub_result_t* result);
+void storage_scrub_forget(const char* name);
+esp_err_t storage_scrub_get_stats(storage_scrub_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
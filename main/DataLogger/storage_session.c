@@ -0,0 +1,225 @@
+#include "storage_session.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const char* TAG = "STORAGE_SESSION";
+
+// Session State
+typedef struct {
+    bool started;
+    SemaphoreHandle_t mutex;    // Manifest appends and the file sequence
+    uint32_t sequence;          // Next file number in this session
+    const char* volatile sync_source;  // Set by the SNTP callback, consumed by check_clock
+    storage_session_info_t info;
+} storage_session_state_t;
+
+static storage_session_state_t g_session = {0};
+
+// Next session ID from NVS; a random ID when NVS is unusable, so names
+// still differ from the previous boot
+static uint32_t next_session_id(void) {
+    nvs_handle_t handle;
+    uint32_t id = 0;
+
+    if (nvs_open(STORAGE_SESSION_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "NVS unavailable, using a random session ID");
+        return esp_random();
+    }
+
+    nvs_get_u32(handle, "id", &id);
+    id++;
+    esp_err_t ret = nvs_set_u32(handle, "id", id);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store session ID: %s", esp_err_to_name(ret));
+    }
+    return id;
+}
+
+// Append one line to the manifest and sync it. Called with the mutex held.
+static void append_line(const char* line) {
+    FILE* file = fopen(g_session.info.manifest, "a");
+    if (!file) {
+        g_session.info.write_errors++;
+        return;
+    }
+
+    if (fputs(line, file) < 0 || fflush(file) != 0 || fsync(fileno(file)) != 0) {
+        g_session.info.write_errors++;
+    }
+    fclose(file);
+}
+
+// Wall clock in microseconds, 0 while it has not been set
+static int64_t utc_now_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec < STORAGE_SESSION_VALID_UTC) {
+        return 0;
+    }
+    return (int64_t)tv.tv_sec * 1000000LL + tv.tv_usec;
+}
+
+esp_err_t storage_session_begin(void) {
+    if (g_session.started) {
+        return ESP_OK;
+    }
+
+    if (!g_session.mutex) {
+        g_session.mutex = xSemaphoreCreateMutex();
+        if (!g_session.mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    int64_t boot_mono_us = esp_timer_get_time();
+    int64_t boot_utc_us = utc_now_us();
+
+    g_session.info.session_id = next_session_id();
+    g_session.sequence = 0;
+    snprintf(g_session.info.manifest, sizeof(g_session.info.manifest), STORAGE_SESSION_MANIFEST_FMT,
+             (unsigned long)(g_session.info.session_id & STORAGE_SESSION_ID_MASK));
+
+    // Manifests of old sessions go before their name is reused
+    char old_manifest[sizeof(g_session.info.manifest)];
+    snprintf(old_manifest, sizeof(old_manifest), STORAGE_SESSION_MANIFEST_FMT,
+             (unsigned long)((g_session.info.session_id - STORAGE_SESSION_KEEP) & STORAGE_SESSION_ID_MASK));
+    remove(old_manifest);
+    remove(g_session.info.manifest);
+
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "{\"session\":%lu,\"device\":\"%02x%02x%02x%02x%02x%02x\",\"boot_mono_us\":%lld,\"boot_utc_us\":%lld}\n",
+             (unsigned long)g_session.info.session_id, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5],
+             (long long)boot_mono_us, (long long)(boot_utc_us ? boot_utc_us - boot_mono_us : 0));
+
+    xSemaphoreTake(g_session.mutex, portMAX_DELAY);
+    append_line(line);
+    xSemaphoreGive(g_session.mutex);
+
+    g_session.started = true;
+    ESP_LOGI(TAG, "Session %lu, manifest %s", (unsigned long)g_session.info.session_id, g_session.info.manifest);
+
+    // A clock kept across a soft reset is anchored right away
+    storage_session_check_clock();
+
+    return ESP_OK;
+}
+
+esp_err_t storage_session_next_filename(const char* tag, char* path, size_t max_len) {
+    if (!tag || strlen(tag) != 2 || !path) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_session.started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(g_session.mutex, portMAX_DELAY);
+
+    // A reused session ID (NVS lost, or 4096 boots later) can meet files
+    // that are still on the card; those numbers are skipped
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    for (uint32_t attempt = 0; attempt <= STORAGE_SESSION_ID_MASK; attempt++) {
+        uint32_t sequence = g_session.sequence++ & STORAGE_SESSION_ID_MASK;
+        snprintf(path, max_len, "%s/%s%03lX%03lX.BIN", CONFIG_SD_MOUNT_POINT, tag,
+                 (unsigned long)(g_session.info.session_id & STORAGE_SESSION_ID_MASK), (unsigned long)sequence);
+
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            ret = ESP_OK;
+            break;
+        }
+    }
+
+    if (ret == ESP_OK) {
+        char line[112];
+        snprintf(line, sizeof(line), "{\"file\":\"%s\",\"stream\":\"%s\",\"mono_us\":%lld}\n",
+                 path + strlen(CONFIG_SD_MOUNT_POINT) + 1, tag, (long long)esp_timer_get_time());
+        append_line(line);
+        g_session.info.files++;
+    } else {
+        ESP_LOGE(TAG, "No free file name left in session %lu", (unsigned long)g_session.info.session_id);
+    }
+
+    xSemaphoreGive(g_session.mutex);
+    return ret;
+}
+
+// Called from the SNTP callback on the network stack's thread; the anchor
+// itself is written by the storage task
+void storage_session_note_sync(const char* source) {
+    g_session.sync_source = source;
+}
+
+// Anchor the monotonic clock to UTC when the clock was just synced or has
+// stepped since the last anchor. Run periodically by the storage task.
+void storage_session_check_clock(void) {
+    if (!g_session.started) {
+        return;
+    }
+
+    int64_t mono_us = esp_timer_get_time();
+    int64_t utc_us = utc_now_us();
+    if (utc_us == 0) {
+        return;
+    }
+
+    const char* source = g_session.sync_source;
+    int64_t offset_us = utc_us - mono_us;
+    if (!source && g_session.info.clock_valid &&
+        llabs(offset_us - g_session.info.utc_offset_us) < STORAGE_SESSION_DRIFT_US) {
+        return;
+    }
+    g_session.sync_source = NULL;
+
+    xSemaphoreTake(g_session.mutex, portMAX_DELAY);
+
+    char line[128];
+    snprintf(line, sizeof(line), "{\"anchor\":%lu,\"mono_us\":%lld,\"utc_us\":%lld,\"source\":\"%s\"}\n",
+             (unsigned long)(g_session.info.anchors + 1), (long long)mono_us, (long long)utc_us,
+             source ? source : "clock");
+    append_line(line);
+
+    g_session.info.anchors++;
+    g_session.info.clock_valid = true;
+    g_session.info.utc_offset_us = offset_us;
+
+    xSemaphoreGive(g_session.mutex);
+
+    ESP_LOGI(TAG, "Clock anchor %lu (%s)", (unsigned long)g_session.info.anchors, source ? source : "clock");
+}
+
+esp_err_t storage_session_get_info(storage_session_info_t* info) {
+    if (!info) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_session.started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(g_session.mutex, portMAX_DELAY);
+    memcpy(info, &g_session.info, sizeof(storage_session_info_t));
+    xSemaphoreGive(g_session.mutex);
+
+    return ESP_OK;
+}
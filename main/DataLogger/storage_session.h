@@ -0,0 +1,60 @@
+#pragma once
+
+#include "esp_err.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-boot logging session. Each boot takes the next session ID (kept in
+// NVS) and appends a manifest, SESS<id>.MAN, next to the log files.
+// Records carry esp_timer microseconds since boot, which mean nothing
+// across reboots or devices; the manifest ties them to UTC with anchor
+// points, (monotonic, UTC) pairs written whenever the wall clock is set or
+// steps. A host maps a record through the last anchor at or before it (the
+// first anchor for records logged before the clock was set).
+//
+// One JSON object per line, each line synced when written:
+//   {"session":26,"device":"a0b1c2d3e4f5","boot_mono_us":812345,"boot_utc_us":0}
+//   {"anchor":1,"mono_us":15234567,"utc_us":1760700000123456,"source":"sntp"}
+//   {"file":"U001A000.BIN","stream":"U0","mono_us":15300000}
+//
+// Log files are named <tag><session><sequence>.BIN, which fits 8.3: the
+// two character stream tag (U0, A1, S0), then the low 12 bits of the
+// session ID and a per-session sequence number, both in hex. Names never
+// depend on the wall clock, so files opened in the same second (or before
+// the clock is set) cannot collide.
+
+// Session Configuration
+#define STORAGE_SESSION_NVS_NAMESPACE   "session"
+#define STORAGE_SESSION_ID_MASK         0xFFF
+#define STORAGE_SESSION_MANIFEST_FMT    CONFIG_SD_MOUNT_POINT "/SESS%03lX.MAN"
+#define STORAGE_SESSION_KEEP            256     // Manifests kept, older ones are removed at boot
+#define STORAGE_SESSION_DRIFT_US        100000  // Clock offset change that adds an anchor
+#define STORAGE_SESSION_VALID_UTC       1577836800  // 2020-01-01, wall clock not set before this
+
+// Session Status
+typedef struct {
+    uint32_t session_id;
+    uint32_t files;             // Log files named in this session
+    uint32_t anchors;
+    bool clock_valid;           // At least one anchor written
+    int64_t utc_offset_us;      // UTC minus monotonic time at the last anchor
+    uint32_t write_errors;      // Manifest lines that could not be written
+    char manifest[32];
+} storage_session_info_t;
+
+// Session Functions
+esp_err_t storage_session_begin(void);
+esp_err_t storage_session_next_filename(const char* tag, char* path, size_t max_len);
+void storage_session_note_sync(const char* source);
+void storage_session_check_clock(void);
+esp_err_t storage_session_get_info(storage_session_info_t* info);
+
+#ifdef __cplusplus
+}
+#endif
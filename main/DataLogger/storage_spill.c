@@ -0,0 +1,468 @@
+#include "storage_spill.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "esp_vfs_fat.h"
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char* TAG = "STORAGE_SPILL";
+
+// Spill State - a ring of segment files. Segments [head, read) are drained
+// and wait for a commit, the drain reads segment read, appends go to tail.
+typedef struct {
+    bool available;
+    wl_handle_t wl_handle;
+    FILE* tail_file;
+    FILE* read_file;            // Segment being drained, NULL while it is the tail
+    uint32_t head;
+    uint32_t read;
+    uint32_t tail;
+    size_t read_offset;
+    size_t write_offset;        // Length of the tail segment
+    uint32_t max_segments;
+    size_t peek_length;         // Length of the record returned by the last peek
+    uint32_t pending_bytes;
+    bool unsynced;              // Appends since the last sync
+    uint64_t last_sync_time;
+    uint32_t mark[2];           // Drain mark last written: segment id, offset
+    storage_spill_stats_t stats;
+} storage_spill_state_t;
+
+static storage_spill_state_t g_spill = {
+    .wl_handle = WL_INVALID_HANDLE
+};
+
+static void segment_path(uint32_t segment, char* path, size_t max_len) {
+    snprintf(path, max_len, STORAGE_SPILL_SEGMENT_FMT, (unsigned long)(segment & STORAGE_SPILL_ID_MASK));
+}
+
+// Read one packed record at offset; returns its total length or 0 if invalid
+static size_t read_record_at(FILE* file, size_t offset, storage_write_request_t* request) {
+    if (fseek(file, offset, SEEK_SET) != 0 ||
+        fread(&request->packet, sizeof(data_packet_t), 1, file) != 1) {
+        return 0;
+    }
+
+    size_t payload_len = request->packet.data_length;
+    if (request->packet.magic != STORAGE_MAGIC_NUMBER || payload_len > STORAGE_MAX_PAYLOAD_LEN ||
+        fread(request->payload, 1, payload_len, file) != payload_len) {
+        return 0;
+    }
+
+    return sizeof(data_packet_t) + payload_len;
+}
+
+// Count the valid records of a segment from start, which is 0 or a drain
+// mark; returns the length they end at (a power cut can tear the last one)
+static size_t scan_segment(FILE* file, size_t start) {
+    storage_write_request_t request;
+    size_t offset = start;
+    size_t length;
+    while ((length = read_record_at(file, offset, &request)) > 0) {
+        offset += length;
+        g_spill.stats.pending_records++;
+    }
+    g_spill.pending_bytes += offset - start;
+    return offset;
+}
+
+// Drain position saved by the last release. Only meaningful while its
+// segment is still the oldest one and long enough to hold it.
+static size_t read_drain_mark(uint32_t first) {
+    uint32_t mark[2] = {0};
+    FILE* file = fopen(STORAGE_SPILL_MARK_FILE, "rb");
+    if (!file) {
+        return 0;
+    }
+    bool valid = fread(mark, sizeof(mark), 1, file) == 1;
+    fclose(file);
+    if (!valid || mark[0] != (first & STORAGE_SPILL_ID_MASK)) {
+        return 0;
+    }
+
+    char path[32];
+    struct stat st;
+    snprintf(path, sizeof(path), STORAGE_SPILL_SEGMENT_FMT, (unsigned long)mark[0]);
+    if (stat(path, &st) != 0 || (size_t)st.st_size < mark[1]) {
+        return 0;
+    }
+    memcpy(g_spill.mark, mark, sizeof(mark));
+    return mark[1];
+}
+
+// Save the drain position after a release: everything before it is
+// committed to the SD card and must not be drained again after a reboot
+static void write_drain_mark(void) {
+    uint32_t mark[2] = { g_spill.read & STORAGE_SPILL_ID_MASK, (uint32_t)g_spill.read_offset };
+    if (memcmp(mark, g_spill.mark, sizeof(mark)) == 0) {
+        return;
+    }
+
+    if (mark[1] == 0) {
+        remove(STORAGE_SPILL_MARK_FILE);
+    } else {
+        FILE* file = fopen(STORAGE_SPILL_MARK_FILE, "wb");
+        if (!file) {
+            return;
+        }
+        bool ok = fwrite(mark, sizeof(mark), 1, file) == 1 && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        fclose(file);
+        if (!ok) {
+            return;
+        }
+    }
+    memcpy(g_spill.mark, mark, sizeof(mark));
+}
+
+// Make segment the new tail. A tail that is still being drained stays open
+// as the read segment.
+static esp_err_t open_tail(uint32_t segment) {
+    storage_spill_sync();
+
+    char path[32];
+    segment_path(segment, path, sizeof(path));
+    FILE* file = fopen(path, "w+b");
+    if (!file) {
+        ESP_LOGE(TAG, "Failed to create %s", path);
+        return ESP_FAIL;
+    }
+
+    if (g_spill.tail_file) {
+        if (g_spill.read == g_spill.tail) {
+            g_spill.read_file = g_spill.tail_file;
+        } else {
+            fclose(g_spill.tail_file);
+        }
+    }
+    g_spill.tail_file = file;
+    g_spill.tail = segment;
+    g_spill.write_offset = 0;
+    g_spill.stats.segments = g_spill.tail - g_spill.head + 1;
+
+    return ESP_OK;
+}
+
+// Drained segment: move the drain to the next one
+static void advance_read_segment(void) {
+    if (g_spill.read_file) {
+        fclose(g_spill.read_file);
+        g_spill.read_file = NULL;
+    }
+    g_spill.read++;
+    g_spill.read_offset = 0;
+
+    // Segments in between may have gone missing; only the tail stays open
+    if (g_spill.read != g_spill.tail) {
+        char path[32];
+        segment_path(g_spill.read, path, sizeof(path));
+        g_spill.read_file = fopen(path, "rb");
+    }
+}
+
+// Find the segments left by a previous run; returns false when there are none
+static bool find_segments(uint32_t* first, uint32_t* last) {
+    DIR* dir = opendir(STORAGE_SPILL_MOUNT_POINT);
+    if (!dir) {
+        return false;
+    }
+
+    bool found = false;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        unsigned long id;
+        char ext[4];
+        if (sscanf(ent->d_name, "SP%6lX.%3s", &id, ext) != 2 || strcmp(ext, "BIN") != 0) {
+            continue;
+        }
+        if (!found || id < *first) {
+            *first = id;
+        }
+        if (!found || id > *last) {
+            *last = id;
+        }
+        found = true;
+    }
+    closedir(dir);
+
+    return found;
+}
+
+esp_err_t storage_spill_init(void) {
+    if (g_spill.available) {
+        return ESP_OK;
+    }
+
+    esp_vfs_fat_mount_config_t mount_config = {
+        .format_if_mount_failed = true,
+        .max_files = 3,         // Read and tail segments, plus the next tail while it is created
+        .allocation_unit_size = CONFIG_WL_SECTOR_SIZE
+    };
+
+    esp_err_t ret = esp_vfs_fat_spiflash_mount_rw_wl(STORAGE_SPILL_MOUNT_POINT, STORAGE_SPILL_PARTITION,
+                                                     &mount_config, &g_spill.wl_handle);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to mount spill partition: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Reopen spill data left by a previous run, otherwise start empty.
+    // The single spill file of older firmware becomes the first segment.
+    uint32_t first = 0;
+    uint32_t last = 0;
+    if (!find_segments(&first, &last)) {
+        char path[32];
+        segment_path(0, path, sizeof(path));
+        rename(STORAGE_SPILL_LEGACY_FILE, path);
+        first = 0;
+        last = 0;
+    }
+
+    g_spill.stats.pending_records = 0;
+    g_spill.pending_bytes = 0;
+    memset(g_spill.mark, 0, sizeof(g_spill.mark));
+    size_t drained = read_drain_mark(first);
+    g_spill.head = first;
+    g_spill.read = first;
+    g_spill.read_offset = drained;
+    g_spill.read_file = NULL;
+    g_spill.tail_file = NULL;
+    g_spill.unsynced = false;
+    size_t spilled_bytes = 0;
+
+    // Older segments are complete; they are only read
+    for (uint32_t segment = first; segment < last; segment++) {
+        char path[32];
+        segment_path(segment, path, sizeof(path));
+        FILE* file = fopen(path, "rb");
+        if (file) {
+            spilled_bytes += scan_segment(file, (segment == first) ? drained : 0);
+            fclose(file);
+        }
+    }
+    if (first != last) {
+        char path[32];
+        segment_path(first, path, sizeof(path));
+        g_spill.read_file = fopen(path, "rb");
+    }
+
+    // The tail takes appends after its last valid record
+    char path[32];
+    segment_path(last, path, sizeof(path));
+    g_spill.tail_file = fopen(path, "r+b");
+    if (!g_spill.tail_file) {
+        g_spill.tail_file = fopen(path, "w+b");
+    }
+    if (!g_spill.tail_file) {
+        ESP_LOGE(TAG, "Failed to open spill segment");
+        if (g_spill.read_file) {
+            fclose(g_spill.read_file);
+            g_spill.read_file = NULL;
+        }
+        esp_vfs_fat_spiflash_unmount_rw_wl(STORAGE_SPILL_MOUNT_POINT, g_spill.wl_handle);
+        g_spill.wl_handle = WL_INVALID_HANDLE;
+        return ESP_FAIL;
+    }
+    g_spill.tail = last;
+    g_spill.write_offset = scan_segment(g_spill.tail_file, (first == last) ? drained : 0);
+    ftruncate(fileno(g_spill.tail_file), g_spill.write_offset);
+    spilled_bytes += g_spill.write_offset;
+    g_spill.stats.segments = last - first + 1;
+
+    uint64_t total_bytes = 0;
+    uint64_t free_bytes = 0;
+    esp_vfs_fat_info(STORAGE_SPILL_MOUNT_POINT, &total_bytes, &free_bytes);
+    size_t usable = (free_bytes + spilled_bytes > STORAGE_SPILL_RESERVE) ?
+                    (size_t)(free_bytes + spilled_bytes - STORAGE_SPILL_RESERVE) : 0;
+    g_spill.max_segments = usable / STORAGE_SPILL_SEGMENT_SIZE;
+
+    g_spill.available = true;
+    ESP_LOGI(TAG, "Spill tier ready: %lu segments of %d bytes, %lu records pending",
+             g_spill.max_segments, STORAGE_SPILL_SEGMENT_SIZE, g_spill.stats.pending_records);
+
+    return ESP_OK;
+}
+
+esp_err_t storage_spill_deinit(void) {
+    if (!g_spill.available) {
+        return ESP_OK;
+    }
+
+    storage_spill_sync();
+    if (g_spill.read_file) {
+        fclose(g_spill.read_file);
+        g_spill.read_file = NULL;
+    }
+    fclose(g_spill.tail_file);
+    g_spill.tail_file = NULL;
+    esp_vfs_fat_spiflash_unmount_rw_wl(STORAGE_SPILL_MOUNT_POINT, g_spill.wl_handle);
+    g_spill.wl_handle = WL_INVALID_HANDLE;
+    g_spill.available = false;
+
+    return ESP_OK;
+}
+
+bool storage_spill_is_available(void) {
+    return g_spill.available;
+}
+
+bool storage_spill_is_empty(void) {
+    return !g_spill.available ||
+           (g_spill.read == g_spill.tail && g_spill.read_offset >= g_spill.write_offset);
+}
+
+esp_err_t storage_spill_append(const uint8_t* records, size_t length, uint32_t record_count) {
+    if (!records || length == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_spill.available || g_spill.max_segments == 0 || length > STORAGE_SPILL_SEGMENT_SIZE) {
+        g_spill.stats.records_dropped += record_count;
+        return ESP_ERR_NO_MEM;
+    }
+
+    // A full tail moves on to the next segment while the ring has room;
+    // drained segments count until release() frees them
+    if (g_spill.write_offset + length > STORAGE_SPILL_SEGMENT_SIZE) {
+        if (g_spill.tail - g_spill.head + 1 >= g_spill.max_segments ||
+            open_tail(g_spill.tail + 1) != ESP_OK) {
+            g_spill.stats.records_dropped += record_count;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if (fseek(g_spill.tail_file, g_spill.write_offset, SEEK_SET) != 0 ||
+        fwrite(records, 1, length, g_spill.tail_file) != length ||
+        fflush(g_spill.tail_file) != 0) {
+        ESP_LOGE(TAG, "Failed to write spill data");
+        g_spill.stats.records_dropped += record_count;
+        // Keep the ring consistent: anything past write_offset is ignored
+        return ESP_FAIL;
+    }
+
+    g_spill.write_offset += length;
+    g_spill.pending_bytes += length;
+    g_spill.stats.pending_records += record_count;
+    g_spill.stats.records_spilled += record_count;
+
+    g_spill.unsynced = true;
+    if (esp_timer_get_time() - g_spill.last_sync_time >= STORAGE_SPILL_SYNC_MS * 1000ULL) {
+        return storage_spill_sync();
+    }
+    return ESP_OK;
+}
+
+esp_err_t storage_spill_sync(void) {
+    if (!g_spill.available || !g_spill.unsynced) {
+        return ESP_OK;
+    }
+
+    g_spill.last_sync_time = esp_timer_get_time();
+    if (fflush(g_spill.tail_file) != 0 || fsync(fileno(g_spill.tail_file)) != 0) {
+        ESP_LOGE(TAG, "Failed to sync spill segment");
+        return ESP_FAIL;
+    }
+    g_spill.unsynced = false;
+    return ESP_OK;
+}
+
+esp_err_t storage_spill_peek(storage_write_request_t* request) {
+    if (!request) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (!storage_spill_is_empty()) {
+        if (g_spill.read == g_spill.tail) {
+            size_t length = read_record_at(g_spill.tail_file, g_spill.read_offset, request);
+            if (length == 0) {
+                ESP_LOGE(TAG, "Corrupt spill record at %zu, discarding %zu bytes",
+                         g_spill.read_offset, g_spill.write_offset - g_spill.read_offset);
+                g_spill.read_offset = g_spill.write_offset;
+                g_spill.pending_bytes = 0;
+                g_spill.stats.pending_records = 0;
+                return ESP_ERR_NOT_FOUND;
+            }
+            g_spill.peek_length = length;
+            request->priority = storage_record_priority(request->packet.data_type);
+            return ESP_OK;
+        }
+
+        // Older segments end at their last valid record
+        size_t length = g_spill.read_file ? read_record_at(g_spill.read_file, g_spill.read_offset, request) : 0;
+        if (length > 0) {
+            g_spill.peek_length = length;
+            request->priority = storage_record_priority(request->packet.data_type);
+            return ESP_OK;
+        }
+        advance_read_segment();
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t storage_spill_consume(void) {
+    if (g_spill.peek_length == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    g_spill.read_offset += g_spill.peek_length;
+    g_spill.pending_bytes -= (g_spill.peek_length < g_spill.pending_bytes) ? g_spill.peek_length : g_spill.pending_bytes;
+    if (g_spill.stats.pending_records > 0) {
+        g_spill.stats.pending_records--;
+    }
+    g_spill.stats.records_drained++;
+    g_spill.stats.bytes_drained += g_spill.peek_length;
+    g_spill.peek_length = 0;
+
+    return ESP_OK;
+}
+
+esp_err_t storage_spill_release(void) {
+    if (!g_spill.available) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Drained segments go; their records are on the SD card now
+    while (g_spill.head != g_spill.read) {
+        char path[32];
+        segment_path(g_spill.head, path, sizeof(path));
+        remove(path);
+        g_spill.head++;
+    }
+
+    // A drained tail starts over, so an idle spill holds no data
+    if (storage_spill_is_empty()) {
+        if (g_spill.write_offset > 0) {
+            fflush(g_spill.tail_file);
+            ftruncate(fileno(g_spill.tail_file), 0);
+        }
+        g_spill.read_offset = 0;
+        g_spill.write_offset = 0;
+        g_spill.pending_bytes = 0;
+        g_spill.stats.pending_records = 0;
+    }
+    g_spill.stats.segments = g_spill.tail - g_spill.head + 1;
+    write_drain_mark();
+
+    return ESP_OK;
+}
+
+void storage_spill_account_drain(uint64_t elapsed_us) {
+    g_spill.stats.drain_time_us += elapsed_us;
+}
+
+esp_err_t storage_spill_get_stats(storage_spill_stats_t* stats) {
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(stats, &g_spill.stats, sizeof(storage_spill_stats_t));
+    stats->available = g_spill.available;
+    stats->capacity_bytes = g_spill.max_segments * STORAGE_SPILL_SEGMENT_SIZE;
+    stats->pending_bytes = g_spill.pending_bytes;
+
+    return ESP_OK;
+}
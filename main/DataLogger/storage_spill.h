@@ -0,0 +1,81 @@
+#pragma once
+
+#include "esp_err.h"
+#include "storage_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Internal-flash spill tier on the wear-levelled flash_test FAT partition.
+// While the SD card is unavailable or stalled, the storage task appends
+// records here (packed data_packet_t + payload, the same layout as a raw
+// chunk body) and drains them back into the SD logs in order once the
+// card recovers. Only the storage task uses these functions.
+//
+// The spill is a ring of segment files, SP<id>.BIN with ids in append
+// order. Records go to the tail segment and are drained from the oldest
+// one; a drained segment is deleted once its records are committed to the
+// SD card, so new records reuse that space while the drain catches up with
+// the tail.
+//
+// Appends are synced to flash at least every STORAGE_SPILL_SYNC_MS, when
+// the storage task goes idle and after every event, so a power cut loses
+// at most that window of spilled records. Each release also syncs a drain
+// mark (DRAINED.DAT, segment and offset), and after a reboot the drain
+// resumes there. Records drained after the last release were not yet
+// committed to the SD card. A reboot drains them again, so the SD logs
+// can hold them twice, each copy with the same timestamp.
+
+// Spill Configuration
+#define STORAGE_SPILL_PARTITION     "flash_test"
+#define STORAGE_SPILL_MOUNT_POINT   "/spill"
+#define STORAGE_SPILL_SEGMENT_FMT   STORAGE_SPILL_MOUNT_POINT "/SP%06lX.BIN"
+#define STORAGE_SPILL_LEGACY_FILE   STORAGE_SPILL_MOUNT_POINT "/SPILL.BIN"  // Single-file spill of older firmware
+#define STORAGE_SPILL_SEGMENT_SIZE  (32 * 1024) // Unit of reuse, holds at least one chunk
+#define STORAGE_SPILL_ID_MASK       0xFFFFFF    // Segment ids in file names (16M segments, far beyond flash endurance)
+#define STORAGE_SPILL_RESERVE       (8 * 1024)  // Free space kept back for FAT metadata
+#define STORAGE_SPILL_MARK_FILE     STORAGE_SPILL_MOUNT_POINT "/DRAINED.DAT"
+#define STORAGE_SPILL_SYNC_MS       200         // Longest time spilled records stay unsynced
+
+// Spill Statistics
+typedef struct {
+    bool available;             // Partition mounted
+    uint32_t capacity_bytes;    // Usable spill space, whole segments
+    uint32_t segments;          // Segment files on flash, drained ones included until released
+    uint32_t pending_bytes;     // Spilled but not yet drained
+    uint32_t pending_records;
+    uint32_t records_spilled;   // Records written to flash
+    uint32_t records_drained;   // Records moved back to the SD card
+    uint32_t records_dropped;   // Records lost because the spill was full
+    uint64_t bytes_drained;
+    uint64_t drain_time_us;     // Time spent draining
+} storage_spill_stats_t;
+
+// Spill Functions
+esp_err_t storage_spill_init(void);
+esp_err_t storage_spill_deinit(void);
+bool storage_spill_is_available(void);
+bool storage_spill_is_empty(void);
+
+// Append packed records (one or more data_packet_t + payload)
+esp_err_t storage_spill_append(const uint8_t* records, size_t length, uint32_t record_count);
+// Sync appended records to flash
+esp_err_t storage_spill_sync(void);
+// Read the oldest spilled record without removing it (priority restored
+// from its type); ESP_ERR_NOT_FOUND when drained
+esp_err_t storage_spill_peek(storage_write_request_t* request);
+// Remove the record returned by the last peek once it is safely on the SD card
+esp_err_t storage_spill_consume(void);
+// Free the space of drained records; call once they are committed to the SD card
+esp_err_t storage_spill_release(void);
+// Note time spent draining (for the drain-rate figure)
+void storage_spill_account_drain(uint64_t elapsed_us);
+
+esp_err_t storage_spill_get_stats(storage_spill_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
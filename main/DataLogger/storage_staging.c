@@ -0,0 +1,188 @@
+#include "storage_staging.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Block of packed records (data_packet_t + payload); records never span blocks
+typedef struct staging_block {
+    struct staging_block* next;
+    uint16_t head;              // Read offset
+    uint16_t tail;              // Write offset
+    uint8_t data[STORAGE_STAGING_BLOCK_SIZE];
+} staging_block_t;
+
+// Per-priority FIFO of blocks
+typedef struct {
+    staging_block_t* first;
+    staging_block_t* last;
+    uint32_t records;
+} staging_fifo_t;
+
+// Staging State
+typedef struct {
+    staging_fifo_t fifos[STORAGE_PRIORITY_LEVELS];
+    staging_block_t* free_list;
+    uint32_t free_blocks;
+    storage_staging_stats_t stats;
+} storage_staging_state_t;
+
+static storage_staging_state_t g_staging = {0};
+
+static staging_block_t* alloc_block(void) {
+    staging_block_t* block = g_staging.free_list;
+    if (block) {
+        g_staging.free_list = block->next;
+        g_staging.free_blocks--;
+    } else {
+        if (g_staging.stats.blocks >= g_staging.stats.block_limit) {
+            return NULL;
+        }
+        block = malloc(sizeof(staging_block_t));
+        if (!block) {
+            return NULL;
+        }
+        g_staging.stats.blocks++;
+        if (g_staging.stats.blocks > g_staging.stats.peak_blocks) {
+            g_staging.stats.peak_blocks = g_staging.stats.blocks;
+        }
+    }
+
+    block->next = NULL;
+    block->head = 0;
+    block->tail = 0;
+    return block;
+}
+
+// Keep emptied blocks for reuse unless the pool is above its limit
+static void release_block(staging_block_t* block) {
+    if (g_staging.stats.blocks > g_staging.stats.block_limit) {
+        free(block);
+        g_staging.stats.blocks--;
+        return;
+    }
+
+    block->next = g_staging.free_list;
+    g_staging.free_list = block;
+    g_staging.free_blocks++;
+}
+
+void storage_staging_init(void) {
+    memset(&g_staging, 0, sizeof(g_staging));
+    g_staging.stats.block_limit = STORAGE_STAGING_MIN_BLOCKS;
+}
+
+void storage_staging_deinit(void) {
+    for (int level = 0; level < STORAGE_PRIORITY_LEVELS; level++) {
+        staging_block_t* block = g_staging.fifos[level].first;
+        while (block) {
+            staging_block_t* next = block->next;
+            free(block);
+            block = next;
+        }
+    }
+
+    staging_block_t* block = g_staging.free_list;
+    while (block) {
+        staging_block_t* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    memset(&g_staging, 0, sizeof(g_staging));
+}
+
+esp_err_t storage_staging_push(storage_priority_t level, const storage_write_request_t* request) {
+    if (level >= STORAGE_PRIORITY_LEVELS || !request) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    staging_fifo_t* fifo = &g_staging.fifos[level];
+    size_t payload_len = request->packet.data_length;
+    size_t record_len = sizeof(data_packet_t) + payload_len;
+
+    staging_block_t* block = fifo->last;
+    if (!block || block->tail + record_len > STORAGE_STAGING_BLOCK_SIZE) {
+        staging_block_t* next = alloc_block();
+        if (!next) {
+            g_staging.stats.records_rejected++;
+            return ESP_ERR_NO_MEM;
+        }
+        if (block) {
+            block->next = next;
+        } else {
+            fifo->first = next;
+        }
+        fifo->last = next;
+        block = next;
+    }
+
+    memcpy(block->data + block->tail, &request->packet, sizeof(data_packet_t));
+    memcpy(block->data + block->tail + sizeof(data_packet_t), request->payload, payload_len);
+    block->tail += record_len;
+
+    fifo->records++;
+    g_staging.stats.records++;
+    g_staging.stats.records_staged++;
+
+    return ESP_OK;
+}
+
+bool storage_staging_pop(storage_priority_t level, storage_write_request_t* request) {
+    if (level >= STORAGE_PRIORITY_LEVELS || !request || g_staging.fifos[level].records == 0) {
+        return false;
+    }
+
+    staging_fifo_t* fifo = &g_staging.fifos[level];
+    staging_block_t* block = fifo->first;
+
+    memcpy(&request->packet, block->data + block->head, sizeof(data_packet_t));
+    memcpy(request->payload, block->data + block->head + sizeof(data_packet_t), request->packet.data_length);
+    request->priority = level;
+    block->head += sizeof(data_packet_t) + request->packet.data_length;
+
+    fifo->records--;
+    g_staging.stats.records--;
+
+    if (block->head == block->tail) {
+        fifo->first = block->next;
+        if (!fifo->first) {
+            fifo->last = NULL;
+        }
+        release_block(block);
+    }
+
+    return true;
+}
+
+uint32_t storage_staging_pending(storage_priority_t level) {
+    return (level < STORAGE_PRIORITY_LEVELS) ? g_staging.fifos[level].records : 0;
+}
+
+// Share of the current limit holding records
+uint32_t storage_staging_usage_pct(void) {
+    uint32_t in_use = g_staging.stats.blocks - g_staging.free_blocks;
+    return in_use * 100 / g_staging.stats.block_limit;
+}
+
+void storage_staging_set_limit(uint32_t blocks) {
+    if (blocks < STORAGE_STAGING_MIN_BLOCKS) {
+        blocks = STORAGE_STAGING_MIN_BLOCKS;
+    } else if (blocks > STORAGE_STAGING_BUDGET_BLOCKS) {
+        blocks = STORAGE_STAGING_BUDGET_BLOCKS;
+    }
+    g_staging.stats.block_limit = blocks;
+
+    // Shrink: free spare blocks now, blocks in use as they empty
+    while (g_staging.stats.blocks > blocks && g_staging.free_list) {
+        staging_block_t* block = g_staging.free_list;
+        g_staging.free_list = block->next;
+        g_staging.free_blocks--;
+        free(block);
+        g_staging.stats.blocks--;
+    }
+}
+
+void storage_staging_get_stats(storage_staging_stats_t* stats) {
+    if (stats) {
+        memcpy(stats, &g_staging.stats, sizeof(storage_staging_stats_t));
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "esp_err.h"
+#include "storage_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// RAM staging pool behind the storage write queues. When a priority queue
+// is full (typically during an SD card stall) records overflow into a FIFO
+// of heap blocks for that level instead of being dropped, and the storage
+// task moves them back into the queue as it catches up. The pool grows on
+// demand up to a limit that the storage manager adapts to the observed
+// card latency, and idle blocks above the limit are freed.
+//
+// Not thread-safe: the storage manager serialises all calls.
+
+// Staging Configuration
+#define STORAGE_STAGING_BLOCK_SIZE      4096
+#define STORAGE_STAGING_BUDGET_BLOCKS   16     // RAM budget, 64 KB
+#define STORAGE_STAGING_MIN_BLOCKS      2      // Limit never drops below this
+
+// Staging Statistics
+typedef struct {
+    uint32_t blocks;            // Blocks allocated (in use or free)
+    uint32_t block_limit;       // Current allocation limit
+    uint32_t peak_blocks;       // Most blocks ever allocated
+    uint32_t records;           // Records waiting in the pool
+    uint32_t records_staged;    // Records that overflowed into the pool
+    uint32_t records_rejected;  // Records refused because the pool was at its limit
+} storage_staging_stats_t;
+
+// Staging Functions
+void storage_staging_init(void);
+void storage_staging_deinit(void);
+esp_err_t storage_staging_push(storage_priority_t level, const storage_write_request_t* request);
+bool storage_staging_pop(storage_priority_t level, storage_write_request_t* request);
+uint32_t storage_staging_pending(storage_priority_t level);
+uint32_t storage_staging_usage_pct(void);
+void storage_staging_set_limit(uint32_t blocks);
+void storage_staging_get_stats(storage_staging_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
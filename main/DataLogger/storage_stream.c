@@ -0,0 +1,152 @@
+#include "storage_stream.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Stream layout: UART ports, then ADC channel groups, then system events
+#define STREAM_FIRST_UART   0
+#define STREAM_FIRST_ADC    (STREAM_FIRST_UART + STORAGE_UART_STREAMS)
+#define STREAM_SYSTEM       (STREAM_FIRST_ADC + STORAGE_ADC_STREAMS)
+
+// Stream State
+typedef struct {
+    storage_chunk_t* free_list;
+    storage_chunk_t* ready_first;
+    storage_chunk_t* ready_last;
+    char prefixes[STORAGE_STREAM_COUNT][8];
+    storage_stream_stats_t stats;
+} storage_stream_state_t;
+
+static storage_stream_state_t g_streams = {0};
+
+void storage_stream_init(void) {
+    memset(&g_streams, 0, sizeof(g_streams));
+
+    for (int port = 0; port < STORAGE_UART_STREAMS; port++) {
+        snprintf(g_streams.prefixes[STREAM_FIRST_UART + port], sizeof(g_streams.prefixes[0]), "U%d", port);
+    }
+    for (int group = 0; group < STORAGE_ADC_STREAMS; group++) {
+        snprintf(g_streams.prefixes[STREAM_FIRST_ADC + group], sizeof(g_streams.prefixes[0]), "A%d", group);
+    }
+    strcpy(g_streams.prefixes[STREAM_SYSTEM], "S0");
+}
+
+void storage_stream_deinit(void) {
+    storage_chunk_t* lists[2] = {g_streams.free_list, g_streams.ready_first};
+    for (int i = 0; i < 2; i++) {
+        storage_chunk_t* chunk = lists[i];
+        while (chunk) {
+            storage_chunk_t* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+    }
+
+    memset(&g_streams, 0, sizeof(g_streams));
+}
+
+uint8_t storage_stream_id(uint8_t data_type, uint8_t source_id) {
+    switch (data_type) {
+        case DATA_TYPE_UART:
+            return (source_id < STORAGE_UART_STREAMS) ? STREAM_FIRST_UART + source_id : STORAGE_STREAM_NONE;
+        case DATA_TYPE_ADC:
+            return (source_id < CONFIG_ADC_CHANNEL_COUNT) ?
+                STREAM_FIRST_ADC + source_id / STORAGE_ADC_STREAM_CHANNELS : STORAGE_STREAM_NONE;
+        default:
+            return STREAM_SYSTEM;
+    }
+}
+
+// Catalog type and source of a stream (ADC streams report their group)
+void storage_stream_source(uint8_t stream, uint8_t* data_type, uint8_t* source_id) {
+    if (stream < STREAM_FIRST_ADC) {
+        *data_type = DATA_TYPE_UART;
+        *source_id = stream - STREAM_FIRST_UART;
+    } else if (stream < STREAM_SYSTEM) {
+        *data_type = DATA_TYPE_ADC;
+        *source_id = stream - STREAM_FIRST_ADC;
+    } else {
+        *data_type = DATA_TYPE_SYSTEM;
+        *source_id = 0;
+    }
+}
+
+const char* storage_stream_prefix(uint8_t stream) {
+    return (stream < STORAGE_STREAM_COUNT) ? g_streams.prefixes[stream] : "S0";
+}
+
+storage_chunk_t* storage_chunk_get(uint8_t stream) {
+    storage_chunk_t* chunk = g_streams.free_list;
+    if (chunk) {
+        g_streams.free_list = chunk->next;
+    } else {
+        if (g_streams.stats.buffers >= STORAGE_CHUNK_POOL_SIZE) {
+            return NULL;
+        }
+        chunk = malloc(sizeof(storage_chunk_t));
+        if (!chunk) {
+            return NULL;
+        }
+        g_streams.stats.buffers++;
+        if (g_streams.stats.buffers > g_streams.stats.peak_buffers) {
+            g_streams.stats.peak_buffers = g_streams.stats.buffers;
+        }
+    }
+
+    chunk->next = NULL;
+    chunk->stream = stream;
+    chunk->used = 0;
+    chunk->records = 0;
+    return chunk;
+}
+
+void storage_chunk_put(storage_chunk_t* chunk) {
+    if (chunk) {
+        chunk->next = g_streams.free_list;
+        g_streams.free_list = chunk;
+    }
+}
+
+void storage_chunk_ready(storage_chunk_t* chunk) {
+    chunk->next = NULL;
+    if (g_streams.ready_last) {
+        g_streams.ready_last->next = chunk;
+    } else {
+        g_streams.ready_first = chunk;
+    }
+    g_streams.ready_last = chunk;
+    g_streams.stats.ready++;
+}
+
+storage_chunk_t* storage_chunk_peek_ready(void) {
+    return g_streams.ready_first;
+}
+
+void storage_chunk_pop_ready(void) {
+    storage_chunk_t* chunk = g_streams.ready_first;
+    if (!chunk) {
+        return;
+    }
+
+    g_streams.ready_first = chunk->next;
+    if (!g_streams.ready_first) {
+        g_streams.ready_last = NULL;
+    }
+    chunk->next = NULL;
+    g_streams.stats.ready--;
+}
+
+uint32_t storage_chunk_ready_count(void) {
+    return g_streams.stats.ready;
+}
+
+void storage_stream_account_batch(uint32_t chunks) {
+    g_streams.stats.batches++;
+    g_streams.stats.batched_chunks += chunks;
+}
+
+void storage_stream_get_stats(storage_stream_stats_t* stats) {
+    if (stats) {
+        memcpy(stats, &g_streams.stats, sizeof(storage_stream_stats_t));
+    }
+}
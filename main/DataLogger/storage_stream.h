@@ -0,0 +1,69 @@
+#pragma once
+
+#include "esp_err.h"
+#include "storage_manager.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-source streams. Each UART port, each group of STORAGE_ADC_STREAM_CHANNELS
+// ADC channels and the system events form a stream with its own log file.
+// The stream of a record follows from its type and source, so the storage
+// task finds a record's file by indexing, not by searching.
+//
+// Streams stage records in chunk buffers drawn from one shared pool. Full
+// chunks go on a ready list, oldest first, and the storage task writes a
+// batch of them (from any streams) in one writer pass. An idle stream
+// holds no buffer once its open chunk has been committed.
+//
+// Not thread-safe: only the storage task uses these functions.
+
+// Stream Configuration
+#define STORAGE_STREAM_NONE         0xFF
+#define STORAGE_CHUNK_POOL_SIZE     (STORAGE_STREAM_COUNT + STORAGE_WRITE_BATCH)
+
+// Chunk buffer: packed data_packet_t + payload records for one stream
+typedef struct storage_chunk {
+    struct storage_chunk* next;
+    uint8_t stream;
+    uint16_t used;              // Bytes staged
+    uint16_t records;           // Records staged
+    uint16_t last_record;       // Offset of the newest record
+    uint8_t data[STORAGE_CHUNK_SIZE];
+} storage_chunk_t;
+
+// Stream Statistics
+typedef struct {
+    uint32_t buffers;           // Chunk buffers allocated (in use or free)
+    uint32_t peak_buffers;
+    uint32_t ready;             // Full chunks waiting for the writer
+    uint32_t batches;           // Writer passes
+    uint32_t batched_chunks;    // Chunks written by writer passes
+} storage_stream_stats_t;
+
+// Stream Functions
+void storage_stream_init(void);
+void storage_stream_deinit(void);
+uint8_t storage_stream_id(uint8_t data_type, uint8_t source_id);
+void storage_stream_source(uint8_t stream, uint8_t* data_type, uint8_t* source_id);
+const char* storage_stream_prefix(uint8_t stream);
+
+// Chunk Pool; storage_chunk_get returns NULL once all buffers are in use
+storage_chunk_t* storage_chunk_get(uint8_t stream);
+void storage_chunk_put(storage_chunk_t* chunk);
+
+// Ready List: full chunks in the order they filled up
+void storage_chunk_ready(storage_chunk_t* chunk);
+storage_chunk_t* storage_chunk_peek_ready(void);
+void storage_chunk_pop_ready(void);
+uint32_t storage_chunk_ready_count(void);
+
+void storage_stream_account_batch(uint32_t chunks);
+void storage_stream_get_stats(storage_stream_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,418 @@
+#include "stream_fanout.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* TAG = "STREAM_FANOUT";
+
+// Queue entry; the generation tells the sender whether the message was
+// queued for the client that holds the slot now
+typedef struct {
+    stream_message_t* message;
+    uint32_t generation;
+} fanout_item_t;
+
+typedef struct {
+    bool active;
+    int fd;
+    uint32_t generation;        // Bumped whenever a client joins or leaves the slot
+    stream_subscription_t subscription;
+    const stream_transport_t* transport;
+    void* ctx;
+    QueueHandle_t queue;
+    TaskHandle_t task;
+    uint64_t full_since_us;     // First publish that found the queue full, 0 while it has room
+    uint64_t latency_total_us;
+    stream_client_stats_t stats;
+
+    // Client that left, waiting for its sender task to release it; the
+    // slot is not reused until then
+    bool release_pending;
+    const stream_transport_t* release_transport;
+    void* release_ctx;
+    int release_fd;
+} fanout_client_t;
+
+typedef struct {
+    bool initialized;
+    SemaphoreHandle_t mutex;
+    fanout_client_t clients[STREAM_FANOUT_MAX_CLIENTS];
+    uint32_t published;
+    uint32_t evictions;
+    uint32_t alloc_failures;
+} stream_fanout_state_t;
+
+static stream_fanout_state_t g_fanout = {0};
+
+stream_message_t* stream_message_create(stream_encoding_t encoding, size_t capacity) {
+    stream_message_t* message = malloc(sizeof(stream_message_t) + capacity);
+    if (!message) {
+        g_fanout.alloc_failures++;
+        return NULL;
+    }
+
+    message->refs = 1;
+    message->created_us = 0;
+    message->encoding = encoding;
+    message->length = 0;
+    message->capacity = capacity;
+    return message;
+}
+
+void stream_message_release(stream_message_t* message) {
+    if (message && __atomic_sub_fetch(&message->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(message);
+    }
+}
+
+static void deactivate(fanout_client_t* client) {
+    if (client->active && client->transport->release) {
+        client->release_pending = true;
+        client->release_transport = client->transport;
+        client->release_ctx = client->ctx;
+        client->release_fd = client->fd;
+
+        // Wake the sender task; a full queue wakes it anyway
+        fanout_item_t wake = {.message = NULL};
+        xQueueSend(client->queue, &wake, 0);
+    }
+    client->active = false;
+    client->generation++;
+    client->full_since_us = 0;
+}
+
+// One per slot. Blocks in the transport send for as long as the client
+// needs; the other slots keep draining meanwhile.
+static void sender_task(void* pvParameters) {
+    fanout_client_t* client = (fanout_client_t*)pvParameters;
+    fanout_item_t item;
+
+    while (1) {
+        if (xQueueReceive(client->queue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        // No send for the client is in flight here, so its transport may free it
+        xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+        const stream_transport_t* released = NULL;
+        void* released_ctx = NULL;
+        int released_fd = -1;
+        if (client->release_pending) {
+            released = client->release_transport;
+            released_ctx = client->release_ctx;
+            released_fd = client->release_fd;
+        }
+        xSemaphoreGive(g_fanout.mutex);
+
+        if (released) {
+            released->release(released_ctx, released_fd);
+            xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+            client->release_pending = false;
+            xSemaphoreGive(g_fanout.mutex);
+        }
+        if (!item.message) {
+            continue;
+        }
+
+        xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+        bool current = client->active && item.generation == client->generation;
+        const stream_transport_t* transport = client->transport;
+        void* ctx = client->ctx;
+        int fd = client->fd;
+        if (current && esp_timer_get_time() - item.message->created_us > STREAM_FANOUT_STALE_MS * 1000LL) {
+            client->stats.stale++;
+            current = false;
+        }
+        xSemaphoreGive(g_fanout.mutex);
+
+        if (!current) {
+            stream_message_release(item.message);
+            continue;
+        }
+
+        esp_err_t ret = transport->send(ctx, fd, item.message);
+        uint32_t latency_us = (uint32_t)(esp_timer_get_time() - item.message->created_us);
+
+        xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+        if (item.generation == client->generation) {
+            if (ret == ESP_OK) {
+                client->stats.sent++;
+                client->stats.bytes += item.message->length;
+                client->latency_total_us += latency_us;
+                if (latency_us > client->stats.latency_max_us) {
+                    client->stats.latency_max_us = latency_us;
+                }
+            } else {
+                ESP_LOGW(TAG, "Client fd %d send failed (%s), removing", fd, esp_err_to_name(ret));
+                client->stats.send_errors++;
+                deactivate(client);
+            }
+        }
+        xSemaphoreGive(g_fanout.mutex);
+
+        stream_message_release(item.message);
+    }
+}
+
+esp_err_t stream_fanout_init(void) {
+    if (g_fanout.initialized) {
+        return ESP_OK;
+    }
+
+    g_fanout.mutex = xSemaphoreCreateMutex();
+    if (!g_fanout.mutex) {
+        ESP_LOGE(TAG, "Failed to create fan-out mutex");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        fanout_client_t* client = &g_fanout.clients[i];
+        client->fd = -1;
+        client->queue = xQueueCreate(STREAM_FANOUT_QUEUE_DEPTH, sizeof(fanout_item_t));
+        if (!client->queue) {
+            ESP_LOGE(TAG, "Failed to create queue for client slot %d", i);
+            return ESP_ERR_NO_MEM;
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "stream_tx%d", i);
+        if (xTaskCreate(sender_task, name, STREAM_FANOUT_TASK_STACK, client,
+                        STREAM_FANOUT_TASK_PRIORITY, &client->task) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create sender task for client slot %d", i);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    g_fanout.initialized = true;
+    ESP_LOGI(TAG, "Stream fan-out ready: %d clients, %d messages each",
+             STREAM_FANOUT_MAX_CLIENTS, STREAM_FANOUT_QUEUE_DEPTH);
+    return ESP_OK;
+}
+
+// Register a client. Returns its slot, or -1 when all slots are taken.
+int stream_fanout_add_client(const stream_transport_t* transport, void* ctx, int fd,
+                             const stream_subscription_t* subscription) {
+    if (!g_fanout.initialized || !transport || !transport->send || !subscription) {
+        return -1;
+    }
+
+    int slot = -1;
+    xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        fanout_client_t* client = &g_fanout.clients[i];
+        if (client->active && client->fd == fd) {
+            // Socket number reused before the old session was reported closed
+            deactivate(client);
+        }
+        if (!client->active && !client->release_pending && slot < 0) {
+            slot = i;
+        }
+    }
+
+    if (slot >= 0) {
+        fanout_client_t* client = &g_fanout.clients[slot];
+        client->generation++;
+        client->active = true;
+        client->fd = fd;
+        client->subscription = *subscription;
+        client->transport = transport;
+        client->ctx = ctx;
+        client->full_since_us = 0;
+        client->latency_total_us = 0;
+        memset(&client->stats, 0, sizeof(stream_client_stats_t));
+    }
+    xSemaphoreGive(g_fanout.mutex);
+
+    return slot;
+}
+
+// Forget a closed connection. Messages still queued for it are released
+// by its sender task. Unknown descriptors are ignored.
+void stream_fanout_remove_client(int fd) {
+    if (!g_fanout.initialized) {
+        return;
+    }
+
+    xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        fanout_client_t* client = &g_fanout.clients[i];
+        if (client->active && client->fd == fd) {
+            deactivate(client);
+            ESP_LOGI(TAG, "Client fd %d removed from slot %d", fd, i);
+        }
+    }
+    xSemaphoreGive(g_fanout.mutex);
+}
+
+// Replace the subscription of a connected client. Returns its slot, or -1
+// when the descriptor is not a stream client.
+int stream_fanout_set_subscription(int fd, const stream_subscription_t* subscription) {
+    if (!g_fanout.initialized || !subscription) {
+        return -1;
+    }
+
+    int slot = -1;
+    xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        if (g_fanout.clients[i].active && g_fanout.clients[i].fd == fd) {
+            g_fanout.clients[i].subscription = *subscription;
+            slot = i;
+            break;
+        }
+    }
+    xSemaphoreGive(g_fanout.mutex);
+
+    return slot;
+}
+
+int stream_fanout_get_subscription(int fd, stream_subscription_t* subscription) {
+    if (!g_fanout.initialized || !subscription) {
+        return -1;
+    }
+
+    int slot = -1;
+    xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        if (g_fanout.clients[i].active && g_fanout.clients[i].fd == fd) {
+            *subscription = g_fanout.clients[i].subscription;
+            slot = i;
+            break;
+        }
+    }
+    xSemaphoreGive(g_fanout.mutex);
+
+    return slot;
+}
+
+// Snapshot of every subscription. Returns the mask of active slots; only
+// their entries are filled in.
+uint32_t stream_fanout_get_subscriptions(stream_subscription_t subscriptions[STREAM_FANOUT_MAX_CLIENTS]) {
+    if (!g_fanout.initialized) {
+        return 0;
+    }
+
+    uint32_t active = 0;
+    xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        if (g_fanout.clients[i].active) {
+            subscriptions[i] = g_fanout.clients[i].subscription;
+            active |= 1 << i;
+        }
+    }
+    xSemaphoreGive(g_fanout.mutex);
+
+    return active;
+}
+
+// Queue a message to the clients in the slot mask. Takes over the caller's
+// reference. Returns the number of clients it was queued for.
+uint32_t stream_fanout_publish(stream_message_t* message, uint32_t clients) {
+    if (!message) {
+        return 0;
+    }
+    if (!g_fanout.initialized) {
+        stream_message_release(message);
+        return 0;
+    }
+
+    int evicted[STREAM_FANOUT_MAX_CLIENTS];
+    const stream_transport_t* evicted_transport[STREAM_FANOUT_MAX_CLIENTS];
+    void* evicted_ctx[STREAM_FANOUT_MAX_CLIENTS];
+    int evicted_count = 0;
+    uint32_t queued = 0;
+
+    uint64_t now = esp_timer_get_time();
+    message->created_us = now;
+
+    xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+    g_fanout.published++;
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        fanout_client_t* client = &g_fanout.clients[i];
+        if (!client->active || !(clients & (1 << i))) {
+            continue;
+        }
+
+        fanout_item_t item = {.message = message, .generation = client->generation};
+        __atomic_add_fetch(&message->refs, 1, __ATOMIC_RELAXED);
+        if (xQueueSend(client->queue, &item, 0) == pdTRUE) {
+            client->full_since_us = 0;
+            queued++;
+            continue;
+        }
+
+        // Queue full: the client is at least a whole queue behind
+        if (client->full_since_us == 0) {
+            client->full_since_us = now;
+        } else if (now - client->full_since_us >= STREAM_FANOUT_EVICT_MS * 1000ULL) {
+            ESP_LOGW(TAG, "Client fd %d backlogged for %d ms, evicting", client->fd, STREAM_FANOUT_EVICT_MS);
+            evicted[evicted_count] = client->fd;
+            evicted_transport[evicted_count] = client->transport;
+            evicted_ctx[evicted_count] = client->ctx;
+            evicted_count++;
+            g_fanout.evictions++;
+            deactivate(client);
+            stream_message_release(message);
+            continue;
+        }
+
+        // Drop the oldest message so the newest one goes out first
+        fanout_item_t oldest;
+        if (xQueueReceive(client->queue, &oldest, 0) == pdTRUE) {
+            if (oldest.generation == client->generation) {
+                client->stats.dropped++;
+            }
+            stream_message_release(oldest.message);
+        }
+        if (xQueueSend(client->queue, &item, 0) == pdTRUE) {
+            queued++;
+        } else {
+            client->stats.dropped++;
+            stream_message_release(message);
+        }
+    }
+    xSemaphoreGive(g_fanout.mutex);
+
+    // The transport may call back into remove_client, so close unlocked
+    for (int i = 0; i < evicted_count; i++) {
+        if (evicted_transport[i]->close) {
+            evicted_transport[i]->close(evicted_ctx[i], evicted[i]);
+        }
+    }
+
+    stream_message_release(message);
+    return queued;
+}
+
+esp_err_t stream_fanout_get_stats(stream_fanout_stats_t* stats) {
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!g_fanout.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(g_fanout.mutex, portMAX_DELAY);
+    stats->published = g_fanout.published;
+    stats->evictions = g_fanout.evictions;
+    stats->alloc_failures = g_fanout.alloc_failures;
+    for (int i = 0; i < STREAM_FANOUT_MAX_CLIENTS; i++) {
+        fanout_client_t* client = &g_fanout.clients[i];
+        stats->clients[i] = client->stats;
+        stats->clients[i].active = client->active;
+        stats->clients[i].fd = client->fd;
+        stats->clients[i].transport = client->transport ? client->transport->name : NULL;
+        stats->clients[i].subscription = client->subscription;
+        stats->clients[i].queued = uxQueueMessagesWaiting(client->queue);
+        stats->clients[i].latency_avg_us = client->stats.sent ?
+            (uint32_t)(client->latency_total_us / client->stats.sent) : 0;
+    }
+    xSemaphoreGive(g_fanout.mutex);
+
+    return ESP_OK;
+}
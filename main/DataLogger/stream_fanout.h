@@ -0,0 +1,122 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Fan-out of live stream messages to network clients. A message is
+// encoded once into a reference-counted buffer and queued by pointer to
+// every client it is published for. Each client slot has its own
+// bounded queue and sender task, so a client stuck in a blocking send only
+// backs up its own queue and never delays the others.
+//
+// Publishing never blocks. A full queue gives up its oldest message to
+// take the new one (counted as dropped), the sender skips messages older
+// than STREAM_FANOUT_STALE_MS (counted as stale) so a lagging client jumps
+// back to live data, and a client whose queue stays full for
+// STREAM_FANOUT_EVICT_MS is closed through its transport.
+//
+// Every client also holds its subscription: what it wants to receive and
+// how. Producers read the subscriptions, encode once per distinct one and
+// publish each message to the slots that asked for it.
+
+// Fan-out Configuration
+#define STREAM_FANOUT_MAX_CLIENTS       4
+#define STREAM_FANOUT_QUEUE_DEPTH       8      // Messages per client
+#define STREAM_FANOUT_STALE_MS          500    // Older messages are skipped, not sent
+#define STREAM_FANOUT_EVICT_MS          5000   // Queue full this long: client is closed
+#define STREAM_FANOUT_TASK_STACK        3072
+#define STREAM_FANOUT_TASK_PRIORITY     4
+
+// Message encodings; a client receives one of them
+typedef enum {
+    STREAM_ENCODING_JSON = 0,
+    STREAM_ENCODING_BINARY,
+    STREAM_ENCODING_COUNT
+} stream_encoding_t;
+
+// How ADC scans are thinned to the subscribed rate
+typedef enum {
+    STREAM_REDUCE_LATEST = 0,   // Newest scan of each batch window
+    STREAM_REDUCE_DECIMATE,     // First scan of every period
+    STREAM_REDUCE_MINMAX,       // Minimum and maximum of every period
+    STREAM_REDUCE_COUNT
+} stream_reduce_t;
+
+// What a client receives
+typedef struct {
+    uint8_t adc_channels;       // Bit n: ADC channel n
+    uint8_t uart_ports;         // Bit n: UART port n
+    uint16_t rate_hz;           // Periods per second, 0 for every scan
+    stream_reduce_t reduce;
+    stream_encoding_t encoding;
+} stream_subscription_t;
+
+// Shared message, read-only once published
+typedef struct {
+    uint32_t refs;              // Publisher plus every queue holding it
+    uint64_t created_us;        // Publish time, for latency and staleness
+    stream_encoding_t encoding; // Binary or text payload
+    size_t length;
+    size_t capacity;
+    uint8_t data[];
+} stream_message_t;
+
+// Client transport. send runs on the client's sender task and may block;
+// close asks the server to drop an evicted connection. release (optional)
+// also runs on the sender task, once the slot is done with ctx after a
+// failed send, an eviction or a removal, so the transport can free it.
+typedef struct {
+    const char* name;           // Shown in the statistics
+    esp_err_t (*send)(void* ctx, int fd, const stream_message_t* message);
+    void (*close)(void* ctx, int fd);
+    void (*release)(void* ctx, int fd);
+} stream_transport_t;
+
+// Client Statistics (reset when a client takes the slot)
+typedef struct {
+    bool active;
+    int fd;
+    const char* transport;
+    stream_subscription_t subscription;
+    uint32_t queued;            // Messages waiting now
+    uint32_t sent;
+    uint32_t dropped;           // Pushed out of a full queue
+    uint32_t stale;             // Skipped by the sender as too old
+    uint32_t send_errors;
+    uint64_t bytes;
+    uint32_t latency_avg_us;    // Publish to send complete
+    uint32_t latency_max_us;
+} stream_client_stats_t;
+
+// Fan-out Statistics
+typedef struct {
+    uint32_t published;
+    uint32_t evictions;
+    uint32_t alloc_failures;
+    stream_client_stats_t clients[STREAM_FANOUT_MAX_CLIENTS];
+} stream_fanout_stats_t;
+
+// Fan-out Functions
+esp_err_t stream_fanout_init(void);
+int stream_fanout_add_client(const stream_transport_t* transport, void* ctx, int fd,
+                             const stream_subscription_t* subscription);
+void stream_fanout_remove_client(int fd);
+int stream_fanout_set_subscription(int fd, const stream_subscription_t* subscription);
+int stream_fanout_get_subscription(int fd, stream_subscription_t* subscription);
+uint32_t stream_fanout_get_subscriptions(stream_subscription_t subscriptions[STREAM_FANOUT_MAX_CLIENTS]);
+esp_err_t stream_fanout_get_stats(stream_fanout_stats_t* stats);
+
+// Message Functions
+stream_message_t* stream_message_create(stream_encoding_t encoding, size_t capacity);
+void stream_message_release(stream_message_t* message);
+uint32_t stream_fanout_publish(stream_message_t* message, uint32_t clients);
+
+#ifdef __cplusplus
+}
+#endif
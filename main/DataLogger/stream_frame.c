@@ -0,0 +1,109 @@
+#include "stream_frame.h"
+#include <string.h>
+#include <math.h>
+
+void stream_batch_reset(stream_batch_t* batch) {
+    uint32_t sequence = batch->sequence;
+    memset(batch, 0, sizeof(stream_batch_t));
+    batch->sequence = sequence;
+}
+
+int16_t stream_frame_millivolts(float voltage) {
+    long millivolts = lroundf(voltage * 1000.0f);
+    if (millivolts > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (millivolts < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)millivolts;
+}
+
+// Add one value. Returns false when the value starts a new scan and the
+// batch is already full; encode the batch and add it again.
+bool stream_batch_put(stream_batch_t* batch, uint8_t channel, uint64_t timestamp_us, int16_t millivolts) {
+    if (channel >= CONFIG_ADC_CHANNEL_COUNT) {
+        return true;
+    }
+
+    if (batch->rows == 0) {
+        batch->rows = 1;
+        batch->first_timestamp_us = timestamp_us;
+        batch->last_timestamp_us = timestamp_us;
+    } else if (timestamp_us != batch->last_timestamp_us) {
+        if (batch->rows >= STREAM_FRAME_MAX_SAMPLES) {
+            return false;
+        }
+
+        // A channel missing from a scan repeats its previous value
+        for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+            batch->millivolts[ch][batch->rows] = batch->millivolts[ch][batch->rows - 1];
+        }
+        batch->rows++;
+        batch->row_mask = 0;
+        batch->last_timestamp_us = timestamp_us;
+    }
+
+    uint8_t bit = 1 << channel;
+    int16_t* block = batch->millivolts[channel];
+
+    // A channel first seen mid-batch takes its first value for the earlier scans
+    if (!(batch->channel_mask & bit)) {
+        for (int row = 0; row < batch->rows - 1; row++) {
+            block[row] = millivolts;
+        }
+        batch->channel_mask |= bit;
+    }
+
+    block[batch->rows - 1] = millivolts;
+    batch->row_mask |= bit;
+    return true;
+}
+
+// Add one sample of the ADC stream tap, same rules as stream_batch_put
+bool stream_batch_add(stream_batch_t* batch, const adc_data_packet_t* packet) {
+    return stream_batch_put(batch, packet->channel, packet->timestamp_us,
+                            stream_frame_millivolts(packet->filtered_voltage));
+}
+
+// Encode the batch as one frame and start the next batch. Returns the
+// frame length, 0 when the batch is empty or the frame does not fit.
+size_t stream_batch_encode(stream_batch_t* batch, uint8_t* out, size_t max_len) {
+    if (batch->rows == 0) {
+        return 0;
+    }
+
+    size_t block_size = batch->rows * sizeof(int16_t);
+    size_t length = sizeof(stream_frame_header_t);
+    for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+        if (batch->channel_mask & (1 << ch)) {
+            length += block_size;
+        }
+    }
+    if (length > max_len) {
+        return 0;
+    }
+
+    stream_frame_header_t header = {
+        .magic = STREAM_FRAME_MAGIC,
+        .version = STREAM_FRAME_VERSION,
+        .channel_mask = batch->channel_mask,
+        .samples = batch->rows,
+        .sequence = batch->sequence++,
+        .base_timestamp_us = batch->first_timestamp_us,
+        .interval_us = (batch->rows > 1) ?
+            (uint32_t)((batch->last_timestamp_us - batch->first_timestamp_us) / (batch->rows - 1)) : 0
+    };
+    memcpy(out, &header, sizeof(header));
+
+    uint8_t* block = out + sizeof(header);
+    for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+        if (batch->channel_mask & (1 << ch)) {
+            memcpy(block, batch->millivolts[ch], block_size);
+            block += block_size;
+        }
+    }
+
+    stream_batch_reset(batch);
+    return length;
+}
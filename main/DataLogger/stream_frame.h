@@ -0,0 +1,65 @@
+#pragma once
+
+#include "adc_manager.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Packed binary frames for live ADC streaming. One frame carries every
+// ADC sample of a batch window: a fixed header followed by one block of
+// int16 millivolt values per channel in the channel mask, lowest channel
+// first. Every scan of the sampling task shares one timestamp, and sample
+// n of every block belongs to scan n, taken at base_timestamp_us +
+// n * interval_us. Channels run at their own rates, so a scan only reads
+// the channels that are due: a slower channel repeats its previous value
+// in the scans that skip it, and a channel first seen mid-frame takes its
+// first value for the scans before.
+//
+// All fields are little-endian. Clients check magic and version and skip
+// frames they do not understand; a gap in the sequence means frames were
+// dropped on the way.
+
+// Frame Configuration
+#define STREAM_FRAME_MAGIC          0xA5
+#define STREAM_FRAME_VERSION        1
+#define STREAM_FRAME_MAX_SAMPLES    64     // Scans per frame
+#define STREAM_FRAME_MAX_SIZE       (sizeof(stream_frame_header_t) + \
+                                     CONFIG_ADC_CHANNEL_COUNT * STREAM_FRAME_MAX_SAMPLES * sizeof(int16_t))
+
+// Frame Header (20 bytes on the wire)
+typedef struct __attribute__((packed)) {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t channel_mask;       // Bit n set: ADC channel n has a block in this frame
+    uint8_t samples;            // Samples per channel block
+    uint32_t sequence;          // Frame counter
+    uint64_t base_timestamp_us; // Scan time of the first sample
+    uint32_t interval_us;       // Scan period within the frame, 0 for a single scan
+} stream_frame_header_t;
+
+// Samples collected for the next frame, one row per ADC scan
+typedef struct {
+    int16_t millivolts[CONFIG_ADC_CHANNEL_COUNT][STREAM_FRAME_MAX_SAMPLES];
+    uint64_t first_timestamp_us;
+    uint64_t last_timestamp_us;
+    uint8_t rows;
+    uint8_t channel_mask;       // Channels seen in this batch
+    uint8_t row_mask;           // Channels filled in the current row
+    uint32_t sequence;          // Sequence of the next frame
+} stream_batch_t;
+
+// Frame Functions
+int16_t stream_frame_millivolts(float voltage);
+void stream_batch_reset(stream_batch_t* batch);
+bool stream_batch_put(stream_batch_t* batch, uint8_t channel, uint64_t timestamp_us, int16_t millivolts);
+bool stream_batch_add(stream_batch_t* batch, const adc_data_packet_t* packet);
+size_t stream_batch_encode(stream_batch_t* batch, uint8_t* out, size_t max_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,292 @@
+#include "stream_udp.h"
+#include "stats_snapshot.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+static const char* TAG = "STREAM_UDP";
+
+#define UDP_TOS_EXPEDITED   0xB8   // DSCP EF: WiFi sends it from the voice queue (WMM)
+#define UNIX_TIME_VALID_S   1600000000  // Earlier wall clock means SNTP has not synced yet
+
+// Streamer State (owned by the streaming task, except restart_requested)
+typedef struct {
+    bool running;
+    volatile bool restart_requested;
+    int sock;
+    struct sockaddr_in destinations[STREAM_UDP_MAX_DESTINATIONS];
+    uint8_t destination_count;
+    uint32_t interval_us;
+    uint64_t last_send_us;
+    uint32_t sequence;
+    stream_udp_datagram_t* datagram;
+    stream_udp_stats_t stats;
+} stream_udp_state_t;
+
+static stream_udp_state_t g_udp = { .sock = -1 };
+
+void stream_udp_datagram_init(stream_udp_datagram_t* datagram) {
+    memset(datagram, 0, sizeof(stream_udp_datagram_t));
+    stream_udp_datagram_reset(datagram);
+}
+
+// Empty the datagram; the open frame stays for the next one
+void stream_udp_datagram_reset(stream_udp_datagram_t* datagram) {
+    datagram->length = sizeof(stream_udp_header_t);
+    datagram->frames = 0;
+}
+
+// Move the open frame into the datagram. False when it does not fit.
+static bool close_frame(stream_udp_datagram_t* datagram) {
+    if (datagram->batch.rows == 0) {
+        return true;
+    }
+    size_t length = stream_batch_encode(&datagram->batch, datagram->data + datagram->length,
+                                        sizeof(datagram->data) - datagram->length);
+    if (length == 0) {
+        return false;
+    }
+    datagram->length += length;
+    datagram->frames++;
+    return true;
+}
+
+// Encoded size of the open frame once the packet is in it
+static size_t frame_length_with(const stream_batch_t* batch, const adc_data_packet_t* packet) {
+    uint8_t mask = batch->channel_mask | (1 << packet->channel);
+    uint8_t rows = batch->rows;
+    if (rows == 0 || packet->timestamp_us != batch->last_timestamp_us) {
+        rows++;
+    }
+    return sizeof(stream_frame_header_t) + __builtin_popcount(mask) * rows * sizeof(int16_t);
+}
+
+// Add one sample. The open frame is closed early when it would outgrow the
+// room left, so datagrams fill up to the MTU. Returns false when the
+// datagram is full; send it, reset it and add the sample again.
+bool stream_udp_datagram_add(stream_udp_datagram_t* datagram, const adc_data_packet_t* packet) {
+    if (packet->channel >= CONFIG_ADC_CHANNEL_COUNT) {
+        return true;
+    }
+
+    size_t room = sizeof(datagram->data) - datagram->length;
+    if (frame_length_with(&datagram->batch, packet) <= room && stream_batch_add(&datagram->batch, packet)) {
+        return true;
+    }
+
+    // The open frame always fits, so closing it cannot fail
+    close_frame(datagram);
+    room = sizeof(datagram->data) - datagram->length;
+    if (frame_length_with(&datagram->batch, packet) > room) {
+        return false;
+    }
+    return stream_batch_add(&datagram->batch, packet);
+}
+
+// Close the open frame and write the header. Returns the
+// datagram length, 0 when there is nothing to send.
+size_t stream_udp_datagram_finish(stream_udp_datagram_t* datagram, uint32_t sequence,
+                                  uint64_t uptime_us, uint64_t unix_us) {
+    close_frame(datagram);
+    if (datagram->frames == 0) {
+        return 0;
+    }
+
+    stream_udp_header_t header = {
+        .magic = STREAM_UDP_MAGIC,
+        .version = STREAM_UDP_VERSION,
+        .frames = datagram->frames,
+        .flags = unix_us ? STREAM_UDP_FLAG_WALL_CLOCK : 0,
+        .sequence = sequence,
+        .send_uptime_us = uptime_us,
+        .send_unix_us = unix_us
+    };
+    memcpy(datagram->data, &header, sizeof(header));
+    return datagram->length;
+}
+
+static void close_socket(void) {
+    if (g_udp.sock >= 0) {
+        close(g_udp.sock);
+        g_udp.sock = -1;
+    }
+    g_udp.running = false;
+    g_udp.stats.running = false;
+}
+
+// Comma-separated IPv4 addresses, unicast or multicast
+static uint8_t parse_destinations(const char* list, uint16_t port) {
+    char copy[sizeof(((system_config_t*)0)->network_config.udp_destinations)];
+    strncpy(copy, list, sizeof(copy) - 1);
+    copy[sizeof(copy) - 1] = '\0';
+
+    uint8_t count = 0;
+    char* save = NULL;
+    for (char* address = strtok_r(copy, ", ", &save); address && count < STREAM_UDP_MAX_DESTINATIONS;
+         address = strtok_r(NULL, ", ", &save)) {
+        struct sockaddr_in* destination = &g_udp.destinations[count];
+        memset(destination, 0, sizeof(*destination));
+        destination->sin_family = AF_INET;
+        destination->sin_port = htons(port);
+        if (inet_pton(AF_INET, address, &destination->sin_addr) != 1) {
+            ESP_LOGW(TAG, "Ignoring destination '%s'", address);
+            continue;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Reopen from the current configuration (streaming task)
+static void apply_configuration(void) {
+    g_udp.restart_requested = false;
+    close_socket();
+
+    system_config_t* config = config_get_instance();
+    if (!config->network_config.udp_enabled) {
+        ESP_LOGI(TAG, "UDP streaming disabled");
+        return;
+    }
+
+    if (!g_udp.datagram) {
+        g_udp.datagram = malloc(sizeof(stream_udp_datagram_t));
+        if (!g_udp.datagram) {
+            ESP_LOGE(TAG, "Failed to allocate datagram buffer");
+            return;
+        }
+    }
+    stream_udp_datagram_init(g_udp.datagram);
+
+    g_udp.destination_count = parse_destinations(config->network_config.udp_destinations,
+                                                 config->network_config.udp_port);
+    if (g_udp.destination_count == 0) {
+        ESP_LOGE(TAG, "No valid UDP destination in '%s'", config->network_config.udp_destinations);
+        return;
+    }
+
+    g_udp.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (g_udp.sock < 0) {
+        ESP_LOGE(TAG, "Failed to create UDP socket: errno %d", errno);
+        return;
+    }
+    int flags = fcntl(g_udp.sock, F_GETFL, 0);
+    fcntl(g_udp.sock, F_SETFL, flags | O_NONBLOCK);
+    int tos = UDP_TOS_EXPEDITED;
+    setsockopt(g_udp.sock, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+
+    g_udp.interval_us = config->network_config.udp_interval_ms * 1000;
+    g_udp.last_send_us = esp_timer_get_time();
+    g_udp.running = true;
+
+    memset(&g_udp.stats, 0, sizeof(g_udp.stats));
+    g_udp.stats.running = true;
+    g_udp.stats.destinations = g_udp.destination_count;
+    g_udp.stats.interval_ms = config->network_config.udp_interval_ms;
+
+    ESP_LOGI(TAG, "UDP streaming to %d destination(s) on port %d every %d ms",
+             g_udp.destination_count, config->network_config.udp_port,
+             config->network_config.udp_interval_ms);
+}
+
+static void send_datagram(void) {
+    uint64_t now = esp_timer_get_time();
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t unix_us = (tv.tv_sec >= UNIX_TIME_VALID_S) ? (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec : 0;
+
+    size_t length = stream_udp_datagram_finish(g_udp.datagram, g_udp.sequence, now, unix_us);
+    if (length == 0) {
+        return;
+    }
+
+    // The first frame starts with the oldest sample
+    stream_frame_header_t first;
+    memcpy(&first, g_udp.datagram->data + sizeof(stream_udp_header_t), sizeof(first));
+
+    for (int i = 0; i < g_udp.destination_count; i++) {
+        if (sendto(g_udp.sock, g_udp.datagram->data, length, 0,
+                   (struct sockaddr*)&g_udp.destinations[i], sizeof(g_udp.destinations[i])) != (int)length) {
+            g_udp.stats.send_errors++;
+        }
+    }
+
+    uint64_t done = esp_timer_get_time();
+    uint32_t send_us = (uint32_t)(done - now);
+    uint32_t age_us = (now > first.base_timestamp_us) ? (uint32_t)(now - first.base_timestamp_us) : 0;
+    if (send_us > g_udp.stats.send_max_us) {
+        g_udp.stats.send_max_us = send_us;
+    }
+    if (age_us > g_udp.stats.age_max_us) {
+        g_udp.stats.age_max_us = age_us;
+    }
+    g_udp.stats.datagrams++;
+    g_udp.stats.frames += g_udp.datagram->frames;
+    g_udp.stats.bytes += length;
+
+    g_udp.sequence++;
+    g_udp.last_send_us = now;
+    stream_udp_datagram_reset(g_udp.datagram);
+}
+
+// Ask the streaming task to (re)open the streamer with the current configuration
+void stream_udp_configure(void) {
+    g_udp.restart_requested = true;
+}
+
+// Channels the ADC task samples now, which runtime commands can change
+static uint8_t enabled_channels(void) {
+    uint8_t mask = 0;
+    for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+        if (adc_manager_is_channel_enabled(ch)) {
+            mask |= 1 << ch;
+        }
+    }
+    return mask;
+}
+
+void stream_udp_add(const adc_data_packet_t* packet) {
+    if (!g_udp.running) {
+        return;
+    }
+
+    if (!stream_udp_datagram_add(g_udp.datagram, packet)) {
+        send_datagram();
+        stream_udp_datagram_add(g_udp.datagram, packet);
+    }
+
+    // Send as soon as the scan is complete, rather than one scan later
+    uint8_t enabled = enabled_channels();
+    if ((g_udp.datagram->batch.row_mask & enabled) == enabled &&
+        esp_timer_get_time() - g_udp.last_send_us >= g_udp.interval_us) {
+        send_datagram();
+    }
+}
+
+// Apply configuration changes, and send what is pending once the interval
+// has passed even if a channel is missing from the newest scan
+void stream_udp_poll(void) {
+    if (g_udp.restart_requested) {
+        apply_configuration();
+    }
+    if (!g_udp.running) {
+        return;
+    }
+
+    if ((g_udp.datagram->frames > 0 || g_udp.datagram->batch.rows > 0) &&
+        esp_timer_get_time() - g_udp.last_send_us >= g_udp.interval_us) {
+        send_datagram();
+    }
+}
+
+esp_err_t stream_udp_get_stats(stream_udp_stats_t* stats) {
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    stats_snapshot(stats, &g_udp.stats, sizeof(stream_udp_stats_t));
+    return ESP_OK;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "esp_err.h"
+#include "stream_frame.h"
+#include "adc_manager.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// UDP telemetry for consumers that need the lowest latency and can live
+// with loss. The streaming task feeds every ADC sample in; samples are
+// packed as stream frames (see stream_frame.h) into datagrams of at most
+// one MTU and sent to every configured unicast or multicast destination
+// once the send interval has passed and the newest scan is complete.
+//
+// Nothing waits: sends are non-blocking, a destination that cannot take a
+// datagram loses it (counted in send_errors), and nothing is retried.
+// Receivers find loss from gaps in the datagram sequence.
+//
+// Datagram layout (little-endian): stream_udp_header_t, then `frames`
+// whole stream frames back to back, each sized by its own header.
+
+// UDP Configuration
+#define STREAM_UDP_MAGIC            0x5A
+#define STREAM_UDP_VERSION          1
+#define STREAM_UDP_MAX_PAYLOAD      1472   // 1500 byte MTU minus IPv4 and UDP headers
+#define STREAM_UDP_MAX_DESTINATIONS 4
+#define STREAM_UDP_FLAG_WALL_CLOCK  0x01   // send_unix_us is valid (SNTP synced)
+
+// Datagram Header (24 bytes on the wire)
+typedef struct __attribute__((packed)) {
+    uint8_t magic;
+    uint8_t version;
+    uint8_t frames;             // Stream frames that follow
+    uint8_t flags;
+    uint32_t sequence;          // Datagram counter, a gap means lost datagrams
+    uint64_t send_uptime_us;    // esp_timer clock at send, same clock as the samples
+    uint64_t send_unix_us;      // Wall clock at send, for one-way latency
+} stream_udp_header_t;
+
+// Datagram being filled: header room, then the frames closed so far, and
+// the scans of the frame still open
+typedef struct {
+    uint8_t data[STREAM_UDP_MAX_PAYLOAD];
+    size_t length;
+    uint8_t frames;
+    stream_batch_t batch;
+} stream_udp_datagram_t;
+
+// UDP Statistics
+typedef struct {
+    bool running;
+    uint8_t destinations;
+    uint32_t interval_ms;
+    uint32_t datagrams;
+    uint32_t frames;
+    uint64_t bytes;
+    uint32_t send_errors;       // Datagrams a destination did not take
+    uint32_t send_max_us;       // Longest time spent sending one datagram
+    uint32_t age_max_us;        // Oldest sample at send: batching delay on the device
+} stream_udp_stats_t;
+
+// Datagram Functions
+void stream_udp_datagram_init(stream_udp_datagram_t* datagram);
+bool stream_udp_datagram_add(stream_udp_datagram_t* datagram, const adc_data_packet_t* packet);
+size_t stream_udp_datagram_finish(stream_udp_datagram_t* datagram, uint32_t sequence,
+                                  uint64_t uptime_us, uint64_t unix_us);
+void stream_udp_datagram_reset(stream_udp_datagram_t* datagram);
+
+// Streamer Functions (add and poll are called by the streaming task only)
+void stream_udp_configure(void);
+void stream_udp_add(const adc_data_packet_t* packet);
+void stream_udp_poll(void);
+esp_err_t stream_udp_get_stats(stream_udp_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,294 @@
+#include "stream_view.h"
+#include "json_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ALL_ADC_CHANNELS    ((1 << CONFIG_ADC_CHANNEL_COUNT) - 1)
+#define ALL_UART_PORTS      ((1 << CONFIG_UART_PORT_COUNT) - 1)
+
+static const char* const g_reduce_names[STREAM_REDUCE_COUNT] = {"latest", "decimate", "minmax"};
+
+// Until a client subscribes: every ADC channel, JSON clients the classic
+// latest-value messages, binary clients every scan
+void stream_subscription_default(stream_subscription_t* subscription, stream_encoding_t encoding) {
+    memset(subscription, 0, sizeof(stream_subscription_t));
+    subscription->adc_channels = ALL_ADC_CHANNELS;
+    subscription->encoding = encoding;
+    subscription->reduce = (encoding == STREAM_ENCODING_JSON) ? STREAM_REDUCE_LATEST : STREAM_REDUCE_DECIMATE;
+}
+
+// Equivalent subscriptions end up identical, so they share a view
+void stream_subscription_normalize(stream_subscription_t* subscription) {
+    subscription->adc_channels &= ALL_ADC_CHANNELS;
+    subscription->uart_ports &= ALL_UART_PORTS;
+    if (subscription->reduce >= STREAM_REDUCE_COUNT) {
+        subscription->reduce = STREAM_REDUCE_LATEST;
+    }
+    if (subscription->encoding >= STREAM_ENCODING_COUNT) {
+        subscription->encoding = STREAM_ENCODING_JSON;
+    }
+    if (subscription->reduce == STREAM_REDUCE_MINMAX && subscription->rate_hz == 0) {
+        subscription->reduce = STREAM_REDUCE_DECIMATE;
+    }
+    if (subscription->reduce == STREAM_REDUCE_LATEST) {
+        subscription->rate_hz = 0;
+    }
+}
+
+// UART ports are sent per packet and do not take part in the ADC view
+bool stream_subscription_same_view(const stream_subscription_t* a, const stream_subscription_t* b) {
+    return a->adc_channels == b->adc_channels && a->rate_hz == b->rate_hz &&
+           a->reduce == b->reduce && a->encoding == b->encoding;
+}
+
+// Topics are "adc<n>" and "uart<n>". Returns false for unknown topics.
+bool stream_subscription_set_topic(stream_subscription_t* subscription, const char* topic, bool enable) {
+    uint8_t* mask;
+    int count;
+    const char* number;
+    if (strncmp(topic, "adc", 3) == 0) {
+        mask = &subscription->adc_channels;
+        count = CONFIG_ADC_CHANNEL_COUNT;
+        number = topic + 3;
+    } else if (strncmp(topic, "uart", 4) == 0) {
+        mask = &subscription->uart_ports;
+        count = CONFIG_UART_PORT_COUNT;
+        number = topic + 4;
+    } else {
+        return false;
+    }
+
+    if (number[0] < '0' || number[0] >= '0' + count || number[1] != '\0') {
+        return false;
+    }
+
+    uint8_t bit = 1 << (number[0] - '0');
+    if (enable) {
+        *mask |= bit;
+    } else {
+        *mask &= ~bit;
+    }
+    return true;
+}
+
+// Name of topic index (ADC channels first, then UART ports). Returns
+// whether the subscription includes it.
+bool stream_subscription_topic(const stream_subscription_t* subscription, int index, char* name, size_t max_len) {
+    if (index < CONFIG_ADC_CHANNEL_COUNT) {
+        snprintf(name, max_len, "adc%d", index);
+        return subscription->adc_channels & (1 << index);
+    }
+    index -= CONFIG_ADC_CHANNEL_COUNT;
+    snprintf(name, max_len, "uart%d", index);
+    return index < CONFIG_UART_PORT_COUNT && (subscription->uart_ports & (1 << index));
+}
+
+const char* stream_reduce_name(stream_reduce_t reduce) {
+    return reduce < STREAM_REDUCE_COUNT ? g_reduce_names[reduce] : "unknown";
+}
+
+bool stream_reduce_from_name(const char* name, stream_reduce_t* reduce) {
+    for (int i = 0; i < STREAM_REDUCE_COUNT; i++) {
+        if (strcmp(name, g_reduce_names[i]) == 0) {
+            *reduce = (stream_reduce_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void stream_view_init(stream_view_t* view, const stream_subscription_t* subscription) {
+    memset(view, 0, sizeof(stream_view_t));
+    view->subscription = *subscription;
+}
+
+static uint32_t period_us(const stream_view_t* view) {
+    return view->subscription.rate_hz ? 1000000 / view->subscription.rate_hz : 0;
+}
+
+static bool add_decimated(stream_view_t* view, const adc_data_packet_t* packet) {
+    if (packet->timestamp_us != view->taken_us) {
+        if (packet->timestamp_us < view->next_due_us) {
+            return true;
+        }
+
+        // Stay on the period grid unless the stream fell a whole period behind it
+        uint32_t period = period_us(view);
+        view->taken_us = packet->timestamp_us;
+        view->next_due_us = (packet->timestamp_us - view->next_due_us < period) ?
+                            view->next_due_us + period : packet->timestamp_us + period;
+    }
+    return stream_batch_add(&view->batch, packet);
+}
+
+// Min row at the start of the period, max row half a period later
+static bool close_bucket(stream_view_t* view) {
+    if (view->batch.rows + 2 > STREAM_FRAME_MAX_SAMPLES) {
+        return false;
+    }
+
+    uint64_t max_us = view->bucket_start_us + period_us(view) / 2;
+    for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+        if (view->bucket_mask & (1 << ch)) {
+            stream_batch_put(&view->batch, ch, view->bucket_start_us, view->bucket_min[ch]);
+        }
+    }
+    for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+        if (view->bucket_mask & (1 << ch)) {
+            stream_batch_put(&view->batch, ch, max_us, view->bucket_max[ch]);
+        }
+    }
+    view->bucket_mask = 0;
+    return true;
+}
+
+static bool add_minmax(stream_view_t* view, const adc_data_packet_t* packet) {
+    if (view->bucket_mask && packet->timestamp_us - view->bucket_start_us >= period_us(view)) {
+        if (!close_bucket(view)) {
+            return false;
+        }
+    }
+    if (!view->bucket_mask) {
+        view->bucket_start_us = packet->timestamp_us;
+    }
+
+    uint8_t bit = 1 << packet->channel;
+    int16_t millivolts = stream_frame_millivolts(packet->filtered_voltage);
+    if (!(view->bucket_mask & bit)) {
+        view->bucket_min[packet->channel] = millivolts;
+        view->bucket_max[packet->channel] = millivolts;
+        view->bucket_mask |= bit;
+    } else if (millivolts < view->bucket_min[packet->channel]) {
+        view->bucket_min[packet->channel] = millivolts;
+    } else if (millivolts > view->bucket_max[packet->channel]) {
+        view->bucket_max[packet->channel] = millivolts;
+    }
+    return true;
+}
+
+// Feed one sample of the stream tap. Returns false when the view's batch
+// is full; encode it and add the sample again.
+bool stream_view_add(stream_view_t* view, const adc_data_packet_t* packet) {
+    if (packet->channel >= CONFIG_ADC_CHANNEL_COUNT ||
+        !(view->subscription.adc_channels & (1 << packet->channel))) {
+        return true;
+    }
+
+    switch (view->subscription.reduce) {
+        case STREAM_REDUCE_DECIMATE:
+            return add_decimated(view, packet);
+        case STREAM_REDUCE_MINMAX:
+            return add_minmax(view, packet);
+        default:
+            view->latest[packet->channel] = *packet;
+            view->latest_mask |= 1 << packet->channel;
+            return true;
+    }
+}
+
+bool stream_view_pending(const stream_view_t* view) {
+    return view->latest_mask != 0 || view->batch.rows > 0;
+}
+
+// Buffer size for the next stream_view_encode
+size_t stream_view_message_size(const stream_view_t* view) {
+    if (view->subscription.encoding == STREAM_ENCODING_BINARY) {
+        return STREAM_FRAME_MAX_SIZE;
+    }
+    return view->subscription.reduce == STREAM_REDUCE_LATEST ? STREAM_VIEW_DATA_MAX_SIZE : STREAM_VIEW_JSON_MAX_SIZE;
+}
+
+// Classic per-channel message, one channel per call
+static size_t encode_latest_data(stream_view_t* view, uint8_t* out, size_t max_len) {
+    int ch = __builtin_ctz(view->latest_mask);
+    const adc_data_packet_t* packet = &view->latest[ch];
+    view->latest_mask &= ~(1 << ch);
+
+    int length = snprintf((char*)out, max_len,
+                          "{\"type\":\"data\",\"timestamp\":%llu,\"channel\":%d,\"voltage\":%.4f,\"raw\":%d,\"sequence\":%lu}",
+                          (unsigned long long)packet->timestamp_us, ch, packet->filtered_voltage,
+                          packet->raw_value, (unsigned long)packet->sequence);
+    return (length > 0 && (size_t)length < max_len) ? length : 0;
+}
+
+// JSON twin of the binary frame, values in millivolts
+static size_t encode_samples(stream_view_t* view, uint8_t* out, size_t max_len) {
+    stream_batch_t* batch = &view->batch;
+    json_writer_t json;
+    json_writer_init(&json, (char*)out, max_len, NULL, NULL);
+
+    json_writer_begin_object(&json, NULL);
+    json_writer_string(&json, "type", "samples");
+    json_writer_string(&json, "reduce", stream_reduce_name(view->subscription.reduce));
+    json_writer_uint(&json, "sequence", batch->sequence);
+    json_writer_uint(&json, "timestamp", batch->first_timestamp_us);
+    json_writer_uint(&json, "interval_us", batch->rows > 1 ?
+                     (batch->last_timestamp_us - batch->first_timestamp_us) / (batch->rows - 1) : 0);
+    json_writer_begin_object(&json, "channels");
+    for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+        if (!(batch->channel_mask & (1 << ch))) {
+            continue;
+        }
+        char key[4];
+        snprintf(key, sizeof(key), "%d", ch);
+        json_writer_begin_array(&json, key);
+        for (int row = 0; row < batch->rows; row++) {
+            json_writer_int(&json, NULL, batch->millivolts[ch][row]);
+        }
+        json_writer_end_array(&json);
+    }
+    json_writer_end_object(&json);
+    json_writer_end_object(&json);
+
+    if (json_writer_finish(&json) != ESP_OK) {
+        return 0;
+    }
+    batch->sequence++;
+    stream_batch_reset(batch);
+    return json.out.used;
+}
+
+// Encode the next message of the view in its encoding. Returns 0 when
+// there is nothing (more) to send; call again until then.
+size_t stream_view_encode(stream_view_t* view, uint8_t* out, size_t max_len) {
+    if (view->subscription.reduce == STREAM_REDUCE_LATEST && view->latest_mask) {
+        if (view->subscription.encoding == STREAM_ENCODING_JSON) {
+            return encode_latest_data(view, out, max_len);
+        }
+        for (int ch = 0; ch < CONFIG_ADC_CHANNEL_COUNT; ch++) {
+            if (view->latest_mask & (1 << ch)) {
+                stream_batch_add(&view->batch, &view->latest[ch]);
+            }
+        }
+        view->latest_mask = 0;
+    }
+
+    if (view->batch.rows == 0) {
+        return 0;
+    }
+
+    size_t length = (view->subscription.encoding == STREAM_ENCODING_BINARY) ?
+                    stream_batch_encode(&view->batch, out, max_len) :
+                    encode_samples(view, out, max_len);
+    if (length == 0) {
+        // Does not fit: drop the rows rather than keep a batch that never goes out
+        stream_batch_reset(&view->batch);
+    }
+    return length;
+}
+
+size_t stream_view_encode_uart(const uart_data_packet_t* packet, uint8_t* out, size_t max_len) {
+    json_writer_t json;
+    json_writer_init(&json, (char*)out, max_len, NULL, NULL);
+
+    json_writer_begin_object(&json, NULL);
+    json_writer_string(&json, "type", "uart");
+    json_writer_uint(&json, "port", packet->port);
+    json_writer_uint(&json, "timestamp", packet->timestamp_us);
+    json_writer_uint(&json, "sequence", packet->sequence);
+    json_writer_bytes(&json, "data", packet->data, packet->length);
+    json_writer_end_object(&json);
+
+    return json_writer_finish(&json) == ESP_OK ? json.out.used : 0;
+}
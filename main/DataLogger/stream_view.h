@@ -0,0 +1,72 @@
+#pragma once
+
+#include "stream_fanout.h"
+#include "stream_frame.h"
+#include "adc_manager.h"
+#include "uart_manager.h"
+#include "config.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Per-subscription reduction of the live ADC stream. The streaming task
+// keeps one view per distinct subscription, and clients with the same
+// subscription share the view and every message it encodes. A view copies
+// only the scans it needs (its channels, thinned to its rate) from the
+// stream tap into a frame batch. At the end of each batch window the
+// batch is encoded once, as a binary frame or a JSON "samples" message.
+//
+//   latest    newest scan of the window; JSON clients get the classic
+//             per-channel "data" messages
+//   decimate  first scan of every 1/rate period (rate 0: every scan)
+//   minmax    minimum and maximum of every 1/rate period as two rows half
+//             a period apart, so a plot keeps every peak
+//
+// UART data is not reduced; each packet goes out as one JSON "uart"
+// message to the clients subscribed to its port.
+
+// View Configuration
+#define STREAM_VIEW_JSON_MAX_SIZE   (160 + CONFIG_ADC_CHANNEL_COUNT * (8 + STREAM_FRAME_MAX_SAMPLES * 7))
+#define STREAM_VIEW_DATA_MAX_SIZE   160    // One classic "data" message
+#define STREAM_VIEW_UART_MAX_SIZE   (112 + UART_MAX_PACKET_SIZE * 6)
+#define STREAM_VIEW_TOPIC_LEN       8      // "adc0", "uart1"
+#define STREAM_VIEW_TOPIC_COUNT     (CONFIG_ADC_CHANNEL_COUNT + CONFIG_UART_PORT_COUNT)
+
+typedef struct {
+    stream_subscription_t subscription;
+    uint32_t clients;           // Fan-out slots with this subscription
+    stream_batch_t batch;       // Reduced rows for the next message
+    uint64_t taken_us;          // Decimate: scan being copied
+    uint64_t next_due_us;       // Decimate: earliest scan to take next
+    uint64_t bucket_start_us;   // Min/max: start of the open period
+    uint8_t bucket_mask;        // Min/max: channels seen in the open period
+    int16_t bucket_min[CONFIG_ADC_CHANNEL_COUNT];
+    int16_t bucket_max[CONFIG_ADC_CHANNEL_COUNT];
+    adc_data_packet_t latest[CONFIG_ADC_CHANNEL_COUNT];  // Latest: newest sample per channel
+    uint8_t latest_mask;
+} stream_view_t;
+
+// Subscription Functions
+void stream_subscription_default(stream_subscription_t* subscription, stream_encoding_t encoding);
+void stream_subscription_normalize(stream_subscription_t* subscription);
+bool stream_subscription_same_view(const stream_subscription_t* a, const stream_subscription_t* b);
+bool stream_subscription_set_topic(stream_subscription_t* subscription, const char* topic, bool enable);
+bool stream_subscription_topic(const stream_subscription_t* subscription, int index, char* name, size_t max_len);
+const char* stream_reduce_name(stream_reduce_t reduce);
+bool stream_reduce_from_name(const char* name, stream_reduce_t* reduce);
+
+// View Functions
+void stream_view_init(stream_view_t* view, const stream_subscription_t* subscription);
+bool stream_view_add(stream_view_t* view, const adc_data_packet_t* packet);
+bool stream_view_pending(const stream_view_t* view);
+size_t stream_view_message_size(const stream_view_t* view);
+size_t stream_view_encode(stream_view_t* view, uint8_t* out, size_t max_len);
+size_t stream_view_encode_uart(const uart_data_packet_t* packet, uint8_t* out, size_t max_len);
+
+#ifdef __cplusplus
+}
+#endif
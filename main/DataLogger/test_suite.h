@@ -40,8 +40,30 @@ esp_err_t test_config_system(test_result_t* result);
 esp_err_t test_hal_initialization(test_result_t* result);
 
 esp_err_t test_adc_readings(test_result_t* result);
+esp_err_t test_adc_reconfigure(test_result_t* result);
 esp_err_t test_storage_write_read(test_result_t* result);
+esp_err_t test_storage_compression(test_result_t* result);
+esp_err_t test_storage_recovery(test_result_t* result);
+esp_err_t test_storage_file_list(test_result_t* result);
+esp_err_t test_storage_reclaim(test_result_t* result);
+esp_err_t test_storage_spill(test_result_t* result);
+esp_err_t test_storage_priority(test_result_t* result);
+esp_err_t test_storage_rollup(test_result_t* result);
+esp_err_t test_storage_card_health(test_result_t* result);
+esp_err_t test_storage_streams(test_result_t* result);
+esp_err_t test_storage_scrub(test_result_t* result);
+esp_err_t test_storage_export(test_result_t* result);
+esp_err_t test_storage_session(test_result_t* result);
+esp_err_t test_spi_bus_sharing(test_result_t* result);
 esp_err_t test_network_api(test_result_t* result);
+esp_err_t test_range_header(test_result_t* result);
+esp_err_t test_stream_frames(test_result_t* result);
+esp_err_t test_json_writer(test_result_t* result);
+esp_err_t test_metrics_writer(test_result_t* result);
+esp_err_t test_stream_fanout(test_result_t* result);
+esp_err_t test_stream_subscriptions(test_result_t* result);
+esp_err_t test_adc_history(test_result_t* result);
+esp_err_t test_stream_udp(test_result_t* result);
 esp_err_t test_display_updates(test_result_t* result);
 esp_err_t test_end_to_end_data_flow(test_result_t* result);
 esp_err_t test_uart_loopback(uint8_t port, test_result_t* result);
@@ -0,0 +1,139 @@
+#include "text_writer.h"
+#include <string.h>
+#include <math.h>
+
+static const uint32_t g_pow10[TEXT_WRITER_MAX_DECIMALS + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+void text_writer_init(text_writer_t* writer, char* buffer, size_t size, text_writer_flush_t flush, void* ctx) {
+    memset(writer, 0, sizeof(text_writer_t));
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->flush = flush;
+    writer->ctx = ctx;
+    writer->error = (buffer && size > 0) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// Hand the buffered output to the callback. Without one the buffer cannot
+// be emptied, so needing to is an error.
+esp_err_t text_writer_flush(text_writer_t* writer) {
+    if (writer->used == 0 || writer->error != ESP_OK) {
+        return writer->error;
+    }
+    writer->error = writer->flush ? writer->flush(writer->buffer, writer->used, writer->ctx)
+                                  : ESP_ERR_INVALID_SIZE;
+    writer->used = 0;
+    return writer->error;
+}
+
+void text_writer_put(text_writer_t* writer, const char* data, size_t length) {
+    writer->total += length;
+    while (length > 0 && writer->error == ESP_OK) {
+        if (writer->used == writer->size) {
+            text_writer_flush(writer);
+            continue;
+        }
+        size_t room = writer->size - writer->used;
+        size_t n = length < room ? length : room;
+        memcpy(writer->buffer + writer->used, data, n);
+        writer->used += n;
+        data += n;
+        length -= n;
+    }
+}
+
+void text_writer_put_char(text_writer_t* writer, char c) {
+    if (writer->used == writer->size) {
+        text_writer_flush(writer);
+    }
+    if (writer->error == ESP_OK) {
+        writer->buffer[writer->used++] = c;
+        writer->total++;
+    }
+}
+
+void text_writer_put_str(text_writer_t* writer, const char* text) {
+    text_writer_put(writer, text, strlen(text));
+}
+
+void text_writer_put_uint(text_writer_t* writer, uint64_t value) {
+    char digits[TEXT_WRITER_NUMBER_LEN];
+    text_writer_put(writer, digits, text_format_uint(digits, value));
+}
+
+void text_writer_put_int(text_writer_t* writer, int64_t value) {
+    char digits[TEXT_WRITER_NUMBER_LEN];
+    text_writer_put(writer, digits, text_format_int(digits, value));
+}
+
+char* text_writer_reserve(text_writer_t* writer, size_t length) {
+    if (writer->error == ESP_OK && writer->size - writer->used < length) {
+        text_writer_flush(writer);
+        if (writer->error == ESP_OK && writer->size < length) {
+            writer->error = ESP_ERR_INVALID_SIZE;
+        }
+    }
+    return (writer->error == ESP_OK) ? writer->buffer + writer->used : NULL;
+}
+
+void text_writer_commit(text_writer_t* writer, size_t length) {
+    writer->used += length;
+    writer->total += length;
+}
+
+size_t text_format_u32(char* out, uint32_t value, size_t width) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (n < width) {
+        digits[n++] = '0';
+    }
+    for (size_t i = 0; i < n; i++) {
+        out[i] = digits[n - 1 - i];
+    }
+    return n;
+}
+
+// One 64-bit division splits off the low nine digits; the rest is 32-bit
+size_t text_format_uint(char* out, uint64_t value) {
+    if (value <= UINT32_MAX) {
+        return text_format_u32(out, (uint32_t)value, 0);
+    }
+    uint64_t high = value / 1000000000ULL;
+    size_t n = text_format_uint(out, high);
+    return n + text_format_u32(out + n, (uint32_t)(value - high * 1000000000ULL), 9);
+}
+
+size_t text_format_int(char* out, int64_t value) {
+    if (value < 0) {
+        out[0] = '-';
+        return 1 + text_format_uint(out + 1, (uint64_t)(-(value + 1)) + 1);
+    }
+    return text_format_uint(out, (uint64_t)value);
+}
+
+size_t text_format_fixed(char* out, double value, uint8_t decimals) {
+    if (decimals > TEXT_WRITER_MAX_DECIMALS) {
+        decimals = TEXT_WRITER_MAX_DECIMALS;
+    }
+
+    double scaled = fabs(value) * g_pow10[decimals];
+    if (isnan(value) || scaled >= 9.0e18) {
+        return 0;
+    }
+
+    uint64_t units = (uint64_t)llround(scaled);
+    size_t n = 0;
+    if (value < 0 && units > 0) {
+        out[n++] = '-';
+    }
+    n += text_format_uint(out + n, units / g_pow10[decimals]);
+
+    if (decimals > 0) {
+        out[n++] = '.';
+        n += text_format_u32(out + n, (uint32_t)(units % g_pow10[decimals]), decimals);
+    }
+    return n;
+}
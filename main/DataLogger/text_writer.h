@@ -0,0 +1,65 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Buffered text output and number formatting shared by the streaming
+// formatters (json_writer, metrics_writer and the log export). Output goes
+// into a caller-provided buffer that is handed to a flush callback whenever
+// it fills. The first error (a failed flush, or running out of room without
+// a callback) sticks and turns later calls into no-ops.
+//
+// Numbers are formatted with integer arithmetic, never printf. Values above
+// 32 bits are split into nine-digit groups, so each group costs one 64-bit
+// division and its digits come from 32-bit arithmetic.
+
+// Writer Configuration
+#define TEXT_WRITER_MAX_DECIMALS    6
+#define TEXT_WRITER_NUMBER_LEN      32     // Longest formatted number (sign, 19 digits, point, decimals)
+
+// Receives formatted output; a non-OK return aborts the output
+typedef esp_err_t (*text_writer_flush_t)(const char* data, size_t length, void* ctx);
+
+typedef struct {
+    char* buffer;
+    size_t size;
+    size_t used;
+    text_writer_flush_t flush;
+    void* ctx;
+    size_t total;               // Bytes produced so far
+    esp_err_t error;
+} text_writer_t;
+
+// Writer Functions
+void text_writer_init(text_writer_t* writer, char* buffer, size_t size, text_writer_flush_t flush, void* ctx);
+esp_err_t text_writer_flush(text_writer_t* writer);
+
+void text_writer_put(text_writer_t* writer, const char* data, size_t length);
+void text_writer_put_char(text_writer_t* writer, char c);
+void text_writer_put_str(text_writer_t* writer, const char* text);
+void text_writer_put_uint(text_writer_t* writer, uint64_t value);
+void text_writer_put_int(text_writer_t* writer, int64_t value);
+
+// Contiguous room for up to length bytes, flushing first if needed; NULL
+// once the writer failed. Fill it directly, then commit the bytes used.
+char* text_writer_reserve(text_writer_t* writer, size_t length);
+void text_writer_commit(text_writer_t* writer, size_t length);
+
+// Number Formatting (return the characters written, no terminator)
+size_t text_format_u32(char* out, uint32_t value, size_t width);   // Zero padded to width
+size_t text_format_uint(char* out, uint64_t value);
+size_t text_format_int(char* out, int64_t value);
+// Rounded once to the given decimals and printed as two integers. Returns
+// 0 for NaN, infinities and values beyond 64-bit units; each format writes
+// its own token for those.
+size_t text_format_fixed(char* out, double value, uint8_t decimals);
+
+#ifdef __cplusplus
+}
+#endif
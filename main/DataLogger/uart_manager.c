@@ -5,8 +5,10 @@
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
 #include "hal.h"
 #include "config.h"
+#include "stats_snapshot.h"
 #include <string.h>
 
 static const char* TAG = "UART_MGR";
@@ -16,10 +18,55 @@ typedef struct {
     bool initialized;
     bool running;
     uart_channel_context_t channels[CONFIG_UART_PORT_COUNT];
+    QueueHandle_t stream_queue;     // Live streaming tap, so streaming never takes packets from logging
+    uint32_t stream_dropped;
+    QueueHandle_t command_queues[CONFIG_UART_PORT_COUNT]; // Taken by each port's reader task
+    SemaphoreHandle_t apply_lock;   // One reconfiguration in flight at a time
+    SemaphoreHandle_t applied;      // Given by a reader task after each command
+    uint32_t generation;            // Last command queued
+    volatile uint32_t applied_generation; // Last command a reader task finished
+    esp_err_t apply_result;         // Outcome of that command
 } uart_manager_state_t;
 
+typedef enum {
+    UART_COMMAND_SET_BAUD,
+    UART_COMMAND_STOP
+} uart_command_type_t;
+
+// Reconfiguration for one port's reader task
+typedef struct {
+    uart_command_type_t type;
+    uint32_t baud_rate;
+    uint32_t generation;
+} uart_command_t;
+
 static uart_manager_state_t g_uart_manager = {0};
 
+static void command_done(uint32_t generation, esp_err_t result) {
+    g_uart_manager.apply_result = result;
+    g_uart_manager.applied_generation = generation;
+    xSemaphoreGive(g_uart_manager.applied);
+}
+
+// Queue a command for a port's reader task and wait for it; apply_lock held
+static esp_err_t send_command(uint8_t port, uart_command_t* command) {
+    command->generation = ++g_uart_manager.generation;
+
+    // A give left over from a command that timed out is not ours
+    xSemaphoreTake(g_uart_manager.applied, 0);
+
+    if (xQueueSend(g_uart_manager.command_queues[port], command, pdMS_TO_TICKS(UART_APPLY_TIMEOUT_MS)) == pdTRUE) {
+        while (xSemaphoreTake(g_uart_manager.applied, pdMS_TO_TICKS(UART_APPLY_TIMEOUT_MS)) == pdTRUE) {
+            if (g_uart_manager.applied_generation == command->generation) {
+                return g_uart_manager.apply_result;
+            }
+        }
+    }
+
+    ESP_LOGW(TAG, "UART%d task did not take command %lu", port, command->generation);
+    return ESP_ERR_TIMEOUT;
+}
+
 // UART Task Function
 static void uart_task(void* pvParameters) {
     uart_channel_context_t* channel = (uart_channel_context_t*)pvParameters;
@@ -33,9 +80,29 @@ static void uart_task(void* pvParameters) {
 
     ESP_LOGI(TAG, "UART%d task started", channel->port);
 
+    uint32_t stop_generation = 0;
+
     while (channel->active) {
-        // Read data from UART
-        int len = hal_uart_read(channel->port, data_buffer, UART_BUFFER_SIZE, 100);
+        // Safe point: between two reads, no packet half built
+        uart_command_t command;
+        while (!stop_generation &&
+               xQueueReceive(g_uart_manager.command_queues[channel->port], &command, 0) == pdTRUE) {
+            if (command.type == UART_COMMAND_STOP) {
+                stop_generation = command.generation;
+            } else {
+                esp_err_t ret = hal_uart_set_baud_rate(channel->port, command.baud_rate);
+                if (ret == ESP_OK) {
+                    channel->baud_rate = command.baud_rate;
+                }
+                command_done(command.generation, ret);
+            }
+        }
+        if (stop_generation) {
+            break;
+        }
+
+        // Read data from UART (bounded by the packet payload size)
+        int len = hal_uart_read(channel->port, data_buffer, UART_MAX_PACKET_SIZE, 100);
 
         if (len > 0) {
             // Create data packet
@@ -49,6 +116,11 @@ static void uart_task(void* pvParameters) {
             // Copy data to packet
             memcpy(packet.data, data_buffer, len);
 
+            // Streaming gets its own copy; a lagging stream only loses its own packets
+            if (xQueueSend(g_uart_manager.stream_queue, &packet, 0) != pdTRUE) {
+                g_uart_manager.stream_dropped++;
+            }
+
             // Send to ring buffer
             esp_err_t ret = xRingbufferSend(channel->ring_buffer, &packet,
                                           sizeof(uart_data_packet_t), pdMS_TO_TICKS(10));
@@ -69,8 +141,15 @@ static void uart_task(void* pvParameters) {
         vTaskDelay(pdMS_TO_TICKS(1));
     }
 
+    channel->active = false;
+    channel->task_handle = NULL;
     free(data_buffer);
     ESP_LOGI(TAG, "UART%d task stopped", channel->port);
+
+    // The channel is free for a restart once the stop is acknowledged
+    if (stop_generation) {
+        command_done(stop_generation, ESP_OK);
+    }
     vTaskDelete(NULL);
 }
 
@@ -82,6 +161,19 @@ esp_err_t uart_manager_init(void) {
 
     ESP_LOGI(TAG, "Initializing UART Manager");
 
+    g_uart_manager.stream_queue = xQueueCreate(UART_STREAM_QUEUE_SIZE, sizeof(uart_data_packet_t));
+    if (!g_uart_manager.stream_queue) {
+        ESP_LOGE(TAG, "Failed to create UART stream queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    g_uart_manager.apply_lock = xSemaphoreCreateMutex();
+    g_uart_manager.applied = xSemaphoreCreateBinary();
+    if (!g_uart_manager.apply_lock || !g_uart_manager.applied) {
+        ESP_LOGE(TAG, "Failed to create UART command locks");
+        return ESP_ERR_NO_MEM;
+    }
+
     // Initialize all channels
     system_config_t* config = config_get_instance();
 
@@ -93,6 +185,13 @@ esp_err_t uart_manager_init(void) {
         channel->sequence_number = 0;
         channel->last_activity = 0;
         memset(&channel->stats, 0, sizeof(uart_stats_t));
+        channel->baud_rate = config->uart_config[i].baud_rate;
+
+        g_uart_manager.command_queues[i] = xQueueCreate(UART_COMMAND_QUEUE_SIZE, sizeof(uart_command_t));
+        if (!g_uart_manager.command_queues[i]) {
+            ESP_LOGE(TAG, "Failed to create command queue for UART%d", i);
+            return ESP_ERR_NO_MEM;
+        }
 
         if (config->uart_config[i].enabled) {
             // Create ring buffer
@@ -150,22 +249,49 @@ esp_err_t uart_manager_start_channel(uint8_t port) {
 
     uart_channel_context_t* channel = &g_uart_manager.channels[port];
 
+    xSemaphoreTake(g_uart_manager.apply_lock, portMAX_DELAY);
+
     if (channel->active) {
+        xSemaphoreGive(g_uart_manager.apply_lock);
         ESP_LOGW(TAG, "UART%d already active", port);
         return ESP_OK;
     }
 
-    // Create task for this channel
+    // Ports enabled after boot get their buffer and driver here
+    esp_err_t ret = ESP_OK;
+    if (!channel->ring_buffer) {
+        channel->ring_buffer = xRingbufferCreate(UART_RING_BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
+        if (!channel->ring_buffer) {
+            ESP_LOGE(TAG, "Failed to create ring buffer for UART%d", port);
+            ret = ESP_ERR_NO_MEM;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = hal_uart_is_initialized(port) ? hal_uart_set_baud_rate(port, channel->baud_rate) :
+                                              hal_uart_init(port, channel->baud_rate);
+    }
+    if (ret != ESP_OK) {
+        xSemaphoreGive(g_uart_manager.apply_lock);
+        return ret;
+    }
+
+    // Commands left by an apply that timed out would be stale now
+    xQueueReset(g_uart_manager.command_queues[port]);
+
+    // Create task for this channel; it runs while active is set
     char task_name[16];
     snprintf(task_name, sizeof(task_name), "uart%d_task", port);
 
-    BaseType_t ret = xTaskCreate(uart_task, task_name, 4096, channel, 5, &channel->task_handle);
-    if (ret != pdPASS) {
+    channel->active = true;
+    BaseType_t task_ret = xTaskCreate(uart_task, task_name, 4096, channel, 5, &channel->task_handle);
+    if (task_ret != pdPASS) {
+        channel->active = false;
+        xSemaphoreGive(g_uart_manager.apply_lock);
         ESP_LOGE(TAG, "Failed to create task for UART%d", port);
         return ESP_ERR_NO_MEM;
     }
 
-    channel->active = true;
+    xSemaphoreGive(g_uart_manager.apply_lock);
     ESP_LOGI(TAG, "UART%d started", port);
 
     return ESP_OK;
@@ -195,13 +321,29 @@ esp_err_t uart_manager_get_data(uint8_t port, uart_data_packet_t* packet, uint32
     return ESP_ERR_TIMEOUT;
 }
 
+esp_err_t uart_manager_get_stream_data(uart_data_packet_t* packet, uint32_t timeout_ms) {
+    if (!packet) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_uart_manager.stream_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xQueueReceive(g_uart_manager.stream_queue, packet, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) {
+        return ESP_OK;
+    }
+
+    return ESP_ERR_TIMEOUT;
+}
+
 esp_err_t uart_manager_get_stats(uint8_t port, uart_stats_t* stats) {
     if (port >= CONFIG_UART_PORT_COUNT || !stats) {
         return ESP_ERR_INVALID_ARG;
     }
 
     uart_channel_context_t* channel = &g_uart_manager.channels[port];
-    memcpy(stats, &channel->stats, sizeof(uart_stats_t));
+    stats_snapshot(stats, &channel->stats, sizeof(uart_stats_t));
 
     return ESP_OK;
 }
@@ -221,6 +363,8 @@ esp_err_t uart_manager_print_stats(void) {
                     channel->stats.error_count);
         }
     }
+    ESP_LOGI(TAG, "Stream tap: %lu packets dropped (no streaming client or client behind)",
+             g_uart_manager.stream_dropped);
 
     return ESP_OK;
 }
@@ -255,16 +399,20 @@ esp_err_t uart_manager_stop(void) {
     ESP_LOGI(TAG, "Stopping UART Manager");
 
     // Stop all channels
+    esp_err_t result = ESP_OK;
     for (int i = 0; i < CONFIG_UART_PORT_COUNT; i++) {
         if (g_uart_manager.channels[i].active) {
-            uart_manager_stop_channel(i);
+            esp_err_t ret = uart_manager_stop_channel(i);
+            if (ret != ESP_OK) {
+                result = ret;
+            }
         }
     }
 
     g_uart_manager.running = false;
     ESP_LOGI(TAG, "UART Manager stopped");
 
-    return ESP_OK;
+    return result;
 }
 
 esp_err_t uart_manager_stop_channel(uint8_t port) {
@@ -274,20 +422,77 @@ esp_err_t uart_manager_stop_channel(uint8_t port) {
 
     uart_channel_context_t* channel = &g_uart_manager.channels[port];
 
+    xSemaphoreTake(g_uart_manager.apply_lock, portMAX_DELAY);
+
     if (!channel->active) {
+        xSemaphoreGive(g_uart_manager.apply_lock);
         return ESP_OK;
     }
 
-    channel->active = false;
-
-    // Wait for task to finish
-    if (channel->task_handle) {
-        // Task will delete itself when active becomes false
-        vTaskDelay(pdMS_TO_TICKS(100));  // Give time for task to exit
-        channel->task_handle = NULL;
+    // The reader task leaves after its current read and acknowledges
+    uart_command_t command = {
+        .type = UART_COMMAND_STOP
+    };
+    esp_err_t ret = send_command(port, &command);
+    xSemaphoreGive(g_uart_manager.apply_lock);
+
+    // Only the reader clears active on its way out, so a reader that missed
+    // the deadline keeps the port busy and no second reader can start
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART%d did not stop: %s", port, esp_err_to_name(ret));
+        return ret;
     }
 
     ESP_LOGI(TAG, "UART%d stopped", port);
-
     return ESP_OK;
 }
+
+esp_err_t uart_manager_reconfigure_channel(uint8_t port, uint32_t baud_rate) {
+    if (port >= CONFIG_UART_PORT_COUNT || !CONFIG_VALIDATE_BAUD_RATE(baud_rate)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!g_uart_manager.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uart_channel_context_t* channel = &g_uart_manager.channels[port];
+
+    xSemaphoreTake(g_uart_manager.apply_lock, portMAX_DELAY);
+
+    esp_err_t ret = ESP_OK;
+    if (channel->active) {
+        uart_command_t command = {
+            .type = UART_COMMAND_SET_BAUD,
+            .baud_rate = baud_rate
+        };
+        ret = send_command(port, &command);
+    } else {
+        // Stopped port: the driver, if any, has no reader to disturb
+        if (hal_uart_is_initialized(port)) {
+            ret = hal_uart_set_baud_rate(port, baud_rate);
+        }
+        if (ret == ESP_OK) {
+            channel->baud_rate = baud_rate;
+        }
+    }
+
+    xSemaphoreGive(g_uart_manager.apply_lock);
+    return ret;
+}
+
+esp_err_t uart_manager_enable_channel(uint8_t port, bool enable) {
+    if (port >= CONFIG_UART_PORT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!enable) {
+        return uart_manager_stop_channel(port);
+    }
+
+    // A stopped manager starts the ports enabled in the configuration
+    if (!g_uart_manager.running) {
+        return ESP_OK;
+    }
+    return uart_manager_start_channel(port);
+}
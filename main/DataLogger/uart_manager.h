@@ -15,6 +15,9 @@ extern "C" {
 #define UART_BUFFER_SIZE            1024
 #define UART_RING_BUFFER_SIZE       (8 * 1024)  // 8KB per channel
 #define UART_MAX_PACKET_SIZE        256
+#define UART_STREAM_QUEUE_SIZE      8      // Copy of every packet for live streaming (all ports)
+#define UART_COMMAND_QUEUE_SIZE     2      // Pending reconfigurations per port
+#define UART_APPLY_TIMEOUT_MS       500    // Reader tasks check commands between 100 ms reads
 
 // UART Data Packet Structure
 typedef struct {
@@ -40,6 +43,7 @@ typedef struct {
     bool active;                // Channel active flag
     TaskHandle_t task_handle;   // Task handle for this channel
     RingbufHandle_t ring_buffer; // Ring buffer for data
+    uint32_t baud_rate;         // Baud rate in effect
     uint32_t sequence_number;   // Current sequence number
     uint64_t last_activity;     // Last activity timestamp
     uart_stats_t stats;         // Channel statistics
@@ -58,6 +62,7 @@ bool uart_manager_is_channel_active(uint8_t port);
 
 // Data Access
 esp_err_t uart_manager_get_data(uint8_t port, uart_data_packet_t* packet, uint32_t timeout_ms);
+esp_err_t uart_manager_get_stream_data(uart_data_packet_t* packet, uint32_t timeout_ms);
 size_t uart_manager_get_available_data(uint8_t port);
 esp_err_t uart_manager_flush_channel(uint8_t port);
 
@@ -67,6 +72,8 @@ esp_err_t uart_manager_reset_stats(uint8_t port);
 esp_err_t uart_manager_print_stats(void);
 
 // Configuration
+// A running port takes the change from its reader task between two reads;
+// the other ports keep reading. Returns once the change is in effect.
 esp_err_t uart_manager_reconfigure_channel(uint8_t port, uint32_t baud_rate);
 esp_err_t uart_manager_enable_channel(uint8_t port, bool enable);
 
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Web UI assets built into the firmware. The files in main/web are gzipped
+// at build time by main/web/embed_assets.py into a generated table, so the
+// server sends them as stored, without compressing or copying at runtime.
+// Strong ETags let browsers revalidate with a 304 instead of downloading.
+
+typedef struct {
+    const char* path;           // "/index.html", "/app.js"
+    const char* content_type;
+    const char* etag;           // Quoted, hash of the uncompressed bytes
+    const char* cache_control;  // Fingerprinted assets are immutable, the page revalidates
+    const uint8_t* data;        // Gzipped
+    size_t length;
+} web_asset_t;
+
+// Generated Asset Table
+extern const web_asset_t g_web_assets[];
+extern const size_t g_web_asset_count;
+
+#ifdef __cplusplus
+}
+#endif
@@ -9,6 +9,7 @@ import json
 import threading
 import queue
 import argparse
+import struct
 import sys
 from websocket import WebSocketApp
 
@@ -39,13 +40,48 @@ if INTERACTIVE_MODE:
     except Exception:
         pass  # Ignore if these settings aren't available
 
+# Binary stream frame (see stream_frame.h): magic, version, channel mask,
+# samples per channel, sequence, base timestamp (us), interval (us), then
+# one block of int16 millivolts per channel in the mask
+FRAME_HEADER = struct.Struct('<BBBBIQI')
+FRAME_MAGIC = 0xA5
+FRAME_VERSION = 1
+
+def decode_frame(frame):
+    """Decode one binary stream frame into (sequence, samples).
+    samples is a list of (channel, timestamp_us, voltage). Returns None for
+    frames this viewer does not understand."""
+    if len(frame) < FRAME_HEADER.size:
+        return None
+    magic, version, mask, count, sequence, base_us, interval_us = FRAME_HEADER.unpack_from(frame)
+    if magic != FRAME_MAGIC or version != FRAME_VERSION:
+        return None
+
+    channels = [ch for ch in range(8) if mask & (1 << ch)]
+    if len(frame) < FRAME_HEADER.size + len(channels) * count * 2:
+        return None
+
+    samples = []
+    offset = FRAME_HEADER.size
+    for ch in channels:
+        block = struct.unpack_from(f'<{count}h', frame, offset)
+        offset += count * 2
+        for k, millivolts in enumerate(block):
+            samples.append((ch, base_us + k * interval_us, millivolts / 1000.0))
+    return sequence, samples
+
 class ESP32DataLogger:
-    def __init__(self, host='192.168.86.100', port=80):
+    def __init__(self, host='192.168.86.100', port=80, binary=True, subscription=None):
         self.base_url = f'http://{host}:{port}'
-        self.ws_url = f'ws://{host}:{port}/ws'  # WebSocket runs on same HTTP server port
+        self.binary = binary
+        self.subscription = subscription
+        # WebSocket runs on same HTTP server port
+        self.ws_url = f'ws://{host}:{port}/ws' + ('?format=binary' if binary else '')
         self.data_queue = queue.Queue()
         self.ws = None
         self.running = False
+        self.last_sequence = None
+        self.lost_frames = 0
 
     def get_latest_data(self):
         """Fallback HTTP method with timeout and error handling"""
@@ -57,12 +93,44 @@ class ESP32DataLogger:
             # Return None on any network error - don't print to avoid spam
             return None
 
+    def get_history(self, channel, seconds, points=500):
+        """Last seconds of one channel from the device's history ring, downsampled on the device"""
+        try:
+            response = requests.get(f'{self.base_url}/api/data/history',
+                                    params={'ch': channel, 'from': -int(seconds * 1e6), 'points': points},
+                                    timeout=2)
+            response.raise_for_status()
+            return response.json()
+        except requests.exceptions.RequestException:
+            return None
+
     def on_message(self, _ws, message):
         """WebSocket message handler"""
+        if isinstance(message, bytes):
+            decoded = decode_frame(message)
+            if decoded is None:
+                return
+            sequence, samples = decoded
+            if self.last_sequence is not None and sequence != (self.last_sequence + 1) & 0xFFFFFFFF:
+                self.lost_frames += (sequence - self.last_sequence - 1) & 0xFFFFFFFF
+            self.last_sequence = sequence
+            for channel, timestamp_us, voltage in samples:
+                self.data_queue.put({'type': 'data', 'channel': channel,
+                                     'timestamp': timestamp_us, 'voltage': voltage, 'device_time': True})
+            return
         try:
             data = json.loads(message)
             if data.get('type') == 'data':
                 self.data_queue.put(data)
+            elif data.get('type') == 'samples':
+                # Subscribed JSON stream: blocks of millivolts per channel
+                for channel, block in data['channels'].items():
+                    for k, millivolts in enumerate(block):
+                        self.data_queue.put({'type': 'data', 'channel': int(channel),
+                                             'timestamp': data['timestamp'] + k * data['interval_us'],
+                                             'voltage': millivolts / 1000.0, 'device_time': True})
+            elif data.get('type') in ('subscription_ack', 'error'):
+                print(f"Server: {message}")
         except json.JSONDecodeError:
             print(f"Invalid JSON received: {message}")
 
@@ -71,13 +139,18 @@ class ESP32DataLogger:
 
     def on_close(self, _ws, _close_status_code, _close_msg):
         print("WebSocket connection closed")
+        if self.binary and self.lost_frames:
+            print(f"Frames lost in transit: {self.lost_frames}")
         self.running = False
 
     def on_open(self, ws):
         print("WebSocket connection opened")
         self.running = True
-        # Send initial message to register as client
-        ws.send('{"type":"connect","message":"Python client connected"}')
+        if self.subscription:
+            ws.send(json.dumps(self.subscription))
+        else:
+            # Send initial message to register as client
+            ws.send('{"type":"connect","message":"Python client connected"}')
 
     def start_websocket(self):
         """Start WebSocket connection in a separate thread"""
@@ -115,6 +188,15 @@ def parse_arguments():
                        type=int,
                        default=80,
                        help='Port number of the ESP32 HTTP server (default: 80)')
+    parser.add_argument('--json',
+                       action='store_true',
+                       help='Use the JSON WebSocket messages instead of binary sample frames')
+    parser.add_argument('--rate',
+                       type=int,
+                       help='Ask the device to reduce the stream to this many periods per second')
+    parser.add_argument('--minmax',
+                       action='store_true',
+                       help='With --rate, send the min and max of each period instead of one sample')
     return parser.parse_args()
 
 # Parse arguments
@@ -129,7 +211,12 @@ else:
 print(f"Connecting to ESP32 at {args.ip}:{args.port}")
 
 # Real-time plotting with WebSocket
-logger = ESP32DataLogger(host=args.ip, port=args.port)
+subscription = None
+if args.rate is not None:
+    subscription = {'type': 'subscribe', 'rate_limit': args.rate,
+                    'reduce': 'minmax' if args.minmax else 'decimate',
+                    'format': 'json' if args.json else 'binary'}
+logger = ESP32DataLogger(host=args.ip, port=args.port, binary=not args.json, subscription=subscription)
 
 # Data storage for plotting - separate timestamps for each channel (4 channels)
 adc_data = {
@@ -304,6 +391,18 @@ if logger.start_websocket():
     last_plot_time = time.time()
     plot_interval = 0.1  # Update plot every 100ms
     time_window = 10.0   # Show last 10 seconds of data
+    device_offset = None  # Host plot time minus device time, set by the first binary sample
+
+    # Start with a full window from the device's history instead of an empty plot
+    for channel in adc_data:
+        history = logger.get_history(channel, time_window)
+        if not history:
+            continue
+        if device_offset is None:
+            device_offset = (time.time() - start_time) - history['now_us'] / 1e6
+        for timestamp_us, voltage in history['points']:
+            adc_data[channel]['timestamps'].append(device_offset + timestamp_us / 1e6)
+            adc_data[channel]['voltages'].append(voltage)
 
     while running:
         try:
@@ -317,6 +416,12 @@ if logger.start_websocket():
             data = logger.data_queue.get_nowait()
 
             current_time = time.time() - start_time
+            if data.get('device_time'):
+                # Binary frames carry exact sample times; keep their spacing
+                device_seconds = data['timestamp'] / 1e6
+                if device_offset is None:
+                    device_offset = current_time - device_seconds
+                current_time = device_offset + device_seconds
             channel = data['channel']
             voltage = data['voltage']
 
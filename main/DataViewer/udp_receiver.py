@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""
+Receiver for the ESP32 UDP stream (POST /api/config/udp to enable it).
+
+Prints once a second what the stream looks like from this host:
+  - loss and reordering, from gaps in the datagram sequence
+  - batching delay on the device (oldest sample to send)
+  - jitter: arrival time minus device send time, relative to the smallest
+    such offset seen, so the unknown clock offset cancels out
+  - one-way latency, when the device clock is SNTP-synced (flag bit 0) and
+    this host is synced too
+
+Usage:
+  python udp_receiver.py                          # unicast to this host, port 5005
+  python udp_receiver.py --group 239.255.0.1      # join the default multicast group
+  python udp_receiver.py --simulate --drop 0.02   # local stand-in sender, 2% loss
+"""
+
+import argparse
+import random
+import socket
+import struct
+import threading
+import time
+
+DATAGRAM = struct.Struct('<BBBBIQQ')   # stream_udp_header_t, 24 bytes
+FRAME = struct.Struct('<BBBBIQI')      # stream_frame_header_t, 20 bytes
+DATAGRAM_MAGIC = 0x5A
+FRAME_MAGIC = 0xA5
+FLAG_WALL_CLOCK = 0x01
+
+
+def parse_datagram(data):
+    """Return (header fields, list of frames) or None for a foreign packet.
+    Each frame is (base_timestamp_us, interval_us, {channel: [millivolts]})."""
+    if len(data) < DATAGRAM.size:
+        return None
+    magic, version, frame_count, flags, sequence, uptime_us, unix_us = DATAGRAM.unpack_from(data)
+    if magic != DATAGRAM_MAGIC or version != 1:
+        return None
+
+    frames = []
+    offset = DATAGRAM.size
+    for _ in range(frame_count):
+        if offset + FRAME.size > len(data):
+            return None
+        magic, _, mask, samples, _, base_us, interval_us = FRAME.unpack_from(data, offset)
+        if magic != FRAME_MAGIC:
+            return None
+        offset += FRAME.size
+        blocks = {}
+        for channel in range(8):
+            if mask & (1 << channel):
+                blocks[channel] = list(struct.unpack_from(f'<{samples}h', data, offset))
+                offset += samples * 2
+        frames.append((base_us, interval_us, blocks))
+
+    header = {'sequence': sequence, 'flags': flags, 'uptime_us': uptime_us, 'unix_us': unix_us}
+    return header, frames
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+class StreamStats:
+    """Loss, reordering, delay and jitter over one report interval"""
+
+    def __init__(self):
+        self.expected = None      # Next sequence number
+        self.min_offset_us = None
+        self.reset()
+
+    def reset(self):
+        self.received = 0
+        self.lost = 0
+        self.reordered = 0
+        self.samples = 0
+        self.batching_us = []
+        self.jitter_us = []
+        self.latency_us = []
+
+    def add(self, header, frames, arrival_unix_us, arrival_mono_us):
+        self.received += 1
+        sequence = header['sequence']
+        if self.expected is None or sequence >= self.expected:
+            if self.expected is not None:
+                self.lost += sequence - self.expected
+            self.expected = sequence + 1
+        else:
+            # Late datagram counted as lost earlier
+            self.reordered += 1
+            self.lost = max(0, self.lost - 1)
+
+        if frames:
+            self.samples += sum(len(next(iter(blocks.values()), [])) for _, _, blocks in frames)
+            self.batching_us.append(header['uptime_us'] - frames[0][0])
+
+        offset = arrival_mono_us - header['uptime_us']
+        if self.min_offset_us is None or offset < self.min_offset_us:
+            self.min_offset_us = offset
+        self.jitter_us.append(offset - self.min_offset_us)
+
+        if header['flags'] & FLAG_WALL_CLOCK:
+            self.latency_us.append(arrival_unix_us - header['unix_us'])
+
+    def report(self, seconds):
+        total = self.received + self.lost
+        loss = 100.0 * self.lost / total if total else 0.0
+        line = (f"{self.received / seconds:6.1f} dgram/s  {self.samples / seconds:7.0f} scans/s  "
+                f"loss {self.lost} ({loss:.2f}%)  reordered {self.reordered}  "
+                f"batching p50 {percentile(self.batching_us, 0.5) / 1000:.1f} ms  "
+                f"jitter p50/p99/max {percentile(self.jitter_us, 0.5) / 1000:.1f}/"
+                f"{percentile(self.jitter_us, 0.99) / 1000:.1f}/"
+                f"{max(self.jitter_us, default=0) / 1000:.1f} ms")
+        if self.latency_us:
+            line += (f"  latency p50/p99 {percentile(self.latency_us, 0.5) / 1000:.1f}/"
+                     f"{percentile(self.latency_us, 0.99) / 1000:.1f} ms")
+        print(line)
+        self.reset()
+
+
+def simulate_sender(port, drop, interval_ms, stop):
+    """Send datagrams like the device: 4 channels at 1 kHz, one every interval_ms"""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    start = time.monotonic()
+    sequence = 0
+    frame_sequence = 0
+    next_scan_us = 0
+    while not stop.is_set():
+        time.sleep(interval_ms / 1000.0)
+        now_us = int((time.monotonic() - start) * 1e6)
+        scans = max(1, (now_us - next_scan_us) // 1000)
+        frame = FRAME.pack(FRAME_MAGIC, 1, 0x0F, scans, frame_sequence, next_scan_us, 1000)
+        for channel in range(4):
+            frame += struct.pack(f'<{scans}h', *[1000 + 250 * channel] * scans)
+        next_scan_us += scans * 1000
+        frame_sequence += 1
+        header = DATAGRAM.pack(DATAGRAM_MAGIC, 1, 1, FLAG_WALL_CLOCK, sequence,
+                               now_us, int(time.time() * 1e6))
+        sequence += 1
+        if random.random() >= drop:
+            sock.sendto(header + frame, ('127.0.0.1', port))
+    sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='ESP32 UDP stream receiver')
+    parser.add_argument('--port', type=int, default=5005)
+    parser.add_argument('--group', help='Multicast group to join, e.g. 239.255.0.1')
+    parser.add_argument('--interface', default='0.0.0.0', help='Local address for the multicast join')
+    parser.add_argument('--simulate', action='store_true', help='Run a local stand-in sender')
+    parser.add_argument('--drop', type=float, default=0.0, help='Loss probability for --simulate')
+    parser.add_argument('--interval', type=int, default=5, help='Send interval (ms) for --simulate')
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, 1 << 20)
+    sock.bind(('', args.port))
+    if args.group:
+        membership = socket.inet_aton(args.group) + socket.inet_aton(args.interface)
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    sock.settimeout(0.2)
+
+    stop = threading.Event()
+    if args.simulate:
+        threading.Thread(target=simulate_sender, args=(args.port, args.drop, args.interval, stop),
+                         daemon=True).start()
+
+    print(f"Listening on UDP port {args.port}" + (f", group {args.group}" if args.group else ""))
+    stats = StreamStats()
+    # Jitter needs a steady clock; its origin does not matter
+    clock_origin = time.monotonic()
+    report_start = time.monotonic()
+    try:
+        while True:
+            try:
+                data, _ = sock.recvfrom(2048)
+                arrival_mono_us = int((time.monotonic() - clock_origin) * 1e6)
+                arrival_unix_us = int(time.time() * 1e6)
+                parsed = parse_datagram(data)
+                if parsed:
+                    stats.add(parsed[0], parsed[1], arrival_unix_us, arrival_mono_us)
+            except socket.timeout:
+                pass
+
+            elapsed = time.monotonic() - report_start
+            if elapsed >= 1.0:
+                stats.report(elapsed)
+                report_start = time.monotonic()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        stop.set()
+        sock.close()
+
+
+if __name__ == '__main__':
+    main()
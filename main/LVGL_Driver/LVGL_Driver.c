@@ -17,11 +17,16 @@ void example_increase_lvgl_tick(void *arg)
     lv_tick_inc(EXAMPLE_LVGL_TICK_PERIOD_MS);
 }
 
+// One band of a flush has been sent; the flush callback waits for this.
+// Without the arbiter the whole area went out as one transfer.
 bool example_notify_lvgl_flush_ready(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
 {
-    lv_disp_drv_t *disp_driver = (lv_disp_drv_t *)user_ctx;
-    lv_disp_flush_ready(disp_driver);
-    return false;
+    if (!spi_arbiter_is_initialized()) {
+        lv_disp_drv_t *disp_driver = (lv_disp_drv_t *)user_ctx;
+        lv_disp_flush_ready(disp_driver);
+        return false;
+    }
+    return spi_arbiter_lcd_chunk_done_from_isr();
 }
 
 void example_lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map)
@@ -29,10 +34,38 @@ void example_lvgl_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t
     esp_lcd_panel_handle_t panel_handle = (esp_lcd_panel_handle_t) drv->user_data;
     int offsetx1 = area->x1;
     int offsetx2 = area->x2;
-    int offsety1 = area->y1;
-    int offsety2 = area->y2;
-    // copy a buffer's content to a specific area of the display
-    esp_lcd_panel_draw_bitmap(panel_handle, offsetx1 + Offset_X, offsety1 + Offset_Y, offsetx2 + Offset_X + 1, offsety2 + Offset_Y + 1, color_map);
+
+    // No bus arbiter: one transfer, completed by the panel IO callback
+    if (!spi_arbiter_is_initialized()) {
+        esp_lcd_panel_draw_bitmap(panel_handle, offsetx1 + Offset_X, area->y1 + Offset_Y, offsetx2 + Offset_X + 1, area->y2 + Offset_Y + 1, color_map);
+        return;
+    }
+
+    int width = offsetx2 - offsetx1 + 1;
+    int rows_per_band = SPI_ARBITER_LCD_CHUNK_BYTES / (width * sizeof(lv_color_t));
+    if (rows_per_band < 1) {
+        rows_per_band = 1;
+    }
+
+    // copy the buffer in bands of about one bus transfer, giving the shared
+    // SPI bus back between bands so SD writes are not held off by a redraw
+    for (int y = area->y1; y <= area->y2; y += rows_per_band) {
+        int band_end = y + rows_per_band - 1;
+        if (band_end > area->y2) {
+            band_end = area->y2;
+        }
+        spi_arbiter_acquire(SPI_CLIENT_LCD);
+        spi_arbiter_lcd_begin_chunk();
+        if (esp_lcd_panel_draw_bitmap(panel_handle, offsetx1 + Offset_X, y + Offset_Y, offsetx2 + Offset_X + 1, band_end + Offset_Y + 1,
+                                      color_map + (y - area->y1) * width) == ESP_OK) {
+            // DMA reads color_map until the band is done; neither the bus nor
+            // the buffer may be handed on before that
+            while (spi_arbiter_lcd_wait_chunk() == ESP_ERR_TIMEOUT) {
+            }
+        }
+        spi_arbiter_release(SPI_CLIENT_LCD);
+    }
+    lv_disp_flush_ready(drv);
 }
 
 /* Rotate display and touch, when rotated screen in LVGL. Called when driver parameters are updated. */
@@ -9,6 +9,7 @@
 #include "demos/lv_demos.h"
 
 #include "ST7789.h"
+#include "SPI_Arbiter.h"
 
 #define LVGL_BUF_LEN  (EXAMPLE_LCD_H_RES * 20)
 #define EXAMPLE_LVGL_TICK_PERIOD_MS    2
@@ -8,6 +8,8 @@ static const char *SD_TAG = "SD";
 uint32_t Flash_Size = 0;
 uint32_t SDCard_Size = 0;
 
+static sdmmc_card_t *s_card = NULL;
+
 esp_err_t s_example_write_file(const char *path, char *data)
 {
     ESP_LOGI(SD_TAG, "Opening file %s", path);
@@ -23,6 +25,16 @@ esp_err_t s_example_write_file(const char *path, char *data)
     return ESP_OK;
 }
 
+// Every SD command takes the shared bus through the arbiter, so LCD
+// flushes can only delay it by one band
+static esp_err_t sd_arbitrated_transaction(int slot, sdmmc_command_t *cmdinfo)
+{
+    spi_arbiter_acquire(SPI_CLIENT_SD);
+    esp_err_t ret = sdspi_host_do_transaction(slot, cmdinfo);
+    spi_arbiter_release(SPI_CLIENT_SD);
+    return ret;
+}
+
 esp_err_t s_example_read_file(const char *path)
 {
     ESP_LOGI(SD_TAG, "Reading file %s", path);
@@ -46,7 +58,7 @@ esp_err_t s_example_read_file(const char *path)
 }
 
 
-void SD_Init(void)
+void SD_Init(bool high_speed)
 {
     esp_err_t ret;
 
@@ -54,7 +66,7 @@ void SD_Init(void)
     // If format_if_mount_failed is set to true, SD card will be partitioned and formatted in case when mounting fails.  false true
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
         .format_if_mount_failed = true,          
-        .max_files = 5,
+        .max_files = 14,                         // 5 stream logs + 3 rollup tiers + catalog, journal, probe, download, bench
         .allocation_unit_size = 16 * 1024
     };
     sdmmc_card_t *card;
@@ -67,9 +79,13 @@ void SD_Init(void)
     ESP_LOGI(SD_TAG, "Using SPI peripheral");
 
     // By default, SD card frequency is initialized to SDMMC_FREQ_DEFAULT (20MHz)
-    // For setting a specific frequency, use host.max_freq_khz (range 400kHz - 20MHz for SDSPI)
-    // Example: for fixed frequency of 10MHz, use host.max_freq_khz = 10000;
+    // The high-speed profile raises host.max_freq_khz; card init only switches
+    // to it when the card reports high-speed support
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+    host.do_transaction = &sd_arbitrated_transaction;
+    if (high_speed) {
+        host.max_freq_khz = SD_HS_FREQ_KHZ;
+    }
     
     spi_bus_config_t bus_cfg = {
         .mosi_io_num = PIN_NUM_MOSI,
@@ -77,7 +93,7 @@ void SD_Init(void)
         .sclk_io_num = PIN_NUM_SCLK,
         .quadwp_io_num = -1,
         .quadhd_io_num = -1,
-        .max_transfer_sz = 4000,
+        .max_transfer_sz = high_speed ? SD_HS_MAX_TRANSFER_SZ : SD_DEFAULT_MAX_TRANSFER_SZ,
     };
     ret = spi_bus_initialize(host.slot, &bus_cfg, SDSPI_DEFAULT_DMA);
     if (ret != ESP_OK) {
@@ -85,6 +101,11 @@ void SD_Init(void)
         return;
     }
 
+    // The LCD attaches to this bus later; both go through the arbiter
+    if (spi_arbiter_init() != ESP_OK) {
+        ESP_LOGE(SD_TAG, "Failed to initialize SPI bus arbiter.");
+    }
+
     // This initializes the slot without card detect (CD) and write protect (WP) signals.
     // Modify slot_config.gpio_cd and slot_config.gpio_wp if your board has these signals.
     sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
@@ -93,6 +114,12 @@ void SD_Init(void)
 
     ESP_LOGI(SD_TAG, "Mounting filesystem");
     ret = esp_vfs_fat_sdspi_mount(mount_point, &host, &slot_config, &mount_config, &card);
+    if (ret != ESP_OK && ret != ESP_FAIL && high_speed) {
+        // Card did not come up at the high-speed clock, retry with the default one
+        ESP_LOGW(SD_TAG, "High-speed mount failed (%s), retrying at default speed", esp_err_to_name(ret));
+        host.max_freq_khz = SDMMC_FREQ_DEFAULT;
+        ret = esp_vfs_fat_sdspi_mount(mount_point, &host, &slot_config, &mount_config, &card);
+    }
 
     if (ret != ESP_OK) {
         if (ret == ESP_FAIL) {
@@ -109,6 +136,12 @@ void SD_Init(void)
     // Card has been initialized, print its properties
     sdmmc_card_print_info(stdout, card);
     SDCard_Size = ((uint64_t) card->csd.capacity) * card->csd.sector_size / (1024 * 1024);
+    s_card = card;
+}
+
+sdmmc_card_t *SD_Get_Card(void)
+{
+    return s_card;
 }
 void Flash_Searching(void)
 {
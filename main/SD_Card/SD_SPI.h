@@ -9,12 +9,20 @@
 #include "esp_flash.h"
 
 #include "ST7789.h"
+#include "SPI_Arbiter.h"
 
 #define PIN_NUM_MOSI    EXAMPLE_PIN_NUM_MOSI    
 #define PIN_NUM_MISO    5    
 #define PIN_NUM_SCLK    EXAMPLE_PIN_NUM_SCLK    
 #define PIN_NUM_CS      4            
 
+// Bus profiles. The default profile keeps the 20 MHz SDSPI clock; the
+// high-speed profile asks for 40 MHz (used only if the card supports it)
+// and sizes DMA transfers in whole sectors.
+#define SD_DEFAULT_MAX_TRANSFER_SZ    4000
+#define SD_HS_FREQ_KHZ                SDMMC_FREQ_HIGHSPEED
+#define SD_HS_MAX_TRANSFER_SZ         (16 * 512)
+
 esp_err_t SD_Card_CS_EN(void);
 esp_err_t SD_Card_CS_Dis(void);
 
@@ -23,5 +31,6 @@ esp_err_t s_example_read_file(const char *path);
 
 extern uint32_t SDCard_Size;
 extern uint32_t Flash_Size;
-void SD_Init(void);
+void SD_Init(bool high_speed);
+sdmmc_card_t *SD_Get_Card(void);
 void Flash_Searching(void);
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "SPI_Arbiter.h"
+#include "stats_snapshot.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG_SPI = "SPI_ARB";
+
+// Arbiter State
+typedef struct {
+    bool initialized;
+    SemaphoreHandle_t bus_mutex;        // Bus token
+    SemaphoreHandle_t lcd_chunk_done;   // Given when an LCD band's transfer completes
+    volatile uint32_t sd_pending;       // SD commands waiting for the token
+    volatile bool lcd_waiting;
+    uint32_t sd_burst;                  // SD grants since the LCD last had the bus
+    uint64_t grant_time[SPI_CLIENT_COUNT];
+    uint64_t init_time;
+    spi_client_stats_t stats[SPI_CLIENT_COUNT];
+} spi_arbiter_state_t;
+
+static spi_arbiter_state_t g_arbiter = {0};
+
+static const char *const g_client_names[SPI_CLIENT_COUNT] = {"SD", "LCD"};
+
+esp_err_t spi_arbiter_init(void)
+{
+    if (g_arbiter.initialized) {
+        return ESP_OK;
+    }
+
+    g_arbiter.bus_mutex = xSemaphoreCreateMutex();
+    g_arbiter.lcd_chunk_done = xSemaphoreCreateBinary();
+    if (!g_arbiter.bus_mutex || !g_arbiter.lcd_chunk_done) {
+        ESP_LOGE(TAG_SPI, "Failed to create arbiter semaphores");
+        return ESP_ERR_NO_MEM;
+    }
+
+    g_arbiter.init_time = esp_timer_get_time();
+    g_arbiter.initialized = true;
+    return ESP_OK;
+}
+
+bool spi_arbiter_is_initialized(void)
+{
+    return g_arbiter.initialized;
+}
+
+void spi_arbiter_acquire(spi_client_t client)
+{
+    if (!g_arbiter.initialized || client >= SPI_CLIENT_COUNT) {
+        return;
+    }
+
+    uint64_t start = esp_timer_get_time();
+
+    if (client == SPI_CLIENT_SD) {
+        // Let one LCD band through after a long SD burst
+        if (g_arbiter.lcd_waiting && g_arbiter.sd_burst >= SPI_ARBITER_SD_BURST) {
+            g_arbiter.stats[SPI_CLIENT_SD].yields++;
+            g_arbiter.sd_burst = 0;
+            vTaskDelay(1);
+        }
+        __atomic_fetch_add(&g_arbiter.sd_pending, 1, __ATOMIC_RELAXED);
+        xSemaphoreTake(g_arbiter.bus_mutex, portMAX_DELAY);
+        __atomic_fetch_sub(&g_arbiter.sd_pending, 1, __ATOMIC_RELAXED);
+        g_arbiter.sd_burst++;
+    } else {
+        g_arbiter.lcd_waiting = true;
+        xSemaphoreTake(g_arbiter.bus_mutex, portMAX_DELAY);
+        g_arbiter.lcd_waiting = false;
+        g_arbiter.sd_burst = 0;
+    }
+
+    uint64_t now = esp_timer_get_time();
+    uint32_t wait_us = (uint32_t)(now - start);
+    spi_client_stats_t *stats = &g_arbiter.stats[client];
+    stats->grants++;
+    stats->wait_us += wait_us;
+    if (wait_us > stats->max_wait_us) {
+        stats->max_wait_us = wait_us;
+    }
+    g_arbiter.grant_time[client] = now;
+}
+
+void spi_arbiter_release(spi_client_t client)
+{
+    if (!g_arbiter.initialized || client >= SPI_CLIENT_COUNT) {
+        return;
+    }
+
+    g_arbiter.stats[client].busy_us += esp_timer_get_time() - g_arbiter.grant_time[client];
+    if (client == SPI_CLIENT_LCD && g_arbiter.sd_pending > 0) {
+        g_arbiter.stats[client].yields++;
+    }
+    xSemaphoreGive(g_arbiter.bus_mutex);
+}
+
+bool spi_arbiter_lcd_chunk_done_from_isr(void)
+{
+    if (!g_arbiter.initialized) {
+        return false;
+    }
+
+    BaseType_t high_task_woken = pdFALSE;
+    xSemaphoreGiveFromISR(g_arbiter.lcd_chunk_done, &high_task_woken);
+    return high_task_woken == pdTRUE;
+}
+
+void spi_arbiter_lcd_begin_chunk(void)
+{
+    if (g_arbiter.initialized) {
+        xSemaphoreTake(g_arbiter.lcd_chunk_done, 0);
+    }
+}
+
+esp_err_t spi_arbiter_lcd_wait_chunk(void)
+{
+    if (!g_arbiter.initialized) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xSemaphoreTake(g_arbiter.lcd_chunk_done, pdMS_TO_TICKS(SPI_ARBITER_LCD_CHUNK_TIMEOUT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG_SPI, "LCD transfer still running after %d ms", SPI_ARBITER_LCD_CHUNK_TIMEOUT_MS);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t spi_arbiter_get_stats(spi_client_t client, spi_client_stats_t *stats)
+{
+    if (!stats || client >= SPI_CLIENT_COUNT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    stats_snapshot(stats, &g_arbiter.stats[client], sizeof(spi_client_stats_t));
+    uint64_t elapsed_us = esp_timer_get_time() - g_arbiter.init_time;
+    stats->utilisation_pct = (g_arbiter.initialized && elapsed_us > 0) ?
+        (uint32_t)(stats->busy_us * 100 / elapsed_us) : 0;
+    return ESP_OK;
+}
+
+void spi_arbiter_print_stats(void)
+{
+    for (int client = 0; client < SPI_CLIENT_COUNT; client++) {
+        spi_client_stats_t stats;
+        spi_arbiter_get_stats(client, &stats);
+        ESP_LOGI(TAG_SPI, "%s: %lu grants, %lu%% busy, wait %llu us total / %lu us max, %lu yields",
+                 g_client_names[client], stats.grants, stats.utilisation_pct,
+                 stats.wait_us, stats.max_wait_us, stats.yields);
+    }
+}
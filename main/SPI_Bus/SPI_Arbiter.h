@@ -0,0 +1,62 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Scheduler for the SPI host shared by the SD card and the ST7789 LCD.
+// Every SD command (SD_Init routes the sdspi host through here) and every
+// LCD band takes the bus token. LCD flushes are split into bands of about
+// one bus transfer and give the token back between bands, so a waiting SD
+// command (from a higher priority task) gets the bus within one band time.
+// Under sustained SD traffic the SD side steps back for one tick after
+// SPI_ARBITER_SD_BURST grants in a row while the LCD waits, so the display
+// keeps moving.
+
+// Bus Clients
+typedef enum {
+    SPI_CLIENT_SD = 0,
+    SPI_CLIENT_LCD,
+    SPI_CLIENT_COUNT
+} spi_client_t;
+
+// Arbiter Configuration
+#define SPI_ARBITER_LCD_CHUNK_BYTES         4000   // Fits either SD bus profile's max_transfer_sz, ~2.7 ms at 12 MHz
+#define SPI_ARBITER_SD_BURST                16     // SD grants in a row before a waiting LCD band goes out
+#define SPI_ARBITER_LCD_CHUNK_TIMEOUT_MS    100
+
+// Per-client Statistics
+typedef struct {
+    uint32_t grants;            // Times the client got the bus
+    uint64_t busy_us;           // Time holding the bus
+    uint64_t wait_us;           // Time waiting for the bus
+    uint32_t max_wait_us;       // Worst wait (SD: the latency bound actually seen)
+    uint32_t yields;            // LCD: bands ended with SD waiting; SD: bursts cut for the LCD
+    uint32_t utilisation_pct;   // busy_us as a share of time since init
+} spi_client_stats_t;
+
+// Arbiter Functions
+esp_err_t spi_arbiter_init(void);
+bool spi_arbiter_is_initialized(void);
+void spi_arbiter_acquire(spi_client_t client);
+void spi_arbiter_release(spi_client_t client);
+
+// LCD band completion: signalled from the panel IO callback, waited on by
+// the flush. begin_chunk drops a completion left over from an earlier band
+// before the next one is queued. wait_chunk returns ESP_ERR_TIMEOUT after
+// SPI_ARBITER_LCD_CHUNK_TIMEOUT_MS with the transfer still running; the
+// band's buffer and the bus stay in use until it reports ESP_OK.
+bool spi_arbiter_lcd_chunk_done_from_isr(void);
+void spi_arbiter_lcd_begin_chunk(void);
+esp_err_t spi_arbiter_lcd_wait_chunk(void);
+
+esp_err_t spi_arbiter_get_stats(spi_client_t client, spi_client_stats_t* stats);
+void spi_arbiter_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
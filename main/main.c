@@ -66,7 +66,7 @@ static esp_err_t system_init(void) {
     // TODO Ian: POTENTIAL CONFLICT - SD_Init() here conflicts with storage_manager_init()
     // in DataLogger if both try to mount SD card filesystem
     ESP_LOGI(TAG, "Initializing SD...");
-    SD_Init();
+    SD_Init(config->storage_config.sd_high_speed);
 
     ESP_LOGI(TAG, "Initializing LCD...");
     LCD_Init();
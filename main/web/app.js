@@ -0,0 +1,22 @@
+function runTest() {
+  fetch('/api/test').then(r => r.json()).then(d => {
+    document.getElementById('results').innerHTML = '<div class="data">Test Status: ' + d.status + '</div>';
+  });
+}
+function getStatus() {
+  fetch('/api/status').then(r => r.json()).then(d => {
+    document.getElementById('results').innerHTML = '<div class="data">Uptime: ' + d.uptime_seconds + 's<br>Free Heap: ' + d.system.free_heap + ' bytes</div>';
+  });
+}
+function getData() {
+  fetch('/api/data/latest').then(r => r.json()).then(d => {
+    let html = '<div class="data"><h3>Latest Data</h3>';
+    if (d.adc) {
+      for (let ch in d.adc) {
+        html += ch + ': ' + d.adc[ch].voltage + 'V<br>';
+      }
+    }
+    html += '</div>';
+    document.getElementById('results').innerHTML = html;
+  });
+}
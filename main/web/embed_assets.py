@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""Gzip the web UI into a C table the HTTP server serves from flash.
+
+Usage: embed_assets.py <output.c> <asset>...
+
+Runs as a build step (see main/CMakeLists.txt). Every asset is stored
+gzipped with a strong ETag derived from its bytes. index.html is rewritten
+to load the other assets as <name>?v=<etag>, so those can be cached for a
+year while a firmware update still brings new ones; index.html itself is
+revalidated on every load and answered with 304 while it is unchanged.
+"""
+import gzip
+import hashlib
+import os
+import sys
+
+CONTENT_TYPES = {
+    '.html': 'text/html',
+    '.js': 'application/javascript',
+    '.css': 'text/css',
+    '.svg': 'image/svg+xml',
+    '.ico': 'image/x-icon',
+}
+
+INDEX = 'index.html'
+CACHE_REVALIDATE = 'no-cache'
+CACHE_IMMUTABLE = 'public, max-age=31536000, immutable'
+
+
+def etag(data):
+    return '"' + hashlib.sha256(data).hexdigest()[:16] + '"'
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('    ' + ', '.join(f'0x{b:02x}' for b in data[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit(__doc__)
+    output, paths = sys.argv[1], sys.argv[2:]
+
+    assets = {}
+    for path in paths:
+        name = os.path.basename(path)
+        extension = os.path.splitext(name)[1]
+        if extension not in CONTENT_TYPES:
+            sys.exit(f'{path}: no content type for {extension}')
+        with open(path, 'rb') as f:
+            assets[name] = f.read()
+
+    # Fingerprint references from the page, then gzip (mtime 0 keeps builds reproducible)
+    entries = []
+    versions = {name: etag(data).strip('"') for name, data in assets.items() if name != INDEX}
+    for name, data in assets.items():
+        if name == INDEX:
+            for other, version in versions.items():
+                data = data.replace(f'"{other}"'.encode(), f'"{other}?v={version}"'.encode())
+        packed = gzip.compress(data, compresslevel=9, mtime=0)
+        cache = CACHE_REVALIDATE if name == INDEX else CACHE_IMMUTABLE
+        entries.append((name, CONTENT_TYPES[os.path.splitext(name)[1]], etag(data), cache, packed, len(data)))
+
+    with open(output, 'w') as out:
+        out.write('// Generated by main/web/embed_assets.py, do not edit\n')
+        out.write('#include "web_assets.h"\n\n')
+        for i, (name, _, _, _, packed, size) in enumerate(entries):
+            out.write(f'// {name}: {size} bytes, {len(packed)} gzipped\n')
+            out.write(f'static const uint8_t g_asset_{i}[] = {{\n{c_bytes(packed)}\n}};\n\n')
+        out.write('const web_asset_t g_web_assets[] = {\n')
+        for i, (name, content_type, tag, cache, packed, _) in enumerate(entries):
+            tag_c = tag.replace('"', '\\"')
+            out.write(f'    {{ "/{name}", "{content_type}", "{tag_c}", "{cache}", '
+                      f'g_asset_{i}, sizeof(g_asset_{i}) }},\n')
+        out.write('};\n\n')
+        out.write(f'const size_t g_web_asset_count = {len(entries)};\n')
+
+
+if __name__ == '__main__':
+    main()
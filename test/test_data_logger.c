@@ -79,6 +79,15 @@ void test_adc_readings(void) {
     TEST_ASSERT_TRUE(result.passed);
 }
 
+void test_adc_hot_reconfiguration(void) {
+    ESP_LOGI(TAG, "Testing ADC hot reconfiguration");
+    
+    test_result_t result;
+    esp_err_t ret = test_adc_reconfigure(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
 void test_storage_operations(void) {
     ESP_LOGI(TAG, "Testing storage operations");
     
@@ -88,6 +97,15 @@ void test_storage_operations(void) {
     TEST_ASSERT_TRUE(result.passed);
 }
 
+void test_storage_reclaim_behind_open_file(void) {
+    ESP_LOGI(TAG, "Testing storage reclaim behind an open file");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_reclaim(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
 void test_network_functionality(void) {
     ESP_LOGI(TAG, "Testing network functionality");
     
@@ -97,6 +115,78 @@ void test_network_functionality(void) {
     TEST_ASSERT_TRUE(result.passed);
 }
 
+void test_download_range_parsing(void) {
+    ESP_LOGI(TAG, "Testing download Range header parsing");
+    
+    test_result_t result;
+    esp_err_t ret = test_range_header(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_stream_frame_encoding(void) {
+    ESP_LOGI(TAG, "Testing binary stream frames");
+    
+    test_result_t result;
+    esp_err_t ret = test_stream_frames(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_json_response_writer(void) {
+    ESP_LOGI(TAG, "Testing streaming JSON writer");
+    
+    test_result_t result;
+    esp_err_t ret = test_json_writer(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_stream_fanout_slow_client(void) {
+    ESP_LOGI(TAG, "Testing stream fan-out with a slow client");
+    
+    test_result_t result;
+    esp_err_t ret = test_stream_fanout(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_stream_subscription_views(void) {
+    ESP_LOGI(TAG, "Testing stream subscriptions and reduction");
+    
+    test_result_t result;
+    esp_err_t ret = test_stream_subscriptions(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_adc_history_downsampling(void) {
+    ESP_LOGI(TAG, "Testing ADC history downsampling");
+    
+    test_result_t result;
+    esp_err_t ret = test_adc_history(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_metrics_exposition(void) {
+    ESP_LOGI(TAG, "Testing metrics writer");
+    
+    test_result_t result;
+    esp_err_t ret = test_metrics_writer(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_stream_udp_datagrams(void) {
+    ESP_LOGI(TAG, "Testing UDP stream datagrams");
+    
+    test_result_t result;
+    esp_err_t ret = test_stream_udp(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
 void test_display_updates(void) {
     ESP_LOGI(TAG, "Testing display updates");
     
@@ -132,3 +222,120 @@ void test_uart_loopback(void) {
     TEST_ASSERT_EQUAL(ESP_OK, ret);
     TEST_ASSERT_TRUE(result.passed);
 }
+
+void test_storage_compression_roundtrip(void) {
+    ESP_LOGI(TAG, "Testing storage compression");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_compression(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_torn_tail_recovery(void) {
+    ESP_LOGI(TAG, "Testing storage recovery");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_recovery(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_catalog_listing(void) {
+    ESP_LOGI(TAG, "Testing storage file list");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_file_list(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_spill_tier(void) {
+    ESP_LOGI(TAG, "Testing storage spill tier");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_spill(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_event_priority(void) {
+    ESP_LOGI(TAG, "Testing storage write priorities");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_priority(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_rollup_tiers(void) {
+    ESP_LOGI(TAG, "Testing storage rollup tiers");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_rollup(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_sd_card_health(void) {
+    ESP_LOGI(TAG, "Testing SD card health metrics");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_card_health(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_per_source_streams(void) {
+    ESP_LOGI(TAG, "Testing per-source storage streams");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_streams(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_integrity_scrub(void) {
+    ESP_LOGI(TAG, "Testing stored log integrity scrub");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_scrub(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_text_export(void) {
+    ESP_LOGI(TAG, "Testing CSV/NDJSON log export");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_export(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_session_manifest(void) {
+    ESP_LOGI(TAG, "Testing session file names and clock anchors");
+    
+    test_result_t result;
+    esp_err_t ret = test_storage_session(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_storage_benchmark(void) {
+    ESP_LOGI(TAG, "Testing SD card benchmark");
+    
+    test_result_t result;
+    esp_err_t ret = test_performance_storage_speed(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}
+
+void test_spi_bus_arbitration(void) {
+    ESP_LOGI(TAG, "Testing shared SPI bus arbitration");
+    
+    test_result_t result;
+    esp_err_t ret = test_spi_bus_sharing(&result);
+    TEST_ASSERT_EQUAL(ESP_OK, ret);
+    TEST_ASSERT_TRUE(result.passed);
+}